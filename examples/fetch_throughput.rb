@@ -0,0 +1,67 @@
+#!/usr/bin/env ruby
+
+require 'rubygems'
+require_gem 'ibruby'
+require 'benchmark'
+
+include IBRuby
+
+# Database details constants.
+DB_FILE      = "localhost:#{File.expand_path('.')}#{File::SEPARATOR}throughput.ib"
+DB_USER_NAME = "sysdba"
+DB_PASSWORD  = "masterkey"
+
+# Benchmark settings.
+ROW_COUNT     = (ARGV[0] || 100000).to_i
+PREFETCH_ROWS = (ARGV[1] || 256).to_i
+
+# SQL constants.
+CREATE_TABLE_SQL = 'CREATE TABLE THROUGHPUT (TESTID INTEGER NOT NULL PRIMARY '\
+                   'KEY, TESTTEXT VARCHAR(100), TESTFLOAT NUMERIC(10,2), '\
+                   'CREATED TIMESTAMP)'
+INSERT_SQL       = 'INSERT INTO THROUGHPUT VALUES(?, ?, ?, ?)'
+SELECT_SQL       = 'SELECT * FROM THROUGHPUT'
+
+begin
+   # Create a fresh database for the benchmark.
+   db = Database.new(DB_FILE)
+   db.drop(DB_USER_NAME, DB_PASSWORD) if File.exist?(DB_FILE.sub(/^localhost:/, ''))
+   db = Database.create(DB_FILE, DB_USER_NAME, DB_PASSWORD, 4096, 'ASCII')
+
+   db.connect(DB_USER_NAME, DB_PASSWORD) do |cxn|
+      cxn.execute_immediate(CREATE_TABLE_SQL)
+
+      # Populate the table.
+      cxn.start_transaction do |tx|
+         s = Statement.new(cxn, tx, INSERT_SQL, 3)
+         1.upto(ROW_COUNT) do |number|
+            s.execute_for([number, "Number is #{number}.", number / 100.0,
+                           Time.new])
+         end
+         s.close
+      end
+
+      # Time iteration of the table with and without prefetching.
+      puts "Fetching #{ROW_COUNT} rows, prefetch of #{PREFETCH_ROWS} rows."
+      Benchmark.bm(10) do |report|
+         report.report('plain:') do
+            cxn.start_transaction do |tx|
+               rows = ResultSet.new(cxn, tx, SELECT_SQL, 3)
+               rows.each {|row| row[1]}
+               rows.close
+            end
+         end
+
+         report.report('prefetch:') do
+            cxn.start_transaction do |tx|
+               rows = ResultSet.new(cxn, tx, SELECT_SQL, 3)
+               rows.prefetch(PREFETCH_ROWS).each {|row| row[1]}
+               rows.close
+            end
+         end
+      end
+   end
+   db.drop(DB_USER_NAME, DB_PASSWORD)
+rescue Exception => error
+   puts error.message
+end
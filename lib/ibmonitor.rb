@@ -0,0 +1,220 @@
+#-------------------------------------------------------------------------------
+# ibmonitor.rb
+#-------------------------------------------------------------------------------
+# Copyright © Peter Wood, 2005
+#
+# The contents of this file are subject to the Mozilla Public License Version
+# 1.1 (the "License"); you may not use this file except in compliance with the
+# License. You may obtain a copy of the License at
+#
+# http://www.mozilla.org/MPL/
+#
+# Software distributed under the License is distributed on an "AS IS" basis,
+# WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+# the specificlanguage governing rights and  limitations under the License.
+#
+# The Original Code is the FireRuby extension for the Ruby language.
+#
+# The Initial Developer of the Original Code is Peter Wood. All Rights
+# Reserved.
+
+module IBRuby
+  #
+  # This class holds the contents of the Firebird monitoring tables as seen
+  # at a single point in time. Firebird fills the MON$ tables once for each
+  # transaction that reads them, so all of the tables are read in the same
+  # read only transaction to make sure that they agree with each other. Each
+  # row is decoded into a Struct, taking the column values by position, so
+  # the members are listed in the order that the columns are selected. The
+  # monitoring tables are only available with Firebird 2.1 or later.
+  #
+  class MonitorSnapshot
+    # The MON$STATE value for an active attachment, transaction or statement.
+    ACTIVE = 1
+
+    # The MON$STAT_GROUP values used by the MON$IO_STATS and MON$RECORD_STATS
+    # tables.
+    STAT_DATABASE    = 0
+    STAT_ATTACHMENT  = 1
+    STAT_TRANSACTION = 2
+    STAT_STATEMENT   = 3
+    STAT_CALL        = 4
+
+    Attachment  = Struct.new(:id, :server_pid, :state, :name, :user, :role,
+                             :remote_protocol, :remote_address, :remote_pid,
+                             :character_set_id, :timestamp,
+                             :garbage_collection, :stat_id)
+    Transaction = Struct.new(:id, :attachment_id, :state, :timestamp,
+                             :top_transaction, :oldest_transaction,
+                             :oldest_active, :isolation_mode, :lock_timeout,
+                             :read_only, :auto_commit, :auto_undo, :stat_id)
+    Statement   = Struct.new(:id, :attachment_id, :transaction_id, :state,
+                             :timestamp, :sql_text, :stat_id)
+    IOStats     = Struct.new(:stat_id, :group, :reads, :writes, :fetches,
+                             :marks)
+    RecordStats = Struct.new(:stat_id, :group, :sequential_reads,
+                             :indexed_reads, :inserts, :updates, :deletes,
+                             :backouts, :purges, :expunges)
+
+    ATTACHMENTS_SQL  = 'select MON$ATTACHMENT_ID, MON$SERVER_PID, MON$STATE, '\
+                       'MON$ATTACHMENT_NAME, MON$USER, MON$ROLE, '\
+                       'MON$REMOTE_PROTOCOL, MON$REMOTE_ADDRESS, '\
+                       'MON$REMOTE_PID, MON$CHARACTER_SET_ID, MON$TIMESTAMP, '\
+                       'MON$GARBAGE_COLLECTION, MON$STAT_ID '\
+                       'from MON$ATTACHMENTS'
+    TRANSACTIONS_SQL = 'select MON$TRANSACTION_ID, MON$ATTACHMENT_ID, '\
+                       'MON$STATE, MON$TIMESTAMP, MON$TOP_TRANSACTION, '\
+                       'MON$OLDEST_TRANSACTION, MON$OLDEST_ACTIVE, '\
+                       'MON$ISOLATION_MODE, MON$LOCK_TIMEOUT, MON$READ_ONLY, '\
+                       'MON$AUTO_COMMIT, MON$AUTO_UNDO, MON$STAT_ID '\
+                       'from MON$TRANSACTIONS'
+    STATEMENTS_SQL   = 'select MON$STATEMENT_ID, MON$ATTACHMENT_ID, '\
+                       'MON$TRANSACTION_ID, MON$STATE, MON$TIMESTAMP, '\
+                       'MON$SQL_TEXT, MON$STAT_ID from MON$STATEMENTS'
+    IO_STATS_SQL     = 'select MON$STAT_ID, MON$STAT_GROUP, MON$PAGE_READS, '\
+                       'MON$PAGE_WRITES, MON$PAGE_FETCHES, MON$PAGE_MARKS '\
+                       'from MON$IO_STATS'
+    RECORD_STATS_SQL = 'select MON$STAT_ID, MON$STAT_GROUP, '\
+                       'MON$RECORD_SEQ_READS, MON$RECORD_IDX_READS, '\
+                       'MON$RECORD_INSERTS, MON$RECORD_UPDATES, '\
+                       'MON$RECORD_DELETES, MON$RECORD_BACKOUTS, '\
+                       'MON$RECORD_PURGES, MON$RECORD_EXPUNGES '\
+                       'from MON$RECORD_STATS'
+    TIMESTAMP_SQL    = 'select CURRENT_TIMESTAMP from RDB$DATABASE'
+
+    attr_reader :taken_at, :attachments, :transactions, :statements,
+                :io_stats, :record_stats
+
+    #
+    # This is the constructor for the MonitorSnapshot class. It is normally
+    # called through Connection#monitor_snapshot.
+    #
+    # ==== Parameters
+    # connection::  The Connection to read the monitoring tables through.
+    #
+    # ==== Exceptions
+    # IBRubyException::  Generated whenever the monitoring tables cannot be
+    #                    read.
+    #
+    def initialize(connection)
+      options = TransactionOptions.new(:isolation => :concurrency,
+                                       :read_only => true)
+      transaction = connection.start_transaction(options)
+      begin
+        transaction.execute(TIMESTAMP_SQL) {|row| @taken_at = row[0]}
+        @attachments  = load(transaction, ATTACHMENTS_SQL, Attachment)
+        @transactions = load(transaction, TRANSACTIONS_SQL, Transaction)
+        @statements   = load(transaction, STATEMENTS_SQL, Statement)
+        @io_stats     = index(load(transaction, IO_STATS_SQL, IOStats))
+        @record_stats = index(load(transaction, RECORD_STATS_SQL, RecordStats))
+      ensure
+        transaction.rollback if transaction.active?
+      end
+    end
+
+    #
+    # This method fetches the active transaction with the lowest id, which
+    # is the one holding back garbage collection, or nil if there are no
+    # active transactions.
+    #
+    def oldest_active_transaction
+      active = @transactions.select {|entry| entry.state == ACTIVE}
+      active.min {|first, second| first.id <=> second.id}
+    end
+
+    #
+    # This method fetches the active statements that have been running the
+    # longest, longest first.
+    #
+    # ==== Parameters
+    # limit::  The maximum number of statements to return. Defaults to 10.
+    #
+    def longest_running_statements(limit=10)
+      active = @statements.select {|entry| entry.state == ACTIVE}
+      active = active.sort_by {|entry| entry.timestamp}
+      active.first(limit)
+    end
+
+    #
+    # This method fetches the number of seconds, as seen by the server, that
+    # an attachment, transaction or statement taken from the snapshot has
+    # existed for.
+    #
+    def age(entry)
+      @taken_at - entry.timestamp
+    end
+
+    #
+    # This method fetches the attachment that a transaction or statement
+    # taken from the snapshot belongs to.
+    #
+    def attachment_for(entry)
+      @attachments.find {|attachment| attachment.id == entry.attachment_id}
+    end
+
+    #
+    # This method fetches the statements running under a transaction taken
+    # from the snapshot.
+    #
+    def statements_for(transaction)
+      @statements.select {|entry| entry.transaction_id == transaction.id}
+    end
+
+    #
+    # This method fetches the page I/O counts for an attachment, transaction
+    # or statement taken from the snapshot, or nil if there are none.
+    #
+    def io_stats_for(entry)
+      @io_stats[entry.stat_id]
+    end
+
+    #
+    # This method fetches the record operation counts for an attachment,
+    # transaction or statement taken from the snapshot, or nil if there are
+    # none.
+    #
+    def record_stats_for(entry)
+      @record_stats[entry.stat_id]
+    end
+
+    private
+
+    def load(transaction, sql, type)
+      entries = []
+      transaction.execute(sql) do |row|
+        values = row.values
+        values.each_with_index do |value, position|
+          if value.kind_of?(String)
+            values[position] = value.strip
+          elsif value.kind_of?(Blob)
+            values[position] = value.to_s
+            value.close
+          end
+        end
+        entries << type.new(*values)
+      end
+      entries
+    end
+
+    def index(entries)
+      table = {}
+      entries.each {|entry| table[entry.stat_id] = entry}
+      table
+    end
+  end
+
+
+  class Connection
+    #
+    # This method reads the Firebird monitoring tables through the
+    # connection. See the MonitorSnapshot class for details.
+    #
+    # ==== Exceptions
+    # IBRubyException::  Generated whenever the monitoring tables cannot be
+    #                    read.
+    #
+    def monitor_snapshot
+      MonitorSnapshot.new(self)
+    end
+  end
+end
@@ -20,3 +20,4 @@
 
 require 'ib_lib'
 require 'ibmeta'
+require 'ibmonitor'
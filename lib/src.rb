@@ -10,6 +10,54 @@
 # IBRuby extension for the Ruby language.
 #
 module IBRuby
+   #
+   # This function fetches the settings hash for the current Ractor. In the
+   # main Ractor this is the hash held by $IBRubySettings. Global variables
+   # cannot be used from other Ractors, so each of those gets its own copy of
+   # the default settings, which can be changed without affecting any other
+   # Ractor. The library may be used from any Ractor. Connections and the
+   # objects created through them cannot be copied or moved between Ractors
+   # and so stay with the Ractor that created them.
+   #
+   def IBRuby.settings
+   end
+   
+   
+   #
+   # This function runs a set of independent statements at the same time,
+   # spread across several connections. The block is passed a QueryBatch to
+   # add the statements to. The statements are then shared out in turn
+   # between the connections. Each connection runs its share, in the order
+   # added, inside a transaction of its own on a native thread. The Ruby
+   # interpreter lock is released while they run, so the call takes about as
+   # long as the slowest connection rather than the sum of all statements.
+   # The transactions are committed once every statement has run. If any
+   # statement fails they are all rolled back and the first failure, in the
+   # order the statements were added, is raised. The connections must not be
+   # used by other threads during the call.
+   #
+   # Query rows are fetched in full before they are converted. Blob values
+   # are read through the transaction that fetched them, so they should be
+   # avoided in parallel queries.
+   #
+   # ==== Parameters
+   # connections::  An Array of open Connection objects, or a single
+   #                Connection.
+   #
+   # ==== Returns
+   # An Array holding one entry per statement, in the order they were added.
+   # A query gives an Array of rows, each an Array of column values. Any
+   # other statement gives the number of rows it affected.
+   #
+   # ==== Exceptions
+   # IBRubyException::  Generated whenever an invalid or closed connection
+   #                    is given or a statement fails.
+   #
+   def IBRuby.parallel(connections)
+      yield batch
+   end
+   
+   
    #
    # This class provides the exception type used by the IBRuby library.
    #
@@ -25,7 +73,10 @@ module IBRuby
 
 
       #
-      #  This is the accessor for the error message attribute
+      # This is the accessor for the error message attribute. For errors
+      # raised by the library the message is decoded from the database status
+      # details the first time it is asked for, so errors that are rescued
+      # and handled without reading it cost less.
       #
       def message
       end
@@ -45,6 +96,24 @@ module IBRuby
       end
       
       
+      #
+      # This method returns an Array of the error codes from the status
+      # vector the exception was raised for, in the order the database
+      # reported them. The first entry matches db_code.
+      #
+      def gds_codes
+      end
+      
+      
+      #
+      # This method returns true if the exception reports a lock conflict,
+      # update conflict, lock timeout or deadlock, errors that a fresh
+      # attempt at the transaction may avoid.
+      #
+      def retryable?
+      end
+      
+      
       #
       # This function generates a simple description string for a IBRubyError
       # object.
@@ -54,6 +123,21 @@ module IBRuby
    end
    
    
+   #
+   # This class is raised for lock conflicts, update conflicts and lock wait
+   # timeouts. These are retryable, see Connection#with_retry.
+   #
+   class ConflictError < IBRubyException
+   end
+   
+   
+   #
+   # This class is raised for deadlocks.
+   #
+   class DeadlockError < ConflictError
+   end
+   
+   
    #
    # This class represents an existing database that can be connected to. It
    # also provides functionality to allow for the creation of new databases.
@@ -169,6 +253,23 @@ module IBRuby
       #
       def character_set=(set)
       end
+
+
+      #
+      # This method fetches the transaction markers for the database, opening
+      # a connection for the purpose and closing it again afterwards. See
+      # Connection#transaction_markers for details.
+      #
+      # ==== Parameters
+      # user::      The user name to connect with.
+      # password::  The password to connect with.
+      #
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever the connection cannot be made
+      #                    or the markers cannot be fetched.
+      #
+      def transaction_markers(user=nil, password=nil)
+      end
    end
    
    
@@ -308,10 +409,15 @@ module IBRuby
       # block completes normally or rolls back if an exception is thrown from
       # the block.
       #
+      # ==== Parameters
+      # options::  A TransactionOptions object giving the settings for the
+      #            transaction. Defaults to nil, which uses the standard
+      #            settings.
+      #
       # ==== Exceptions
       # Exception::  Thrown whenever a problem occurs starting the transaction.
       #
-      def start_transaction
+      def start_transaction(options=nil)
          yield transaction
       end
       
@@ -345,6 +451,20 @@ module IBRuby
       # takes a single parameter. This block will be executed once for each
       # row in any result set generated.
       #
+      # Assign true to $IBRubySettings[:SHARED_READ_TRANSACTION] to have
+      # queries (SELECT and WITH statements that don't mention UPDATE or LOCK
+      # outside of quotes and comments) executed within a long lived, read
+      # only, read committed transaction that is shared by all such calls on
+      # the connection, saving the start and commit of a transaction for each
+      # one. Don't turn it on where queries select from procedures that change
+      # data. This transaction is committed with retained context after the
+      # number of statements given by the
+      # $IBRubySettings[:READ_TRANSACTION_STATEMENTS] setting or the number of
+      # seconds given by the $IBRubySettings[:READ_TRANSACTION_SECONDS]
+      # setting, whichever comes first. It is committed when the connection is
+      # closed or a DDL statement is executed through this method, after which
+      # result sets still open on it can no longer be read.
+      #
       # ==== Parameters
       # sql::  The SQL statement to be executed.
       #
@@ -355,1205 +475,2542 @@ module IBRuby
       def execute_immediate(sql)
          yield(row)
       end
-   end
-   
-   
-   #
-   # This class represents an InterBase database transaction. There may be
-   # multiple transaction outstanding against a connection at any one time.
-   #
-   class Transaction
-      TPB_VERSION_1          = 1
-      TPB_VERSION_3          = 3
-      TPB_CONSISTENCY        = 1
-      TPB_CONCURRENCY        = 2
-      TPB_SHARED             = 3
-      TPB_PROTECTED          = 4
-      TPB_EXCLUSIVE          = 5
-      TPB_WAIT               = 6
-      TPB_NO_WAIT            = 7
-      TPB_READ               = 8
-      TPB_WRITE              = 9
-      TPB_LOCK_READ          = 10
-      TPB_LOCK_WRITE         = 11
-      TPB_VERB_TIME          = 12
-      TPB_COMMIT_TIME        = 13
-      TPB_IGNORE_LIMBO       = 14
-      TPB_READ_COMMITTED     = 15
-      TPB_AUTO_COMMIT        = 16
-      TPB_REC_VERSION        = 17
-      TPB_NO_REC_VERSION     = 18
-      TPB_RESTART_REQUESTS   = 19
-      # Transaction parameter buffer value constants.
-      TPB_NO_AUTO_UNDO       = 20
-
+      
       
       #
-      # This is the constructor for the Transaction class.
+      # This method returns the number of seconds that statements executed on
+      # the connection are allowed to run for, or nil if there is no limit.
+      #
+      def statement_timeout
+      end
+      
+      
+      #
+      # This method sets the number of seconds that statements executed on
+      # the connection are allowed to run for. A statement that runs for
+      # longer is cancelled and raises an exception. Firebird 4 and later
+      # client libraries apply the timeout on the server. Firebird 2.5 and 3
+      # client libraries cancel the statement from a separate thread, which
+      # covers executing the statement but not fetching its rows.
       #
       # ==== Parameters
-      # connections::  Either a single instance of the Connection class or
-      #                an array of Connection instances to specify a
-      #                multi-database transaction.
+      # seconds::  The number of seconds, which may be fractional. Pass nil
+      #            or zero to remove the limit.
       #
       # ==== Exceptions
-      # Exception::  Generated whenever the method is passed an invalid
-      #              parameter or a problem occurs creating the transaction.
+      # IBRubyError::  Generated whenever a timeout is set and the client
+      #                library does not support cancelling statements.
       #
-      def initialize(connections)
+      def statement_timeout=(seconds)
       end
       
       
       #
-      # This method is used to determine whether a Transaction object is still
-      # valid for use (i.e. commit or rollback has not been called for the
-      # Transaction).
+      # This method cancels the operation running on a connection. It is
+      # intended to be called from a thread other than the one running the
+      # operation, which will see an exception raised. A thread executing a
+      # statement is also cancelled in this way when it is interrupted, for
+      # example with Thread#raise. Requires a Firebird 2.5 or later client
+      # library.
       #
-      def active?
+      # ==== Exceptions
+      # IBRubyError::  Generated whenever the connection is closed, the
+      #                cancel fails or the client library does not support
+      #                cancellation.
+      #
+      def cancel
       end
       
       
       #
-      # This is the accessor for the connections attribute. This method returns
-      # an array of the connections that the transaction applies to.
+      # This method starts a transaction on the connection and passes it to
+      # a block, committing it once the block completes. If the block or the
+      # commit raises a ConflictError, the transaction is rolled back and
+      # the block is run again in a new transaction. Before each retry the
+      # method pauses, and the pause doubles each time. Any other exception
+      # rolls the transaction back and is passed on, as is the last
+      # ConflictError once all attempts are used. The block must be safe to
+      # run more than once.
       #
-      def connections
+      # ==== Parameters
+      # options::  A Hash that may contain :attempts (the total number of
+      #            attempts, default 3), :backoff (the first pause in seconds,
+      #            default 0.05) and :options (a TransactionOptions object
+      #            used for each transaction).
+      #
+      # ==== Returns
+      # The value returned by the block.
+      #
+      def with_retry(options={})
+         yield transaction
       end
       
       
       #
-      # This method is used to determine whether a given Transaction applies to
-      # a specified Connection.
+      # This method starts listening for database events, as posted with the
+      # POST_EVENT statement. The block is called with the event name and the
+      # number of times it was posted each time a transaction posting one of
+      # the events commits. Any number of names may be given. The block runs
+      # on a thread started for the listener and exceptions it raises are
+      # reported as warnings. Closing the connection closes its listeners.
       #
       # ==== Parameters
-      # connection::  A reference to the Connection object to perform the test
-      #               for.
+      # names::  The names of the events to listen for, as Strings, Symbols
+      #          or Arrays of either.
       #
-      def for_connection?(connection)
+      # ==== Returns
+      # An EventListener object that can be used to stop listening.
+      #
+      # ==== Exceptions
+      # IBRubyError::  Generated whenever the connection is closed, no names
+      #                or block are given or the events cannot be queued.
+      #
+      def on_event(*names)
+         yield name, count
       end
-
+      
       
       #
-      # This method commits the details outstanding against a Transaction
-      # object. The Transaction object may not be reused after a successful
-      # call to this method.
+      # This method reads every row of a table using several attachments at
+      # once. The range of an integer key column, from its MIN to its MAX
+      # value, is split into equal partitions. Each partition is fetched by a
+      # native thread over its own attachment, opened with the connection's
+      # credentials, inside a read only snapshot transaction. Rows are passed
+      # to the block in batches as soon as they are fetched, so batches from
+      # different partitions arrive interleaved. Each partition has its own
+      # snapshot, so rows changed while the scan starts may be seen by some
+      # partitions and not by others.
+      #
+      # ==== Parameters
+      # table::    The name of the table to be scanned.
+      # options::  A Hash that may contain :key (the integer column to split
+      #            the table on, the table's single column primary key by
+      #            default), :partitions (the number of attachments to use,
+      #            default 4, larger values are reduced to 32) and :batch_size
+      #            (the most rows passed to the block at once, default 1000).
+      #
+      # ==== Returns
+      # The total number of rows passed to the block.
       #
       # ==== Exceptions
-      # Exception::  Generated whenever a problem occurs committing the details
-      #              of the transaction.
+      # IBRubyException::  Generated whenever the connection is closed, the
+      #                    options are invalid, the key is not an integer
+      #                    column or a partition fails.
       #
-      def commit
+      def parallel_scan(table, options={})
+         yield rows
       end
-
+      
       
       #
-      # This method rolls back the details outstanding against a Transaction
-      # object. The Transaction object may not be reused after a successful
-      # call to this method.
+      # This method fetches the I/O and operation counts for the connection,
+      # accumulated since it was opened. The Hash returned contains the page
+      # counts :reads, :writes, :fetches and :marks, and a :tables Hash keyed
+      # on table name. The entry for each table touched holds those of
+      # :sequential_reads, :indexed_reads, :inserts, :updates, :deletes,
+      # :backouts, :purges and :expunges that are non-zero. A large number of
+      # sequential reads on a table points to a full table scan.
       #
       # ==== Exceptions
-      # Exception::  Generated whenever a problem occurs rolling back the
-      #              details of the transaction.
+      # IBRubyException::  Generated whenever the connection is closed or the
+      #                    counts cannot be fetched.
       #
-      def rollback
+      def io_stats
       end
       
       
       #
-      # This method executes a SQL statement using a Transaction object. This
-      # method will only work whenever a Transaction object applies to a
-      # single Connection as it would otherwise be impossible to determine
-      # which connection to execute against. If the statement executed was a
-      # SQL query then the method returns a ResultSet object. For non-query SQL
-      # statements (insert, update or delete) the method returns an Integer that
-      # contains the number of rows affected by the statement. For all other
-      # statements the method returns nil. The method  also accepts a block that
-      # takes a single parameter. If the SQL statement was a query the block
-      # will be invoked and passed each row retrieved.
-      #
-      # ==== Parameters
-      # sql::  A string containing the SQL statement to be executed.
+      # This method runs a block and returns the change in the I/O and
+      # operation counts of the connection while it ran, laid out as for the
+      # io_stats method. Only the tables with counts that changed are
+      # included. Work done by other threads on the same connection while the
+      # block runs is counted too.
       #
       # ==== Exceptions
-      # Exception::  Generated whenever the Transaction object represents more
-      #              than one connection or a problem occurs executing the SQL
-      #              statement.
+      # IBRubyException::  Generated whenever no block is given, the
+      #                    connection is closed or the counts cannot be
+      #                    fetched.
       #
-      def execute(sql)
-         yield(row)
+      def measure
+         yield connection
       end
       
       
       #
-      # This method allows for the creation of a Transaction object with
-      # non-standard settings.
+      # This method fetches the plan the optimizer would use for a SQL
+      # statement. The statement is prepared, in a transaction that is rolled
+      # back afterwards, but is not executed.
       #
       # ==== Parameters
-      # connections::  Either a single Connection object or an array of
-      #                Connection objects that the new Transaction will
-      #                be associated with.
-      # parameters::   An array of the parameters to be used in creating
-      #                the new constants. Populate this from the TPB
-      #                constants defined within the class.
+      # sql::  A String containing the SQL statement to be explained.
+      #
+      # ==== Returns
+      # A String containing the plan, or nil if the statement has no plan.
       #
       # ==== Exceptions
-      # IBRubyError::  Generated whenever a problem occurs creating the
-      #                  transaction.
+      # IBRubyException::  Generated whenever the statement cannot be
+      #                    prepared.
       #
-      def Transaction.create(connections, parameters)
+      def explain(sql)
+      end
+
+
+      #
+      # This method fetches the transaction markers for the database the
+      # connection is attached to. The returned Hash holds the oldest
+      # interesting transaction (:oldest_transaction), the oldest active
+      # transaction (:oldest_active), the oldest snapshot (:oldest_snapshot)
+      # and the number the next transaction will get (:next_transaction).
+      # Record versions created since the oldest snapshot cannot be garbage
+      # collected, so a large gap between the next transaction and the
+      # oldest active one points to a transaction that has been left open.
+      #
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever the connection is closed or the
+      #                    markers cannot be fetched.
+      #
+      def transaction_markers
       end
    end
    
    
    #
-   # This class  represents a prepared SQL statement that may be executed more
-   # than once.
+   # This class represents a set of database events being listened for on a
+   # Connection. The database notifies the client library, which records the
+   # event counts and wakes the listener thread without needing the Ruby
+   # interpreter lock. The listener thread calls the block and then asks the
+   # database for the next notification. Names are queued with the database
+   # in groups of up to fifteen.
    #
-   class Statement
-      # A definition for a SQL statement type constant.
-      SELECT_STATEMENT            = 1
-      
-      # A definition for a SQL statement type constant.
-      INSERT_STATEMENT            = 2
-      
-      # A definition for a SQL statement type constant.
-      UPDATE_STATEMENT            = 3
-      
-      # A definition for a SQL statement type constant.
-      DELETE_STATEMENT            = 4
-      
-      # A definition for a SQL statement type constant.
-      DDL_STATEMENT               = 5
-      
-      # A definition for a SQL statement type constant.
-      GET_SEGMENT_STATEMENT       = 6
-      
-      # A definition for a SQL statement type constant.
-      PUT_SEGMENT_STATEMENT       = 7
-      
-      # A definition for a SQL statement type constant.
-      EXECUTE_PROCEDURE_STATEMENT = 8
-      
-      # A definition for a SQL statement type constant.
-      START_TRANSACTION_STATEMENT = 9
-      
-      # A definition for a SQL statement type constant.
-      COMMIT_STATEMENT            = 10
-      
-      # A definition for a SQL statement type constant.
-      ROLLBACK_STATEMENT          = 11
-      
-      # A definition for a SQL statement type constant.
-      SELECT_FOR_UPDATE_STATEMENT = 12
-      
-      # A definition for a SQL statement type constant.
-      SET_GENERATOR_STATEMENT     = 13
-      
-      # A definition for a SQL statement type constant.
-      SAVE_POINT_STATEMENT        = 14
-      
+   class EventListener
       #
-      # This is the constructor for the Statement class.
+      # This is the constructor for the EventListener class. It is normally
+      # called through Connection#on_event.
       #
       # ==== Parameters
-      # connection::   The Connection object that the SQL statement will be
-      #                executed through.
-      # transaction::  The Transaction object that the SQL statement will be
-      #                executed under.
-      # sql::          The SQL statement to be prepared for execution.
-      # dialect::      The InterBase dialect to be used in preparing the SQL
-      #                statement.
+      # connection::  The Connection to listen on.
+      # names::       The names of the events to listen for.
       #
-      def initialize(connection, transaction, sql, dialect)
+      def initialize(connection, *names)
+         yield name, count
       end
       
       
       #
-      # This is the accessor for the connection attribute.
+      # This method fetches the Connection that the listener is using.
       #
       def connection
       end
       
       
       #
-      # This is the accessor for the transaction attribute.
+      # This method fetches an Array of the event names being listened for.
       #
-      def transaction
+      def names
       end
       
       
       #
-      # This is the accessor for the SQL statement attribute.
+      # This method returns true while the listener is receiving events.
       #
-      def sql
+      def active?
       end
       
       
       #
-      # This is the accessor for the dialect attribute.
+      # This method stops the listener. Unless it is called from the listener
+      # block, it waits for the listener thread to finish.
       #
-      def dialect
+      def close
       end
-      
-      
+   end
+   
+   
+   #
+   # This class watches the gap between the next transaction number of a
+   # database and one of its older transaction markers. A background thread
+   # fetches the markers at a set interval, over a connection of its own, and
+   # calls the block when the gap reaches the threshold. The block is not
+   # called again until the gap has fallen back below the threshold. The
+   # block is passed the gap, the Hash of markers and an Array of the active
+   # Transaction objects created by the current Ractor, as returned by
+   # Transaction.longest_active. The Transaction#id of the first of these
+   # can be compared with the :oldest_active marker to see whether the
+   # transaction holding back garbage collection belongs to this process.
+   #
+   class GapMonitor
       #
-      # This method is used to determine the type of a SQL statement. The method
-      # will return one of the constant SQL types defined within the class.
+      # This is the constructor for the GapMonitor class.
       #
-      def type
-      end
-      
-      
+      # ==== Parameters
+      # database::  The Database to monitor.
+      # user::      The user name to connect with.
+      # password::  The password to connect with.
+      # options::   A Hash of options. Recognised keys are :interval (the
+      #             number of seconds between samples, defaults to 60),
+      #             :threshold (the gap at which the block is called,
+      #             defaults to 10000) and :from (the marker the gap is
+      #             measured from, one of :oldest_active, the default,
+      #             :oldest_snapshot or :oldest_transaction).
       #
-      # This method fetches a count of the number of dynamic parameters for
-      # a statement object (i.e. the number of parameters that must be provided
-      # with values before the SQL statement can be executed).
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever no block is given or an option
+      #                    is invalid.
       #
-      def parameter_count
+      def initialize(database, user, password, options={})
+         yield gap, markers, transactions
       end
-      
-      
+
+
       #
-      # This method executes the SQL statement within a Statement object. This
-      # method returns a ResultSet object if the statement executed was a SQL
-      # query. For non-query SQL statements (insert, update or delete) it
+      # This method fetches the Database being monitored.
+      #
+      def database
+      end
+
+
+      #
+      # This method fetches the number of seconds between samples.
+      #
+      def interval
+      end
+
+
+      #
+      # This method fetches the gap at which the block is called.
+      #
+      def threshold
+      end
+
+
+      #
+      # This method fetches the Hash of markers from the last sample, or nil
+      # if no sample has been taken yet.
+      #
+      def markers
+      end
+
+
+      #
+      # This method fetches the gap found by the last sample, or nil if no
+      # sample has been taken yet.
+      #
+      def gap
+      end
+
+
+      #
+      # This method fetches the exception raised by the last sample, or nil
+      # if it succeeded. A sample that fails drops the connection so that the
+      # next one connects again.
+      #
+      def error
+      end
+
+
+      #
+      # This method returns true while the monitor is sampling.
+      #
+      def active?
+      end
+
+
+      #
+      # This method stops the monitor and closes its connection. Unless it
+      # is called from the monitor block, it waits for the monitor thread to
+      # finish.
+      #
+      def stop
+      end
+   end
+   
+   
+   #
+   # This class collects the statements to be run by IBRuby.parallel.
+   #
+   class QueryBatch
+      #
+      # This method adds a statement to the batch.
+      #
+      # ==== Parameters
+      # sql::         The SQL text of the statement.
+      # parameters::  An Array of values for the statement parameters, or nil
+      #               if it has none.
+      #
+      def add(sql, parameters=nil)
+      end
+      
+      
+      #
+      # This method fetches the number of statements added to the batch.
+      #
+      def size
+      end
+   end
+   
+   
+   #
+   # This class manages a set of Connection objects to a single database that
+   # can be shared between threads. Connections are checked out for use and
+   # checked back in afterwards, new connections being opened on demand up
+   # to the pool maximum. Once the maximum is reached callers wait, up to the
+   # pool timeout, for a connection to be checked in. The attachments opened
+   # when the pool is created are made in parallel. Where the interpreter
+   # allows it, waiting callers and attachments being opened don't hold up
+   # other Ruby threads.
+   #
+   class ConnectionPool
+      #
+      # This is the constructor for the ConnectionPool class. The minimum
+      # number of connections are opened before the constructor returns.
+      #
+      # ==== Parameters
+      # database::  A reference to the Database that the pool connects to.
+      # user::      The user name to be used in making connections.
+      # password::  The password to be used in making connections.
+      # options::   A Hash of connection options, as accepted by
+      #             Database#connect. May be nil.
+      # settings::  A Hash of pool settings. Recognised keys are :min (the
+      #             number of connections kept open, default 1), :max (the
+      #             most connections opened, default 10), :timeout (the number
+      #             of seconds to wait for a connection, default 5),
+      #             :max_waiting (the most callers allowed to wait at once,
+      #             default 100), :idle_timeout (the number of seconds after
+      #             which an idle connection above the minimum is closed,
+      #             default 300, 0 to never close) and :check_after (the
+      #             number of seconds a connection must have been idle before
+      #             it is checked with the server when checked out, default
+      #             30, -1 to never check).
+      #
+      # ==== Exceptions
+      # IBRubyError::  Generated whenever the settings are invalid or the
+      #                initial connections cannot be opened.
+      #
+      def initialize(database, user, password, options=nil, settings=nil)
+      end
+      
+      
+      #
+      # This method takes a Connection from the pool. Connections that fail
+      # their health check are closed and replaced.
+      #
+      # ==== Exceptions
+      # IBRubyError::  Generated whenever no connection becomes available
+      #                within the pool timeout, the wait queue is full, the
+      #                pool has been shut down or a new connection cannot be
+      #                opened.
+      #
+      def checkout
+      end
+      
+      
+      #
+      # This method returns a Connection to the pool. Any transactions left
+      # active on the connection are rolled back. A connection that has been
+      # closed is simply removed from the pool.
+      #
+      # ==== Parameters
+      # connection::  The Connection being returned. This must have been
+      #               obtained from the pool with checkout.
+      #
+      def checkin(connection)
+      end
+      
+      
+      #
+      # This method checks a Connection out of the pool, passes it to a block
+      # and checks it back in when the block completes, even if the block
+      # raises an exception.
+      #
+      # ==== Returns
+      # The value returned by the block.
+      #
+      def connection
+         yield(connection)
+      end
+      
+      
+      #
+      # This method closes connections that have been idle for longer than the
+      # pool :idle_timeout setting, keeping at least the pool minimum open.
+      # This is also done each time a connection is checked in.
+      #
+      # ==== Returns
+      # A count of the connections closed.
+      #
+      def reap
+      end
+      
+      
+      #
+      # This method closes the idle connections in the pool and stops any
+      # further check outs. Connections currently checked out are closed when
+      # they are checked in.
+      #
+      def shutdown
+      end
+      
+      
+      #
+      # This method returns the number of connections open in the pool,
+      # including those checked out.
+      #
+      def size
+      end
+      
+      
+      #
+      # This method returns a Hash of pool usage figures for capacity
+      # planning. The keys are :size, :idle, :in_use, :waiting (callers
+      # waiting now), :waits (callers that have had to wait), :wait_time (the
+      # total seconds spent waiting), :timeouts, :creations, :destructions and
+      # :health_failures.
+      #
+      def statistics
+      end
+   end
+   
+   
+   #
+   # This class represents an InterBase database transaction. There may be
+   # multiple transaction outstanding against a connection at any one time.
+   #
+   class Transaction
+      TPB_VERSION_1          = 1
+      TPB_VERSION_3          = 3
+      TPB_CONSISTENCY        = 1
+      TPB_CONCURRENCY        = 2
+      TPB_SHARED             = 3
+      TPB_PROTECTED          = 4
+      TPB_EXCLUSIVE          = 5
+      TPB_WAIT               = 6
+      TPB_NO_WAIT            = 7
+      TPB_READ               = 8
+      TPB_WRITE              = 9
+      TPB_LOCK_READ          = 10
+      TPB_LOCK_WRITE         = 11
+      TPB_VERB_TIME          = 12
+      TPB_COMMIT_TIME        = 13
+      TPB_IGNORE_LIMBO       = 14
+      TPB_READ_COMMITTED     = 15
+      TPB_AUTO_COMMIT        = 16
+      TPB_REC_VERSION        = 17
+      TPB_NO_REC_VERSION     = 18
+      TPB_RESTART_REQUESTS   = 19
+      # Transaction parameter buffer value constants.
+      TPB_NO_AUTO_UNDO       = 20
+
+      
+      #
+      # This is the constructor for the Transaction class.
+      #
+      # ==== Parameters
+      # connections::  Either a single instance of the Connection class or
+      #                an array of Connection instances to specify a
+      #                multi-database transaction.
+      # options::      A TransactionOptions object giving the settings for the
+      #                transaction. Defaults to nil, which uses the standard
+      #                settings.
+      #
+      # ==== Exceptions
+      # Exception::  Generated whenever the method is passed an invalid
+      #              parameter or a problem occurs creating the transaction.
+      #
+      def initialize(connections, options=nil)
+      end
+      
+      
+      #
+      # This method is used to determine whether a Transaction object is still
+      # valid for use (i.e. commit or rollback has not been called for the
+      # Transaction).
+      #
+      def active?
+      end
+      
+      
+      #
+      # This is the accessor for the connections attribute. This method returns
+      # an array of the connections that the transaction applies to.
+      #
+      def connections
+      end
+      
+      
+      #
+      # This method is used to determine whether a given Transaction applies to
+      # a specified Connection.
+      #
+      # ==== Parameters
+      # connection::  A reference to the Connection object to perform the test
+      #               for.
+      #
+      def for_connection?(connection)
+      end
+
+      
+      #
+      # This method commits the details outstanding against a Transaction
+      # object. The Transaction object may not be reused after a successful
+      # call to this method.
+      #
+      # ==== Exceptions
+      # Exception::  Generated whenever a problem occurs committing the details
+      #              of the transaction.
+      #
+      def commit
+      end
+
+      
+      #
+      # This method rolls back the details outstanding against a Transaction
+      # object. The Transaction object may not be reused after a successful
+      # call to this method.
+      #
+      # ==== Exceptions
+      # Exception::  Generated whenever a problem occurs rolling back the
+      #              details of the transaction.
+      #
+      def rollback
+      end
+      
+      
+      #
+      # This method commits the details outstanding against a Transaction
+      # object while leaving the transaction active. Statements and result sets
+      # open under the transaction remain valid after the call.
+      #
+      # ==== Exceptions
+      # Exception::  Generated whenever a problem occurs committing the details
+      #              of the transaction.
+      #
+      def commit_retaining
+      end
+      
+      
+      #
+      # This method rolls back the details outstanding against a Transaction
+      # object while leaving the transaction active. Statements and result sets
+      # open under the transaction remain valid after the call.
+      #
+      # ==== Exceptions
+      # Exception::  Generated whenever a problem occurs rolling back the
+      #              details of the transaction.
+      #
+      def rollback_retaining
+      end
+      
+      
+      #
+      # This method switches on periodic commits for a Transaction object.
+      # Once set, each Statement executed under the transaction counts the
+      # rows it affects and a commit_retaining is performed whenever the total
+      # since the last commit reaches the row limit or the time since the last
+      # commit reaches the seconds limit. This bounds the amount of outstanding
+      # work in long batch loops without closing any open cursors. As a commit
+      # would discard them, periodic commits are held off while savepoints
+      # created with the savepoint method are outstanding.
+      #
+      # ==== Parameters
+      # options::  A Hash that may contain a :rows and a :seconds entry setting
+      #            the limits. Pass nil to switch periodic commits off.
+      #
+      def auto_commit_every(options)
+      end
+      
+      
+      #
+      # This method creates a named savepoint within a Transaction. Work done
+      # after the savepoint can later be undone with rollback_to without
+      # losing anything else done by the transaction. If a block is given it
+      # is executed once the savepoint exists and is passed the Transaction.
+      # When the block completes the savepoint is released, keeping its work.
+      # If the block is left any other way, whether by an exception, a break
+      # or a throw, the work done in the block is rolled back to the savepoint
+      # and the savepoint released before control passes on, leaving the
+      # transaction active, so a batch can skip a bad row and carry on.
+      #
+      # ==== Parameters
+      # name::  A String containing the savepoint name. This must be a plain
+      #         SQL identifier of no more than 31 characters.
+      #
+      # ==== Exceptions
+      # IBRubyError::  Generated whenever the name is invalid, the transaction
+      #                is not active or the database rejects the savepoint.
+      #
+      def savepoint(name)
+      end
+      
+      
+      #
+      # This method releases a savepoint, keeping the work done since it was
+      # created.
+      #
+      # ==== Parameters
+      # name::  A String containing the name of the savepoint to release.
+      #
+      # ==== Exceptions
+      # IBRubyError::  Generated whenever the savepoint cannot be released.
+      #
+      def release_savepoint(name)
+      end
+      
+      
+      #
+      # This method undoes all work done since a savepoint was created. The
+      # savepoint itself remains and may be rolled back to again.
+      #
+      # ==== Parameters
+      # name::  A String containing the name of the savepoint to roll back to.
+      #
+      # ==== Exceptions
+      # IBRubyError::  Generated whenever the roll back fails.
+      #
+      def rollback_to(name)
+      end
+
+
+      #
+      # This method fetches the number the database gave the transaction
+      # when it was started, for comparison with the markers returned by
+      # Connection#transaction_markers. Returns nil if the transaction is not
+      # active.
+      #
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever the number cannot be fetched.
+      #
+      def id
+      end
+
+
+      #
+      # This method fetches a Time for when the transaction was started, or
+      # nil if the transaction is not active.
+      #
+      def started
+      end
+
+
+      #
+      # This method fetches the transactions created by the current Ractor
+      # that are still active, the longest active first. Transactions are
+      # not kept alive by being included in the list.
+      #
+      # ==== Parameters
+      # limit::  The maximum number of transactions to return. Defaults to
+      #          all of them.
+      #
+      def Transaction.longest_active(limit=nil)
+      end
+      
+      
+      #
+      # This method executes a SQL statement using a Transaction object. This
+      # method will only work whenever a Transaction object applies to a
+      # single Connection as it would otherwise be impossible to determine
+      # which connection to execute against. If the statement executed was a
+      # SQL query then the method returns a ResultSet object. For non-query SQL
+      # statements (insert, update or delete) the method returns an Integer that
+      # contains the number of rows affected by the statement. For all other
+      # statements the method returns nil. The method  also accepts a block that
+      # takes a single parameter. If the SQL statement was a query the block
+      # will be invoked and passed each row retrieved.
+      #
+      # ==== Parameters
+      # sql::  A string containing the SQL statement to be executed.
+      #
+      # ==== Exceptions
+      # Exception::  Generated whenever the Transaction object represents more
+      #              than one connection or a problem occurs executing the SQL
+      #              statement.
+      #
+      def execute(sql)
+         yield(row)
+      end
+      
+      
+      #
+      # This method allows for the creation of a Transaction object with
+      # non-standard settings.
+      #
+      # ==== Parameters
+      # connections::  Either a single Connection object or an array of
+      #                Connection objects that the new Transaction will
+      #                be associated with.
+      # parameters::   An array of the parameters to be used in creating
+      #                the new constants. Populate this from the TPB
+      #                constants defined within the class. A
+      #                TransactionOptions object may be passed instead.
+      #
+      # ==== Exceptions
+      # IBRubyError::  Generated whenever a problem occurs creating the
+      #                  transaction.
+      #
+      def Transaction.create(connections, parameters)
+      end
+   end
+   
+   
+   #
+   # This class represents a reusable set of transaction settings. The
+   # settings are compiled into a transaction parameter buffer when the object
+   # is created so transactions started with it don't have to rebuild the
+   # buffer each time. Create one for each distinct set of settings used by an
+   # application and pass it to Transaction.new, Transaction.create or
+   # Connection#start_transaction.
+   #
+   class TransactionOptions
+      #
+      # This is the constructor for the TransactionOptions class.
+      #
+      # ==== Parameters
+      # settings::  A Hash of the transaction settings. Recognised keys are
+      #             :isolation (one of :concurrency, the default,
+      #             :consistency or :read_committed), :rec_version (false to
+      #             make a read committed transaction wait for uncommitted
+      #             versions), :read_only (true for a read only transaction),
+      #             :wait (false for no wait lock resolution), :lock_timeout
+      #             (the number of seconds to wait for a lock, Firebird only)
+      #             and :reserve (a Hash of table names to one of
+      #             :shared_read, :shared_write, :protected_read or
+      #             :protected_write). Table names must be given as stored in
+      #             the database, normally upper case.
+      #
+      # ==== Exceptions
+      # Exception::  Generated whenever an invalid setting is specified.
+      #
+      def initialize(settings={})
+      end
+      
+      
+      #
+      # This method returns a frozen copy of the settings Hash that the object
+      # was created with.
+      #
+      def settings
+      end
+      
+      
+      #
+      # This method returns a String containing the bytes of the compiled
+      # transaction parameter buffer.
+      #
+      def tpb
+      end
+   end
+   
+   
+   #
+   # This class  represents a prepared SQL statement that may be executed more
+   # than once.
+   #
+   # When a statement is executed, or a row fetched, from a Fiber running
+   # under a Fiber scheduler (Ruby 3.0 or later) the client call is made on
+   # one of a small number of worker threads and the Fiber is suspended
+   # through the scheduler until the call completes, so other Fibers keep
+   # running. The number of worker threads is set by
+   # $IBRubySettings[:CLIENT_WORKER_THREADS] (default 4). Assign false to
+   # $IBRubySettings[:NON_BLOCKING_EXECUTION] to make these calls on the
+   # calling thread instead. Outside a Fiber scheduler the calls release the
+   # interpreter lock where the interpreter allows it.
+   #
+   class Statement
+      # A definition for a SQL statement type constant.
+      SELECT_STATEMENT            = 1
+      
+      # A definition for a SQL statement type constant.
+      INSERT_STATEMENT            = 2
+      
+      # A definition for a SQL statement type constant.
+      UPDATE_STATEMENT            = 3
+      
+      # A definition for a SQL statement type constant.
+      DELETE_STATEMENT            = 4
+      
+      # A definition for a SQL statement type constant.
+      DDL_STATEMENT               = 5
+      
+      # A definition for a SQL statement type constant.
+      GET_SEGMENT_STATEMENT       = 6
+      
+      # A definition for a SQL statement type constant.
+      PUT_SEGMENT_STATEMENT       = 7
+      
+      # A definition for a SQL statement type constant.
+      EXECUTE_PROCEDURE_STATEMENT = 8
+      
+      # A definition for a SQL statement type constant.
+      START_TRANSACTION_STATEMENT = 9
+      
+      # A definition for a SQL statement type constant.
+      COMMIT_STATEMENT            = 10
+      
+      # A definition for a SQL statement type constant.
+      ROLLBACK_STATEMENT          = 11
+      
+      # A definition for a SQL statement type constant.
+      SELECT_FOR_UPDATE_STATEMENT = 12
+      
+      # A definition for a SQL statement type constant.
+      SET_GENERATOR_STATEMENT     = 13
+      
+      # A definition for a SQL statement type constant.
+      SAVE_POINT_STATEMENT        = 14
+      
+      #
+      # This is the constructor for the Statement class.
+      #
+      # ==== Parameters
+      # connection::   The Connection object that the SQL statement will be
+      #                executed through.
+      # transaction::  The Transaction object that the SQL statement will be
+      #                executed under.
+      # sql::          The SQL statement to be prepared for execution.
+      # dialect::      The InterBase dialect to be used in preparing the SQL
+      #                statement.
+      #
+      def initialize(connection, transaction, sql, dialect)
+      end
+      
+      
+      #
+      # This is the accessor for the connection attribute.
+      #
+      def connection
+      end
+      
+      
+      #
+      # This is the accessor for the transaction attribute.
+      #
+      def transaction
+      end
+      
+      
+      #
+      # This is the accessor for the SQL statement attribute.
+      #
+      def sql
+      end
+      
+      
+      #
+      # This is the accessor for the dialect attribute.
+      #
+      def dialect
+      end
+      
+      
+      #
+      # This method is used to determine the type of a SQL statement. The method
+      # will return one of the constant SQL types defined within the class.
+      #
+      def type
+      end
+      
+      
+      #
+      # This method fetches a count of the number of dynamic parameters for
+      # a statement object (i.e. the number of parameters that must be provided
+      # with values before the SQL statement can be executed).
+      #
+      def parameter_count
+      end
+      
+      
+      #
+      # This method fetches the plan the optimizer has chosen for the
+      # statement, such as 'PLAN (TEST INDEX (RDB$PRIMARY1))'. The statement
+      # is prepared if need be but is not executed. Returns nil for statements
+      # that have no plan.
+      #
+      def plan
+      end
+      
+      
+      #
+      # This method executes the SQL statement within a Statement object. This
+      # method returns a ResultSet object if the statement executed was a SQL
+      # query. For non-query SQL statements (insert, update or delete) it
       # returns an Integer indicating the number of affected rows. For all other
       # statements the method returns nil. This method accepts a block taking a
       # single parameter. If this block is provided and the statement is a query
       # then the rows returned by the query will be passed, one at a time, to
       # the block.
       #
-      # ==== Exception
-      # Exception::  Generated if the Statement object actual requires some
-      #              parameters or a problem occurs executing the SQL statement.
+      # ==== Parameters
+      # options::  An optional Hash of execution options. The :timeout entry
+      #            gives the number of seconds the statement may run for,
+      #            replacing Connection#statement_timeout for this call.
+      #
+      # ==== Exception
+      # Exception::  Generated if the Statement object actual requires some
+      #              parameters or a problem occurs executing the SQL statement.
+      #
+      def execute(options=nil)
+         yield row
+      end
+      
+      
+      #
+      # This method executes the SQL statement within a Statement object and
+      # passes it a set of parameters. Parameterized statements use question
+      # marks as place holders for values that may change between calls to
+      # execute the statement. This method returns a ResultSet object if the
+      # statement executed was a SQL query. If the statement was a non-query SQL
+      # statement (insert, update or delete) then the method returns a count of
+      # the number of rows affected. For all other types of statement the method
+      # returns nil. This method accepts a block taking a single parameter. If
+      # this block is provided and the statement is a query then the rows
+      # returned by the query will be passed, one at a time, to the block.
+      #
+      # ==== Parameters
+      # parameters::  An array of the parameters for the statement. An effort
+      #               will be made to convert the values passed in to the
+      #               appropriate types but no guarantees are made (especially
+      #               in the case of text fields, which will simply use to_s
+      #               if the object passed is not a String).
+      #
+      # ==== Exception
+      # Exception::  Generated whenever a problem occurs translating one of the
+      #              input parameters or executing the SQL statement.
+      #
+      def execute_for(parameters)
+         yield row
+      end
+      
+      
+      #
+      # This method releases the database resources associated with a Statement
+      # object and should be explicitly called when a Statement object is of
+      # no further use.
+      #
+      # ==== Exceptions
+      # IBRubyError::  Generated whenever a problem occurs closing the
+      #                  statement object.
+      #
+      def close
+      end
+   end
+   
+   
+   #
+   # This class represents the results of a SQL query executed against a
+   # database. The viable lifespan of a ResultSet object is limited by the
+   # transaction that was used in it's creation. Once this transaction has
+   # been committed or rolled back all related ResultSet object are invalidated
+   # and can no longer be used.
+   #
+   class ResultSet
+      include Enumerable
+      
+      #
+      # This is the constructor for the ResultSet object.
+      #
+      # ==== Parameters
+      # connection::   A reference to the Connection object that will be used
+      #                to execute the SQL query.
+      # transaction::  A reference to the Transaction object that will be used
+      #                in executing the SQL query.
+      # sql::          A reference to a String containing the SQL query that
+      #                will be executed.
+      # dialect::      A reference to an integer containing the InterBase dialect
+      #                to be used in executing the SQL statement.
+      #
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever a non-query SQL statement is
+      #                      specified, an invalid connection or transaction is
+      #                      provided or a problem occurs executing the SQL
+      #                      against the database.
+      #
+      def initialize(connection, transaction, sql, dialect)
+      end
+      
+      
+      #
+      # This is the accessor for the connection attribute.
+      #
+      def connection
+      end
+      
+      
+      #
+      # This is the accessor for the transaction attribute.
+      #
+      def transaction
+      end
+      
+      
+      #
+      # This is the accessor for the sql attribute.
+      #
+      def sql
+      end
+      
+      
+      #
+      # This method fetches the plan being used by the query that produced the
+      # result set.
+      #
+      # ==== Exceptions
+      # IBRubyException::  Generated if the result set has been closed.
+      #
+      def plan
+      end
+      
+      
+      #
+      # This is the accessor for the dialect attribute.
+      #
+      def dialect
+      end
+      
+      
+      #
+      # This method fetches a count of the number of columns in a row of data
+      # that the ResultSet can fetch.
+      #
+      def column_count
+      end
+      
+      
+      #
+      # This method fetches the name associated with a specified column for a
+      # ResultSet object.
+      #
+      # ==== Parameters
+      # column::  A reference to the column number to fetch the details for.
+      #           Column numbers start at zero.
+      #
+      def column_name(column)
+      end
+      
+      
+      #
+      # This method fetches the alias associated with a specified column for a
+      # ResultSet object.
+      #
+      # ==== Parameters
+      # column::  A reference to the column number to fetch the details for.
+      #           Column numbers start at zero.
+      #
+      def column_alias(column)
+      end
+      
+      
+      #
+      # This method fetches the table name associated with a specified column
+      # for a ResultSet object.
+      #
+      # ==== Parameters
+      # column::  A reference to the column number to fetch the details for.
+      #           Column numbers start at zero.
+      #
+      def column_table(column)
+      end
+      
+      
+      #
+      # This method fetches a single rows worth of data from the ResultSet
+      # object. If the set contains more rows then an array containing the
+      # row data will be retrieved. If the ResultSet is exhausted (i.e. all
+      # rows have been fetched) then nil is returned. Translation of the row
+      # data into an appropriate Ruby type is performed on the row data that
+      # is extracted.
+      #
+      def fetch
+      end
+      
+      
+      
+      #
+      # This method switches a ResultSet into prefetch mode, in which a
+      # background native thread fetches rows from the server ahead of the
+      # caller while earlier rows are being converted and processed. This
+      # can significantly improve throughput when iterating large result sets
+      # over a network connection. The method returns the ResultSet object
+      # and has no effect on a result set that is closed, exhausted or already
+      # prefetching. Prefetching stops when the result set is exhausted or
+      # closed.
+      #
+      # ==== Parameters
+      # rows::  The maximum number of rows to fetch ahead of the caller.
+      #         Defaults to 256.
+      #
+      # ==== Exceptions
+      # IBRubyException::  Generated if an invalid row count is specified.
+      #
+      def prefetch(rows=256)
+      end
+      
+      #
+      # This method is used to determine if all of the rows have been retrieved
+      # from a ResultSet object. This method will always return false until
+      # the fetch method has been called at least once so it cannot be used to
+      # detect a result set that returns no rows.
+      #
+      def exhausted?
+      end
+      
+      
+      #
+      # This method fetches a count of the total number of rows retrieved
+      # from a result set.
+      #
+      def row_count
+      end
+      
+      
+      #
+      # This method provides an iterator for the (remaining) rows contained in
+      # a ResultSet object.
+      #
+      # ==== Parameters
+      # block::  A block that takes a single parameter. This will be called for
+      #          and passed each remaining row (as per the fetch method) from
+      #          the ResultSet.
+      #
+      def each(&block)
+      end
+      
+      
+      #
+      # This method releases the database resources associated with a ResultSet
+      # object and should be explicitly called when a ResultSet object is of
+      # no further use. The method is implicitly called if the rows available
+      # from a ResultSet are exhausted but calling this method at that time
+      # will not cause an error.
+      #
+      # ==== Exceptions
+      # IBRubyError::  Generated whenever a problem occurs closing the result
+      #                  set object.
+      #
+      def close
+      end
+      
+      #
+      # This method retrieves the base SQL type for a column of data within a
+      # ResultSet object. The method returns one of the base types defined in
+      # the SQLType class but does not return an actual SQLType object.
+      #
+      # ==== Parameters
+      # index::  The offset from the ResultSet first column of the column to
+      #          return the type information for.
+      #
+      def get_base_type(index)
+      end
+   end
+   
+   
+   #
+   # This class models a row of data fetched as part of a SQL query.
+   #
+   class Row
+      include Enumerable
+      
+      #
+      # This is the constructor for the Row class. This method shouldn't really
+      # be used as Row objects are automatically created by ResultSets.
+      #
+      # ==== Parameters
+      # results::  The ResultSet object that the row relates to.
+      # data::     An array containing the row data values.
+      # number::   The row number for the new row.
+      #
+      def initialize(results, data, number)
+      end
+      
       #
-      def execute
-         yield row
+      # This is the accessor for the row number attribute. This will generally
+      # reflect the order the row was fetched from the result set in, with 1
+      # being the first row retrieved.
+      #
+      def number
       end
       
       
       #
-      # This method executes the SQL statement within a Statement object and
-      # passes it a set of parameters. Parameterized statements use question
-      # marks as place holders for values that may change between calls to
-      # execute the statement. This method returns a ResultSet object if the
-      # statement executed was a SQL query. If the statement was a non-query SQL
-      # statement (insert, update or delete) then the method returns a count of
-      # the number of rows affected. For all other types of statement the method
-      # returns nil. This method accepts a block taking a single parameter. If
-      # this block is provided and the statement is a query then the rows
-      # returned by the query will be passed, one at a time, to the block.
+      # This method fetches a count of the number of columns of data that are
+      # available from a row.
+      #
+      def column_count
+      end
+      
+      
+      #
+      # This method fetches the name of a column within a row of data.
       #
       # ==== Parameters
-      # parameters::  An array of the parameters for the statement. An effort
-      #               will be made to convert the values passed in to the
-      #               appropriate types but no guarantees are made (especially
-      #               in the case of text fields, which will simply use to_s
-      #               if the object passed is not a String).
+      # index::  The index of the column to fetch the name for. The first
+      #          column in the row is at offset zero.
       #
-      # ==== Exception
-      # Exception::  Generated whenever a problem occurs translating one of the
-      #              input parameters or executing the SQL statement.
+      def column_name(index)
+      end
+      
+      
+      #
+      # This method fetches the alias of a column within a row of data.
+      #
+      # ==== Parameters
+      # index::  The index of the column to fetch the alias for. The first
+      #          column in the row is at offset zero.
+      #
+      def column_alias(index)
+      end
+      
+      
+      #
+      # This method fetches the value associated with a column within a Row
+      # object.
+      #
+      # ==== Parameters
+      # index::  Either the offset of the column to retrieve the value of or
+      #          the alias of the column to retrieve the value of (column alias
+      #          comparisons are case sensitive).
+      #
+      def [](index)
+      end
+      
+      
+      #
+      # This method iterates over the contents of a Row object. The block
+      # specified for the method should accept two parameters; one for the
+      # column alias and one for the column value.
+      #
+      def each
+         yield column, vlaue
+      end
+      
+      
+      #
+      # This method iterates over the column names for a Row class.
+      #
+      def each_key
+         yield column
+      end
+      
+      
+      #
+      # This method iterators over the column values for a Row class.
+      #
+      def each_value
+         yield value
+      end
+      
+      
+      #
+      # An implementation of the Hash#fetch method for the Row class. The
+      # method accepts a block but this should not be specified if a value
+      # for the alternative parameter is specified.
+      #
+      # ==== Parameters
+      # key::          A string containing the column alias to retrieve.
+      # alternative::  A reference to the alternative value to be returned if
+      #                the keyed value is not found. Defaults to nil.
+      #
+      def fetch(key, alternative=nil)
+         yield key
+      end
+      
+      
+      #
+      # This method is used to determine whether a Row object contains a given
+      # column alias.
+      #
+      # ==== Parameters
+      # name::  A String containing the column name to check for.
+      #
+      def has_key?(name)
+      end
+      
+      
+      #
+      # This method is used to determine whether a Row object contains a given
+      # column name.
+      #
+      # ==== Parameters
+      # name::  A String containing the column name to check for.
+      #
+      def has_column?(name)
+      end
+      
+      
+      #
+      # This method is used to determine whether a Row object contains a given
+      # column alias.
+      #
+      # ==== Parameters
+      # name::  A String containing the column alias to check for.
+      #
+      def has_alias?(name)
+      end
+      
+      
+      #
+      # This method is used to determine whether a Row object contains a given
+      # column value.
+      #
+      # ==== Parameters
+      # value::  A reference to an object value to be checked for.
+      #
+      def has_value?(value)
+      end
+      
+      
+      #
+      # This method retrieves an array of column aliases for a Row object.
+      #
+      def keys
+      end
+      
+      
+      #
+      # This method retrieves an array of column names for a Row object.
+      #
+      def names
+      end
+      
+      
+      #
+      # This method retrieves an array of column aliases for a Row object.
+      #
+      def aliases
+      end
+      
+      
+      #
+      # This method retrieves an array of column values for a Row object.
+      #
+      def values
+      end
+      
+      
+      #
+      # This method returns an array of the Row elements for which the specified
+      # block returns true.
+      #
+      def select
+         yield column, value
+      end
+      
+      
+      #
+      # This method retrieves an Array containing the values from a Row object.
+      # Each value is represented as an Array containing a column name and the
+      # associated column value.
+      #
+      def to_a
+      end
+      
+      
+      #
+      # This method retrieves a Hash created from a Row objects values. The Row
+      # objects column names will be used as a key on to the column values.
+      #
+      def to_hash
+      end
+      
+      
+      #
+      # This method returns an array of column values based on a list of column
+      # aliases.
+      #
+      # ==== Parameters
+      # names::  One or more Strings containing the names of the columns to
+      #          retrieve values for.
+      #
+      def values_at(*names)
+      end
+      
+      #
+      # This method retrieves the base SQL type for a column of data within a
+      # Row object. The method returns one of the base types defined in the
+      # SQLType class but does not return an actual SQLType object.
+      #
+      # ==== Parameters
+      # index::  The offset from the Row first column of the column to return
+      #          the type information for.
+      #
+      def get_base_type(index)
+      end
+   end
+   
+   #
+   # This class represents Blob data fetched from the database. The class defers
+   # the actual loading of the blob until requested. The class is somewhat basic
+   # and maybe expanded upon in later releases.
+   #
+   class Blob
+      #
+      # This is the constructor for the Blob class. This shouldn't really be
+      # used outside of the IBRuby library.
+      #
+      def initialize
+      end
+      
+      
+      #
+      # This method loads the entire data set for a blob as a string.
+      #
+      def to_s
+      end
+      
+      
+      #
+      # This method closes a blob, freeing any resources associated with it.
       #
-      def execute_for(parameters)
-         yield row
+      def close
       end
       
       
       #
-      # This method releases the database resources associated with a Statement
-      # object and should be explicitly called when a Statement object is of
-      # no further use.
-      #
-      # ==== Exceptions
-      # IBRubyError::  Generated whenever a problem occurs closing the
-      #                  statement object.
+      # This method loads the segments of a blob one after another. The blob
+      # segments are passed as strings to the block passed to the method.
       #
-      def close
+      def each
+         yield segment
       end
    end
    
    
    #
-   # This class represents the results of a SQL query executed against a
-   # database. The viable lifespan of a ResultSet object is limited by the
-   # transaction that was used in it's creation. Once this transaction has
-   # been committed or rolled back all related ResultSet object are invalidated
-   # and can no longer be used.
+   # This class represents a InterBase generator entity.
    #
-   class ResultSet
-      include Enumerable
-      
+   class Generator
       #
-      # This is the constructor for the ResultSet object.
+      # This is the constructor for the Generator class. Note, this method
+      # assumes that the named generator already exists. If it doesn't then
+      # the object will be constructed but will fail during use.
       #
       # ==== Parameters
-      # connection::   A reference to the Connection object that will be used
-      #                to execute the SQL query.
-      # transaction::  A reference to the Transaction object that will be used
-      #                in executing the SQL query.
-      # sql::          A reference to a String containing the SQL query that
-      #                will be executed.
-      # dialect::      A reference to an integer containing the InterBase dialect
-      #                to be used in executing the SQL statement.
-      #
-      # ==== Exceptions
-      # IBRubyException::  Generated whenever a non-query SQL statement is
-      #                      specified, an invalid connection or transaction is
-      #                      provided or a problem occurs executing the SQL
-      #                      against the database.
+      # name::        A string containing the generator name.
+      # connection::  A reference to the Connection object that will be used
+      #               to access the generator.
       #
-      def initialize(connection, transaction, sql, dialect)
+      def initialize(name, connection)
       end
       
       
       #
-      # This is the accessor for the connection attribute.
+      # This is the accessor for the name attribute.
       #
-      def connection
+      def name
       end
       
       
       #
-      # This is the accessor for the transaction attribute.
+      # This is the accessor for the connection attribute.
       #
-      def transaction
+      def connection
       end
       
       
       #
-      # This is the accessor for the sql attribute.
+      # This method fetches the last value generator from a generator.
       #
-      def sql
+      # ==== Exceptions
+      # Exception::  Generated whenever a problem occurs accessing the
+      #              database generator.
+      #
+      def last
       end
       
       
       #
-      # This is the accessor for the dialect attribute.
+      # This method drops a generator from the database. After a successful
+      # call to this method the Generator object may not be used to obtain
+      # values unless it is recreated.
       #
-      def dialect
+      # ==== Exceptions
+      # Exception::  Generated whenever a problem occurs dropping the generator
+      #              from the database.
+      #
+      def drop
       end
       
       
       #
-      # This method fetches a count of the number of columns in a row of data
-      # that the ResultSet can fetch.
+      # This method fetches the next value, depending on a specified increment,
+      # from a generator.
       #
-      def column_count
+      # ==== Parameters
+      # step::  The step interval to be applied to the generator to obtain the
+      #         next value.
+      #
+      # ==== Exceptions
+      # Exception::  Generated whenever a problem occurs accessing the
+      #              database generator.
+      #
+      def next(step)
       end
       
       
       #
-      # This method fetches the name associated with a specified column for a
-      # ResultSet object.
+      # This method reserves a block of values from a generator using a single
+      # call to the database. The values reserved are returned as a Range and
+      # will not be issued to any other caller.
       #
       # ==== Parameters
-      # column::  A reference to the column number to fetch the details for.
-      #           Column numbers start at zero.
+      # size::  The number of values to be reserved.
       #
-      def column_name(column)
+      # ==== Exceptions
+      # Exception::  Generated whenever a problem occurs accessing the
+      #              database generator.
+      #
+      def reserve(size)
       end
       
       
       #
-      # This method fetches the alias associated with a specified column for a
-      # ResultSet object.
-      #
-      # ==== Parameters
-      # column::  A reference to the column number to fetch the details for.
-      #           Column numbers start at zero.
+      # This method fetches the number of values reserved each time the local
+      # value cache for the generator is refilled. A value of 0 indicates that
+      # caching is switched off, which is the default.
       #
-      def column_alias(column)
+      def cache_size
       end
       
       
       #
-      # This method fetches the table name associated with a specified column
-      # for a ResultSet object.
+      # This method sets the number of values to be reserved each time the
+      # local value cache for the generator is refilled. When set, calls to
+      # next with a step of 1 are satisfied from the cache, only contacting the
+      # database when the current block of values has been used up. Values
+      # left in the cache when the Generator is discarded are lost, so gaps
+      # may appear in the sequence.
       #
       # ==== Parameters
-      # column::  A reference to the column number to fetch the details for.
-      #           Column numbers start at zero.
+      # size::  The number of values to reserve at a time, 0 to switch caching
+      #         off.
       #
-      def column_table(column)
+      def cache_size=(size)
       end
       
       
       #
-      # This method fetches a single rows worth of data from the ResultSet
-      # object. If the set contains more rows then an array containing the
-      # row data will be retrieved. If the ResultSet is exhausted (i.e. all
-      # rows have been fetched) then nil is returned. Translation of the row
-      # data into an appropriate Ruby type is performed on the row data that
-      # is extracted.
+      # This method returns a Hash of statistics for the local value cache of
+      # the generator. The Hash contains :hits (the number of values issued
+      # from the cache), :misses (the number of times the cache had to be
+      # refilled) and :cached (the number of values currently held).
       #
-      def fetch
+      def statistics
       end
       
       
       #
-      # This method is used to determine if all of the rows have been retrieved
-      # from a ResultSet object. This method will always return false until
-      # the fetch method has been called at least once so it cannot be used to
-      # detect a result set that returns no rows.
+      # This method is used to determine whether a named generator exists
+      # within a database.
       #
-      def exhausted?
+      # ==== Parameters
+      # name::        A string containing the generator name to check for.
+      # connection::  A reference to the Connection object to be used in
+      #               performing the check.
+      #
+      # ==== Exceptions
+      # Exception::  Generated whenever a problem occurs determining the
+      #              existence of the generator.
+      #
+      def Generator.exists?(name, connection)
       end
       
       
       #
-      # This method fetches a count of the total number of rows retrieved
-      # from a result set.
+      # This method creates a new generator within a database. This method
+      # returns a Generator object is successful.
       #
-      def row_count
+      # ==== Parameters
+      # name::        A string containing the name for the new generator.
+      # connection::  A reference to the Connection object that will be used to
+      #               create the generator.
+      #
+      # ==== Exceptions
+      # Exception::  Generated whenever a problem occurs creating the new
+      #              generator in the database.
+      #
+      def Generator.create(name, connection)
+      end
+   end
+   
+   
+   #
+   # This class represents a connection to the service manager for a InterBase
+   # database server instance. The service calls are made with the interpreter
+   # lock released so threads can run tasks at the same time, each on a
+   # ServiceManager of its own.
+   #
+   class ServiceManager
+      #
+      # This is the constructor for the ServiceManager class.
+      #
+      # ==== Parameters
+      # host::  The name of the host supporting the service manager to be
+      #         connected with.
+      #
+      def initialize(host)
       end
       
       
       #
-      # This method provides an iterator for the (remaining) rows contained in
-      # a ResultSet object.
+      # This method attaches a ServiceManager object to its host service. The
+      # user name used to connect with can affect which services can be accessed
+      # on the server.
       #
       # ==== Parameters
-      # block::  A block that takes a single parameter. This will be called for
-      #          and passed each remaining row (as per the fetch method) from
-      #          the ResultSet.
+      # user::      A string containing the user name to connect with.
+      # password::  A string containing the user password to connect with.
       #
-      def each(&block)
+      def connect(user, password)
       end
       
       
       #
-      # This method releases the database resources associated with a ResultSet
-      # object and should be explicitly called when a ResultSet object is of
-      # no further use. The method is implicitly called if the rows available
-      # from a ResultSet are exhausted but calling this method at that time
-      # will not cause an error.
+      # This method disconnects a previously connected ServiceManager object.
       #
-      # ==== Exceptions
-      # IBRubyError::  Generated whenever a problem occurs closing the result
-      #                  set object.
+      def disconnect
+      end
+      
+      
       #
-      def close
+      # This method is used to determine whether a ServiceManager object has
+      # been connected.
+      #
+      def connected?
       end
       
+      
       #
-      # This method retrieves the base SQL type for a column of data within a
-      # ResultSet object. The method returns one of the base types defined in
-      # the SQLType class but does not return an actual SQLType object.
+      # This method is used to batch execute a collection of task objects.
       #
       # ==== Parameters
-      # index::  The offset from the ResultSet first column of the column to
-      #          return the type information for.
+      # tasks::  One or more task objects to be executed by the service manager.
       #
-      def get_base_type(index)
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever this method is called on a
+      #                      disconnected service manager or is a problem
+      #                      occurs executing one of the tasks.
+      #
+      def execute(*tasks)
       end
    end
    
    
    #
-   # This class models a row of data fetched as part of a SQL query.
+   # This class represents a service manager task to add a new user to a
+   # database instance. NOTE: This class does not currently work on the
+   # Mac OS X platform.
    #
-   class Row
-      include Enumerable
+   class AddUser
+      # Attribute accessor.
+      attr_reader :user_name, :password, :first_name, :middle_name, :last_name
+      
+      # Attribute mutator.
+      attr_writer :user_name, :password, :first_name, :middle_name, :last_name
       
       #
-      # This is the constructor for the Row class. This method shouldn't really
-      # be used as Row objects are automatically created by ResultSets.
+      # This is a constructor for the AddUser class.
       #
       # ==== Parameters
-      # results::  The ResultSet object that the row relates to.
-      # data::     An array containing the row data values.
-      # number::   The row number for the new row.
+      # user_name::    A String containing the user name to be assigned to the
+      #                new user.
+      # password::     A String containing the password to be assigned to the
+      #                new user.
+      # first_name::   A String containing the first name to be associated with
+      #                the new user. Defaults to nil.
+      # middle_name::  A String containing the middle name to be associated
+      #                with the new user. Defaults to nil.
+      # last_name::    A String containing the last name to be associated with
+      #                the new user. Defaults to nil.
       #
-      def initialize(results, data, number)
+      def initialize(user_name, password, firsts_name=nil, middle_name=nil,
+                     last_name=nil)
       end
       
+      
       #
-      # This is the accessor for the row number attribute. This will generally
-      # reflect the order the row was fetched from the result set in, with 1
-      # being the first row retrieved.
+      # This method executes the add user task against a service manager.
       #
-      def number
-      end
-      
-      
+      # ==== Parameters
+      # manager::  A reference to the ServiceManager object to execute the task
+      #            on.
       #
-      # This method fetches a count of the number of columns of data that are
-      # available from a row.
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever a disconnected service manager
+      #                      is specified or an error occurs executing the
+      #                      task.
       #
-      def column_count
+      def execute(manager)
       end
+   end
+   
+   
+   #
+   # This class represents a service manager task to remove an existing user
+   # from a database instance. NOTE: This class does not currently work on the
+   # Mac OS X platform.
+   #
+   class RemoveUser
+      # Attribute accessor.
+      attr_reader :user_name
       
+      # Attribute mutator.
+      attr_writer :user_name
       
       #
-      # This method fetches the name of a column within a row of data.
+      # This is a constructor for the RemoveUser class.
       #
       # ==== Parameters
-      # index::  The index of the column to fetch the name for. The first
-      #          column in the row is at offset zero.
+      # user_name::    A String containing the user name to be assigned to the
+      #                new user.
       #
-      def column_name(index)
+      def initialize(user_name)
       end
       
       
       #
-      # This method fetches the alias of a column within a row of data.
+      # This method executes the remove user task against a service manager.
       #
       # ==== Parameters
-      # index::  The index of the column to fetch the alias for. The first
-      #          column in the row is at offset zero.
+      # manager::  A reference to the ServiceManager object to execute the task
+      #            on.
       #
-      def column_alias(index)
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever a disconnected service manager
+      #                      is specified or an error occurs executing the
+      #                      task.
+      #
+      def execute(manager)
       end
+   end
+   
+   
+   #
+   # This class represents a service manager task to backup an existing database
+   # on the InterBase server. NOTE: This class does not currently work on the
+   # Mac OS X platform.
+   #
+   class Backup
+      # Attribute accessor.
+      attr_reader :backup_file, :database
       
+      # Attribute mutator.
+      attr_writer :backup_file, :database
       
       #
-      # This method fetches the value associated with a column within a Row
-      # object.
+      # This is the constructor for the Backup class.
       #
       # ==== Parameters
-      # index::  Either the offset of the column to retrieve the value of or
-      #          the alias of the column to retrieve the value of (column alias
-      #          comparisons are case sensitive).
+      # database::  A String or File giving the path and name (relative to the
+      #             database server) of the main database file for the database
+      #             to be backed up.
+      # file::      A String or File giving the path and name (relative to the
+      #             database server) of the back up file to be generated.
       #
-      def [](index)
+      def initialize(database, file)
       end
       
       
       #
-      # This method iterates over the contents of a Row object. The block
-      # specified for the method should accept two parameters; one for the
-      # column alias and one for the column value.
+      # This method fetches the blocking factor to be used in generating the
+      # back up. This will return nil until it has been explicitly set.
       #
-      def each
-         yield column, vlaue
+      def blocking_factor
       end
       
       
       #
-      # This method iterates over the column names for a Row class.
+      # This method sets the blocking factor to be used in generating the
+      # back up.
       #
-      def each_key
-         yield column
+      # ==== Parameters
+      # size::  A reference to an integer containing the new back up blocking
+      #         factor setting.
+      #
+      def blocking_factor=(size)
       end
       
       
       #
-      # This method iterators over the column values for a Row class.
+      # This method fetches the ignore checksums setting for a Backup object.
       #
-      def each_value
-         yield value
+      def ignore_checksums
       end
       
       
       #
-      # An implementation of the Hash#fetch method for the Row class. The
-      # method accepts a block but this should not be specified if a value
-      # for the alternative parameter is specified.
+      # This method is used to set the indicator for whether checksum values
+      # should be ignored in performing a backup.
       #
       # ==== Parameters
-      # key::          A string containing the column alias to retrieve.
-      # alternative::  A reference to the alternative value to be returned if
-      #                the keyed value is not found. Defaults to nil.
+      # setting::  True to ignore checksums, false otherwise.
       #
-      def fetch(key, alternative=nil)
-         yield key
+      def ignore_checksums=(setting)
       end
       
       
       #
-      # This method is used to determine whether a Row object contains a given
-      # column alias.
-      #
-      # ==== Parameters
-      # name::  A String containing the column name to check for.
+      # This method fetches the ignore limbo setting for a Backup object.
       #
-      def has_key?(name)
+      def ignore_limbo
       end
       
       
       #
-      # This method is used to determine whether a Row object contains a given
-      # column name.
+      # This method is used to set the indicator for whether limbo transactions
+      # should be ignored in performing a backup.
       #
       # ==== Parameters
-      # name::  A String containing the column name to check for.
+      # setting::  True to ignore limbo transactions, false otherwise.
       #
-      def has_column?(name)
+      def ignore_limbo=(setting)
       end
       
       
       #
-      # This method is used to determine whether a Row object contains a given
-      # column alias.
-      #
-      # ==== Parameters
-      # name::  A String containing the column alias to check for.
+      # This method fetches the metadata only setting for a Backup object.
       #
-      def has_alias?(name)
+      def metadata_only
       end
       
       
       #
-      # This method is used to determine whether a Row object contains a given
-      # column value.
+      # This method is used to set the indicator for whether a backup stores
+      # only the database metadata.
       #
       # ==== Parameters
-      # value::  A reference to an object value to be checked for.
+      # setting::  True to store only metadata, false otherwise.
       #
-      def has_value?(value)
+      def metadata_only=(setting)
       end
       
       
       #
-      # This method retrieves an array of column aliases for a Row object.
+      # This method fetches the garbage collect setting for a Backup object.
       #
-      def keys
+      def garbage_collect
       end
       
       
       #
-      # This method retrieves an array of column names for a Row object.
+      # This method is used to set the indicator for whether the backup will
+      # undertake garbage collection.
       #
-      def names
+      # ==== Parameters
+      # setting::  True to perform garbage collection, false otherwise.
+      #
+      def garbage_collect=(setting)
       end
       
       
       #
-      # This method retrieves an array of column aliases for a Row object.
+      # This method fetches the non-transportable setting for a Backup object.
       #
-      def aliases
+      def non_transportable
       end
       
       
       #
-      # This method retrieves an array of column values for a Row object.
+      # This method is used to set the indicator for whether backup generated
+      # by the task will be platform specific.
       #
-      def values
+      # ==== Parameters
+      # setting::  True to generate a platform specific backup, false otherwise.
+      #
+      def non_transportable=(setting)
       end
       
       
       #
-      # This method returns an array of the Row elements for which the specified
-      # block returns true.
+      # This method fetches the convert tables setting for a Backup object.
       #
-      def select
-         yield column, value
+      def convert_tables
       end
       
       
       #
-      # This method retrieves an Array containing the values from a Row object.
-      # Each value is represented as an Array containing a column name and the
-      # associated column value.
+      # This method is used to set the indicator for whether external tables
+      # will be converted to internal tables as part of the backup.
       #
-      def to_a
+      # ==== Parameters
+      # setting::  True to convert external tables, false otherwise.
+      #
+      def convert_tables=(setting)
       end
       
       
       #
-      # This method retrieves a Hash created from a Row objects values. The Row
-      # objects column names will be used as a key on to the column values.
+      # This method is used to execute a backup task against a service manager.
+      # The output of the task is read from the server a line at a time
+      # without holding the interpreter lock, so other threads keep running
+      # while the task works. If a block is given each line is passed to it
+      # as soon as it arrives.
+      #
+      # Rather than using the server side backup file the backup can be
+      # written to a Ruby IO, such as a pipe or socket, by passing the IO as
+      # the :io option. This needs a Firebird 2.5 or later client library.
+      # The backup data passes through the service manager connection and
+      # can be compressed with zlib (in gzip format) or zstd on a separate
+      # native thread, given by a :compression option of :zlib or :zstd.
+      # Verbose output isn't available from a backup written to an IO, so
+      # there is no log and no lines or progress are reported.
       #
-      def to_hash
+      # ==== Parameters
+      # manager::  A reference to the service manager to execute the backup
+      #            task against.
+      # options::  A Hash of options, :io and :compression. Defaults to nil.
+      #
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever a disconnected service manager
+      #                      is specified or a problem occurs executing the
+      #                      task.
+      #
+      def execute(manager, options=nil)
       end
       
       
       #
-      # This method returns an array of column values based on a list of column
-      # aliases.
-      #
-      # ==== Parameters
-      # names::  One or more Strings containing the names of the columns to
-      #          retrieve values for.
+      # This method sets a block to be called with progress details while a
+      # Backup task executes. The block is passed the number of tables
+      # processed so far and the total number of rows in them processed so
+      # far, worked out from the verbose output of the task. It is called
+      # whenever either changes. Calling the method without a block removes
+      # any block previously set.
       #
-      def values_at(*names)
+      def on_progress(&block)
       end
       
+      
       #
-      # This method retrieves the base SQL type for a column of data within a
-      # Row object. The method returns one of the base types defined in the
-      # SQLType class but does not return an actual SQLType object.
-      #
-      # ==== Parameters
-      # index::  The offset from the Row first column of the column to return
-      #          the type information for.
+      # This method fetches the log value for a Backup task. This value will
+      # always be nil until the task has been executed. After a successful
+      # execution the log value should contain output from the backup task
+      # generated on the server.
       #
-      def get_base_type(index)
+      def log
       end
    end
    
+   
    #
-   # This class represents Blob data fetched from the database. The class defers
-   # the actual loading of the blob until requested. The class is somewhat basic
-   # and maybe expanded upon in later releases.
+   # This class represents a service manager task to make or restore a physical
+   # backup of a database using the nbackup facility of the server. The backup
+   # files form a chain of levels, the level 0 file holding a copy of the whole
+   # database and each file at a higher level holding the pages that changed
+   # since the backup at the level below it. This class requires a Firebird
+   # 2.5 or later client library.
    #
-   class Blob
-      #
-      # This is the constructor for the Blob class. This shouldn't really be
-      # used outside of the IBRuby library.
+   class NBackup
       #
-      def initialize
-      end
-      
-      
+      # This is the constructor for the NBackup class.
       #
-      # This method loads the entire data set for a blob as a string.
+      # ==== Parameters
+      # database::  Either a String or File object referring to the database
+      #             file to be backed up or restored.
+      # files::     Either a String or File object referring to the level 0
+      #             backup file, or an Array of these giving the backup file
+      #             for each level in turn.
       #
-      def to_s
+      def initialize(database, files)
       end
       
       
       #
-      # This method closes a blob, freeing any resources associated with it.
+      # This method fetches the database file for the backup.
       #
-      def close
+      def database
       end
       
       
       #
-      # This method loads the segments of a blob one after another. The blob
-      # segments are passed as strings to the block passed to the method.
-      #
-      def each
-         yield segment
-      end
-   end
-   
-   
-   #
-   # This class represents a InterBase generator entity.
-   #
-   class Generator
-      #
-      # This is the constructor for the Generator class. Note, this method
-      # assumes that the named generator already exists. If it doesn't then
-      # the object will be constructed but will fail during use.
+      # This method updates the database file for the backup.
       #
       # ==== Parameters
-      # name::        A string containing the generator name.
-      # connection::  A reference to the Connection object that will be used
-      #               to access the generator.
+      # setting::  Either a String or File object referring to the database
+      #            file.
       #
-      def initialize(name, connection)
+      def database=(setting)
       end
       
       
       #
-      # This is the accessor for the name attribute.
+      # This method fetches an Array of the backup file paths, one per level.
       #
-      def name
+      def files
       end
       
       
       #
-      # This is the accessor for the connection attribute.
+      # This method updates the backup files.
       #
-      def connection
+      # ==== Parameters
+      # setting::  Either a String or File object referring to the level 0
+      #            backup file or an Array of these, one for each level.
+      #
+      def files=(setting)
       end
       
       
       #
-      # This method fetches the last value generator from a generator.
-      #
-      # ==== Exceptions
-      # Exception::  Generated whenever a problem occurs accessing the
-      #              database generator.
+      # This method fetches the level of backup that the execute method will
+      # make. This is one less than the number of backup files, the last of
+      # which is the one written.
       #
-      def last
+      def level
       end
       
       
       #
-      # This method drops a generator from the database. After a successful
-      # call to this method the Generator object may not be used to obtain
-      # values unless it is recreated.
-      #
-      # ==== Exceptions
-      # Exception::  Generated whenever a problem occurs dropping the generator
-      #              from the database.
+      # This method fetches the no triggers setting for the backup. If set to
+      # true the database triggers are not fired while the task runs.
       #
-      def drop
+      def no_triggers
       end
       
       
       #
-      # This method fetches the next value, depending on a specified increment,
-      # from a generator.
+      # This method updates the no triggers setting for the backup.
       #
       # ==== Parameters
-      # step::  The step interval to be applied to the generator to obtain the
-      #         next value.
-      #
-      # ==== Exceptions
-      # Exception::  Generated whenever a problem occurs accessing the
-      #              database generator.
+      # setting::  Either true or false.
       #
-      def next(step)
+      def no_triggers=(setting)
       end
       
       
       #
-      # This method is used to determine whether a named generator exists
-      # within a database.
+      # This method makes a backup at the current level, writing the last of
+      # the backup files. The files for the lower levels must already exist.
+      # If a block is given then each line of output from the server is
+      # passed to it as it is produced.
       #
       # ==== Parameters
-      # name::        A string containing the generator name to check for.
-      # connection::  A reference to the Connection object to be used in
-      #               performing the check.
+      # manager::  A reference to the ServiceManager object to be used to
+      #            execute the backup.
       #
       # ==== Exceptions
-      # Exception::  Generated whenever a problem occurs determining the
-      #              existence of the generator.
+      # IBRubyException::  Generated whenever a problem occurs making the
+      #                    backup.
       #
-      def Generator.exists?(name, connection)
+      def execute(manager)
       end
       
       
       #
-      # This method creates a new generator within a database. This method
-      # returns a Generator object is successful.
+      # This method creates the database from the chain of backup files,
+      # applying each level in turn. The database file must not already
+      # exist. If a block is given then each line of output from the server is
+      # passed to it as it is produced.
       #
       # ==== Parameters
-      # name::        A string containing the name for the new generator.
-      # connection::  A reference to the Connection object that will be used to
-      #               create the generator.
+      # manager::  A reference to the ServiceManager object to be used to
+      #            execute the restore.
       #
       # ==== Exceptions
-      # Exception::  Generated whenever a problem occurs creating the new
-      #              generator in the database.
+      # IBRubyException::  Generated whenever a problem occurs restoring the
+      #                    database.
       #
-      def Generator.create(name, connection)
+      def restore(manager)
+      end
+      
+      
+      #
+      # This method fetches the log output from the last execute or restore.
+      #
+      def log
       end
    end
    
    
    #
-   # This class represents a connection to the service manager for a InterBase
-   # database server instance. 
+   # This class runs a queue of service manager tasks, such as backups, restores
+   # and sweeps, a number of them at once. Each worker thread connects a
+   # ServiceManager of its own to the server, so the tasks proceed on the server
+   # in parallel. A Hash is kept for every job queued with the following
+   # entries...
    #
-   class ServiceManager
+   # :action::   Either :execute for a task or :sweep for a sweep.
+   # :task::     The task object or, for a sweep, the database path.
+   # :status::   One of :pending, :running, :done or :failed.
+   # :error::    The exception raised by a failed job, or nil.
+   # :elapsed::  The number of seconds the job took, once it has finished.
+   #
+   class ServiceQueue
       #
-      # This is the constructor for the ServiceManager class.
+      # This is the constructor for the ServiceQueue class.
       #
       # ==== Parameters
-      # host::  The name of the host supporting the service manager to be
-      #         connected with.
+      # host::      The name of the server host to run the tasks on.
+      # user::      The user name to connect to the service manager with.
+      # password::  The password to connect to the service manager with.
+      # size::      The largest number of jobs to run at once. Defaults to 4.
       #
-      def initialize(host)
+      def initialize(host, user, password, size=4)
       end
       
       
       #
-      # This method attaches a ServiceManager object to its host service. The
-      # user name used to connect with can affect which services can be accessed
-      # on the server.
+      # This method queues a task to be run. This is also available as the
+      # << method.
       #
       # ==== Parameters
-      # user::      A string containing the user name to connect with.
-      # password::  A string containing the user password to connect with.
+      # task::  The task to be queued. This can be any object, such as a Backup,
+      #         Restore or NBackup, that has an execute method taking a
+      #         ServiceManager.
       #
-      def connect(user, password)
+      def add(task)
       end
       
       
       #
-      # This method disconnects a previously connected ServiceManager object.
+      # This method queues a sweep of a database.
       #
-      def disconnect
+      # ==== Parameters
+      # database::  Either a String or File object referring to the database
+      #             to be swept.
+      #
+      def sweep(database)
       end
       
       
       #
-      # This method is used to determine whether a ServiceManager object has
-      # been connected.
+      # This method fetches an Array of the job Hashes for the queue.
       #
-      def connected?
+      def jobs
       end
       
       
       #
-      # This method is used to batch execute a collection of task objects.
+      # This method fetches the largest number of jobs the queue will run at
+      # once.
       #
-      # ==== Parameters
-      # tasks::  One or more task objects to be executed by the service manager.
+      def size
+      end
+      
+      
+      #
+      # This method runs each of the pending jobs, returning once they have all
+      # finished. A job that raises an exception is marked as failed and the
+      # other jobs carry on. If a block is given then each job Hash is passed
+      # to it as the job finishes. Should the block raise an exception no
+      # more jobs are started, the jobs already running are waited for and
+      # the exception is raised again, leaving the remaining jobs pending.
       #
       # ==== Exceptions
-      # IBRubyException::  Generated whenever this method is called on a
-      #                      disconnected service manager or is a problem
-      #                      occurs executing one of the tasks.
+      # IBRubyException::  Generated if the queue is already running.
       #
-      def execute(*tasks)
+      def run
       end
    end
    
    
    #
-   # This class represents a service manager task to add a new user to a
-   # database instance. NOTE: This class does not currently work on the
-   # Mac OS X platform.
+   # This class represents a service manager task to gather statistics for a
+   # database, the same figures as produced by the gstat utility. The text
+   # produced by the server is parsed into Hashes with Symbol keys made from
+   # the names of the figures, so the header page fields include entries
+   # such as :oldest_transaction, :oldest_active, :oldest_snapshot and
+   # :next_transaction. Each table has entries such as :total_records,
+   # :total_versions, :max_versions, :fill_distribution (an Array of the page
+   # counts for each fill band) and :indices, a Hash of the index statistics
+   # keyed on index name. Each index has entries such as :depth, :nodes,
+   # :total_dup and :selectivity.
    #
-   class AddUser
-      # Attribute accessor.
-      attr_reader :user_name, :password, :first_name, :middle_name, :last_name
-      
-      # Attribute mutator.
-      attr_writer :user_name, :password, :first_name, :middle_name, :last_name
-      
+   class Statistics
       #
-      # This is a constructor for the AddUser class.
+      # This is the constructor for the Statistics class.
       #
       # ==== Parameters
-      # user_name::    A String containing the user name to be assigned to the
-      #                new user.
-      # password::     A String containing the password to be assigned to the
-      #                new user.
-      # first_name::   A String containing the first name to be associated with
-      #                the new user. Defaults to nil.
-      # middle_name::  A String containing the middle name to be associated
-      #                with the new user. Defaults to nil.
-      # last_name::    A String containing the last name to be associated with
-      #                the new user. Defaults to nil.
+      # database::  Either a String or File object referring to the database
+      #             to gather statistics for.
       #
-      def initialize(user_name, password, firsts_name=nil, middle_name=nil,
-                     last_name=nil)
+      def initialize(database)
       end
       
       
       #
-      # This method executes the add user task against a service manager.
-      #
-      # ==== Parameters
-      # manager::  A reference to the ServiceManager object to execute the task
-      #            on.
-      #
-      # ==== Exceptions
-      # IBRubyException::  Generated whenever a disconnected service manager
-      #                      is specified or an error occurs executing the
-      #                      task.
+      # This method fetches the database the statistics are gathered for.
       #
-      def execute(manager)
+      def database
       end
-   end
-   
-   
-   #
-   # This class represents a service manager task to remove an existing user
-   # from a database instance. NOTE: This class does not currently work on the
-   # Mac OS X platform.
-   #
-   class RemoveUser
-      # Attribute accessor.
-      attr_reader :user_name
       
-      # Attribute mutator.
-      attr_writer :user_name
       
       #
-      # This is a constructor for the RemoveUser class.
+      # This method updates the database the statistics are gathered for.
       #
       # ==== Parameters
-      # user_name::    A String containing the user name to be assigned to the
-      #                new user.
+      # setting::  Either a String or File object referring to the database.
       #
-      def initialize(user_name)
+      def database=(setting)
       end
       
       
       #
-      # This method executes the remove user task against a service manager.
+      # This method fetches the data pages setting. If true, which is the
+      # default, the data pages of each table are analysed.
+      #
+      def data_pages
+      end
+      
+      
+      #
+      # This method updates the data pages setting.
       #
       # ==== Parameters
-      # manager::  A reference to the ServiceManager object to execute the task
-      #            on.
+      # setting::  Either true or false.
       #
-      # ==== Exceptions
-      # IBRubyException::  Generated whenever a disconnected service manager
-      #                      is specified or an error occurs executing the
-      #                      task.
+      def data_pages=(setting)
+      end
+      
+      
       #
-      def execute(manager)
+      # This method fetches the index pages setting. If true, which is the
+      # default, the index pages of each table are analysed.
+      #
+      def index_pages
       end
-   end
-   
-   
-   #
-   # This class represents a service manager task to backup an existing database
-   # on the InterBase server. NOTE: This class does not currently work on the
-   # Mac OS X platform.
-   #
-   class Backup
-      # Attribute accessor.
-      attr_reader :backup_file, :database
       
-      # Attribute mutator.
-      attr_writer :backup_file, :database
       
       #
-      # This is the constructor for the Backup class.
+      # This method updates the index pages setting.
       #
       # ==== Parameters
-      # database::  A String or File giving the path and name (relative to the
-      #             database server) of the main database file for the database
-      #             to be backed up.
-      # file::      A String or File giving the path and name (relative to the
-      #             database server) of the back up file to be generated.
+      # setting::  Either true or false.
       #
-      def initialize(database, file)
+      def index_pages=(setting)
       end
       
       
       #
-      # This method fetches the blocking factor to be used in generating the
-      # back up. This will return nil until it has been explicitly set.
+      # This method fetches the record versions setting. If true the record
+      # and version counts for each table are included. Defaults to false.
       #
-      def blocking_factor
+      def record_versions
       end
       
       
       #
-      # This method sets the blocking factor to be used in generating the
-      # back up.
+      # This method updates the record versions setting.
       #
       # ==== Parameters
-      # size::  A reference to an integer containing the new back up blocking
-      #         factor setting.
+      # setting::  Either true or false.
       #
-      def blocking_factor=(size)
+      def record_versions=(setting)
       end
       
       
       #
-      # This method fetches the ignore checksums setting for a Backup object.
+      # This method fetches the system tables setting. If true the system
+      # tables are analysed as well. Defaults to false.
       #
-      def ignore_checksums
+      def system_tables
       end
       
       
       #
-      # This method is used to set the indicator for whether checksum values
-      # should be ignored in performing a backup.
+      # This method updates the system tables setting.
       #
       # ==== Parameters
-      # setting::  True to ignore checksums, false otherwise.
+      # setting::  Either true or false.
       #
-      def ignore_checksums=(setting)
+      def system_tables=(setting)
       end
       
       
       #
-      # This method fetches the ignore limbo setting for a Backup object.
+      # This method fetches an Array of the names of the tables to gather
+      # statistics for, or nil if all tables are to be analysed.
       #
-      def ignore_limbo
+      def table_names
       end
       
       
       #
-      # This method is used to set the indicator for whether limbo transactions
-      # should be ignored in performing a backup.
+      # This method updates the names of the tables to gather statistics for.
+      # This requires a Firebird 2.5 or later client library.
       #
       # ==== Parameters
-      # setting::  True to ignore limbo transactions, false otherwise.
+      # setting::  A String or Array of Strings giving the table names, or nil
+      #            for all tables.
       #
-      def ignore_limbo=(setting)
+      def table_names=(setting)
       end
       
       
       #
-      # This method fetches the metadata only setting for a Backup object.
+      # This method gathers the statistics. If none of the data pages, index
+      # pages and record versions settings are true then only the header page
+      # is analysed. If a block is given then each line of text from the
+      # server is passed to it as it is produced.
       #
-      def metadata_only
+      # ==== Parameters
+      # manager::  A reference to the ServiceManager object to be used to
+      #            gather the statistics.
+      #
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever a problem occurs gathering the
+      #                    statistics.
+      #
+      def execute(manager)
       end
       
       
       #
-      # This method is used to set the indicator for whether a backup stores
-      # only the database metadata.
-      #
-      # ==== Parameters
-      # setting::  True to store only metadata, false otherwise.
+      # This method fetches a Hash of the database header page fields from
+      # the last execute, or nil.
       #
-      def metadata_only=(setting)
+      def header
       end
       
       
       #
-      # This method fetches the garbage collect setting for a Backup object.
+      # This method fetches a Hash of the table statistics from the last
+      # execute, keyed on table name, or nil.
       #
-      def garbage_collect
+      def tables
       end
       
       
       #
-      # This method is used to set the indicator for whether the backup will
-      # undertake garbage collection.
+      # This method fetches the text produced by the server for the last
+      # execute.
+      #
+      def log
+      end
+   end
+   
+   
+   #
+   # This class represents a user trace session on a Firebird server, started
+   # through the service manager. The trace output is read as it is produced
+   # and each event in it is parsed into a Hash, holding such of the
+   # following entries as the event provides...
+   #
+   # :event::           The event type, such as EXECUTE_STATEMENT_FINISH.
+   # :time::            The event time stamp as a String.
+   # :process_id::      The id of the server process.
+   # :database::        The database path.
+   # :attachment_id::   The id of the attachment.
+   # :user::            The user and role names.
+   # :charset::         The attachment character set.
+   # :remote::          The protocol and remote address of the attachment.
+   # :transaction_id::  The id of the transaction.
+   # :statement_id::    The id of the statement.
+   # :sql::             The text of the statement.
+   # :plan::            The plan of the statement.
+   # :parameters::      An Array of the parameter types and values.
+   # :records::         The number of records fetched.
+   # :elapsed::         The time taken in milliseconds.
+   # :reads::           The number of page reads.
+   # :writes::          The number of page writes.
+   # :fetches::         The number of page fetches.
+   # :marks::           The number of pages marked.
+   # :tables::          A Hash, keyed on table name, of Hashes of the table
+   #                    counters (:natural, :index, :update, :insert,
+   #                    :delete, :backout, :purge and :expunge).
+   # :text::            The full text of the event.
+   #
+   # This class requires a Firebird 2.5 or later client library.
+   #
+   class TraceSession
+      #
+      # This is the constructor for the TraceSession class.
       #
       # ==== Parameters
-      # setting::  True to perform garbage collection, false otherwise.
+      # config::  A String containing the trace configuration, in the format
+      #           of the server's fbtrace.conf file.
+      # name::    An optional name for the session.
       #
-      def garbage_collect=(setting)
+      def initialize(config, name=nil)
       end
       
       
       #
-      # This method fetches the non-transportable setting for a Backup object.
+      # This method fetches the trace configuration for the session.
       #
-      def non_transportable
+      def config
       end
       
       
       #
-      # This method is used to set the indicator for whether backup generated
-      # by the task will be platform specific.
+      # This method fetches the name of the session.
       #
-      # ==== Parameters
-      # setting::  True to generate a platform specific backup, false otherwise.
+      def name
+      end
+      
+      
       #
-      def non_transportable=(setting)
+      # This method fetches the id given to the session by the server, or nil
+      # if the session has not been started.
+      #
+      def id
       end
       
       
       #
-      # This method fetches the convert tables setting for a Backup object.
+      # This method starts the session and passes each event, as a Hash, to
+      # the block. The method does not return until the session has been
+      # stopped, either by the stop method or by the service manager being
+      # disconnected, so it is normally called from a thread of its own. The
+      # interpreter lock is released while waiting for output. Leaving the
+      # block early, whether by raising an exception or with break, ends the
+      # trace. The service manager is reconnected, with the details it was
+      # connected with, so that it is free for other use afterwards.
       #
-      def convert_tables
+      # ==== Parameters
+      # manager::  A reference to the ServiceManager object to run the trace
+      #            on. This cannot be used for anything else until the
+      #            session stops.
+      #
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever no block is given or the trace
+      #                    cannot be started.
+      #
+      def start(manager)
+         yield event
       end
       
       
       #
-      # This method is used to set the indicator for whether external tables
-      # will be converted to internal tables as part of the backup.
+      # This method stops the session.
       #
       # ==== Parameters
-      # setting::  True to convert external tables, false otherwise.
+      # manager::  A reference to a ServiceManager object to make the request
+      #            on. This must not be the one running the trace.
       #
-      def convert_tables=(setting)
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever the session has not been started
+      #                    or the request fails.
+      #
+      def stop(manager)
       end
       
       
       #
-      # This method is used to execute a backup task against a service manager.
+      # This method suspends the session, so that no events are produced until
+      # it is resumed.
       #
       # ==== Parameters
-      # manager::  A reference to the service manager to execute the backup
-      #            task against.
+      # manager::  A reference to a ServiceManager object to make the request
+      #            on. This must not be the one running the trace.
       #
       # ==== Exceptions
-      # IBRubyException::  Generated whenever a disconnected service manager
-      #                      is specified or a problem occurs executing the
-      #                      task.
+      # IBRubyException::  Generated whenever the session has not been started
+      #                    or the request fails.
       #
-      def execute(manager)
+      def suspend(manager)
       end
       
       
       #
-      # This method fetches the log value for a Backup task. This value will
-      # always be nil until the task has been executed. After a successful
-      # execution the log value should contain output from the backup task
-      # generated on the server.
+      # This method resumes a suspended session.
       #
-      def log
+      # ==== Parameters
+      # manager::  A reference to a ServiceManager object to make the request
+      #            on. This must not be the one running the trace.
+      #
+      # ==== Exceptions
+      # IBRubyException::  Generated whenever the session has not been started
+      #                    or the request fails.
+      #
+      def resume(manager)
       end
    end
    
@@ -1768,17 +3225,42 @@ module IBRuby
       
       #
       # This method is used to execute a restore task against a service manager.
+      # The output of the task is read from the server a line at a time
+      # without holding the interpreter lock, so other threads keep running
+      # while the task works. If a block is given each line is passed to it
+      # as soon as it arrives.
+      #
+      # Rather than using the server side backup file the backup can be
+      # read from a Ruby IO, such as a pipe or socket, by passing the IO as
+      # the :io option. This needs a Firebird 2.5 or later client library.
+      # The backup data passes through the service manager connection and
+      # can be compressed with zlib (in gzip format) or zstd on a separate
+      # native thread, given by a :compression option of :zlib or :zstd.
+      # The compression must match that used when the backup was written.
       #
       # ==== Parameters
       # manager::  A reference to the service manager to execute the restore
       #            task against.
+      # options::  A Hash of options, :io and :compression. Defaults to nil.
       #
       # ==== Exceptions
       # IBRubyException::  Generated whenever a disconnected service manager
       #                      is specified or a problem occurs executing the
       #                      task.
       #
-      def execute(manager)
+      def execute(manager, options=nil)
+      end
+      
+      
+      #
+      # This method sets a block to be called with progress details while a
+      # Restore task executes. The block is passed the number of tables
+      # processed so far and the total number of rows in them processed so
+      # far, worked out from the verbose output of the task. It is called
+      # whenever either changes. Calling the method without a block removes
+      # any block previously set.
+      #
+      def on_progress(&block)
       end
       
       
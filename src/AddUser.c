@@ -27,6 +27,7 @@
 #include "AddUser.h"
 #include "ibase.h"
 #include "ServiceManager.h"
+#include "Services.h"
 
 /* Function prototypes. */
 static VALUE initializeAddUser(int, VALUE *, VALUE);
@@ -330,7 +331,7 @@ VALUE executeAddUser(VALUE self, VALUE manager)
    createAddUserBuffer(self, &buffer, &length);
 
    /* Start the service request. */
-   if(isc_service_start(status, &handle->handle, NULL, length, buffer))
+   if(startService(status, &handle->handle, length, buffer))
    {
       free(buffer);
       rb_ibruby_raise(status, "Error adding user.");
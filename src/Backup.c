@@ -28,6 +28,7 @@
 #include "ibase.h"
 #include "ServiceManager.h"
 #include "Services.h"
+#include "ServiceStream.h"
 
 /* Function prototypes. */
 static VALUE getBackupFile(VALUE);
@@ -48,9 +49,10 @@ static VALUE getBackupNonTransportable(VALUE);
 static VALUE setBackupNonTransportable(VALUE, VALUE);
 static VALUE getBackupConvertTables(VALUE);
 static VALUE setBackupConvertTables(VALUE, VALUE);
-static VALUE executeBackup(VALUE, VALUE);
+static VALUE executeBackup(int, VALUE *, VALUE);
+static VALUE setBackupProgress(VALUE);
 static VALUE getBackupLog(VALUE);
-static void createBackupBuffer(VALUE, VALUE, VALUE, char **, short *);
+static void createBackupBuffer(VALUE, VALUE, VALUE, char **, short *, int);
 
 
 /* Globals. */
@@ -108,6 +110,7 @@ VALUE initializeBackup(VALUE self, VALUE database, VALUE file)
    rb_iv_set(self, "@files", files);
    rb_iv_set(self, "@options", rb_hash_new());
    rb_iv_set(self, "@log", Qnil);
+   rb_iv_set(self, "@progress", Qnil);
 
    return(self);
 }
@@ -523,22 +526,51 @@ VALUE setBackupConvertTables(VALUE self, VALUE setting)
 
 
 /**
- * This function provides the execute method for the Backup class.
- *
- * @param  self     A reference to the Backup object to be executed.
- * @param  manager  A reference to the ServiceManager object that will be used
- *                  to execute the backup.
+ * This function provides the execute method for the Backup class. Each line
+ * of the service output is passed to the block, if one is given, as it is
+ * produced. If an IO is given in the options the backup is written to it,
+ * rather than to the backup file, and there is no log.
+ *
+ * @param  argc  A count of the number of arguments passed to the function.
+ * @param  argv  A pointer to the array of arguments passed to the function.
+ *               The first is the ServiceManager object that will be used to
+ *               execute the backup and the second an optional Hash of
+ *               options, :io and :compression.
+ * @param  self  A reference to the Backup object to be executed.
  *
  * @return  A reference to the Backup object executed.
  *
  */
-VALUE executeBackup(VALUE self, VALUE manager)
+VALUE executeBackup(int argc, VALUE *argv, VALUE self)
 {
-   ManagerHandle *handle   = NULL;
-   short         length    = 0;
-   char          *buffer   = NULL;
+   ManagerHandle *handle     = NULL;
+   short         length      = 0;
+   char          *buffer     = NULL;
+   VALUE         manager     = Qnil,
+                 io          = Qnil,
+                 files       = rb_iv_get(self, "@files");
+   int           compression = STREAM_COMPRESSION_NONE;
    ISC_STATUS    status[20];
 
+   if(argc < 1 || argc > 2)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               argc < 1 ? 1 : 2);
+   }
+   manager = argv[0];
+   if(argc > 1 && argv[1] != Qnil)
+   {
+      io = rb_hash_aref(argv[1], toSymbol("io"));
+   }
+   if(io != Qnil)
+   {
+      /* The service writes the backup to its standard output. */
+      compression = getStreamCompression(rb_hash_aref(argv[1],
+                                                      toSymbol("compression")));
+      files       = rb_hash_new();
+      rb_hash_aset(files, rb_str_new2("stdout"), Qnil);
+   }
+
    /* Check that the service manager is connected. */
    Data_Get_Struct(manager, ManagerHandle, handle);
    if(handle->handle == 0)
@@ -547,11 +579,12 @@ VALUE executeBackup(VALUE self, VALUE manager)
                         "Database backup error. Service manager not connected.");
    }
 
-   createBackupBuffer(rb_iv_get(self, "@database"), rb_iv_get(self, "@files"),
-                      rb_iv_get(self, "@options"), &buffer, &length);
+   createBackupBuffer(rb_iv_get(self, "@database"), files,
+                      rb_iv_get(self, "@options"), &buffer, &length,
+                      io == Qnil);
 
    /* Start the service request. */
-   if(isc_service_start(status, &handle->handle, NULL, length, buffer))
+   if(startService(status, &handle->handle, length, buffer))
    {
       free(buffer);
       rb_ibruby_raise(status, "Error performing database backup.");
@@ -559,12 +592,38 @@ VALUE executeBackup(VALUE self, VALUE manager)
    free(buffer);
 
    /* Query the service until it has completed. */
-   rb_iv_set(self, "@log", queryService(&handle->handle));
+   if(io != Qnil)
+   {
+      rb_iv_set(self, "@log", Qnil);
+      writeServiceOutput(&handle->handle, io, compression);
+   }
+   else
+   {
+      rb_iv_set(self, "@log", queryService(&handle->handle,
+                                           rb_iv_get(self, "@progress")));
+   }
 
    return(self);
 }
 
 
+/**
+ * This function provides the on_progress method for the Backup class, setting
+ * the block to be called with counts of the tables and rows processed as the
+ * backup is executed.
+ *
+ * @param  self  A reference to the Backup object to make the call on.
+ *
+ * @return  A reference to the Backup object.
+ *
+ */
+VALUE setBackupProgress(VALUE self)
+{
+   rb_iv_set(self, "@progress", rb_block_given_p() ? rb_block_proc() : Qnil);
+   return(self);
+}
+
+
 /**
  * This function provides the log attribute accessor for the Backup class.
  *
@@ -594,10 +653,11 @@ VALUE getBackupLog(VALUE self)
  *                  buffer.
  * @param  length   A pointer to a short integer that will be assigned the
  *                  length of buffer.
+ * @param  verbose  True to ask for verbose output from the backup.
  *
  */
 void createBackupBuffer(VALUE from, VALUE to, VALUE options, char **buffer,
-                        short *length)
+                        short *length, int verbose)
 {
    ID    id        = rb_intern("key?");
    VALUE names     = rb_funcall(to, rb_intern("keys"), 0),
@@ -620,7 +680,7 @@ void createBackupBuffer(VALUE from, VALUE to, VALUE options, char **buffer,
    }
 
    /* Calculate the length needed for the buffer. */
-   *length = 2;
+   *length = verbose ? 2 : 1;
    *length += strlen(STR2CSTR(from)) + 3;
 
    /* Count file name and length sizes. */
@@ -746,7 +806,10 @@ void createBackupBuffer(VALUE from, VALUE to, VALUE options, char **buffer,
       position += 4;
    }
 
-   *position++ = isc_spb_verbose;
+   if(verbose)
+   {
+      *position++ = isc_spb_verbose;
+   }
 }
 
 
@@ -778,6 +841,7 @@ void Init_Backup(VALUE module)
    rb_define_method(cBackup, "non_transportable=", setBackupNonTransportable, 1);
    rb_define_method(cBackup, "convert_tables", getBackupConvertTables, 0);
    rb_define_method(cBackup, "convert_tables=", setBackupConvertTables, 1);
-   rb_define_method(cBackup, "execute", executeBackup, 1);
+   rb_define_method(cBackup, "execute", executeBackup, -1);
+   rb_define_method(cBackup, "on_progress", setBackupProgress, 0);
    rb_define_method(cBackup, "log", getBackupLog, 0);
 }
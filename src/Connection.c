@@ -53,6 +53,10 @@
 #include "Connection.h"
 
 #include "Database.h"
+#include "EventListener.h"
+#include "IOStats.h"
+#include "GapMonitor.h"
+#include "Parallel.h"
 
 #include "ResultSet.h"
 
@@ -61,6 +65,22 @@
 #include "Transaction.h"
 
 #include "Common.h"
+#include "Threads.h"
+#include <ctype.h>
+
+
+
+/* Type definitions. */
+typedef struct
+{
+   isc_db_handle *handle;
+   char          *items,
+                 *buffer;
+   short         count,
+                 size;
+   ISC_STATUS    *status,
+                 result;
+} DatabaseInfoCall;
 
 
 
@@ -78,7 +98,7 @@ static VALUE closeConnection(VALUE);
 
 static VALUE getConnectionDatabase(VALUE);
 
-static VALUE startConnectionTransaction(VALUE);
+static VALUE startConnectionTransaction(int, VALUE *, VALUE);
 
 static VALUE connectionToString(VALUE);
 
@@ -101,6 +121,29 @@ VALUE executeImmediateBlock(VALUE);
 VALUE executeImmediateRescue(VALUE, VALUE);
 
 char *createDPB(VALUE, VALUE, VALUE, short *);
+static VALUE executeSharedQuery(VALUE, VALUE);
+static int matchesKeyword(const char *, const char *);
+void *databaseInfoCall(void *);
+static int startsWithKeyword(const char *, const char *);
+static int containsKeyword(const char *, const char *);
+VALUE getReadTransaction(VALUE);
+void releaseReadTransaction(VALUE);
+static VALUE getConnectionStatementTimeout(VALUE);
+static VALUE setConnectionStatementTimeout(VALUE, VALUE);
+static VALUE cancelConnectionOperation(VALUE);
+static VALUE listenForConnectionEvents(int, VALUE *, VALUE);
+static VALUE scanConnectionTable(int, VALUE *, VALUE);
+static VALUE getConnectionIOStats(VALUE);
+static VALUE measureConnectionIO(VALUE);
+static VALUE getConnectionTransactionMarkers(VALUE);
+static VALUE explainConnectionQuery(VALUE, VALUE);
+VALUE explainBlock(VALUE);
+VALUE explainEnsure(VALUE);
+static VALUE retryConnectionTransaction(int, VALUE *, VALUE);
+VALUE retryAttempt(VALUE);
+VALUE retryAttemptBody(VALUE);
+VALUE retryAttemptEnsure(VALUE);
+VALUE retryAttemptRescue(VALUE, VALUE);
 
 
 
@@ -146,8 +189,12 @@ static VALUE allocateConnection(VALUE klass)
 
       /* Wrap the structure in a class. */
 
-      connection->handle = 0;
-
+      connection->handle    = 0;
+      connection->reads     = 0;
+      connection->refreshed = 0;
+      connection->timeout   = 0;
+      connection->dpb       = NULL;
+      connection->length    = 0;
       instance = Data_Wrap_Struct(klass, NULL, connectionFree, connection);
 
    }
@@ -290,7 +337,9 @@ static VALUE initializeConnection(int argc, VALUE *argv, VALUE self)
 
    }
 
-   free(dpb);
+   /* Keep the parameters for opening further attachments. */
+   connection->dpb    = dpb;
+   connection->length = length;
 
    
 
@@ -302,6 +351,8 @@ static VALUE initializeConnection(int argc, VALUE *argv, VALUE self)
 
    rb_iv_set(self, "@transactions", rb_ary_new());
 
+   rb_iv_set(self, "@read_transaction", Qnil);
+   rb_iv_set(self, "@listeners", rb_ary_new());
    
 
    return(self);
@@ -428,6 +479,12 @@ static VALUE closeConnection(VALUE self)
 
 
 
+      /* Stop any event listeners. */
+      rb_event_listeners_close(self);
+
+      /* Release the shared read only transaction. */
+      releaseReadTransaction(self);
+
       /* Roll back an outstanding transactions. */
 
       while((transaction = rb_ary_pop(transactions)) != Qnil)
@@ -518,6 +575,9 @@ static VALUE getConnectionDatabase(VALUE self)
 
  *
 
+ * @param  argc  A count of the arguments passed to the function.
+ * @param  argv  A pointer to the arguments passed to the function. The only
+ *               argument accepted is an optional TransactionOptions object.
  * @param  self  A reference to the Database object to start the transaction
 
  *               on.
@@ -530,11 +590,17 @@ static VALUE getConnectionDatabase(VALUE self)
 
  */
 
-static VALUE startConnectionTransaction(VALUE self)
+static VALUE startConnectionTransaction(int argc, VALUE *argv, VALUE self)
 
 {
 
-   VALUE result = rb_transaction_new(self);
+   VALUE result = Qnil;
+
+   if(argc > 1)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc, 1);
+   }
+   result = rb_transaction_new_with_options(self, argc > 0 ? argv[0] : Qnil);
 
          
 
@@ -704,6 +770,9 @@ static VALUE executeOnConnection(VALUE self, VALUE sql, VALUE transaction)
 
  * This function provides the execute_immediate method for the Connection class.
 
+ * Queries are executed through the shared read only transaction for the
+ * connection if the SHARED_READ_TRANSACTION setting is on, which it is not by
+ * default, other statements are executed within a transaction of their own.
  *
 
  * @param  self  A reference to the connection object to perform the execution
@@ -724,13 +793,30 @@ static VALUE executeOnConnectionImmediate(VALUE self, VALUE sql)
 
 {
 
-   VALUE transaction = rb_transaction_new(self),
+   VALUE transaction = Qnil,
 
          set         = Qnil,
 
          results     = Qnil,
 
          array       = rb_ary_new();
+   char  *text       = STR2CSTR(sql);
+
+   if(getIBRubySetting("SHARED_READ_TRANSACTION") == Qtrue &&
+      (startsWithKeyword(text, "SELECT") ||
+       startsWithKeyword(text, "WITH")) &&
+      !containsKeyword(text, "UPDATE") && !containsKeyword(text, "LOCK"))
+   {
+      return(executeSharedQuery(self, sql));
+   }
+
+   /* Don't leave the shared transaction holding objects being changed. */
+   if(startsWithKeyword(text, "CREATE") || startsWithKeyword(text, "ALTER") ||
+      startsWithKeyword(text, "DROP") || startsWithKeyword(text, "RECREATE"))
+   {
+      releaseReadTransaction(self);
+   }
+   transaction = rb_transaction_new(self);
 
 
 
@@ -1131,6 +1217,213 @@ VALUE getTransactions(VALUE self)
 
 
 
+/**
+ * This function executes a query through the shared read only transaction for
+ * a connection. The transaction is not assigned to the ResultSet generated so
+ * it remains active after the ResultSet is exhausted or closed.
+ *
+ * @param  self  A reference to the Connection object to execute the query on.
+ * @param  sql   A reference to a String containing the query to be executed.
+ *
+ * @return  A reference to the ResultSet generated by the query or, if a block
+ *          was given, the last value returned by the block.
+ *
+ */
+static VALUE executeSharedQuery(VALUE self, VALUE sql)
+{
+   VALUE results = Qnil,
+         array   = rb_ary_new();
+
+   rb_ary_push(array, self);
+   rb_ary_push(array, getReadTransaction(self));
+   rb_ary_push(array, sql);
+   results = executeBlock(array);
+   if(TYPE(results) == T_DATA &&
+      RDATA(results)->dfree == (RUBY_DATA_FUNC)resultSetFree &&
+      rb_block_given_p())
+   {
+      results = rb_rescue(executeImmediateBlock, results,
+                          executeImmediateRescue, results);
+   }
+
+   return(results);
+}
+
+
+/**
+ * This function checks whether a piece of SQL text starts with a keyword. The
+ * keyword must be followed by a character that can't appear in an identifier.
+ *
+ * @param  text     A pointer to the SQL text to be checked.
+ * @param  keyword  A pointer to the upper case keyword to check for.
+ *
+ * @return  Non-zero if the text starts with the keyword, zero otherwise.
+ *
+ */
+static int matchesKeyword(const char *text, const char *keyword)
+{
+   while(*keyword != '\0' && toupper((unsigned char)*text) == *keyword)
+   {
+      text++;
+      keyword++;
+   }
+
+   return(*keyword == '\0' && !isalnum((unsigned char)*text) &&
+          *text != '_' && *text != '$');
+}
+
+
+/**
+ * This function checks whether a SQL statement starts with a keyword, ignoring
+ * any leading white space.
+ *
+ * @param  sql      A pointer to the SQL statement to be checked.
+ * @param  keyword  A pointer to the upper case keyword to check for.
+ *
+ * @return  Non-zero if the statement starts with the keyword, zero otherwise.
+ *
+ */
+static int startsWithKeyword(const char *sql, const char *keyword)
+{
+   while(isspace((unsigned char)*sql))
+   {
+      sql++;
+   }
+
+   return(matchesKeyword(sql, keyword));
+}
+
+
+/**
+ * This function checks whether a keyword appears anywhere within a SQL
+ * statement. Quoted strings, quoted identifiers and comments are skipped.
+ *
+ * @param  sql      A pointer to the SQL statement to be checked.
+ * @param  keyword  A pointer to the upper case keyword to check for.
+ *
+ * @return  Non-zero if the keyword appears in the statement, zero otherwise.
+ *
+ */
+static int containsKeyword(const char *sql, const char *keyword)
+{
+   const char *position = sql;
+   int        result    = 0;
+
+   while(*position != '\0' && !result)
+   {
+      if(*position == '\'' || *position == '"')
+      {
+         const char quote = *position++;
+
+         while(*position != '\0' && *position != quote)
+         {
+            position++;
+         }
+      }
+      else if(position[0] == '-' && position[1] == '-')
+      {
+         while(*position != '\0' && *position != '\n')
+         {
+            position++;
+         }
+      }
+      else if(position[0] == '/' && position[1] == '*')
+      {
+         position += 2;
+         while(*position != '\0' &&
+               !(position[0] == '*' && position[1] == '/'))
+         {
+            position++;
+         }
+         if(*position != '\0')
+         {
+            position++;
+         }
+      }
+      else if(position == sql || (!isalnum((unsigned char)position[-1]) &&
+                                  position[-1] != '_' && position[-1] != '$'))
+      {
+         result = matchesKeyword(position, keyword);
+      }
+      if(*position != '\0')
+      {
+         position++;
+      }
+   }
+
+   return(result);
+}
+
+
+/**
+ * This function fetches the shared read only transaction for a Connection,
+ * starting it if need be. The transaction is read committed so a periodic
+ * commit retaining, controlled by the READ_TRANSACTION_STATEMENTS and
+ * READ_TRANSACTION_SECONDS settings, is all that is needed to stop it from
+ * holding back the oldest interesting transaction.
+ *
+ * @param  self  A reference to the Connection object to fetch the transaction
+ *               for.
+ *
+ * @return  A reference to the active shared Transaction object.
+ *
+ */
+VALUE getReadTransaction(VALUE self)
+{
+   VALUE            transaction = rb_iv_get(self, "@read_transaction"),
+                    statements  = getIBRubySetting("READ_TRANSACTION_STATEMENTS"),
+                    seconds     = getIBRubySetting("READ_TRANSACTION_SECONDS");
+   ConnectionHandle *connection = NULL;
+   time_t           now         = time(NULL);
+
+   Data_Get_Struct(self, ConnectionHandle, connection);
+   if(transaction == Qnil ||
+      rb_funcall(transaction, rb_intern("active?"), 0) == Qfalse)
+   {
+      transaction = rb_read_transaction_new(self);
+      rb_iv_set(self, "@read_transaction", transaction);
+      connection->reads     = 0;
+      connection->refreshed = now;
+   }
+   else if((TYPE(statements) == T_FIXNUM && FIX2INT(statements) > 0 &&
+            connection->reads >= FIX2INT(statements)) ||
+           (TYPE(seconds) == T_FIXNUM && FIX2INT(seconds) > 0 &&
+            now - connection->refreshed >= FIX2INT(seconds)))
+   {
+      rb_commit_retaining(transaction);
+      connection->reads     = 0;
+      connection->refreshed = now;
+   }
+   connection->reads++;
+
+   return(transaction);
+}
+
+
+/**
+ * This function commits and discards the shared read only transaction for a
+ * Connection, if it has one. Any ResultSet still open on the transaction can
+ * no longer be read from afterwards.
+ *
+ * @param  self  A reference to the Connection object to release the
+ *               transaction for.
+ *
+ */
+void releaseReadTransaction(VALUE self)
+{
+   VALUE transaction = rb_iv_get(self, "@read_transaction");
+
+   if(transaction != Qnil)
+   {
+      rb_iv_set(self, "@read_transaction", Qnil);
+      if(rb_funcall(transaction, rb_intern("active?"), 0) == Qtrue)
+      {
+         rb_funcall(transaction, rb_intern("commit"), 0);
+      }
+   }
+}
+
+
 /**
 
  * This method creates a database parameter buffer to be used in creating a
@@ -1531,6 +1824,10 @@ void connectionFree(void *connection)
 
       }
 
+      if(handle->dpb != NULL)
+      {
+         free(handle->dpb);
+      }
       free(handle);
 
    }
@@ -1605,6 +1902,557 @@ VALUE rb_connection_new(VALUE database, VALUE user, VALUE password, VALUE option
 
 
 
+/**
+ * This function provides the statement_timeout method for the Connection
+ * class.
+ *
+ * @param  self  A reference to the Connection object to make the call on.
+ *
+ * @return  The number of seconds statements executed on the connection may
+ *          run for, or nil if there is no limit.
+ *
+ */
+static VALUE getConnectionStatementTimeout(VALUE self)
+{
+   ConnectionHandle *connection = NULL;
+
+   Data_Get_Struct(self, ConnectionHandle, connection);
+
+   return(connection->timeout > 0 ?
+          rb_float_new(connection->timeout / 1000.0) : Qnil);
+}
+
+
+/**
+ * This function provides the statement_timeout= method for the Connection
+ * class, limiting the time that statements executed on the connection may
+ * run for.
+ *
+ * @param  self     A reference to the Connection object to make the call on.
+ * @param  seconds  A reference to the number of seconds, which may be
+ *                  fractional, or nil or zero to remove the limit.
+ *
+ * @return  A reference to the seconds value.
+ *
+ */
+static VALUE setConnectionStatementTimeout(VALUE self, VALUE seconds)
+{
+   ConnectionHandle *connection = NULL;
+
+   Data_Get_Struct(self, ConnectionHandle, connection);
+   connection->timeout = getTimeoutValue(seconds);
+
+   return(seconds);
+}
+
+
+/**
+ * This function provides the cancel method for the Connection class. The
+ * operation currently running on the connection, which will be running on
+ * another thread, is interrupted and raises an exception in that thread.
+ *
+ * @param  self  A reference to the Connection object to make the call on.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE cancelConnectionOperation(VALUE self)
+{
+   ConnectionHandle *connection = NULL;
+
+   Data_Get_Struct(self, ConnectionHandle, connection);
+   if(connection->handle == 0)
+   {
+      rb_ibruby_raise(NULL, "Connection is closed.");
+   }
+#if defined(FB_API_VER) && FB_API_VER >= 25
+   {
+      ISC_STATUS status[20];
+
+      if(fb_cancel_operation(status, &connection->handle, fb_cancel_raise) != 0)
+      {
+         rb_ibruby_raise(status, "Error cancelling connection operation.");
+      }
+   }
+#else
+   rb_ibruby_raise(NULL, "Operation cancellation is not supported by the "\
+                   "database client library.");
+#endif
+
+   return(self);
+}
+
+
+/**
+ * This function provides the on_event method for the Connection class. The
+ * block is called with the event name and count whenever one of the named
+ * events is posted by a committed transaction, from a thread started for the
+ * listener.
+ *
+ * @param  argc  A count of the number of arguments passed to the function.
+ * @param  argv  A pointer to the array of arguments passed to the function,
+ *               being the names of the events to listen for.
+ * @param  self  A reference to the Connection object to make the call on.
+ *
+ * @return  A reference to the EventListener created.
+ *
+ */
+static VALUE listenForConnectionEvents(int argc, VALUE *argv, VALUE self)
+{
+   if(!rb_block_given_p())
+   {
+      rb_ibruby_raise(NULL, "No block specified for event listener.");
+   }
+
+   return(rb_event_listener_new(self, rb_ary_new4(argc, argv),
+                                rb_block_proc()));
+}
+
+
+/**
+ * This function provides the parallel_scan method for the Connection class.
+ *
+ * @param  argc  A count of the number of arguments passed to the function.
+ * @param  argv  A pointer to the array of arguments passed to the function.
+ *               These are the table name and an optional Hash of options.
+ * @param  self  A reference to the Connection object to make the call on.
+ *
+ * @return  The total number of rows passed to the block.
+ *
+ */
+static VALUE scanConnectionTable(int argc, VALUE *argv, VALUE self)
+{
+   if(argc < 1 || argc > 2)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               argc < 1 ? 1 : 2);
+   }
+
+   return(rb_parallel_scan(self, argv[0], argc > 1 ? argv[1] : Qnil));
+}
+
+
+/**
+ * This function provides the io_stats method for the Connection class.
+ *
+ * @param  self  A reference to the Connection object to make the call on.
+ *
+ * @return  A reference to a Hash of the page I/O counts and per table
+ *          operation counts for the connection.
+ *
+ */
+static VALUE getConnectionIOStats(VALUE self)
+{
+   return(rb_io_stats(self));
+}
+
+
+/**
+ * This function provides the measure method for the Connection class, which
+ * runs a block and returns the I/O and operation counts it caused.
+ *
+ * @param  self  A reference to the Connection object to make the call on.
+ *
+ * @return  A reference to a Hash of the changes in the counts.
+ *
+ */
+static VALUE measureConnectionIO(VALUE self)
+{
+   return(rb_measure_io(self));
+}
+
+
+/**
+ * This function provides the transaction_markers method for the Connection
+ * class.
+ *
+ * @param  self  A reference to the Connection object to make the call on.
+ *
+ * @return  A reference to a Hash of the transaction markers.
+ *
+ */
+static VALUE getConnectionTransactionMarkers(VALUE self)
+{
+   return(rb_transaction_markers(self));
+}
+
+
+/**
+ * This function provides the explain method for the Connection class. The
+ * SQL is prepared, but not executed, in a transaction that is rolled back
+ * afterwards.
+ *
+ * @param  self  A reference to the Connection object to make the call on.
+ * @param  sql   A reference to a String containing the SQL to be explained.
+ *
+ * @return  A reference to a String containing the plan chosen by the
+ *          optimizer, or nil if the statement has no plan.
+ *
+ */
+static VALUE explainConnectionQuery(VALUE self, VALUE sql)
+{
+   VALUE transaction = rb_transaction_new(self),
+         array       = rb_ary_new();
+
+   rb_ary_push(array, transaction);
+   rb_ary_push(array, rb_statement_new(self, transaction, sql, INT2FIX(3)));
+
+   return(rb_ensure(explainBlock, array, explainEnsure, array));
+}
+
+
+/**
+ * This function fetches the plan for the explain method.
+ *
+ * @param  array  A reference to an Array holding the Transaction and the
+ *                Statement to be explained.
+ *
+ * @return  A reference to the plan String, or nil.
+ *
+ */
+VALUE explainBlock(VALUE array)
+{
+   return(rb_funcall(rb_ary_entry(array, 1), rb_intern("plan"), 0));
+}
+
+
+/**
+ * This function closes the statement and rolls back the transaction used by
+ * the explain method.
+ *
+ * @param  array  A reference to an Array holding the Transaction and the
+ *                Statement that was explained.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE explainEnsure(VALUE array)
+{
+   rb_statement_close(rb_ary_entry(array, 1));
+   rb_funcall(rb_ary_entry(array, 0), rb_intern("rollback"), 0);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function provides the with_retry method for the Connection class. A
+ * transaction is started and passed to the block, being committed if the
+ * block completes normally. Should the block or the commit fail with a lock
+ * conflict or deadlock the transaction is rolled back and the block is run
+ * again in a new transaction, after a pause that doubles with each attempt.
+ * Any other exception rolls the transaction back and is passed on.
+ *
+ * @param  argc  A count of the number of arguments passed to the function.
+ * @param  argv  A pointer to the array of arguments passed to the function.
+ *               The only argument is an optional Hash that may contain
+ *               :attempts (default 3), :backoff (the initial pause in
+ *               seconds, default 0.05) and :options (a TransactionOptions
+ *               object for the transactions).
+ * @param  self  A reference to the Connection object to make the call on.
+ *
+ * @return  The value returned by the block.
+ *
+ */
+static VALUE retryConnectionTransaction(int argc, VALUE *argv, VALUE self)
+{
+   VALUE  array    = rb_ary_new(),
+          options  = Qnil,
+          setting  = Qnil;
+   long   attempts = 3,
+          attempt  = 1;
+   double backoff  = 0.05;
+
+   if(argc > 1)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc, 1);
+   }
+   if(!rb_block_given_p())
+   {
+      rb_ibruby_raise(NULL, "No block specified for with_retry call.");
+   }
+   if(argc == 1 && argv[0] != Qnil)
+   {
+      if(TYPE(argv[0]) != T_HASH)
+      {
+         rb_ibruby_raise(NULL, "Invalid retry options specified.");
+      }
+      if((setting = rb_hash_aref(argv[0], toSymbol("attempts"))) != Qnil)
+      {
+         attempts = NUM2LONG(setting);
+      }
+      if((setting = rb_hash_aref(argv[0], toSymbol("backoff"))) != Qnil)
+      {
+         backoff = NUM2DBL(setting);
+      }
+      options = rb_hash_aref(argv[0], toSymbol("options"));
+   }
+   if(attempts < 1 || backoff < 0)
+   {
+      rb_ibruby_raise(NULL, "Invalid retry options specified.");
+   }
+
+   /* The array holds the connection, options, transaction and error. */
+   rb_ary_push(array, self);
+   rb_ary_push(array, options);
+   rb_ary_push(array, Qnil);
+   rb_ary_push(array, Qnil);
+   for(;;)
+   {
+      VALUE          result = Qnil,
+                     error  = Qnil;
+      struct timeval pause;
+
+      rb_ary_store(array, 3, Qnil);
+      result = rb_rescue2(retryAttempt, array, retryAttemptRescue, array,
+                          cConflictError, (VALUE)0);
+      if((error = rb_ary_entry(array, 3)) == Qnil)
+      {
+         return(result);
+      }
+      if(attempt >= attempts)
+      {
+         rb_exc_raise(error);
+      }
+
+      pause.tv_sec  = (long)backoff;
+      pause.tv_usec = (long)((backoff - pause.tv_sec) * 1000000);
+      rb_thread_wait_for(pause);
+      backoff *= 2;
+      attempt++;
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function makes a single attempt at the work for the with_retry method,
+ * making sure the transaction used is not left active.
+ *
+ * @param  array  A reference to the Array of details for the call.
+ *
+ * @return  The value returned by the block.
+ *
+ */
+VALUE retryAttempt(VALUE array)
+{
+   return(rb_ensure(retryAttemptBody, array, retryAttemptEnsure, array));
+}
+
+
+/**
+ * This function starts a transaction, passes it to the block for the
+ * with_retry method and commits it.
+ *
+ * @param  array  A reference to the Array of details for the call.
+ *
+ * @return  The value returned by the block.
+ *
+ */
+VALUE retryAttemptBody(VALUE array)
+{
+   VALUE connection  = rb_ary_entry(array, 0),
+         options     = rb_ary_entry(array, 1),
+         transaction = Qnil,
+         result      = Qnil;
+
+   if(options != Qnil)
+   {
+      transaction = rb_transaction_new_with_options(connection, options);
+   }
+   else
+   {
+      transaction = rb_transaction_new(connection);
+   }
+   rb_ary_store(array, 2, transaction);
+
+   result = rb_yield(transaction);
+   if(rb_funcall(transaction, rb_intern("active?"), 0) == Qtrue)
+   {
+      rb_funcall(transaction, rb_intern("commit"), 0);
+   }
+
+   return(result);
+}
+
+
+/**
+ * This function rolls back the transaction for a with_retry attempt if it
+ * did not complete.
+ *
+ * @param  array  A reference to the Array of details for the call.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE retryAttemptEnsure(VALUE array)
+{
+   VALUE transaction = rb_ary_entry(array, 2);
+
+   if(transaction != Qnil &&
+      rb_funcall(transaction, rb_intern("active?"), 0) == Qtrue)
+   {
+      rb_funcall(transaction, rb_intern("rollback"), 0);
+   }
+   rb_ary_store(array, 2, Qnil);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function records a retryable error raised by a with_retry attempt.
+ *
+ * @param  array  A reference to the Array of details for the call.
+ * @param  error  A reference to the exception raised.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE retryAttemptRescue(VALUE array, VALUE error)
+{
+   rb_ary_store(array, 3, error);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function converts a timeout given in seconds to milliseconds,
+ * checking that timeouts are supported by the database client library.
+ *
+ * @param  seconds  A reference to the number of seconds, which may be
+ *                  fractional, or nil for no timeout.
+ *
+ * @return  The timeout in milliseconds, zero for no timeout.
+ *
+ */
+long getTimeoutValue(VALUE seconds)
+{
+   long result = 0;
+
+   if(seconds != Qnil)
+   {
+      double value = NUM2DBL(seconds);
+
+      if(value < 0)
+      {
+         rb_ibruby_raise(NULL, "Invalid timeout value specified.");
+      }
+      result = (long)(value * 1000.0);
+      if(value > 0 && result == 0)
+      {
+         result = 1;
+      }
+   }
+#if !defined(FB_API_VER) || FB_API_VER < 25
+   if(result > 0)
+   {
+      rb_ibruby_raise(NULL, "Statement timeouts are not supported by the "\
+                      "database client library.");
+   }
+#endif
+
+   return(result);
+}
+
+
+/**
+ * This function makes a database information request with the interpreter
+ * lock released, so that other threads keep running while the request makes
+ * its way to the server and back.
+ *
+ * @param  status  A pointer to the status vector for the call.
+ * @param  handle  A pointer to the database handle to make the request on.
+ * @param  count   The length of the list of items requested.
+ * @param  items   A pointer to the list of items requested.
+ * @param  size    The size of the buffer to receive the reply.
+ * @param  buffer  A pointer to the buffer to receive the reply.
+ *
+ * @return  Zero on success, the error code otherwise.
+ *
+ */
+ISC_STATUS getDatabaseInfo(ISC_STATUS *status, isc_db_handle *handle,
+                           short count, char *items, short size, char *buffer)
+{
+   DatabaseInfoCall call;
+
+   call.status = status;
+   call.handle = handle;
+   call.count  = count;
+   call.items  = items;
+   call.size   = size;
+   call.buffer = buffer;
+   callBlocking(databaseInfoCall, &call, NULL, NULL);
+
+   return(call.result);
+}
+
+
+/**
+ * This function makes the isc_database_info call for getDatabaseInfo. It is
+ * called without the interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the DatabaseInfoCall structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *databaseInfoCall(void *data)
+{
+   DatabaseInfoCall *call = (DatabaseInfoCall *)data;
+
+   call->result = isc_database_info(call->status, call->handle, call->count,
+                                    call->items, call->size, call->buffer);
+
+   return(NULL);
+}
+
+
+/**
+ * This function creates a new Connection object around a database attachment
+ * that has already been opened, such as one opened on a separate thread by a
+ * ConnectionPool.
+ *
+ * @param  database  A reference to the Database that the attachment relates
+ *                   to.
+ * @param  user      A reference to the database user name used in opening the
+ *                   attachment.
+ * @param  handle    The handle of the open attachment.
+ * @param  dpb       A pointer to the database parameter buffer used in
+ *                   opening the attachment, which is copied.
+ * @param  length    The length of the database parameter buffer.
+ *
+ * @return  A reference to the newly created Connection object.
+ *
+ */
+VALUE rb_connection_attached(VALUE database, VALUE user, isc_db_handle handle,
+                             const char *dpb, short length)
+{
+   VALUE            instance    = allocateConnection(cConnection);
+   ConnectionHandle *connection = NULL;
+
+   Data_Get_Struct(instance, ConnectionHandle, connection);
+   connection->handle = handle;
+   connection->dpb    = ALLOC_N(char, length);
+   if(connection->dpb == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure creating a connection.");
+   }
+   memcpy(connection->dpb, dpb, length);
+   connection->length = length;
+   rb_iv_set(instance, "@database", database);
+   rb_iv_set(instance, "@user", user);
+   rb_iv_set(instance, "@transactions", rb_ary_new());
+   rb_iv_set(instance, "@read_transaction", Qnil);
+   rb_iv_set(instance, "@listeners", rb_ary_new());
+
+   return(instance);
+}
+
+
 /**
 
  * This function is called to record the beginnings of a transactions against
@@ -1772,6 +2620,19 @@ void Init_Connection(VALUE module)
    rb_define_method(cConnection, "initialize_copy", forbidObjectCopy, 1);
 
    rb_define_method(cConnection, "user", getConnectionUser, 0);
+   rb_define_method(cConnection, "statement_timeout",
+                    getConnectionStatementTimeout, 0);
+   rb_define_method(cConnection, "statement_timeout=",
+                    setConnectionStatementTimeout, 1);
+   rb_define_method(cConnection, "cancel", cancelConnectionOperation, 0);
+   rb_define_method(cConnection, "with_retry", retryConnectionTransaction, -1);
+   rb_define_method(cConnection, "on_event", listenForConnectionEvents, -1);
+   rb_define_method(cConnection, "parallel_scan", scanConnectionTable, -1);
+   rb_define_method(cConnection, "io_stats", getConnectionIOStats, 0);
+   rb_define_method(cConnection, "measure", measureConnectionIO, 0);
+   rb_define_method(cConnection, "transaction_markers",
+                    getConnectionTransactionMarkers, 0);
+   rb_define_method(cConnection, "explain", explainConnectionQuery, 1);
 
    rb_define_method(cConnection, "open?", isConnectionOpen, 0);
 
@@ -1781,7 +2642,7 @@ void Init_Connection(VALUE module)
 
    rb_define_method(cConnection, "database", getConnectionDatabase, 0);
 
-   rb_define_method(cConnection, "start_transaction", startConnectionTransaction, 0);
+   rb_define_method(cConnection, "start_transaction", startConnectionTransaction, -1);
 
    rb_define_method(cConnection, "to_s", connectionToString, 0);
 
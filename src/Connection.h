@@ -34,15 +34,28 @@
       #include "IBRubyException.h"
    #endif
 
+   #include <time.h>
+
    /* Structure definitions. */
    typedef struct
    {
       isc_db_handle handle;
+      long          reads;
+      time_t        refreshed;
+      long          timeout;
+      char          *dpb;
+      short         length;
    } ConnectionHandle;
    
    /* Function prototypes. */
    void Init_Connection(VALUE);
    VALUE rb_connection_new(VALUE, VALUE, VALUE, VALUE);
+   VALUE rb_connection_attached(VALUE, VALUE, isc_db_handle, const char *,
+                                short);
+   char *createDPB(VALUE, VALUE, VALUE, short *);
+   long getTimeoutValue(VALUE);
+   ISC_STATUS getDatabaseInfo(ISC_STATUS *, isc_db_handle *, short, char *,
+                              short, char *);
    void rb_tx_started(VALUE, VALUE);
    void rb_tx_released(VALUE, VALUE);
    void connectionFree(void *);
@@ -0,0 +1,1073 @@
+/*------------------------------------------------------------------------------
+ * ConnectionPool.c
+ *------------------------------------------------------------------------------
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "ConnectionPool.h"
+#include "Common.h"
+#include "Connection.h"
+#include "Database.h"
+#include <string.h>
+
+/* Type definitions. */
+typedef struct
+{
+   char          *file,
+                 *dpb;
+   short         length;
+   isc_db_handle handle;
+   ISC_STATUS    status[20];
+} AttachRequest;
+
+typedef struct
+{
+   AttachRequest *requests;
+   long          count;
+} AttachBatch;
+
+typedef struct
+{
+   ConnectionPoolHandle *pool;
+   long                 checkins,
+                        milliseconds;
+} PoolWait;
+
+typedef struct
+{
+   VALUE  self;
+   int    waiting;
+   double started;
+} CheckoutRequest;
+
+/* Function prototypes. */
+static VALUE allocateConnectionPool(VALUE);
+static VALUE initializeConnectionPool(int, VALUE *, VALUE);
+static VALUE checkoutConnection(VALUE);
+static VALUE checkinConnection(VALUE, VALUE);
+static VALUE withPooledConnection(VALUE);
+static VALUE reapConnectionPool(VALUE);
+static VALUE shutdownConnectionPool(VALUE);
+static VALUE getConnectionPoolSize(VALUE);
+static VALUE getConnectionPoolStatistics(VALUE);
+VALUE checkoutBlock(VALUE);
+VALUE checkoutEnsure(VALUE);
+VALUE pooledConnectionBlock(VALUE);
+VALUE pooledConnectionEnsure(VALUE);
+long getPoolSetting(VALUE, const char *, long);
+void openConnections(VALUE, ConnectionPoolHandle *, long);
+VALUE createPooledConnection(VALUE, ConnectionPoolHandle *);
+int isConnectionHealthy(ConnectionPoolHandle *, VALUE, VALUE);
+void discardConnection(ConnectionPoolHandle *, VALUE);
+VALUE closePooledConnection(VALUE);
+VALUE ignoreCloseError(VALUE, VALUE);
+long reapIdleConnections(VALUE, ConnectionPoolHandle *);
+void waitForCheckin(ConnectionPoolHandle *, double);
+void *attachDatabase(void *);
+void *attachInParallel(void *);
+void *waitOnPool(void *);
+void wakePoolWaiters(void *);
+
+/* Globals. */
+VALUE cConnectionPool;
+
+
+/**
+ * This function provides for the allocation of new ConnectionPool objects
+ * through the Ruby language.
+ *
+ * @param  klass  A reference to the ConnectionPool Class object.
+ *
+ * @return  A reference to the newly allocated ConnectionPool object.
+ *
+ */
+static VALUE allocateConnectionPool(VALUE klass)
+{
+   VALUE                instance = Qnil;
+   ConnectionPoolHandle *pool    = ALLOC(ConnectionPoolHandle);
+
+   if(pool != NULL)
+   {
+      memset(pool, 0, sizeof(ConnectionPoolHandle));
+      initializeLock(&pool->lock);
+      initializeCondition(&pool->available);
+      instance = Data_Wrap_Struct(klass, NULL, connectionPoolFree, pool);
+   }
+   else
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure creating a connection pool.");
+   }
+
+   return(instance);
+}
+
+
+/**
+ * This function provides the initialize method for the ConnectionPool class.
+ * The minimum number of connections for the pool are opened before the
+ * function returns, with the attachments being made in parallel.
+ *
+ * @param  argc  A count of the number of arguments passed to the function.
+ * @param  argv  A pointer to the array of arguments passed to the function.
+ *               The arguments are the Database, the user name, the password,
+ *               an optional Hash of connection options and an optional Hash
+ *               of pool settings.
+ * @param  self  A reference to the ConnectionPool object being initialized.
+ *
+ * @return  A reference to the initialized object.
+ *
+ */
+static VALUE initializeConnectionPool(int argc, VALUE *argv, VALUE self)
+{
+   ConnectionPoolHandle *pool    = NULL;
+   VALUE                options  = Qnil,
+                        settings = Qnil,
+                        timeout  = Qnil;
+   char                 *file    = NULL;
+
+   if(argc < 3 || argc > 5)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               argc < 3 ? 3 : 5);
+   }
+   if(TYPE(argv[0]) != T_DATA ||
+      RDATA(argv[0])->dfree != (RUBY_DATA_FUNC)databaseFree)
+   {
+      rb_ibruby_raise(NULL, "Invalid database specified for connection pool.");
+   }
+   if(argc > 3)
+   {
+      options = argv[3];
+   }
+   if(argc > 4)
+   {
+      settings = argv[4];
+      if(settings != Qnil && TYPE(settings) != T_HASH)
+      {
+         rb_ibruby_raise(NULL, "Invalid connection pool settings specified.");
+      }
+   }
+   Data_Get_Struct(self, ConnectionPoolHandle, pool);
+
+   /* Read the pool settings. */
+   pool->minimum     = getPoolSetting(settings, "min", 1);
+   pool->maximum     = getPoolSetting(settings, "max", 10);
+   pool->queue       = getPoolSetting(settings, "max_waiting", 100);
+   pool->idleTimeout = getPoolSetting(settings, "idle_timeout", 300);
+   pool->checkAfter  = getPoolSetting(settings, "check_after", 30);
+   pool->timeout     = 5.0;
+   if(settings != Qnil &&
+      (timeout = rb_hash_aref(settings, toSymbol("timeout"))) != Qnil)
+   {
+      pool->timeout = NUM2DBL(timeout);
+   }
+   if(pool->minimum < 0 || pool->maximum < 1 ||
+      pool->minimum > pool->maximum)
+   {
+      rb_ibruby_raise(NULL, "Invalid connection pool size specified.");
+   }
+
+   /* Keep copies of the attachment details for use off the Ruby thread. */
+   file       = STR2CSTR(rb_iv_get(argv[0], "@file"));
+   pool->file = ALLOC_N(char, strlen(file) + 1);
+   strcpy(pool->file, file);
+   pool->dpb  = createDPB(argv[1], argv[2], options, &pool->length);
+
+   rb_iv_set(self, "@database", argv[0]);
+   rb_iv_set(self, "@user", argv[1]);
+   rb_iv_set(self, "@idle", rb_ary_new());
+   rb_iv_set(self, "@idle_since", rb_hash_new());
+   rb_iv_set(self, "@checked_out", rb_hash_new());
+
+   openConnections(self, pool, pool->minimum);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the checkout method for the ConnectionPool class. An
+ * idle connection is handed out if there is one, otherwise a new connection
+ * is opened if the pool is below its maximum size. Failing that the caller
+ * waits for a connection to be checked in, up to the pool timeout.
+ *
+ * @param  self  A reference to the ConnectionPool object to take the
+ *               connection from.
+ *
+ * @return  A reference to a Connection object.
+ *
+ */
+static VALUE checkoutConnection(VALUE self)
+{
+   CheckoutRequest request;
+
+   request.self    = self;
+   request.waiting = 0;
+   request.started = 0.0;
+
+   return(rb_ensure(checkoutBlock, (VALUE)&request, checkoutEnsure,
+                    (VALUE)&request));
+}
+
+
+/**
+ * This function provides the checkin method for the ConnectionPool class.
+ * Any transactions left active on the connection are rolled back before it
+ * is made available to other callers.
+ *
+ * @param  self        A reference to the ConnectionPool object to return the
+ *                     connection to.
+ * @param  connection  A reference to the Connection object being returned.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE checkinConnection(VALUE self, VALUE connection)
+{
+   ConnectionPoolHandle *pool     = NULL;
+   ConnectionHandle     *handle   = NULL;
+   VALUE                idle      = rb_iv_get(self, "@idle");
+
+   Data_Get_Struct(self, ConnectionPoolHandle, pool);
+   if(rb_hash_delete(rb_iv_get(self, "@checked_out"), connection) == Qnil)
+   {
+      rb_ibruby_raise(NULL, "Connection was not checked out of this pool.");
+   }
+
+   Data_Get_Struct(connection, ConnectionHandle, handle);
+   if(handle->handle != 0 && !pool->closed)
+   {
+      VALUE transactions = rb_iv_get(connection, "@transactions"),
+            transaction  = Qnil;
+
+      while((transaction = rb_ary_pop(transactions)) != Qnil)
+      {
+         if(rb_funcall(transaction, rb_intern("active?"), 0) == Qtrue)
+         {
+            rb_funcall(transaction, rb_intern("rollback"), 0);
+         }
+      }
+      rb_ary_push(idle, connection);
+      rb_hash_aset(rb_iv_get(self, "@idle_since"), connection,
+                   INT2NUM(time(NULL)));
+
+      acquireLock(&pool->lock);
+      pool->checkins++;
+      signalCondition(&pool->available);
+      releaseLock(&pool->lock);
+   }
+   else
+   {
+      discardConnection(pool, connection);
+   }
+
+   if(pool->idleTimeout > 0)
+   {
+      reapIdleConnections(self, pool);
+   }
+
+   return(self);
+}
+
+
+/**
+ * This function provides the connection method for the ConnectionPool class.
+ * A connection is checked out and passed to the block, being checked back in
+ * when the block completes, whether normally or by an exception.
+ *
+ * @param  self  A reference to the ConnectionPool object to take the
+ *               connection from.
+ *
+ * @return  The value returned by the block.
+ *
+ */
+static VALUE withPooledConnection(VALUE self)
+{
+   VALUE array = rb_ary_new();
+
+   if(!rb_block_given_p())
+   {
+      rb_ibruby_raise(NULL, "No block specified for pooled connection.");
+   }
+   rb_ary_push(array, self);
+   rb_ary_push(array, checkoutConnection(self));
+
+   return(rb_ensure(pooledConnectionBlock, array, pooledConnectionEnsure,
+                    array));
+}
+
+
+/**
+ * This function provides the reap method for the ConnectionPool class,
+ * closing connections that have been idle for longer than the pool idle
+ * timeout while keeping the pool at its minimum size.
+ *
+ * @param  self  A reference to the ConnectionPool object to reap.
+ *
+ * @return  A count of the connections closed.
+ *
+ */
+static VALUE reapConnectionPool(VALUE self)
+{
+   ConnectionPoolHandle *pool = NULL;
+
+   Data_Get_Struct(self, ConnectionPoolHandle, pool);
+
+   return(INT2NUM(reapIdleConnections(self, pool)));
+}
+
+
+/**
+ * This function provides the shutdown method for the ConnectionPool class.
+ * Idle connections are closed straight away while connections that are
+ * checked out get closed as they are checked in. Any callers waiting on the
+ * pool are woken and receive an exception.
+ *
+ * @param  self  A reference to the ConnectionPool object to shut down.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE shutdownConnectionPool(VALUE self)
+{
+   ConnectionPoolHandle *pool      = NULL;
+   VALUE                idle       = rb_iv_get(self, "@idle"),
+                        connection = Qnil;
+
+   Data_Get_Struct(self, ConnectionPoolHandle, pool);
+   acquireLock(&pool->lock);
+   pool->closed = 1;
+   broadcastCondition(&pool->available);
+   releaseLock(&pool->lock);
+
+   while((connection = rb_ary_pop(idle)) != Qnil)
+   {
+      discardConnection(pool, connection);
+   }
+   rb_funcall(rb_iv_get(self, "@idle_since"), rb_intern("clear"), 0);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the size method for the ConnectionPool class.
+ *
+ * @param  self  A reference to the ConnectionPool object to make the call on.
+ *
+ * @return  A count of the connections currently open in the pool, whether
+ *          idle or checked out.
+ *
+ */
+static VALUE getConnectionPoolSize(VALUE self)
+{
+   ConnectionPoolHandle *pool = NULL;
+
+   Data_Get_Struct(self, ConnectionPoolHandle, pool);
+
+   return(INT2NUM(pool->size));
+}
+
+
+/**
+ * This function provides the statistics method for the ConnectionPool class.
+ *
+ * @param  self  A reference to the ConnectionPool object to make the call on.
+ *
+ * @return  A Hash of the pool usage figures.
+ *
+ */
+static VALUE getConnectionPoolStatistics(VALUE self)
+{
+   ConnectionPoolHandle *pool       = NULL;
+   VALUE                statistics = rb_hash_new(),
+                        idle       = rb_funcall(rb_iv_get(self, "@idle"),
+                                                rb_intern("size"), 0),
+                        used       = rb_funcall(rb_iv_get(self, "@checked_out"),
+                                                rb_intern("size"), 0);
+
+   Data_Get_Struct(self, ConnectionPoolHandle, pool);
+   acquireLock(&pool->lock);
+   rb_hash_aset(statistics, toSymbol("size"), INT2NUM(pool->size));
+   rb_hash_aset(statistics, toSymbol("idle"), idle);
+   rb_hash_aset(statistics, toSymbol("in_use"), used);
+   rb_hash_aset(statistics, toSymbol("waiting"), INT2NUM(pool->waiting));
+   rb_hash_aset(statistics, toSymbol("waits"), INT2NUM(pool->waits));
+   rb_hash_aset(statistics, toSymbol("wait_time"), rb_float_new(pool->waited));
+   rb_hash_aset(statistics, toSymbol("timeouts"), INT2NUM(pool->timeouts));
+   rb_hash_aset(statistics, toSymbol("creations"), INT2NUM(pool->creations));
+   rb_hash_aset(statistics, toSymbol("destructions"),
+                INT2NUM(pool->destructions));
+   rb_hash_aset(statistics, toSymbol("health_failures"),
+                INT2NUM(pool->failures));
+   releaseLock(&pool->lock);
+
+   return(statistics);
+}
+
+
+/**
+ * This function does the work for the checkout method.
+ *
+ * @param  data  A pointer to the CheckoutRequest for the call.
+ *
+ * @return  A reference to the Connection checked out.
+ *
+ */
+VALUE checkoutBlock(VALUE data)
+{
+   CheckoutRequest      *request = (CheckoutRequest *)data;
+   ConnectionPoolHandle *pool    = NULL;
+   VALUE                idle     = rb_iv_get(request->self, "@idle"),
+                        since    = rb_iv_get(request->self, "@idle_since"),
+                        result   = Qnil;
+
+   Data_Get_Struct(request->self, ConnectionPoolHandle, pool);
+   while(result == Qnil)
+   {
+      VALUE connection = Qnil;
+      int   create     = 0;
+
+      if(pool->closed)
+      {
+         rb_ibruby_raise(NULL, "Connection pool has been shut down.");
+      }
+
+      if((connection = rb_ary_pop(idle)) != Qnil)
+      {
+         if(isConnectionHealthy(pool, connection,
+                                rb_hash_delete(since, connection)))
+         {
+            result = connection;
+         }
+         else
+         {
+            discardConnection(pool, connection);
+         }
+         continue;
+      }
+
+      /* Reserve a slot for a new connection if there's room. */
+      acquireLock(&pool->lock);
+      if(pool->size < pool->maximum)
+      {
+         pool->size++;
+         create = 1;
+      }
+      releaseLock(&pool->lock);
+
+      if(create)
+      {
+         result = createPooledConnection(request->self, pool);
+      }
+      else
+      {
+         double remaining = 0.0;
+
+         if(!request->waiting)
+         {
+            acquireLock(&pool->lock);
+            if(pool->waiting >= pool->queue)
+            {
+               releaseLock(&pool->lock);
+               rb_ibruby_raise(NULL, "Connection pool wait queue is full.");
+            }
+            pool->waiting++;
+            pool->waits++;
+            releaseLock(&pool->lock);
+            request->waiting = 1;
+            request->started = getCurrentTime();
+         }
+
+         remaining = pool->timeout - (getCurrentTime() - request->started);
+         if(remaining <= 0.0)
+         {
+            acquireLock(&pool->lock);
+            pool->timeouts++;
+            releaseLock(&pool->lock);
+            rb_ibruby_raise(NULL,
+                            "Timed out waiting for a pooled connection.");
+         }
+         waitForCheckin(pool, remaining);
+      }
+   }
+   rb_hash_aset(rb_iv_get(request->self, "@checked_out"), result, Qtrue);
+
+   return(result);
+}
+
+
+/**
+ * This function tidies up after a call to the checkout method, removing the
+ * caller from the count of waiters if it had to wait.
+ *
+ * @param  data  A pointer to the CheckoutRequest for the call.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE checkoutEnsure(VALUE data)
+{
+   CheckoutRequest *request = (CheckoutRequest *)data;
+
+   if(request->waiting)
+   {
+      ConnectionPoolHandle *pool = NULL;
+
+      Data_Get_Struct(request->self, ConnectionPoolHandle, pool);
+      acquireLock(&pool->lock);
+      pool->waiting--;
+      pool->waited += getCurrentTime() - request->started;
+      releaseLock(&pool->lock);
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function yields a checked out connection to the block passed to the
+ * connection method.
+ *
+ * @param  array  A reference to an Array holding the ConnectionPool and the
+ *                Connection.
+ *
+ * @return  The value returned by the block.
+ *
+ */
+VALUE pooledConnectionBlock(VALUE array)
+{
+   return(rb_yield(rb_ary_entry(array, 1)));
+}
+
+
+/**
+ * This function checks a connection back in once the block passed to the
+ * connection method has completed.
+ *
+ * @param  array  A reference to an Array holding the ConnectionPool and the
+ *                Connection.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE pooledConnectionEnsure(VALUE array)
+{
+   checkinConnection(rb_ary_entry(array, 0), rb_ary_entry(array, 1));
+
+   return(Qnil);
+}
+
+
+/**
+ * This function fetches an integer setting for a connection pool.
+ *
+ * @param  settings  A reference to the Hash of settings passed to the pool.
+ *                   May be nil.
+ * @param  name      The name of the setting.
+ * @param  fallback  The value to use if the setting was not specified.
+ *
+ * @return  The value of the setting.
+ *
+ */
+long getPoolSetting(VALUE settings, const char *name, long fallback)
+{
+   long  result = fallback;
+   VALUE value  = Qnil;
+
+   if(settings != Qnil &&
+      (value = rb_hash_aref(settings, toSymbol(name))) != Qnil)
+   {
+      result = NUM2LONG(value);
+   }
+
+   return(result);
+}
+
+
+/**
+ * This function opens a number of new connections for a pool, adding them to
+ * the list of idle connections. The attachments are made in parallel, each
+ * on its own native thread, with the interpreter lock released while they
+ * are made.
+ *
+ * @param  self   A reference to the ConnectionPool object.
+ * @param  pool   A pointer to the pool structure.
+ * @param  count  The number of connections to open.
+ *
+ */
+void openConnections(VALUE self, ConnectionPoolHandle *pool, long count)
+{
+   AttachBatch batch;
+   AttachRequest *failed = NULL;
+   VALUE       idle      = rb_iv_get(self, "@idle"),
+               since     = rb_iv_get(self, "@idle_since"),
+               database  = rb_iv_get(self, "@database"),
+               user      = rb_iv_get(self, "@user");
+   long        index;
+
+   if(count < 1)
+   {
+      return;
+   }
+
+   batch.count    = count;
+   batch.requests = ALLOC_N(AttachRequest, count);
+   for(index = 0; index < count; index++)
+   {
+      batch.requests[index].file   = pool->file;
+      batch.requests[index].dpb    = pool->dpb;
+      batch.requests[index].length = pool->length;
+      batch.requests[index].handle = 0;
+   }
+   callBlocking(attachInParallel, &batch, NULL, NULL);
+
+   for(index = 0; index < count; index++)
+   {
+      AttachRequest *request = &batch.requests[index];
+
+      if(request->handle != 0)
+      {
+         VALUE connection = rb_connection_attached(database, user,
+                                                   request->handle, pool->dpb,
+                                                   pool->length);
+
+         rb_ary_push(idle, connection);
+         rb_hash_aset(since, connection, INT2NUM(time(NULL)));
+         acquireLock(&pool->lock);
+         pool->size++;
+         pool->creations++;
+         releaseLock(&pool->lock);
+      }
+      else if(failed == NULL)
+      {
+         failed = request;
+      }
+   }
+
+   if(failed != NULL)
+   {
+      ISC_STATUS status[20];
+
+      memcpy(status, failed->status, sizeof(status));
+      free(batch.requests);
+      rb_ibruby_raise(status, "Error opening pooled connection.");
+   }
+   free(batch.requests);
+}
+
+
+/**
+ * This function opens a single new connection for a pool. The caller must
+ * already have reserved a place for the connection in the pool size.
+ *
+ * @param  self  A reference to the ConnectionPool object.
+ * @param  pool  A pointer to the pool structure.
+ *
+ * @return  A reference to the new Connection object.
+ *
+ */
+VALUE createPooledConnection(VALUE self, ConnectionPoolHandle *pool)
+{
+   AttachRequest request;
+
+   request.file   = pool->file;
+   request.dpb    = pool->dpb;
+   request.length = pool->length;
+   request.handle = 0;
+   callBlocking(attachDatabase, &request, NULL, NULL);
+   if(request.handle == 0)
+   {
+      acquireLock(&pool->lock);
+      pool->size--;
+      pool->checkins++;
+      signalCondition(&pool->available);
+      releaseLock(&pool->lock);
+      rb_ibruby_raise(request.status, "Error opening pooled connection.");
+   }
+
+   acquireLock(&pool->lock);
+   pool->creations++;
+   releaseLock(&pool->lock);
+
+   return(rb_connection_attached(rb_iv_get(self, "@database"),
+                                 rb_iv_get(self, "@user"), request.handle,
+                                 pool->dpb, pool->length));
+}
+
+
+/**
+ * This function checks whether an idle connection is still usable before it
+ * is handed out. Only connections that have been idle for longer than the
+ * pool check period are tested, using a single item database information
+ * request that is made without holding the GVL.
+ *
+ * @param  pool        A pointer to the pool structure.
+ * @param  connection  A reference to the Connection to be checked.
+ * @param  since       A reference to the time the connection became idle.
+ *
+ * @return  Non-zero if the connection can be used, zero otherwise.
+ *
+ */
+int isConnectionHealthy(ConnectionPoolHandle *pool, VALUE connection,
+                        VALUE since)
+{
+   ConnectionHandle *handle = NULL;
+   int              result  = 1;
+
+   Data_Get_Struct(connection, ConnectionHandle, handle);
+   if(handle->handle == 0)
+   {
+      result = 0;
+   }
+   else if(pool->checkAfter >= 0 && since != Qnil &&
+           time(NULL) - NUM2LONG(since) >= pool->checkAfter)
+   {
+      ISC_STATUS status[20];
+      char       items[] = {isc_info_ods_version},
+                 buffer[16];
+
+      if(getDatabaseInfo(status, &handle->handle, sizeof(items), items,
+                         sizeof(buffer), buffer) != 0)
+      {
+         result = 0;
+      }
+   }
+
+   if(!result)
+   {
+      acquireLock(&pool->lock);
+      pool->failures++;
+      releaseLock(&pool->lock);
+   }
+
+   return(result);
+}
+
+
+/**
+ * This function closes a connection that is leaving a pool, ignoring any
+ * error as the attachment may already be broken, and frees its place in the
+ * pool for a new connection. Should the close fail the attachment handle is
+ * dropped regardless.
+ *
+ * @param  pool        A pointer to the pool structure.
+ * @param  connection  A reference to the Connection to be discarded.
+ *
+ */
+void discardConnection(ConnectionPoolHandle *pool, VALUE connection)
+{
+   ConnectionHandle *handle = NULL;
+
+   rb_rescue(closePooledConnection, connection, ignoreCloseError, Qnil);
+   Data_Get_Struct(connection, ConnectionHandle, handle);
+   if(handle->handle != 0)
+   {
+      ISC_STATUS status[20];
+
+      isc_detach_database(status, &handle->handle);
+      handle->handle = 0;
+   }
+
+   acquireLock(&pool->lock);
+   pool->size--;
+   pool->destructions++;
+   pool->checkins++;
+   signalCondition(&pool->available);
+   releaseLock(&pool->lock);
+}
+
+
+/**
+ * This function closes a Connection on behalf of discardConnection.
+ *
+ * @param  connection  A reference to the Connection to be closed.
+ *
+ * @return  The value returned by the close call.
+ *
+ */
+VALUE closePooledConnection(VALUE connection)
+{
+   return(rb_funcall(connection, rb_intern("close"), 0));
+}
+
+
+/**
+ * This function discards any error raised closing a pooled connection.
+ *
+ * @param  unused  Not used.
+ * @param  error   A reference to the exception raised.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE ignoreCloseError(VALUE unused, VALUE error)
+{
+   return(Qnil);
+}
+
+
+/**
+ * This function closes the connections in a pool that have been idle for
+ * longer than the pool idle timeout, never taking the pool below its minimum
+ * size. Idle connections are handed out most recently used first so the
+ * longest idle connections are at the start of the list.
+ *
+ * @param  self  A reference to the ConnectionPool object.
+ * @param  pool  A pointer to the pool structure.
+ *
+ * @return  A count of the connections closed.
+ *
+ */
+long reapIdleConnections(VALUE self, ConnectionPoolHandle *pool)
+{
+   VALUE  idle   = rb_iv_get(self, "@idle"),
+          since  = rb_iv_get(self, "@idle_since");
+   long   count  = 0;
+   time_t now    = time(NULL);
+
+   while(pool->idleTimeout > 0 && pool->size > pool->minimum)
+   {
+      VALUE connection = rb_ary_entry(idle, 0),
+            released   = Qnil;
+
+      if(connection == Qnil)
+      {
+         break;
+      }
+      released = rb_hash_aref(since, connection);
+      if(released != Qnil && now - NUM2LONG(released) < pool->idleTimeout)
+      {
+         break;
+      }
+      rb_ary_shift(idle);
+      rb_hash_delete(since, connection);
+      discardConnection(pool, connection);
+      count++;
+   }
+
+   return(count);
+}
+
+
+/**
+ * This function waits for a connection to be returned to a pool or for a
+ * place to become free in it. Where the interpreter lock can be released the
+ * wait is made on the pool condition, otherwise the current Ruby thread
+ * sleeps briefly so that other Ruby threads can run. The wait is never longer
+ * than a tenth of a second so the caller rechecks its deadline regularly.
+ *
+ * @param  pool     A pointer to the pool structure.
+ * @param  seconds  The longest time the caller is prepared to wait.
+ *
+ */
+void waitForCheckin(ConnectionPoolHandle *pool, double seconds)
+{
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+   PoolWait wait;
+
+   wait.pool         = pool;
+   wait.milliseconds = seconds < 0.1 ? (long)(seconds * 1000) + 1 : 100;
+   acquireLock(&pool->lock);
+   wait.checkins = pool->checkins;
+   releaseLock(&pool->lock);
+   callBlocking(waitOnPool, &wait, wakePoolWaiters, pool);
+#else
+   struct timeval interval;
+
+   interval.tv_sec  = 0;
+   interval.tv_usec = seconds < 0.01 ? (long)(seconds * 1000000) + 1 : 10000;
+   rb_thread_wait_for(interval);
+#endif
+}
+
+
+/**
+ * This function makes a database attachment for a pool. It is called without
+ * the interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the AttachRequest to be processed.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *attachDatabase(void *data)
+{
+   AttachRequest *request = (AttachRequest *)data;
+
+   if(isc_attach_database(request->status, strlen(request->file),
+                          request->file, &request->handle, request->length,
+                          request->dpb) != 0)
+   {
+      request->handle = 0;
+   }
+
+   return(NULL);
+}
+
+
+/**
+ * This function processes a batch of attachment requests in parallel. The
+ * first request is processed on the calling thread and each of the others on
+ * a thread of its own. Should a thread fail to start its request is simply
+ * processed on the calling thread.
+ *
+ * @param  data  A pointer to the AttachBatch to be processed.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *attachInParallel(void *data)
+{
+   AttachBatch  *batch   = (AttachBatch *)data;
+   IBRubyThread *threads = NULL;
+   int          *started = NULL;
+   long         index;
+
+   if(batch->count > 1)
+   {
+      threads = (IBRubyThread *)malloc(sizeof(IBRubyThread) * batch->count);
+      started = (int *)calloc(batch->count, sizeof(int));
+   }
+   if(threads != NULL && started != NULL)
+   {
+      for(index = 1; index < batch->count; index++)
+      {
+         started[index] = (startThread(&threads[index], attachDatabase,
+                                       &batch->requests[index]) == 0);
+      }
+   }
+
+   for(index = 0; index < batch->count; index++)
+   {
+      if(index > 0 && started != NULL && started[index])
+      {
+         joinThread(threads[index]);
+      }
+      else
+      {
+         attachDatabase(&batch->requests[index]);
+      }
+   }
+   free(threads);
+   free(started);
+
+   return(NULL);
+}
+
+
+/**
+ * This function waits on a pool condition without the interpreter lock.
+ *
+ * @param  data  A pointer to the PoolWait structure for the wait.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *waitOnPool(void *data)
+{
+   PoolWait             *wait = (PoolWait *)data;
+   ConnectionPoolHandle *pool = wait->pool;
+
+   acquireLock(&pool->lock);
+   if(pool->checkins == wait->checkins && !pool->closed)
+   {
+      waitOnCondition(&pool->available, &pool->lock, wait->milliseconds);
+   }
+   releaseLock(&pool->lock);
+
+   return(NULL);
+}
+
+
+/**
+ * This function is called by the interpreter to interrupt threads waiting on
+ * a pool, such as when a thread is killed.
+ *
+ * @param  data  A pointer to the pool structure.
+ *
+ */
+void wakePoolWaiters(void *data)
+{
+   ConnectionPoolHandle *pool = (ConnectionPoolHandle *)data;
+
+   acquireLock(&pool->lock);
+   broadcastCondition(&pool->available);
+   releaseLock(&pool->lock);
+}
+
+
+/**
+ * This function integrates with the Ruby garbage collector to release the
+ * resources associated with a ConnectionPool object. Pooled connections are
+ * closed as their own Connection objects are collected.
+ *
+ * @param  pool  A pointer to the ConnectionPoolHandle structure associated
+ *               with the object being collected.
+ *
+ */
+void connectionPoolFree(void *pool)
+{
+   if(pool != NULL)
+   {
+      ConnectionPoolHandle *handle = (ConnectionPoolHandle *)pool;
+
+      destroyCondition(&handle->available);
+      destroyLock(&handle->lock);
+      if(handle->file != NULL)
+      {
+         free(handle->file);
+      }
+      if(handle->dpb != NULL)
+      {
+         free(handle->dpb);
+      }
+      free(handle);
+   }
+}
+
+
+/**
+ * This function initializes the ConnectionPool class within the Ruby
+ * environment. The class is established under the module specified to the
+ * function.
+ *
+ * @param  module  A reference to the module to create the class within.
+ *
+ */
+void Init_ConnectionPool(VALUE module)
+{
+   cConnectionPool = rb_define_class_under(module, "ConnectionPool", rb_cObject);
+   rb_define_alloc_func(cConnectionPool, allocateConnectionPool);
+   rb_define_method(cConnectionPool, "initialize", initializeConnectionPool, -1);
+   rb_define_method(cConnectionPool, "initialize_copy", forbidObjectCopy, 1);
+   rb_define_method(cConnectionPool, "checkout", checkoutConnection, 0);
+   rb_define_method(cConnectionPool, "checkin", checkinConnection, 1);
+   rb_define_method(cConnectionPool, "connection", withPooledConnection, 0);
+   rb_define_method(cConnectionPool, "reap", reapConnectionPool, 0);
+   rb_define_method(cConnectionPool, "shutdown", shutdownConnectionPool, 0);
+   rb_define_method(cConnectionPool, "size", getConnectionPoolSize, 0);
+   rb_define_method(cConnectionPool, "statistics",
+                    getConnectionPoolStatistics, 0);
+}
@@ -27,6 +27,7 @@
 #include "Database.h"
 #include "IBRubyException.h"
 #include "Connection.h"
+#include "GapMonitor.h"
 #include "ruby.h"
 
 /* Function prototypes. */
@@ -38,6 +39,7 @@ static VALUE createDatabase(int, VALUE *, VALUE);
 static VALUE dropDatabase(VALUE, VALUE, VALUE);
 static VALUE getDatabaseCharacterSet(VALUE);
 static VALUE setDatabaseCharacterSet(VALUE, VALUE);
+static VALUE getDatabaseTransactionMarkers(int, VALUE *, VALUE);
 VALUE connectBlock(VALUE);
 VALUE connectEnsure(VALUE);
 
@@ -358,6 +360,48 @@ static VALUE setDatabaseCharacterSet(VALUE self, VALUE set)
 }
 
 
+/**
+ * This function provides the transaction_markers method for the Database
+ * class. A connection is opened to make the request and closed again
+ * afterwards.
+ *
+ * @param  argc  A count of the number of parameters passed to the function.
+ * @param  argv  A pointer to the start of an array containing the function
+ *               parameter values, the user name and password to connect
+ *               with.
+ * @param  self  A reference to the Database object to make the call on.
+ *
+ * @return  A reference to a Hash of the transaction markers.
+ *
+ */
+static VALUE getDatabaseTransactionMarkers(int argc, VALUE *argv, VALUE self)
+{
+   VALUE user       = Qnil,
+         password   = Qnil,
+         connection = Qnil;
+
+   if(argc > 2)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               2);
+   }
+   if(argc > 0)
+   {
+      user = argv[0];
+   }
+   if(argc > 1)
+   {
+      password = argv[1];
+   }
+
+   connection = rb_connection_new(self, user, password,
+                                  rb_iv_get(self, "@options"));
+
+   return(rb_ensure(rb_transaction_markers, connection, connectEnsure,
+                    connection));
+}
+
+
 /**                 
  * This function is used to integrate with the Ruby garbage collection system
  * to guarantee the release of the resources associated with a Database object.
@@ -446,5 +490,7 @@ void Init_Database(VALUE module)
    rb_define_method(cDatabase, "drop", dropDatabase, 2);
    rb_define_method(cDatabase, "character_set", getDatabaseCharacterSet, 0);
    rb_define_method(cDatabase, "character_set=", setDatabaseCharacterSet, 1);
+   rb_define_method(cDatabase, "transaction_markers",
+                    getDatabaseTransactionMarkers, -1);
    rb_define_module_function(cDatabase, "create", createDatabase, -1);
 }
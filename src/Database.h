@@ -44,5 +44,6 @@
    void Init_Database(VALUE);
    void databaseFree(void *);
    VALUE rb_database_new(VALUE);   
+   VALUE connectEnsure(VALUE);
 
 #endif /* IBRUBY_DATABASE_H */
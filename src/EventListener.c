@@ -0,0 +1,758 @@
+/*------------------------------------------------------------------------------
+ * EventListener.c
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "EventListener.h"
+#include "Common.h"
+#include "Connection.h"
+#include <string.h>
+
+/* Definitions. */
+#if defined(FB_API_VER) && FB_API_VER >= 20
+   #define EVENT_CALLBACK(function) ((ISC_EVENT_CALLBACK)(function))
+#else
+   #define EVENT_CALLBACK(function) ((isc_callback)(function))
+#endif
+
+/* Function prototypes. */
+static VALUE allocateEventListener(VALUE);
+static VALUE initializeEventListener(int, VALUE *, VALUE);
+static VALUE getEventListenerConnection(VALUE);
+static VALUE getEventListenerNames(VALUE);
+static VALUE isEventListenerActive(VALUE);
+static VALUE closeEventListener(VALUE);
+void setupEventListener(VALUE, VALUE, VALUE, VALUE);
+void createEventBlocks(EventListenerHandle *, VALUE);
+int queueEventBlock(EventListenerHandle *, EventBlock *, VALUE, ISC_STATUS *);
+void cancelEventBlocks(EventListenerHandle *, VALUE);
+VALUE dispatchEvents(void *);
+void waitForEvents(EventListenerHandle *);
+void deliverEvents(VALUE, EventListenerHandle *);
+VALUE callEventBlock(VALUE);
+VALUE eventBlockRescue(VALUE, VALUE);
+void eventCallback(void *, ISC_USHORT, const ISC_UCHAR *);
+void *waitOnListener(void *);
+void wakeEventListener(void *);
+
+/* Globals. */
+VALUE cEventListener;
+
+
+/**
+ * This function provides for the allocation of new EventListener objects
+ * through the Ruby language.
+ *
+ * @param  klass  A reference to the EventListener Class object.
+ *
+ * @return  A reference to the newly allocated EventListener object.
+ *
+ */
+static VALUE allocateEventListener(VALUE klass)
+{
+   VALUE               instance  = Qnil;
+   EventListenerHandle *listener = ALLOC(EventListenerHandle);
+
+   if(listener != NULL)
+   {
+      memset(listener, 0, sizeof(EventListenerHandle));
+      initializeLock(&listener->lock);
+      initializeCondition(&listener->notified);
+      instance = Data_Wrap_Struct(klass, NULL, eventListenerFree, listener);
+   }
+   else
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure creating an event listener.");
+   }
+
+   return(instance);
+}
+
+
+/**
+ * This function provides the initialize method for the EventListener class.
+ *
+ * @param  argc  A count of the number of arguments passed to the function.
+ * @param  argv  A pointer to the array of arguments passed to the function.
+ *               The first argument is the Connection to listen on and the
+ *               remainder are the names of the events to listen for.
+ * @param  self  A reference to the EventListener object being initialized.
+ *
+ * @return  A reference to the initialized object.
+ *
+ */
+static VALUE initializeEventListener(int argc, VALUE *argv, VALUE self)
+{
+   if(argc < 2)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               2);
+   }
+   if(!rb_block_given_p())
+   {
+      rb_ibruby_raise(NULL, "No block specified for event listener.");
+   }
+   setupEventListener(self, argv[0], rb_ary_new4(argc - 1, &argv[1]),
+                      rb_block_proc());
+
+   return(self);
+}
+
+
+/**
+ * This function provides the connection method for the EventListener class.
+ *
+ * @param  self  A reference to the EventListener object to make the call on.
+ *
+ * @return  A reference to the Connection being listened on.
+ *
+ */
+static VALUE getEventListenerConnection(VALUE self)
+{
+   return(rb_iv_get(self, "@connection"));
+}
+
+
+/**
+ * This function provides the names method for the EventListener class.
+ *
+ * @param  self  A reference to the EventListener object to make the call on.
+ *
+ * @return  An Array containing the names of the events being listened for.
+ *
+ */
+static VALUE getEventListenerNames(VALUE self)
+{
+   return(rb_ary_dup(rb_iv_get(self, "@names")));
+}
+
+
+/**
+ * This function provides the active? method for the EventListener class.
+ *
+ * @param  self  A reference to the EventListener object to make the call on.
+ *
+ * @return  Qtrue if the listener is still receiving events, Qfalse otherwise.
+ *
+ */
+static VALUE isEventListenerActive(VALUE self)
+{
+   EventListenerHandle *listener = NULL;
+
+   Data_Get_Struct(self, EventListenerHandle, listener);
+
+   return(listener->closed ? Qfalse : Qtrue);
+}
+
+
+/**
+ * This function provides the close method for the EventListener class. The
+ * outstanding event requests are cancelled and, unless called from within the
+ * listener block, the call waits for the thread delivering events to finish.
+ *
+ * @param  self  A reference to the EventListener object to be closed.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE closeEventListener(VALUE self)
+{
+   EventListenerHandle *listener   = NULL;
+   VALUE               connection  = rb_iv_get(self, "@connection"),
+                       thread      = rb_iv_get(self, "@thread"),
+                       listeners   = Qnil;
+
+   Data_Get_Struct(self, EventListenerHandle, listener);
+   acquireLock(&listener->lock);
+   listener->closed = 1;
+   broadcastCondition(&listener->notified);
+   releaseLock(&listener->lock);
+
+   if(connection != Qnil)
+   {
+      cancelEventBlocks(listener, connection);
+      listeners = rb_iv_get(connection, "@listeners");
+      if(listeners != Qnil)
+      {
+         rb_ary_delete(listeners, self);
+      }
+   }
+
+   if(thread != Qnil && thread != rb_thread_current())
+   {
+      rb_iv_set(self, "@thread", Qnil);
+      rb_funcall(thread, rb_intern("join"), 0);
+   }
+
+   return(self);
+}
+
+
+/**
+ * This function sets up an EventListener, building the event parameter
+ * blocks, queueing them with the database and starting the thread that
+ * delivers events to the listener block.
+ *
+ * @param  self        A reference to the EventListener object to set up.
+ * @param  connection  A reference to the Connection to listen on.
+ * @param  names       A reference to an Array of event names, which may
+ *                     contain nested Arrays.
+ * @param  block       A reference to the Proc that receives the events.
+ *
+ */
+void setupEventListener(VALUE self, VALUE connection, VALUE names,
+                        VALUE block)
+{
+   EventListenerHandle *listener  = NULL;
+   ConnectionHandle    *handle    = NULL;
+   ISC_STATUS          status[20];
+   VALUE               list       = rb_ary_new(),
+                       name       = Qnil,
+                       listeners  = Qnil;
+   long                size       = 0,
+                       index;
+   int                 number;
+
+   if(TYPE(connection) != T_DATA ||
+      RDATA(connection)->dfree != (RUBY_DATA_FUNC)connectionFree)
+   {
+      rb_ibruby_raise(NULL, "Invalid connection specified for event listener.");
+   }
+   Data_Get_Struct(connection, ConnectionHandle, handle);
+   if(handle->handle == 0)
+   {
+      rb_ibruby_raise(NULL, "Closed connection specified for event listener.");
+   }
+
+   /* Collect and check the event names. */
+   names = rb_funcall(names, rb_intern("flatten"), 0);
+   size  = NUM2LONG(rb_funcall(names, rb_intern("size"), 0));
+   for(index = 0; index < size; index++)
+   {
+      name = rb_funcall(rb_ary_entry(names, index), rb_intern("to_s"), 0);
+      if(strlen(STR2CSTR(name)) == 0 || strlen(STR2CSTR(name)) > 255)
+      {
+         rb_ibruby_raise(NULL, "Invalid event name specified.");
+      }
+      rb_ary_push(list, name);
+   }
+   if(size == 0)
+   {
+      rb_ibruby_raise(NULL, "No event names specified for event listener.");
+   }
+
+   Data_Get_Struct(self, EventListenerHandle, listener);
+   rb_iv_set(self, "@connection", connection);
+   rb_iv_set(self, "@names", list);
+   rb_iv_set(self, "@block", block);
+   rb_iv_set(self, "@thread", Qnil);
+   createEventBlocks(listener, list);
+
+   /* Queue the event requests. */
+   for(number = 0; number < listener->count; number++)
+   {
+      if(queueEventBlock(listener, &listener->blocks[number], connection,
+                         status) != 0)
+      {
+         acquireLock(&listener->lock);
+         listener->closed = 1;
+         releaseLock(&listener->lock);
+         cancelEventBlocks(listener, connection);
+         rb_ibruby_raise(status, "Error queueing database event request.");
+      }
+   }
+
+   listeners = rb_iv_get(connection, "@listeners");
+   if(listeners == Qnil)
+   {
+      listeners = rb_ary_new();
+      rb_iv_set(connection, "@listeners", listeners);
+   }
+   rb_ary_push(listeners, self);
+   rb_iv_set(self, "@thread", rb_thread_create(dispatchEvents, (void *)self));
+}
+
+
+/**
+ * This function creates the event parameter blocks for an EventListener. A
+ * single block can hold no more than fifteen event names so a block is
+ * created for each group of up to fifteen names.
+ *
+ * @param  listener  A pointer to the listener structure to be populated.
+ * @param  names     A reference to an Array of event name Strings.
+ *
+ */
+void createEventBlocks(EventListenerHandle *listener, VALUE names)
+{
+   long size   = NUM2LONG(rb_funcall(names, rb_intern("size"), 0)),
+        index;
+   int  number;
+
+   listener->count  = (int)((size + MAX_EVENTS_PER_BLOCK - 1) /
+                            MAX_EVENTS_PER_BLOCK);
+   listener->blocks = ALLOC_N(EventBlock, listener->count);
+   if(listener->blocks == NULL)
+   {
+      listener->count = 0;
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure creating an event listener.");
+   }
+   memset(listener->blocks, 0, sizeof(EventBlock) * listener->count);
+
+   for(number = 0; number < listener->count; number++)
+   {
+      EventBlock *block = &listener->blocks[number];
+      char       *list[MAX_EVENTS_PER_BLOCK];
+
+      memset(list, 0, sizeof(list));
+      block->listener = listener;
+      block->first    = number * MAX_EVENTS_PER_BLOCK;
+      block->count    = (int)(size - block->first);
+      if(block->count > MAX_EVENTS_PER_BLOCK)
+      {
+         block->count = MAX_EVENTS_PER_BLOCK;
+      }
+      for(index = 0; index < block->count; index++)
+      {
+         list[index] = STR2CSTR(rb_ary_entry(names, block->first + index));
+      }
+      block->length = (short)isc_event_block(&block->buffer, &block->result,
+                                             (ISC_USHORT)block->count,
+                                             list[0], list[1], list[2],
+                                             list[3], list[4], list[5],
+                                             list[6], list[7], list[8],
+                                             list[9], list[10], list[11],
+                                             list[12], list[13], list[14]);
+      if(block->buffer == NULL || block->result == NULL)
+      {
+         rb_raise(rb_eNoMemError,
+                  "Memory allocation failure creating an event listener.");
+      }
+   }
+}
+
+
+/**
+ * This function queues an event parameter block with the database so that
+ * the event callback is invoked when any of its events are posted.
+ *
+ * @param  listener    A pointer to the listener owning the block.
+ * @param  block       A pointer to the event block to be queued.
+ * @param  connection  A reference to the Connection to queue the block on.
+ * @param  status      A pointer to the status vector to be used.
+ *
+ * @return  Zero if the block was queued, non-zero otherwise.
+ *
+ */
+int queueEventBlock(EventListenerHandle *listener, EventBlock *block,
+                    VALUE connection, ISC_STATUS *status)
+{
+   ConnectionHandle *handle = NULL;
+   int              result  = 0;
+
+   Data_Get_Struct(connection, ConnectionHandle, handle);
+
+   /* The callback can fire before the request returns. */
+   acquireLock(&listener->lock);
+   block->queued = 1;
+   releaseLock(&listener->lock);
+   result = isc_que_events(status, &handle->handle, &block->id, block->length,
+                           block->buffer, EVENT_CALLBACK(eventCallback),
+                           block) != 0;
+   if(result)
+   {
+      acquireLock(&listener->lock);
+      block->queued = 0;
+      releaseLock(&listener->lock);
+   }
+
+   return(result);
+}
+
+
+/**
+ * This function cancels any of the event requests for a listener that are
+ * still outstanding with the database. Errors are ignored as the connection
+ * may already have been lost.
+ *
+ * @param  listener    A pointer to the listener whose requests are to be
+ *                     cancelled.
+ * @param  connection  A reference to the Connection the requests were queued
+ *                     on.
+ *
+ */
+void cancelEventBlocks(EventListenerHandle *listener, VALUE connection)
+{
+   ConnectionHandle *handle = NULL;
+   ISC_STATUS       status[20];
+   int              number,
+                    queued;
+
+   Data_Get_Struct(connection, ConnectionHandle, handle);
+   for(number = 0; number < listener->count; number++)
+   {
+      EventBlock *block = &listener->blocks[number];
+
+      acquireLock(&listener->lock);
+      queued        = block->queued;
+      block->queued = 0;
+      releaseLock(&listener->lock);
+      if(queued && handle->handle != 0)
+      {
+         isc_cancel_events(status, &handle->handle, &block->id);
+      }
+   }
+}
+
+
+/**
+ * This function provides the body of the thread that delivers events to the
+ * block of an EventListener, running until the listener is closed.
+ *
+ * @param  data  The EventListener object, cast to a pointer.
+ *
+ * @return  Always Qnil.
+ *
+ */
+VALUE dispatchEvents(void *data)
+{
+   volatile VALUE      self      = (VALUE)data;
+   EventListenerHandle *listener = NULL;
+
+   Data_Get_Struct(self, EventListenerHandle, listener);
+   while(!listener->closed)
+   {
+      waitForEvents(listener);
+      deliverEvents(self, listener);
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function waits for the database to notify a listener of events. Where
+ * the interpreter lock can be released the wait is made on the listener
+ * condition, otherwise the current Ruby thread sleeps briefly so that other
+ * Ruby threads can run.
+ *
+ * @param  listener  A pointer to the listener structure.
+ *
+ */
+void waitForEvents(EventListenerHandle *listener)
+{
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+   callBlocking(waitOnListener, listener, wakeEventListener, listener);
+#else
+   struct timeval interval;
+
+   interval.tv_sec  = 0;
+   interval.tv_usec = 10000;
+   rb_thread_wait_for(interval);
+#endif
+}
+
+
+/**
+ * This function delivers the events recorded against a listener's blocks to
+ * the listener block and then queues the blocks with the database again. The
+ * first notification for a block only establishes the current event counts
+ * and is not delivered.
+ *
+ * @param  self      A reference to the EventListener object.
+ * @param  listener  A pointer to the listener structure.
+ *
+ */
+void deliverEvents(VALUE self, EventListenerHandle *listener)
+{
+   VALUE      names      = rb_iv_get(self, "@names"),
+              connection = rb_iv_get(self, "@connection");
+   ISC_STATUS status[20];
+   int        number,
+              index,
+              pending;
+
+   for(number = 0; number < listener->count && !listener->closed; number++)
+   {
+      EventBlock *block = &listener->blocks[number];
+      ISC_ULONG  counts[MAX_EVENTS_PER_BLOCK];
+
+      acquireLock(&listener->lock);
+      pending        = block->pending;
+      block->pending = 0;
+      if(pending)
+      {
+         listener->pending--;
+      }
+      releaseLock(&listener->lock);
+      if(!pending)
+      {
+         continue;
+      }
+
+      memset(counts, 0, sizeof(counts));
+      isc_event_counts(counts, block->length, block->buffer, block->result);
+      for(index = 0; index < block->count && block->primed; index++)
+      {
+         if(counts[index] > 0)
+         {
+            VALUE args = rb_ary_new();
+
+            rb_ary_push(args, rb_iv_get(self, "@block"));
+            rb_ary_push(args, rb_ary_entry(names, block->first + index));
+            rb_ary_push(args, UINT2NUM(counts[index]));
+            rb_rescue(callEventBlock, args, eventBlockRescue, self);
+
+         }
+      }
+      block->primed = 1;
+
+      /* The block may have closed the listener. */
+      if(!listener->closed &&
+         queueEventBlock(listener, block, connection, status) != 0)
+      {
+         acquireLock(&listener->lock);
+         listener->closed = 1;
+         releaseLock(&listener->lock);
+         cancelEventBlocks(listener, connection);
+         rb_ibruby_raise(status, "Error queueing database event request.");
+      }
+   }
+}
+
+
+/**
+ * This function calls an event listener block with the name of an event and
+ * the number of times it has been posted.
+ *
+ * @param  args  A reference to an Array containing the block, the event name
+ *               and the count.
+ *
+ * @return  The value returned by the block.
+ *
+ */
+VALUE callEventBlock(VALUE args)
+{
+   return(rb_funcall(rb_ary_entry(args, 0), rb_intern("call"), 2,
+                     rb_ary_entry(args, 1), rb_ary_entry(args, 2)));
+}
+
+
+/**
+ * This function handles exceptions raised by an event listener block. The
+ * exception is reported as a warning so that the listener carries on
+ * receiving events.
+ *
+ * @param  self   A reference to the EventListener object.
+ * @param  error  A reference to the exception raised.
+ *
+ * @return  Always Qnil.
+ *
+ */
+VALUE eventBlockRescue(VALUE self, VALUE error)
+{
+   VALUE message = rb_funcall(error, rb_intern("message"), 0);
+
+   rb_warn("Exception raised by event listener block: %s", STR2CSTR(message));
+
+   return(Qnil);
+}
+
+
+/**
+ * This function is called by the database client library when events queued
+ * by a listener are posted. It is called on a client library thread and so
+ * makes no calls into Ruby, it records the updated event counts and wakes the
+ * listener thread.
+ *
+ * @param  data     A pointer to the EventBlock that was queued.
+ * @param  length   The length of the updated event parameter block.
+ * @param  updated  A pointer to the updated event parameter block.
+ *
+ */
+void eventCallback(void *data, ISC_USHORT length, const ISC_UCHAR *updated)
+{
+   EventBlock          *block    = (EventBlock *)data;
+   EventListenerHandle *listener = block->listener;
+
+   acquireLock(&listener->lock);
+   block->queued = 0;
+   if(!listener->closed && updated != NULL && length > 0)
+   {
+      memcpy(block->result, updated,
+             length < block->length ? length : block->length);
+      if(!block->pending)
+      {
+         block->pending = 1;
+         listener->pending++;
+      }
+      signalCondition(&listener->notified);
+   }
+   releaseLock(&listener->lock);
+}
+
+
+/**
+ * This function waits on a listener condition until events have been
+ * recorded, the listener is closed or a quarter of a second has passed. It
+ * is called without the interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the listener structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *waitOnListener(void *data)
+{
+   EventListenerHandle *listener = (EventListenerHandle *)data;
+
+   acquireLock(&listener->lock);
+   if(listener->pending == 0 && !listener->closed)
+   {
+      waitOnCondition(&listener->notified, &listener->lock, 250);
+   }
+   releaseLock(&listener->lock);
+
+   return(NULL);
+}
+
+
+/**
+ * This function is called by the interpreter to interrupt a listener thread
+ * waiting for events, such as when the thread is killed.
+ *
+ * @param  data  A pointer to the listener structure.
+ *
+ */
+void wakeEventListener(void *data)
+{
+   EventListenerHandle *listener = (EventListenerHandle *)data;
+
+   acquireLock(&listener->lock);
+   broadcastCondition(&listener->notified);
+   releaseLock(&listener->lock);
+}
+
+
+/**
+ * This function creates a new EventListener object.
+ *
+ * @param  connection  A reference to the Connection to listen on.
+ * @param  names       A reference to an Array of event names.
+ * @param  block       A reference to the Proc to receive the events.
+ *
+ * @return  A reference to the new EventListener object.
+ *
+ */
+VALUE rb_event_listener_new(VALUE connection, VALUE names, VALUE block)
+{
+   VALUE listener = allocateEventListener(cEventListener);
+
+   setupEventListener(listener, connection, names, block);
+
+   return(listener);
+}
+
+
+/**
+ * This function closes all of the EventListener objects active on a
+ * Connection. It is called before the connection is detached.
+ *
+ * @param  connection  A reference to the Connection being closed.
+ *
+ */
+void rb_event_listeners_close(VALUE connection)
+{
+   VALUE listeners = rb_iv_get(connection, "@listeners"),
+         listener  = Qnil;
+
+   if(listeners != Qnil)
+   {
+      listeners = rb_ary_dup(listeners);
+      while((listener = rb_ary_pop(listeners)) != Qnil)
+      {
+         closeEventListener(listener);
+      }
+   }
+}
+
+
+/**
+ * This function integrates with the Ruby garbage collector to release the
+ * resources associated with an EventListener object.
+ *
+ * @param  listener  A pointer to the EventListenerHandle structure associated
+ *                   with the object being collected.
+ *
+ */
+void eventListenerFree(void *listener)
+{
+   if(listener != NULL)
+   {
+      EventListenerHandle *handle = (EventListenerHandle *)listener;
+      int                 number;
+
+      for(number = 0; number < handle->count; number++)
+      {
+         if(handle->blocks[number].buffer != NULL)
+         {
+            isc_free((char *)handle->blocks[number].buffer);
+         }
+         if(handle->blocks[number].result != NULL)
+         {
+            isc_free((char *)handle->blocks[number].result);
+         }
+      }
+      if(handle->blocks != NULL)
+      {
+         free(handle->blocks);
+      }
+      destroyCondition(&handle->notified);
+      destroyLock(&handle->lock);
+      free(handle);
+   }
+}
+
+
+/**
+ * This function initializes the EventListener class within the Ruby
+ * environment. The class is established under the module specified to the
+ * function.
+ *
+ * @param  module  A reference to the module to create the class within.
+ *
+ */
+void Init_EventListener(VALUE module)
+{
+   cEventListener = rb_define_class_under(module, "EventListener", rb_cObject);
+   rb_define_alloc_func(cEventListener, allocateEventListener);
+   rb_define_method(cEventListener, "initialize", initializeEventListener, -1);
+   rb_define_method(cEventListener, "initialize_copy", forbidObjectCopy, 1);
+   rb_define_method(cEventListener, "connection",
+                    getEventListenerConnection, 0);
+   rb_define_method(cEventListener, "names", getEventListenerNames, 0);
+   rb_define_method(cEventListener, "active?", isEventListenerActive, 0);
+   rb_define_method(cEventListener, "close", closeEventListener, 0);
+}
@@ -0,0 +1,77 @@
+/*------------------------------------------------------------------------------
+ * EventListener.h
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+#ifndef IBRUBY_EVENT_LISTENER_H
+#define IBRUBY_EVENT_LISTENER_H
+
+   /* Includes. */
+   #ifndef IBRUBY_FIRE_RUBY_H
+      #include "IBRuby.h"
+   #endif
+
+   #ifndef IBRUBY_FIRE_RUBY_EXCEPTION_H
+      #include "IBRubyException.h"
+   #endif
+
+   #ifndef IBRUBY_THREADS_H
+      #include "Threads.h"
+   #endif
+
+   /* Definitions. */
+   #define MAX_EVENTS_PER_BLOCK 15
+
+   /* Structure definitions. */
+   typedef struct EventListenerHandle EventListenerHandle;
+
+   typedef struct
+   {
+      EventListenerHandle *listener;
+      ISC_UCHAR           *buffer,
+                          *result;
+      ISC_LONG            id;
+      short               length;
+      int                 first,
+                          count,
+                          queued,
+                          pending,
+                          primed;
+   } EventBlock;
+
+   struct EventListenerHandle
+   {
+      IBRubyLock      lock;
+      IBRubyCondition notified;
+      EventBlock      *blocks;
+      int             count,
+                      pending,
+                      closed;
+   };
+
+   /* Function prototypes. */
+   void Init_EventListener(VALUE);
+   VALUE rb_event_listener_new(VALUE, VALUE, VALUE);
+   void rb_event_listeners_close(VALUE);
+   void eventListenerFree(void *);
+
+#endif /* IBRUBY_EVENT_LISTENER_H */
@@ -0,0 +1,757 @@
+/*------------------------------------------------------------------------------
+ * GapMonitor.c
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "GapMonitor.h"
+#include "Common.h"
+#include "Connection.h"
+#include "Database.h"
+#include "Transaction.h"
+#include <string.h>
+
+/* Type definitions. */
+typedef struct
+{
+   char item;
+   char *name;
+} TransactionMarker;
+
+/* Function prototypes. */
+static VALUE allocateGapMonitor(VALUE);
+static VALUE initializeGapMonitor(int, VALUE *, VALUE);
+static VALUE getGapMonitorDatabase(VALUE);
+static VALUE getGapMonitorInterval(VALUE);
+static VALUE getGapMonitorThreshold(VALUE);
+static VALUE getGapMonitorMarkers(VALUE);
+static VALUE getGapMonitorGap(VALUE);
+static VALUE getGapMonitorError(VALUE);
+static VALUE isGapMonitorActive(VALUE);
+static VALUE stopGapMonitor(VALUE);
+VALUE runGapMonitor(void *);
+VALUE sampleGapMonitor(VALUE);
+VALUE gapMonitorRescue(VALUE, VALUE);
+VALUE callGapMonitorBlock(VALUE);
+VALUE gapMonitorBlockRescue(VALUE, VALUE);
+void closeGapMonitorConnection(VALUE);
+VALUE ignoreGapMonitorError(VALUE, VALUE);
+void waitForGapMonitor(GapMonitorHandle *);
+void *waitOnGapMonitor(void *);
+void wakeGapMonitor(void *);
+
+/* Definitions. */
+#define MARKERS_INFO_SIZE     64
+#define DEFAULT_GAP_INTERVAL  60
+#define DEFAULT_GAP_THRESHOLD 10000
+
+/* Globals. */
+VALUE cGapMonitor;
+
+static TransactionMarker markers[] = {{isc_info_oldest_transaction,
+                                       "oldest_transaction"},
+                                      {isc_info_oldest_active,
+                                       "oldest_active"},
+                                      {isc_info_oldest_snapshot,
+                                       "oldest_snapshot"},
+                                      {isc_info_next_transaction,
+                                       "next_transaction"}};
+
+
+/**
+ * This function fetches the transaction markers for the database that a
+ * connection is attached to.
+ *
+ * @param  connection  A reference to the Connection to make the request
+ *                     through.
+ *
+ * @return  A reference to a Hash of the oldest interesting transaction
+ *          (:oldest_transaction), the oldest active transaction
+ *          (:oldest_active), the oldest snapshot (:oldest_snapshot) and the
+ *          next transaction number (:next_transaction).
+ *
+ */
+VALUE rb_transaction_markers(VALUE connection)
+{
+   ConnectionHandle *handle = NULL;
+   VALUE            result  = rb_hash_new();
+   char             items[sizeof(markers) / sizeof(TransactionMarker) + 1],
+                    buffer[MARKERS_INFO_SIZE],
+                    *offset = buffer;
+   int              count   = 0,
+                    i;
+   ISC_STATUS       status[20];
+
+   Data_Get_Struct(connection, ConnectionHandle, handle);
+   if(handle->handle == 0)
+   {
+      rb_ibruby_raise(NULL, "Connection is closed.");
+   }
+
+   for(i = 0; i < sizeof(markers) / sizeof(TransactionMarker); i++)
+   {
+      items[count++] = markers[i].item;
+   }
+   items[count] = isc_info_end;
+
+   memset(buffer, 0, sizeof(buffer));
+   if(getDatabaseInfo(status, &handle->handle, count, items,
+                      sizeof(buffer), buffer) != 0)
+   {
+      rb_ibruby_raise(status, "Error fetching transaction markers.");
+   }
+
+   while(offset < buffer + sizeof(buffer) && *offset != isc_info_end &&
+         *offset != isc_info_truncated)
+   {
+      char  item   = *offset++;
+      short length = (short)isc_vax_integer(offset, 2);
+
+      offset += 2;
+      for(i = 0; i < sizeof(markers) / sizeof(TransactionMarker); i++)
+      {
+         if(item == markers[i].item)
+         {
+            rb_hash_aset(result, toSymbol(markers[i].name),
+                         toInfoInteger(offset, length));
+         }
+      }
+      offset += length;
+   }
+
+   return(result);
+}
+
+
+/**
+ * This function provides for the allocation of new GapMonitor objects
+ * through the Ruby language.
+ *
+ * @param  klass  A reference to the GapMonitor Class object.
+ *
+ * @return  A reference to the newly allocated GapMonitor object.
+ *
+ */
+static VALUE allocateGapMonitor(VALUE klass)
+{
+   VALUE            instance = Qnil;
+   GapMonitorHandle *monitor = ALLOC(GapMonitorHandle);
+
+   if(monitor != NULL)
+   {
+      memset(monitor, 0, sizeof(GapMonitorHandle));
+      monitor->stopped = 1;
+      initializeLock(&monitor->lock);
+      initializeCondition(&monitor->wakeup);
+      instance = Data_Wrap_Struct(klass, NULL, gapMonitorFree, monitor);
+   }
+   else
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure creating a gap monitor.");
+   }
+
+   return(instance);
+}
+
+
+/**
+ * This function provides the initialize method for the GapMonitor class,
+ * starting the thread that samples the transaction markers.
+ *
+ * @param  argc  A count of the number of arguments passed to the function.
+ * @param  argv  A pointer to the array of arguments passed to the function.
+ *               These are the Database to monitor, the user name and
+ *               password to connect with and an optional Hash of options.
+ * @param  self  A reference to the GapMonitor object being initialized.
+ *
+ * @return  A reference to the initialized object.
+ *
+ */
+static VALUE initializeGapMonitor(int argc, VALUE *argv, VALUE self)
+{
+   GapMonitorHandle *monitor  = NULL;
+   VALUE            options   = Qnil,
+                    interval  = INT2FIX(DEFAULT_GAP_INTERVAL),
+                    threshold = INT2FIX(DEFAULT_GAP_THRESHOLD),
+                    from      = toSymbol("oldest_active"),
+                    value     = Qnil;
+   double           seconds   = 0;
+   int              i,
+                    valid     = 0;
+
+   if(argc < 3 || argc > 4)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               argc < 3 ? 3 : 4);
+   }
+   if(!rb_block_given_p())
+   {
+      rb_ibruby_raise(NULL, "No block specified for gap monitor.");
+   }
+
+   if(argc > 3 && argv[3] != Qnil)
+   {
+      options = argv[3];
+      if((value = rb_hash_aref(options, toSymbol("interval"))) != Qnil)
+      {
+         interval = value;
+      }
+      if((value = rb_hash_aref(options, toSymbol("threshold"))) != Qnil)
+      {
+         threshold = value;
+      }
+      if((value = rb_hash_aref(options, toSymbol("from"))) != Qnil)
+      {
+         from = value;
+      }
+   }
+
+   seconds = NUM2DBL(interval);
+   if(seconds <= 0)
+   {
+      rb_ibruby_raise(NULL, "Invalid interval specified for gap monitor.");
+   }
+   if(rb_funcall(threshold, rb_intern("<="), 1, INT2FIX(0)) == Qtrue)
+   {
+      rb_ibruby_raise(NULL, "Invalid threshold specified for gap monitor.");
+   }
+   for(i = 0; i < sizeof(markers) / sizeof(TransactionMarker); i++)
+   {
+      if(markers[i].item != isc_info_next_transaction &&
+         from == toSymbol(markers[i].name))
+      {
+         valid = 1;
+      }
+   }
+   if(!valid)
+   {
+      rb_ibruby_raise(NULL, "Invalid marker specified for gap monitor.");
+   }
+
+   Data_Get_Struct(self, GapMonitorHandle, monitor);
+   monitor->interval = (long)(seconds * 1000.0);
+   if(monitor->interval < 1)
+   {
+      monitor->interval = 1;
+   }
+   /* The password is kept out of sight in the monitor structure. */
+   if(monitor->password != NULL)
+   {
+      memset(monitor->password, 0, strlen(monitor->password));
+      free(monitor->password);
+      monitor->password = NULL;
+   }
+   if(argv[2] != Qnil)
+   {
+      char *text = STR2CSTR(argv[2]);
+
+      monitor->password = ALLOC_N(char, strlen(text) + 1);
+      if(monitor->password == NULL)
+      {
+         rb_raise(rb_eNoMemError,
+                  "Memory allocation failure creating a gap monitor.");
+      }
+      strcpy(monitor->password, text);
+   }
+   monitor->stopped = 0;
+
+   rb_iv_set(self, "@database", argv[0]);
+   rb_iv_set(self, "@user", argv[1]);
+   rb_iv_set(self, "@interval", interval);
+   rb_iv_set(self, "@threshold", threshold);
+   rb_iv_set(self, "@from", from);
+   rb_iv_set(self, "@block", rb_block_proc());
+   rb_iv_set(self, "@connection", Qnil);
+   rb_iv_set(self, "@markers", Qnil);
+   rb_iv_set(self, "@gap", Qnil);
+   rb_iv_set(self, "@error", Qnil);
+   rb_iv_set(self, "@thread", rb_thread_create(runGapMonitor, (void *)self));
+
+   return(self);
+}
+
+
+/**
+ * This function provides the database attribute accessor for the GapMonitor
+ * class.
+ *
+ * @param  self  A reference to the GapMonitor object to make the call on.
+ *
+ * @return  A reference to the Database being monitored.
+ *
+ */
+static VALUE getGapMonitorDatabase(VALUE self)
+{
+   return(rb_iv_get(self, "@database"));
+}
+
+
+/**
+ * This function provides the interval attribute accessor for the GapMonitor
+ * class.
+ *
+ * @param  self  A reference to the GapMonitor object to make the call on.
+ *
+ * @return  A reference to the number of seconds between samples.
+ *
+ */
+static VALUE getGapMonitorInterval(VALUE self)
+{
+   return(rb_iv_get(self, "@interval"));
+}
+
+
+/**
+ * This function provides the threshold attribute accessor for the GapMonitor
+ * class.
+ *
+ * @param  self  A reference to the GapMonitor object to make the call on.
+ *
+ * @return  A reference to the gap at which the monitor block is called.
+ *
+ */
+static VALUE getGapMonitorThreshold(VALUE self)
+{
+   return(rb_iv_get(self, "@threshold"));
+}
+
+
+/**
+ * This function provides the markers attribute accessor for the GapMonitor
+ * class.
+ *
+ * @param  self  A reference to the GapMonitor object to make the call on.
+ *
+ * @return  A reference to the Hash of markers from the last sample, or nil
+ *          if no sample has been taken yet.
+ *
+ */
+static VALUE getGapMonitorMarkers(VALUE self)
+{
+   return(rb_iv_get(self, "@markers"));
+}
+
+
+/**
+ * This function provides the gap attribute accessor for the GapMonitor
+ * class.
+ *
+ * @param  self  A reference to the GapMonitor object to make the call on.
+ *
+ * @return  A reference to the gap found by the last sample, or nil if no
+ *          sample has been taken yet.
+ *
+ */
+static VALUE getGapMonitorGap(VALUE self)
+{
+   return(rb_iv_get(self, "@gap"));
+}
+
+
+/**
+ * This function provides the error attribute accessor for the GapMonitor
+ * class.
+ *
+ * @param  self  A reference to the GapMonitor object to make the call on.
+ *
+ * @return  A reference to the exception raised by the last sample, or nil if
+ *          it succeeded.
+ *
+ */
+static VALUE getGapMonitorError(VALUE self)
+{
+   return(rb_iv_get(self, "@error"));
+}
+
+
+/**
+ * This function provides the active? method for the GapMonitor class.
+ *
+ * @param  self  A reference to the GapMonitor object to make the call on.
+ *
+ * @return  Qtrue if the monitor is still sampling, Qfalse otherwise.
+ *
+ */
+static VALUE isGapMonitorActive(VALUE self)
+{
+   GapMonitorHandle *monitor = NULL;
+
+   Data_Get_Struct(self, GapMonitorHandle, monitor);
+
+   return(monitor->stopped ? Qfalse : Qtrue);
+}
+
+
+/**
+ * This function provides the stop method for the GapMonitor class. Unless
+ * called from within the monitor block, the call waits for the sampling
+ * thread to finish.
+ *
+ * @param  self  A reference to the GapMonitor object to be stopped.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE stopGapMonitor(VALUE self)
+{
+   GapMonitorHandle *monitor = NULL;
+   VALUE            thread   = rb_iv_get(self, "@thread");
+
+   Data_Get_Struct(self, GapMonitorHandle, monitor);
+   acquireLock(&monitor->lock);
+   monitor->stopped = 1;
+   broadcastCondition(&monitor->wakeup);
+   releaseLock(&monitor->lock);
+
+   if(thread != Qnil && thread != rb_thread_current())
+   {
+      rb_iv_set(self, "@thread", Qnil);
+#ifndef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+      if(rb_funcall(thread, rb_intern("alive?"), 0) == Qtrue)
+      {
+         rb_funcall(thread, rb_intern("wakeup"), 0);
+      }
+#endif
+      rb_funcall(thread, rb_intern("join"), 0);
+   }
+
+   return(self);
+}
+
+
+/**
+ * This function provides the body of the thread that samples the transaction
+ * markers for a GapMonitor, running until the monitor is stopped.
+ *
+ * @param  data  The GapMonitor object, cast to a pointer.
+ *
+ * @return  Always Qnil.
+ *
+ */
+VALUE runGapMonitor(void *data)
+{
+   volatile VALUE   self     = (VALUE)data;
+   GapMonitorHandle *monitor = NULL;
+
+   Data_Get_Struct(self, GapMonitorHandle, monitor);
+   while(!monitor->stopped)
+   {
+      rb_rescue(sampleGapMonitor, self, gapMonitorRescue, self);
+      if(!monitor->stopped)
+      {
+         waitForGapMonitor(monitor);
+      }
+   }
+   closeGapMonitorConnection(self);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function takes a sample of the transaction markers for a GapMonitor,
+ * connecting to the database first if need be. The monitor block is called
+ * when the gap reaches the threshold, and not again until the gap has fallen
+ * back below it.
+ *
+ * @param  self  A reference to the GapMonitor object.
+ *
+ * @return  Always Qnil.
+ *
+ */
+VALUE sampleGapMonitor(VALUE self)
+{
+   GapMonitorHandle *monitor    = NULL;
+   VALUE            connection  = rb_iv_get(self, "@connection"),
+                    markers     = Qnil,
+                    gap         = Qnil;
+
+   Data_Get_Struct(self, GapMonitorHandle, monitor);
+   if(connection == Qnil)
+   {
+      VALUE password = Qnil;
+
+      if(monitor->password != NULL)
+      {
+         password = rb_str_new2(monitor->password);
+      }
+      connection = rb_funcall(rb_iv_get(self, "@database"),
+                              rb_intern("connect"), 2,
+                              rb_iv_get(self, "@user"), password);
+      rb_iv_set(self, "@connection", connection);
+   }
+
+   markers = rb_transaction_markers(connection);
+   gap     = rb_funcall(rb_hash_aref(markers, toSymbol("next_transaction")),
+                        rb_intern("-"), 1,
+                        rb_hash_aref(markers, rb_iv_get(self, "@from")));
+   rb_iv_set(self, "@markers", markers);
+   rb_iv_set(self, "@gap", gap);
+   rb_iv_set(self, "@error", Qnil);
+
+   if(rb_funcall(gap, rb_intern(">="), 1,
+                 rb_iv_get(self, "@threshold")) == Qtrue)
+   {
+      if(!monitor->alerted && !monitor->stopped)
+      {
+         VALUE args = rb_ary_new();
+
+         monitor->alerted = 1;
+         rb_ary_push(args, rb_iv_get(self, "@block"));
+         rb_ary_push(args, gap);
+         rb_ary_push(args, markers);
+         rb_ary_push(args, rb_transactions_active(0));
+         rb_rescue(callGapMonitorBlock, args, gapMonitorBlockRescue, self);
+      }
+   }
+   else
+   {
+      monitor->alerted = 0;
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function handles exceptions raised while sampling the transaction
+ * markers. The exception is recorded and the connection dropped, so that the
+ * next sample connects afresh.
+ *
+ * @param  self   A reference to the GapMonitor object.
+ * @param  error  A reference to the exception raised.
+ *
+ * @return  Always Qnil.
+ *
+ */
+VALUE gapMonitorRescue(VALUE self, VALUE error)
+{
+   rb_iv_set(self, "@error", error);
+   closeGapMonitorConnection(self);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function calls a gap monitor block with the gap, the markers and the
+ * active transactions.
+ *
+ * @param  args  A reference to an Array containing the block followed by the
+ *               values to pass to it.
+ *
+ * @return  The value returned by the block.
+ *
+ */
+VALUE callGapMonitorBlock(VALUE args)
+{
+   return(rb_funcall(rb_ary_entry(args, 0), rb_intern("call"), 3,
+                     rb_ary_entry(args, 1), rb_ary_entry(args, 2),
+                     rb_ary_entry(args, 3)));
+}
+
+
+/**
+ * This function handles exceptions raised by a gap monitor block. The
+ * exception is reported as a warning so that the monitor carries on
+ * sampling.
+ *
+ * @param  self   A reference to the GapMonitor object.
+ * @param  error  A reference to the exception raised.
+ *
+ * @return  Always Qnil.
+ *
+ */
+VALUE gapMonitorBlockRescue(VALUE self, VALUE error)
+{
+   VALUE message = rb_funcall(error, rb_intern("message"), 0);
+
+   rb_warn("Exception raised by gap monitor block: %s", STR2CSTR(message));
+
+   return(Qnil);
+}
+
+
+/**
+ * This function closes the connection used by a GapMonitor, if it has one.
+ * Errors closing the connection are ignored as it may already have been
+ * lost.
+ *
+ * @param  self  A reference to the GapMonitor object.
+ *
+ */
+void closeGapMonitorConnection(VALUE self)
+{
+   VALUE connection = rb_iv_get(self, "@connection");
+
+   rb_iv_set(self, "@connection", Qnil);
+   if(connection != Qnil)
+   {
+      rb_rescue(connectEnsure, connection, ignoreGapMonitorError, Qnil);
+   }
+}
+
+
+/**
+ * This function discards an exception raised closing a gap monitor
+ * connection.
+ *
+ * @param  unused  Like it says, not used.
+ * @param  error   A reference to the exception raised.
+ *
+ * @return  Always Qnil.
+ *
+ */
+VALUE ignoreGapMonitorError(VALUE unused, VALUE error)
+{
+   return(Qnil);
+}
+
+
+/**
+ * This function waits for the interval between samples to pass. Where the
+ * interpreter lock can be released the wait is made on the monitor
+ * condition, so that stopping the monitor ends it early, otherwise the
+ * current Ruby thread sleeps.
+ *
+ * @param  monitor  A pointer to the monitor structure.
+ *
+ */
+void waitForGapMonitor(GapMonitorHandle *monitor)
+{
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+   /* Cleared before the wait as the interrupt can come before it starts. */
+   acquireLock(&monitor->lock);
+   monitor->woken = 0;
+   releaseLock(&monitor->lock);
+   callBlocking(waitOnGapMonitor, monitor, wakeGapMonitor, monitor);
+#else
+   struct timeval interval;
+
+   interval.tv_sec  = monitor->interval / 1000;
+   interval.tv_usec = (monitor->interval % 1000) * 1000;
+   rb_thread_wait_for(interval);
+#endif
+}
+
+
+/**
+ * This function waits on a monitor condition until the interval between
+ * samples has passed, the monitor is stopped or the wait is interrupted. It
+ * is called without the interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the monitor structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *waitOnGapMonitor(void *data)
+{
+   GapMonitorHandle *monitor  = (GapMonitorHandle *)data;
+   double           deadline  = getCurrentTime() + (monitor->interval / 1000.0);
+
+   acquireLock(&monitor->lock);
+   while(!monitor->stopped && !monitor->woken)
+   {
+      long remaining = (long)((deadline - getCurrentTime()) * 1000.0);
+
+      if(remaining <= 0)
+      {
+         break;
+      }
+      waitOnCondition(&monitor->wakeup, &monitor->lock, remaining);
+   }
+   releaseLock(&monitor->lock);
+
+   return(NULL);
+}
+
+
+/**
+ * This function is called by the interpreter to interrupt a monitor thread
+ * waiting between samples, such as when the thread is killed.
+ *
+ * @param  data  A pointer to the monitor structure.
+ *
+ */
+void wakeGapMonitor(void *data)
+{
+   GapMonitorHandle *monitor = (GapMonitorHandle *)data;
+
+   acquireLock(&monitor->lock);
+   monitor->woken = 1;
+   broadcastCondition(&monitor->wakeup);
+   releaseLock(&monitor->lock);
+}
+
+
+/**
+ * This function integrates with the Ruby garbage collector to release the
+ * resources associated with a GapMonitor object.
+ *
+ * @param  monitor  A pointer to the GapMonitorHandle structure associated
+ *                  with the object being collected.
+ *
+ */
+void gapMonitorFree(void *monitor)
+{
+   if(monitor != NULL)
+   {
+      GapMonitorHandle *handle = (GapMonitorHandle *)monitor;
+
+      destroyCondition(&handle->wakeup);
+      destroyLock(&handle->lock);
+      if(handle->password != NULL)
+      {
+         memset(handle->password, 0, strlen(handle->password));
+         free(handle->password);
+      }
+      free(handle);
+   }
+}
+
+
+/**
+ * This function initializes the GapMonitor class within the Ruby
+ * environment. The class is established under the module specified to the
+ * function.
+ *
+ * @param  module  A reference to the module to create the class within.
+ *
+ */
+void Init_GapMonitor(VALUE module)
+{
+   cGapMonitor = rb_define_class_under(module, "GapMonitor", rb_cObject);
+   rb_define_alloc_func(cGapMonitor, allocateGapMonitor);
+   rb_define_method(cGapMonitor, "initialize", initializeGapMonitor, -1);
+   rb_define_method(cGapMonitor, "initialize_copy", forbidObjectCopy, 1);
+   rb_define_method(cGapMonitor, "database", getGapMonitorDatabase, 0);
+   rb_define_method(cGapMonitor, "interval", getGapMonitorInterval, 0);
+   rb_define_method(cGapMonitor, "threshold", getGapMonitorThreshold, 0);
+   rb_define_method(cGapMonitor, "markers", getGapMonitorMarkers, 0);
+   rb_define_method(cGapMonitor, "gap", getGapMonitorGap, 0);
+   rb_define_method(cGapMonitor, "error", getGapMonitorError, 0);
+   rb_define_method(cGapMonitor, "active?", isGapMonitorActive, 0);
+   rb_define_method(cGapMonitor, "stop", stopGapMonitor, 0);
+}
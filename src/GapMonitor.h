@@ -0,0 +1,58 @@
+/*------------------------------------------------------------------------------
+ * GapMonitor.h
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+#ifndef IBRUBY_GAP_MONITOR_H
+#define IBRUBY_GAP_MONITOR_H
+
+   /* Includes. */
+   #ifndef IBRUBY_FIRE_RUBY_H
+      #include "IBRuby.h"
+   #endif
+
+   #ifndef IBRUBY_FIRE_RUBY_EXCEPTION_H
+      #include "IBRubyException.h"
+   #endif
+
+   #ifndef IBRUBY_THREADS_H
+      #include "Threads.h"
+   #endif
+
+   /* Structure definitions. */
+   typedef struct
+   {
+      IBRubyLock      lock;
+      IBRubyCondition wakeup;
+      long            interval;
+      char            *password;
+      int             stopped,
+                      woken,
+                      alerted;
+   } GapMonitorHandle;
+
+   /* Function prototypes. */
+   void Init_GapMonitor(VALUE);
+   VALUE rb_transaction_markers(VALUE);
+   void gapMonitorFree(void *);
+
+#endif /* IBRUBY_GAP_MONITOR_H */
@@ -100,6 +100,10 @@ static VALUE doesGeneratorExist(VALUE, VALUE, VALUE);
 
 static VALUE createGenerator(VALUE, VALUE, VALUE);
 
+static VALUE reserveGeneratorValues(VALUE, VALUE);
+static VALUE getGeneratorCacheSize(VALUE);
+static VALUE setGeneratorCacheSize(VALUE, VALUE);
+static VALUE getGeneratorStatistics(VALUE);
 int checkForGenerator(const char *, isc_db_handle *);
 
 int installGenerator(const char *, isc_db_handle *);
@@ -108,7 +112,7 @@ int deleteGenerator(const char *, isc_db_handle *);
 
 XSQLDA *createStorage(void);
 
-int32_t getGeneratorValue(const char *, int, isc_db_handle *);
+ISC_INT64 getGeneratorValue(const char *, long, isc_db_handle *);
 
 
 
@@ -154,6 +158,12 @@ static VALUE allocateGenerator(VALUE klass)
 
       generator->connection = NULL;
 
+      generator->next       = 1;
+      generator->limit      = 0;
+      generator->cache      = 0;
+      generator->hits       = 0;
+      generator->misses     = 0;
+
       instance              = Data_Wrap_Struct(klass, NULL, generatorFree,
 
                                                generator);
@@ -348,7 +358,7 @@ static VALUE getLastGeneratorValue(VALUE self)
 
    GeneratorHandle  *generator = NULL;
 
-   int32_t          number     = 0;
+   ISC_INT64        number     = 0;
 
 
 
@@ -360,7 +370,7 @@ static VALUE getLastGeneratorValue(VALUE self)
 
 
 
-   return(INT2NUM(number));
+   return(LL2NUM(number));
 
 }
 
@@ -383,9 +393,9 @@ static VALUE getLastGeneratorValue(VALUE self)
  *
 
  * @return  A reference to an integer containing the next generator value.
-
+ *          Where a cache size has been set for the Generator and the step is
+ *          1 the value is issued from a locally reserved block of values.
  *
-
  */
 
 static VALUE getNextGeneratorValue(VALUE self, VALUE step)
@@ -396,7 +406,7 @@ static VALUE getNextGeneratorValue(VALUE self, VALUE step)
 
    GeneratorHandle  *generator = NULL;
 
-   int32_t          number     = 0;
+   ISC_INT64        number     = 0;
 
 
 
@@ -416,13 +426,31 @@ static VALUE getNextGeneratorValue(VALUE self, VALUE step)
 
 
 
-   number = getGeneratorValue(STR2CSTR(name), FIX2INT(step),
-
-                              generator->connection);
+   if(generator->cache > 0 && FIX2INT(step) == 1)
+   {
+      /* Hand the value out of the locally reserved block if possible. */
+      if(generator->next > generator->limit)
+      {
+         generator->limit = getGeneratorValue(STR2CSTR(name), generator->cache,
+                                              generator->connection);
+         generator->next  = generator->limit - generator->cache + 1;
+         generator->misses++;
+      }
+      else
+      {
+         generator->hits++;
+      }
+      number = generator->next++;
+   }
+   else
+   {
+      number = getGeneratorValue(STR2CSTR(name), FIX2INT(step),
+                                 generator->connection);
+   }
 
 
 
-   return(INT2NUM(number));
+   return(LL2NUM(number));
 
 }
 
@@ -651,7 +679,122 @@ static VALUE createGenerator(VALUE klass, VALUE name, VALUE connection)
 
 
 /**
+ * This function provides the reserve method for the Generator class. A block
+ * of values is taken from the database generator with a single call and
+ * returned to the caller for local issue.
+ *
+ * @param  self  A reference to the Generator object to reserve values from.
+ * @param  size  The number of values to be reserved.
+ *
+ * @return  A reference to a Range containing the reserved values.
+ *
+ */
+static VALUE reserveGeneratorValues(VALUE self, VALUE size)
+{
+   VALUE            name       = rb_iv_get(self, "@name");
+   GeneratorHandle  *generator = NULL;
+   ISC_INT64        last       = 0;
+
+   Data_Get_Struct(self, GeneratorHandle, generator);
+
+   if(TYPE(size) != T_FIXNUM || FIX2INT(size) < 1)
+   {
+      rb_ibruby_raise(NULL, "Invalid generator reservation size.");
+   }
+
+   last = getGeneratorValue(STR2CSTR(name), FIX2INT(size),
+                            generator->connection);
+
+   return(rb_range_new(LL2NUM(last - FIX2INT(size) + 1), LL2NUM(last), 0));
+}
+
+
+/**
+ * This function provides the cache_size accessor for the Generator class.
+ *
+ * @param  self  A reference to the Generator object to fetch the cache size
+ *               for.
+ *
+ * @return  A reference to an integer containing the number of values that
+ *          will be reserved each time the local cache is refilled. A value
+ *          of zero indicates that caching is not in use.
+ *
+ */
+static VALUE getGeneratorCacheSize(VALUE self)
+{
+   GeneratorHandle *generator = NULL;
+
+   Data_Get_Struct(self, GeneratorHandle, generator);
 
+   return(INT2NUM(generator->cache));
+}
+
+
+/**
+ * This function provides the cache_size= mutator for the Generator class.
+ * Changing the cache size discards any values remaining in the current block.
+ * Calls on the Generator are made while holding the interpreter lock so the
+ * cache may be shared by multiple threads.
+ *
+ * @param  self  A reference to the Generator object to set the cache size
+ *               for.
+ * @param  size  The number of values to reserve each time the cache is
+ *               refilled, 0 to switch caching off.
+ *
+ * @return  A reference to the cache size set.
+ *
+ */
+static VALUE setGeneratorCacheSize(VALUE self, VALUE size)
+{
+   GeneratorHandle *generator = NULL;
+
+   Data_Get_Struct(self, GeneratorHandle, generator);
+
+   if(TYPE(size) != T_FIXNUM || FIX2INT(size) < 0)
+   {
+      rb_ibruby_raise(NULL, "Invalid generator cache size.");
+   }
+
+   generator->cache = FIX2INT(size);
+   generator->next  = 1;
+   generator->limit = 0;
+
+   return(size);
+}
+
+
+/**
+ * This function provides the statistics method for the Generator class.
+ *
+ * @param  self  A reference to the Generator object to fetch the statistics
+ *               for.
+ *
+ * @return  A reference to a Hash containing the :hits, :misses and :cached
+ *          counts for the local value cache.
+ *
+ */
+static VALUE getGeneratorStatistics(VALUE self)
+{
+   VALUE           statistics = rb_hash_new();
+   GeneratorHandle *generator = NULL;
+   ISC_INT64       cached     = 0;
+
+   Data_Get_Struct(self, GeneratorHandle, generator);
+
+   if(generator->next <= generator->limit)
+   {
+      cached = generator->limit - generator->next + 1;
+   }
+
+   rb_hash_aset(statistics, toSymbol("hits"), LONG2NUM(generator->hits));
+   rb_hash_aset(statistics, toSymbol("misses"), LONG2NUM(generator->misses));
+   rb_hash_aset(statistics, toSymbol("cached"), LL2NUM(cached));
+
+   return(statistics);
+}
+
+
+/**
  * This function executes a check for a named generator.
 
  *
@@ -1120,11 +1263,11 @@ XSQLDA *createStorage(void)
 
       da->sqld      = 1;
 
-      var->sqltype  = SQL_LONG;
+      var->sqltype  = SQL_INT64;
 
       var->sqlscale = 0;
 
-      var->sqllen   = sizeof(long);
+      var->sqllen   = sizeof(ISC_INT64);
 
       prepareDataArea(da);
 
@@ -1168,17 +1311,18 @@ XSQLDA *createStorage(void)
 
  *
 
- * @return  A long integer containing the generator value.
+ * @return  A 64 bit integer containing the generator value.
 
  *
 
  */
 
-int32_t getGeneratorValue(const char *name, int step, isc_db_handle *connection)
+ISC_INT64 getGeneratorValue(const char *name, long step,
+                            isc_db_handle *connection)
 
 {
 
-   int32_t       result      = 0;
+   ISC_INT64     result      = 0;
 
    ISC_STATUS    status[20];
 
@@ -1196,7 +1340,7 @@ int32_t getGeneratorValue(const char *name, int step, isc_db_handle *connection)
 
 
 
-      sprintf(sql, "SELECT GEN_ID(%s, %d) FROM RDB$DATABASE", name, step);
+      sprintf(sql, "SELECT GEN_ID(%s, %ld) FROM RDB$DATABASE", name, step);
 
       if(isc_dsql_exec_immed2(status, connection, &transaction, 0, sql,
 
@@ -1204,7 +1348,7 @@ int32_t getGeneratorValue(const char *name, int step, isc_db_handle *connection)
 
       {
 
-         result = *((int32_t *)da->sqlvar->sqldata);
+         result = *((ISC_INT64 *)da->sqlvar->sqldata);
 
       }
 
@@ -1371,6 +1515,10 @@ void Init_Generator(VALUE module)
    rb_define_method(cGenerator, "name", getGeneratorName, 0);
 
    rb_define_method(cGenerator, "drop", dropGenerator, 0);
+   rb_define_method(cGenerator, "reserve", reserveGeneratorValues, 1);
+   rb_define_method(cGenerator, "cache_size", getGeneratorCacheSize, 0);
+   rb_define_method(cGenerator, "cache_size=", setGeneratorCacheSize, 1);
+   rb_define_method(cGenerator, "statistics", getGeneratorStatistics, 0);
 
    rb_define_module_function(cGenerator, "exists?", doesGeneratorExist, 2);
 
@@ -43,6 +43,11 @@
    typedef struct
    {
       isc_db_handle *connection;
+      ISC_INT64     next,
+                    limit;
+      long          cache,
+                    hits,
+                    misses;
    } GeneratorHandle;
 
    /* Function prototypes. */
@@ -40,10 +40,18 @@
 #include "Blob.h"
 
 #include "Backup.h"
+#include "NBackup.h"
+#include "ServiceQueue.h"
+#include "Statistics.h"
+#include "TraceSession.h"
+#include "GapMonitor.h"
 
 #include "Database.h"
 
 #include "Connection.h"
+#include "ConnectionPool.h"
+#include "EventListener.h"
+#include "Parallel.h"
 
 #include "IBRubyException.h"
 
@@ -57,17 +65,32 @@
 
 #include "Statement.h"
 
+#include "Threads.h"
 #include "Transaction.h"
+#include "TransactionOptions.h"
 
 #include "Restore.h"
 
 #include "Row.h"
+#ifdef HAVE_RUBY_RACTOR_H
+   #include <ruby/ractor.h>
+#endif
 
 
 #ifdef OS_UNIX
   #define __declspec(X) 
 #endif
 
+/* Function prototypes. */
+static VALUE getSettings(VALUE);
+
+/* Globals. */
+#ifdef HAVE_RUBY_RACTOR_H
+static VALUE                 defaultSettings = Qnil,
+                             mainRactor      = Qnil;
+static rb_ractor_local_key_t settingsKey;
+#endif
+
 
 
 
@@ -89,7 +112,7 @@ VALUE getIBRubySetting(const char *key)
 
 {
 
-   VALUE settings = rb_gv_get("$IBRubySettings");
+   VALUE settings = getIBRubySettings();
 
    return(rb_hash_aref(settings, toSymbol(key)));
 
@@ -99,6 +122,52 @@ VALUE getIBRubySetting(const char *key)
 
 
 
+/**
+ * This function fetches the IBRuby settings hash for the current Ractor. The
+ * main Ractor always reads $IBRubySettings, so assigning a new hash to it
+ * takes effect, while every other Ractor gets its own copy of the default
+ * settings the first time it asks for them, as global variables cannot be
+ * shared between Ractors.
+ *
+ * @return  A reference to the settings hash.
+ *
+ */
+VALUE getIBRubySettings(void)
+{
+#ifdef HAVE_RUBY_RACTOR_H
+   VALUE settings = Qnil;
+
+   if(rb_funcall(rb_cRactor, rb_intern("current"), 0) == mainRactor)
+   {
+      return(rb_gv_get("$IBRubySettings"));
+   }
+   if(!rb_ractor_local_storage_value_lookup(settingsKey, &settings))
+   {
+      settings = rb_hash_dup(defaultSettings);
+      rb_ractor_local_storage_value_set(settingsKey, settings);
+   }
+
+   return(settings);
+#else
+   return(rb_gv_get("$IBRubySettings"));
+#endif
+}
+
+
+/**
+ * This function provides the settings method for the IBRuby module.
+ *
+ * @param  self  A reference to the IBRuby module.
+ *
+ * @return  A reference to the settings hash for the current Ractor.
+ *
+ */
+static VALUE getSettings(VALUE self)
+{
+   return(getIBRubySettings());
+}
+
+
 /**
 
  * This function provides a convenience mechanism to obtain the class name for
@@ -158,6 +227,31 @@ VALUE toSymbol(const char *name)
 }
 
 
+/**
+ * This function converts an integer value taken from an information request
+ * reply into a Ruby number. Firebird returns transaction numbers as eight
+ * byte values once they no longer fit in four bytes.
+ *
+ * @param  value   A pointer to the start of the integer value.
+ * @param  length  The length of the value in bytes.
+ *
+ * @return  A reference to the number.
+ *
+ */
+VALUE toInfoInteger(const char *value, short length)
+{
+#if defined(FB_API_VER) && FB_API_VER >= 20
+   if(length > 4)
+   {
+      return(LL2NUM(isc_portable_integer((const unsigned char *)value,
+                                         length)));
+   }
+#endif
+
+   return(LONG2NUM(isc_vax_integer(value, length)));
+}
+
+
 
 
 
@@ -411,6 +505,11 @@ extern void Init_ib_lib(void)
 
          hash   = rb_hash_new();
 
+#ifdef HAVE_RB_EXT_RACTOR_SAFE
+   /* Everything defined from here on may be used from any Ractor. */
+   rb_ext_ractor_safe(1);
+#endif
+
 
 
    /* Initialise the configuration and make it available. */
@@ -424,10 +523,23 @@ extern void Init_ib_lib(void)
    rb_hash_aset(hash, toSymbol("ALIAS_KEYS"), Qtrue);
 
    rb_hash_aset(hash, toSymbol("DATE_AS_DATE"), Qtrue);
+   rb_hash_aset(hash, toSymbol("SHARED_READ_TRANSACTION"), Qfalse);
+   rb_hash_aset(hash, toSymbol("READ_TRANSACTION_STATEMENTS"), INT2FIX(1000));
+   rb_hash_aset(hash, toSymbol("READ_TRANSACTION_SECONDS"), INT2FIX(60));
+   rb_hash_aset(hash, toSymbol("NON_BLOCKING_EXECUTION"), Qtrue);
+   rb_hash_aset(hash, toSymbol("CLIENT_WORKER_THREADS"), INT2FIX(4));
 
    rb_gv_set("$IBRubyVersion", array);
 
    rb_gv_set("$IBRubySettings", hash);
+#ifdef HAVE_RUBY_RACTOR_H
+   defaultSettings = rb_ractor_make_shareable(rb_hash_dup(hash));
+   rb_gc_register_mark_object(defaultSettings);
+   mainRactor = rb_funcall(rb_cRactor, rb_intern("current"), 0);
+   rb_gc_register_mark_object(mainRactor);
+   settingsKey = rb_ractor_local_storage_value_newkey();
+#endif
+   rb_define_module_function(module, "settings", getSettings, 0);
 
 
 
@@ -439,12 +551,17 @@ extern void Init_ib_lib(void)
 
 
    /* Initialise the library classes. */
+   Init_Threads(module);
 
    Init_Database(module);
 
    Init_Connection(module);
+   Init_ConnectionPool(module);
+   Init_EventListener(module);
+   Init_Parallel(module);
 
    Init_Transaction(module);
+   Init_TransactionOptions(module);
 
    Init_Statement(module);
 
@@ -461,6 +578,11 @@ extern void Init_ib_lib(void)
    Init_ServiceManager(module);
 
    Init_Backup(module);
+   Init_NBackup(module);
+   Init_ServiceQueue(module);
+   Init_Statistics(module);
+   Init_TraceSession(module);
+   Init_GapMonitor(module);
 
    Init_AddUser(module);
 
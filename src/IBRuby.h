@@ -43,8 +43,10 @@
    
    /* Function definitions. */
    VALUE getIBRubySetting(const char *);
+   VALUE getIBRubySettings(void);
    void getClassName(VALUE, char *);
    VALUE toSymbol(const char *);
+   VALUE toInfoInteger(const char *, short);
    VALUE getColumnType(const XSQLVAR *);
 
 #endif /* IBRUBY_FIRE_RUBY_H */
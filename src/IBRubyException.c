@@ -33,10 +33,18 @@ static VALUE initializeIBRubyException(VALUE, VALUE);
 static VALUE getIBRubyExceptionSQLCode(VALUE);
 static VALUE getIBRubyExceptionDBCode(VALUE);
 static VALUE getIBRubyExceptionMessage(VALUE);
-VALUE decodeError(ISC_STATUS *, const char *, VALUE);
+static VALUE getIBRubyExceptionGDSCodes(VALUE);
+static VALUE isIBRubyExceptionRetryable(VALUE);
+VALUE decodeException(ISC_STATUS *, const char *);
+VALUE getGDSCodes(ISC_STATUS *);
+VALUE getExceptionClass(ISC_STATUS *);
+int hasGDSCode(ISC_STATUS *, ISC_STATUS);
+ISC_STATUS *copyStatusVector(ISC_STATUS *);
 
 /* Globals. */
-VALUE cIBRubyException;
+VALUE cIBRubyException,
+      cConflictError,
+      cDeadlockError;
 
 
 /**
@@ -55,7 +63,9 @@ static VALUE allocateIBRubyException(VALUE klass)
    
    if(exception != NULL)
    {
-      exception->when = (long)time(NULL);
+      exception->when   = (long)time(NULL);
+      exception->status = NULL;
+      exception->prefix = NULL;
       instance = Data_Wrap_Struct(klass, NULL, ibrubyExceptionFree,
                                   exception);
    }
@@ -89,8 +99,9 @@ static VALUE initializeIBRubyException(VALUE self, VALUE message)
    }
    
    rb_iv_set(self, "@message", message);
-   rb_iv_set(self, "@sql_code", 0);
-   rb_iv_set(self, "@db_code", 0);
+   rb_iv_set(self, "@sql_code", INT2FIX(0));
+   rb_iv_set(self, "@db_code", INT2FIX(0));
+   rb_iv_set(self, "@gds_codes", rb_ary_new());
    
    return(self);
 }
@@ -98,7 +109,8 @@ static VALUE initializeIBRubyException(VALUE self, VALUE message)
 
 /**
  * This function provides the accessor for the SQL code attribute of the
- * IBRubyException class.
+ * IBRubyException class. The code is worked out from the status vector the
+ * first time it is asked for.
  *
  * @param  self  A reference to the exception to fetch the code from.
  *
@@ -107,7 +119,18 @@ static VALUE initializeIBRubyException(VALUE self, VALUE message)
  */
 static VALUE getIBRubyExceptionSQLCode(VALUE self)
 {
-   return(rb_iv_get(self, "@sql_code"));
+   VALUE code = rb_iv_get(self, "@sql_code");
+
+   if(code == Qnil)
+   {
+      ExceptionHandle *exception = NULL;
+
+      Data_Get_Struct(self, ExceptionHandle, exception);
+      code = INT2NUM(isc_sqlcode(exception->status));
+      rb_iv_set(self, "@sql_code", code);
+   }
+
+   return(code);
 }
 
 
@@ -128,6 +151,9 @@ static VALUE getIBRubyExceptionDBCode(VALUE self)
 
 /**
  * This function provides the message method for the IBRubyException class.
+ * For exceptions raised by the library the message text is only decoded from
+ * the status vector the first time it is asked for, as many errors, such as
+ * lock conflicts that are retried, are handled without it being needed.
  *
  * @param  self  A reference to the exception object to fetch the message from.
  *
@@ -136,7 +162,247 @@ static VALUE getIBRubyExceptionDBCode(VALUE self)
  */
 static VALUE getIBRubyExceptionMessage(VALUE self)
 {
-   return(rb_iv_get(self, "@message"));
+   VALUE message = rb_iv_get(self, "@message");
+
+   if(message == Qnil)
+   {
+      ExceptionHandle *exception = NULL;
+
+      Data_Get_Struct(self, ExceptionHandle, exception);
+      message = decodeException(exception->status, exception->prefix);
+      rb_iv_set(self, "@message", message);
+   }
+
+   return(message);
+}
+
+
+/**
+ * This function provides the gds_codes method for the IBRubyException class.
+ *
+ * @param  self  A reference to the exception object to fetch the codes from.
+ *
+ * @return  A reference to an Array of the error codes from the status vector
+ *          that the exception was raised for, in the order they appeared.
+ *
+ */
+static VALUE getIBRubyExceptionGDSCodes(VALUE self)
+{
+   VALUE codes = rb_iv_get(self, "@gds_codes");
+
+   if(codes == Qnil)
+   {
+      ExceptionHandle *exception = NULL;
+
+      Data_Get_Struct(self, ExceptionHandle, exception);
+      codes = getGDSCodes(exception->status);
+      rb_iv_set(self, "@gds_codes", codes);
+   }
+
+   return(codes);
+}
+
+
+/**
+ * This function provides the retryable? method for the IBRubyException
+ * class.
+ *
+ * @param  self  A reference to the exception object to make the call on.
+ *
+ * @return  Qtrue if the exception reports a lock conflict or deadlock that a
+ *          fresh attempt at the transaction may avoid, Qfalse otherwise.
+ *
+ */
+static VALUE isIBRubyExceptionRetryable(VALUE self)
+{
+   return(rb_obj_is_kind_of(self, cConflictError));
+}
+
+
+/**
+ * This function extracts the error codes from an InterBase status vector.
+ *
+ * @param  status  A pointer to the status vector. May be NULL.
+ *
+ * @return  A reference to an Array of the error codes.
+ *
+ */
+VALUE getGDSCodes(ISC_STATUS *status)
+{
+   VALUE      codes  = rb_ary_new();
+   ISC_STATUS *entry = status;
+
+   if(entry != NULL && entry[0] == isc_arg_gds && entry[1] != 0)
+   {
+      while(*entry != isc_arg_end)
+      {
+         switch(*entry)
+         {
+            case isc_arg_gds :
+               rb_ary_push(codes, INT2NUM(entry[1]));
+               entry += 2;
+               break;
+
+            case isc_arg_cstring :
+               entry += 3;
+               break;
+
+            default :
+               entry += 2;
+         }
+      }
+   }
+
+   return(codes);
+}
+
+
+/**
+ * This function checks whether an InterBase status vector contains a given
+ * error code.
+ *
+ * @param  status  A pointer to the status vector. May be NULL.
+ * @param  code    The error code to look for.
+ *
+ * @return  Non-zero if the code is present, zero otherwise.
+ *
+ */
+int hasGDSCode(ISC_STATUS *status, ISC_STATUS code)
+{
+   ISC_STATUS *entry = status;
+
+   if(entry != NULL && entry[0] == isc_arg_gds && entry[1] != 0)
+   {
+      while(*entry != isc_arg_end)
+      {
+         if(*entry == isc_arg_gds && entry[1] == code)
+         {
+            return(1);
+         }
+         entry += (*entry == isc_arg_cstring ? 3 : 2);
+      }
+   }
+
+   return(0);
+}
+
+
+/**
+ * This function selects the exception class to be raised for a status
+ * vector. Firebird reports an update conflict as a deadlock followed by the
+ * more specific code so the specific conflict codes are checked first.
+ *
+ * @param  status  A pointer to the status vector. May be NULL.
+ *
+ * @return  A reference to the exception class.
+ *
+ */
+VALUE getExceptionClass(ISC_STATUS *status)
+{
+   VALUE result = cIBRubyException;
+
+   if(hasGDSCode(status, isc_update_conflict) ||
+      hasGDSCode(status, isc_lock_conflict) ||
+      hasGDSCode(status, isc_lock_timeout))
+   {
+      result = cConflictError;
+   }
+   else if(hasGDSCode(status, isc_deadlock))
+   {
+      result = cDeadlockError;
+   }
+
+   return(result);
+}
+
+
+/**
+ * This function takes a copy of an InterBase status vector. The strings the
+ * vector refers to belong to the client library and may be overwritten by
+ * later calls so they are copied too, into the same block of memory, and the
+ * vector entries pointed at the copies.
+ *
+ * @param  status  A pointer to the status vector to be copied. May be NULL.
+ *
+ * @return  A pointer to the copy, to be released with free, or NULL.
+ *
+ */
+ISC_STATUS *copyStatusVector(ISC_STATUS *status)
+{
+   ISC_STATUS *copy   = NULL,
+              *entry  = status;
+   long       count   = 1,
+              size    = 0;
+   char       *text   = NULL;
+
+   if(status == NULL)
+   {
+      return(NULL);
+   }
+
+   /* Size the vector and the strings it refers to. */
+   while(*entry != isc_arg_end)
+   {
+      switch(*entry)
+      {
+         case isc_arg_cstring :
+            size  += entry[1] + 1;
+            count += 3;
+            entry += 3;
+            break;
+
+         case isc_arg_string :
+         case isc_arg_interpreted :
+         case isc_arg_sql_state :
+            size  += strlen((char *)entry[1]) + 1;
+            count += 2;
+            entry += 2;
+            break;
+
+         default :
+            count += 2;
+            entry += 2;
+      }
+   }
+
+   copy = (ISC_STATUS *)malloc((sizeof(ISC_STATUS) * count) + size);
+   if(copy == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure copying an error status vector.");
+   }
+   memcpy(copy, status, sizeof(ISC_STATUS) * count);
+
+   /* Copy the strings and point the copied vector at them. */
+   text  = (char *)&copy[count];
+   entry = copy;
+   while(*entry != isc_arg_end)
+   {
+      switch(*entry)
+      {
+         case isc_arg_cstring :
+            memcpy(text, (char *)entry[2], entry[1]);
+            text[entry[1]] = '\0';
+            entry[2]       = (ISC_STATUS)text;
+            text          += entry[1] + 1;
+            entry         += 3;
+            break;
+
+         case isc_arg_string :
+         case isc_arg_interpreted :
+         case isc_arg_sql_state :
+            strcpy(text, (char *)entry[1]);
+            entry[1]  = (ISC_STATUS)text;
+            text     += strlen(text) + 1;
+            entry    += 2;
+            break;
+
+         default :
+            entry += 2;
+      }
+   }
+
+   return(copy);
 }
 
 
@@ -154,41 +420,46 @@ static VALUE getIBRubyExceptionMessage(VALUE self)
  */
 VALUE decodeException(ISC_STATUS *status, const char *prefix)
 {
-   VALUE      message = rb_str_new2(""),
-              eol     = rb_str_new2("\n");
+   VALUE      message = rb_str_new2("");
    char       text[512];
-   int        sqlCode = isc_sqlcode(status),
+   int        sqlCode = 0,
               dbCode  = 0;
-   ISC_STATUS **ptr   = &status;
+#ifdef FB_API_VER
+   const ISC_STATUS *ptr = status;
+#else
+   ISC_STATUS       *ptr = status;
+#endif
 
    /* Add the prefix message if it exists. */
    if(prefix != NULL && strlen(prefix) > 0)
    {
-      rb_str_concat(message, rb_str_new2(prefix));
-      rb_str_concat(message, eol);
+      rb_str_cat2(message, prefix);
+      rb_str_cat2(message, "\n");
    }
    
    if(status != NULL)
    {
       /* Decode the status array. */
-      dbCode = status[1];
-      while(isc_interprete(text, ptr) != 0)
+      sqlCode = isc_sqlcode(status);
+      dbCode  = status[1];
+#ifdef FB_API_VER
+      while(fb_interpret(text, sizeof(text), &ptr) != 0)
+#else
+      while(isc_interprete(text, &ptr) != 0)
+#endif
       {
-         rb_str_concat(message, rb_str_new2(text));
-         rb_str_concat(message, eol);
-         memset(text, 0, 512);
+         rb_str_cat2(message, text);
+         rb_str_cat2(message, "\n");
       }
       
-      isc_sql_interprete(sqlCode, text, 512);
+      isc_sql_interprete(sqlCode, text, sizeof(text));
       if(strlen(text) > 0)
       {
-         rb_str_concat(message, rb_str_new2(text));
+         rb_str_cat2(message, text);
       }
       
-      sprintf(text, "\nSQL Code = %d\n", sqlCode);
-      rb_str_concat(message, rb_str_new2(text));
-      sprintf(text, "InterBase Code = %d\n", dbCode);
-      rb_str_concat(message, rb_str_new2(text));
+      sprintf(text, "\nSQL Code = %d\nInterBase Code = %d\n", sqlCode, dbCode);
+      rb_str_cat2(message, text);
    }
    
    return(message);
@@ -225,9 +496,24 @@ VALUE rb_ibruby_exception_new(const char *message)
  */
 void rb_ibruby_raise(ISC_STATUS *status, const char *message)
 {
-   VALUE text = decodeException(status, message);
-   rb_raise(cIBRubyException, STR2CSTR(text));}
-
+   VALUE           instance   = allocateIBRubyException(getExceptionClass(status));
+   ExceptionHandle *exception = NULL;
+
+   /* Keep the raw details, the message is decoded if it's asked for. */
+   Data_Get_Struct(instance, ExceptionHandle, exception);
+   exception->status = copyStatusVector(status);
+   if(message != NULL)
+   {
+      exception->prefix = ALLOC_N(char, strlen(message) + 1);
+      strcpy(exception->prefix, message);
+   }
+   rb_iv_set(instance, "@message", Qnil);
+   rb_iv_set(instance, "@sql_code", status != NULL ? Qnil : INT2FIX(0));
+   rb_iv_set(instance, "@db_code", INT2NUM(status != NULL ? status[1] : 0));
+   rb_iv_set(instance, "@gds_codes", Qnil);
+   rb_exc_raise(instance);
+}
+
 
 
 /**
@@ -243,7 +529,17 @@ void ibrubyExceptionFree(void *exception)
 {
    if(exception != NULL)
    {
-      free((ExceptionHandle *)exception);
+      ExceptionHandle *handle = (ExceptionHandle *)exception;
+
+      if(handle->status != NULL)
+      {
+         free(handle->status);
+      }
+      if(handle->prefix != NULL)
+      {
+         free(handle->prefix);
+      }
+      free(handle);
    }
 }
 
@@ -264,4 +560,12 @@ void Init_IBRubyException(VALUE module)
    rb_define_method(cIBRubyException, "sql_code", getIBRubyExceptionSQLCode, 0);
    rb_define_method(cIBRubyException, "db_code", getIBRubyExceptionDBCode, 0);
    rb_define_method(cIBRubyException, "message", getIBRubyExceptionMessage, 0);
+   rb_define_method(cIBRubyException, "to_s", getIBRubyExceptionMessage, 0);
+   rb_define_method(cIBRubyException, "gds_codes", getIBRubyExceptionGDSCodes, 0);
+   rb_define_method(cIBRubyException, "retryable?", isIBRubyExceptionRetryable, 0);
+
+   cConflictError = rb_define_class_under(module, "ConflictError",
+                                          cIBRubyException);
+   cDeadlockError = rb_define_class_under(module, "DeadlockError",
+                                          cConflictError);
 }
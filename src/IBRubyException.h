@@ -39,9 +39,16 @@
    /* Type definitions. */
    typedef struct
    {
-      long when;
+      long       when;
+      ISC_STATUS *status;
+      char       *prefix;
    } ExceptionHandle;
    
+   /* Globals. */
+   extern VALUE cIBRubyException,
+                cConflictError,
+                cDeadlockError;
+
    /* Function prototypes. */
    void Init_IBRubyException(VALUE);
    VALUE rb_ibruby_exception_new(const char *);
@@ -0,0 +1,403 @@
+/*------------------------------------------------------------------------------
+ * IOStats.c
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "IOStats.h"
+#include "Connection.h"
+#include <stdlib.h>
+
+/* Type definitions. */
+typedef struct
+{
+   char item;
+   char *name;
+} IOCounter;
+
+/* Function prototypes. */
+VALUE getIOCounters(VALUE);
+void addTableCounters(VALUE, const char *, char *, short);
+VALUE getIOCountersDelta(VALUE, VALUE);
+VALUE getCountersDelta(VALUE, VALUE, int);
+VALUE nameIOTables(VALUE, VALUE);
+void loadRelationNames(VALUE);
+
+/* Definitions. */
+#define IO_INFO_SIZE          1024
+#define MAX_IO_INFO_SIZE      32767
+
+/* Globals. */
+static IOCounter pageCounters[] = {{isc_info_reads, "reads"},
+                                   {isc_info_writes, "writes"},
+                                   {isc_info_fetches, "fetches"},
+                                   {isc_info_marks, "marks"}};
+
+static IOCounter tableCounters[] = {{isc_info_read_seq_count,
+                                     "sequential_reads"},
+                                    {isc_info_read_idx_count, "indexed_reads"},
+                                    {isc_info_insert_count, "inserts"},
+                                    {isc_info_update_count, "updates"},
+                                    {isc_info_delete_count, "deletes"},
+                                    {isc_info_backout_count, "backouts"},
+                                    {isc_info_purge_count, "purges"},
+                                    {isc_info_expunge_count, "expunges"}};
+
+
+/**
+ * This function fetches the I/O and operation counters for a connection. The
+ * counts are those accumulated by the attachment since it was made.
+ *
+ * @param  connection  A reference to the Connection to fetch the counters
+ *                     for.
+ *
+ * @return  A reference to a Hash containing the page counters (:reads,
+ *          :writes, :fetches and :marks) and a :tables Hash of the operation
+ *          counters for each table touched, keyed on table name.
+ *
+ */
+VALUE rb_io_stats(VALUE connection)
+{
+   return(nameIOTables(connection, getIOCounters(connection)));
+}
+
+
+/**
+ * This function runs the block given to the calling method and returns the
+ * change in the I/O and operation counters for a connection made while it
+ * ran.
+ *
+ * @param  connection  A reference to the Connection to measure.
+ *
+ * @return  A reference to a Hash of the counter changes, laid out as for
+ *          rb_io_stats. Only tables with a counter that changed are included.
+ *
+ */
+VALUE rb_measure_io(VALUE connection)
+{
+   VALUE before = Qnil,
+         after  = Qnil;
+
+   if(!rb_block_given_p())
+   {
+      rb_ibruby_raise(NULL, "No block specified for I/O measurement.");
+   }
+
+   before = getIOCounters(connection);
+   rb_yield(connection);
+   after  = getIOCounters(connection);
+
+   return(nameIOTables(connection, getIOCountersDelta(before, after)));
+}
+
+
+/**
+ * This function makes the database information request for the counters of
+ * a connection. The table counters are left keyed on relation id so that no
+ * query is run between fetching them and working out a change.
+ *
+ * @param  connection  A reference to the Connection to fetch the counters
+ *                     for.
+ *
+ * @return  A reference to a Hash of the counters.
+ *
+ */
+VALUE getIOCounters(VALUE connection)
+{
+   ConnectionHandle *handle  = NULL;
+   VALUE            counters = rb_hash_new(),
+                    tables   = rb_hash_new();
+   char             items[sizeof(pageCounters) / sizeof(IOCounter) +
+                          sizeof(tableCounters) / sizeof(IOCounter) + 1],
+                    *buffer  = NULL,
+                    *offset  = NULL;
+   int              size     = IO_INFO_SIZE,
+                    count    = 0,
+                    done     = 0,
+                    i;
+   ISC_STATUS       status[20];
+
+   Data_Get_Struct(connection, ConnectionHandle, handle);
+   if(handle->handle == 0)
+   {
+      rb_ibruby_raise(NULL, "Connection is closed.");
+   }
+
+   for(i = 0; i < sizeof(pageCounters) / sizeof(IOCounter); i++)
+   {
+      items[count++] = pageCounters[i].item;
+   }
+   for(i = 0; i < sizeof(tableCounters) / sizeof(IOCounter); i++)
+   {
+      items[count++] = tableCounters[i].item;
+   }
+   items[count] = isc_info_end;
+
+   /* Make the request, growing the buffer until the reply fits. */
+   while(!done)
+   {
+      buffer = ALLOC_N(char, size);
+      if(buffer == NULL)
+      {
+         rb_raise(rb_eNoMemError,
+                  "Memory allocation failure fetching connection I/O "\
+                  "statistics.");
+      }
+      memset(buffer, 0, size);
+
+      if(getDatabaseInfo(status, &handle->handle, count, items, size,
+                         buffer) != 0)
+      {
+         free(buffer);
+         rb_ibruby_raise(status, "Error fetching connection I/O statistics.");
+      }
+
+      done = 1;
+      for(offset = buffer; *offset != isc_info_end &&
+          offset < buffer + size; )
+      {
+         char  item   = *offset++;
+         short length = 0;
+
+         if(item == isc_info_truncated)
+         {
+            done = -1;
+            break;
+         }
+         length  = isc_vax_integer(offset, 2);
+         offset += 2;
+
+         for(i = 0; i < sizeof(pageCounters) / sizeof(IOCounter); i++)
+         {
+            if(item == pageCounters[i].item)
+            {
+               rb_hash_aset(counters, toSymbol(pageCounters[i].name),
+                            LONG2NUM(isc_vax_integer(offset, length)));
+            }
+         }
+         for(i = 0; i < sizeof(tableCounters) / sizeof(IOCounter); i++)
+         {
+            if(item == tableCounters[i].item)
+            {
+               addTableCounters(tables, tableCounters[i].name, offset,
+                                length);
+            }
+         }
+         offset += length;
+      }
+      free(buffer);
+
+      if(done == -1)
+      {
+         if(size == MAX_IO_INFO_SIZE)
+         {
+            rb_ibruby_raise(NULL, "Connection I/O statistics too large to "\
+                            "fetch.");
+         }
+         size     = (size < MAX_IO_INFO_SIZE / 2 ? size * 2 :
+                     MAX_IO_INFO_SIZE);
+         done     = 0;
+         counters = rb_hash_new();
+         tables   = rb_hash_new();
+      }
+   }
+   rb_hash_aset(counters, toSymbol("tables"), tables);
+
+   return(counters);
+}
+
+
+/**
+ * This function adds the counts for one of the table operation counters to
+ * the Hash of table counters. The counts are a sequence of entries holding a
+ * two byte relation id followed by a four byte count.
+ *
+ * @param  tables  A reference to the Hash of table counters, keyed on
+ *                 relation id.
+ * @param  name    The name of the counter.
+ * @param  data    A pointer to the counter entries.
+ * @param  length  The length of the counter entries.
+ *
+ */
+void addTableCounters(VALUE tables, const char *name, char *data,
+                      short length)
+{
+   char *offset = data;
+
+   while(offset + 6 <= data + length)
+   {
+      VALUE id    = INT2FIX(isc_vax_integer(offset, 2)),
+            table = rb_hash_aref(tables, id);
+
+      if(table == Qnil)
+      {
+         table = rb_hash_new();
+         rb_hash_aset(tables, id, table);
+      }
+      rb_hash_aset(table, toSymbol(name),
+                   LONG2NUM(isc_vax_integer(offset + 2, 4)));
+      offset += 6;
+   }
+}
+
+
+/**
+ * This function works out the change between two sets of counters.
+ *
+ * @param  before  A reference to the Hash of counters taken first.
+ * @param  after   A reference to the Hash of counters taken second.
+ *
+ * @return  A reference to a Hash of the counter changes.
+ *
+ */
+VALUE getIOCountersDelta(VALUE before, VALUE after)
+{
+   VALUE delta  = getCountersDelta(before, after, 1),
+         prior  = rb_hash_aref(before, toSymbol("tables")),
+         latest = rb_hash_aref(after, toSymbol("tables")),
+         tables = rb_hash_new(),
+         ids    = rb_funcall(latest, rb_intern("keys"), 0),
+         id     = Qnil;
+
+   while((id = rb_ary_shift(ids)) != Qnil)
+   {
+      VALUE counts = rb_hash_aref(prior, id),
+            change = getCountersDelta(counts == Qnil ? rb_hash_new() :
+                                      counts, rb_hash_aref(latest, id), 0);
+      if(rb_funcall(change, rb_intern("empty?"), 0) == Qfalse)
+      {
+         rb_hash_aset(tables, id, change);
+      }
+   }
+   rb_hash_aset(delta, toSymbol("tables"), tables);
+
+   return(delta);
+}
+
+
+/**
+ * This function works out the change between two Hashes of counts. Values
+ * that are not counts, such as the Hash of table counters, are ignored.
+ *
+ * @param  before  A reference to the Hash of counts taken first.
+ * @param  after   A reference to the Hash of counts taken second.
+ * @param  zeroes  True to include counts that are unchanged, false to leave
+ *                 them out.
+ *
+ * @return  A reference to a Hash of the count changes.
+ *
+ */
+VALUE getCountersDelta(VALUE before, VALUE after, int zeroes)
+{
+   VALUE delta = rb_hash_new(),
+         keys  = rb_funcall(after, rb_intern("keys"), 0),
+         key   = Qnil;
+
+   while((key = rb_ary_shift(keys)) != Qnil)
+   {
+      VALUE first  = rb_hash_aref(before, key),
+            last   = rb_hash_aref(after, key);
+      long  change = 0;
+
+      if(FIXNUM_P(last) || TYPE(last) == T_BIGNUM)
+      {
+         change = NUM2LONG(last) - (first == Qnil ? 0 : NUM2LONG(first));
+         if(zeroes || change != 0)
+         {
+            rb_hash_aset(delta, key, LONG2NUM(change));
+         }
+      }
+   }
+
+   return(delta);
+}
+
+
+/**
+ * This function replaces the relation ids that key the table counters with
+ * the table names. The names are read from the system tables when an id is
+ * first seen and cached on the connection.
+ *
+ * @param  connection  A reference to the Connection the counters are for.
+ * @param  counters    A reference to the Hash of counters.
+ *
+ * @return  A reference to the Hash of counters.
+ *
+ */
+VALUE nameIOTables(VALUE connection, VALUE counters)
+{
+   VALUE tables = rb_hash_aref(counters, toSymbol("tables")),
+         named  = rb_hash_new(),
+         names  = rb_iv_get(connection, "@relation_names"),
+         ids    = rb_funcall(tables, rb_intern("keys"), 0),
+         id     = Qnil;
+   int   loaded = 0;
+
+   while((id = rb_ary_shift(ids)) != Qnil)
+   {
+      VALUE name = names == Qnil ? Qnil : rb_hash_aref(names, id);
+
+      if(name == Qnil && !loaded)
+      {
+         loadRelationNames(connection);
+         names  = rb_iv_get(connection, "@relation_names");
+         name   = rb_hash_aref(names, id);
+         loaded = 1;
+      }
+      rb_hash_aset(named, name != Qnil ? name : id, rb_hash_aref(tables, id));
+   }
+   rb_hash_aset(counters, toSymbol("tables"), named);
+
+   return(counters);
+}
+
+
+/**
+ * This function reads the relation ids and names of a database into a Hash
+ * cached on the connection.
+ *
+ * @param  connection  A reference to the Connection to read the names for.
+ *
+ */
+void loadRelationNames(VALUE connection)
+{
+   VALUE names = rb_hash_new(),
+         set   = Qnil,
+         row   = Qnil;
+
+   set = rb_funcall(connection, rb_intern("execute_immediate"), 1,
+                    rb_str_new2("SELECT RDB$RELATION_ID, RDB$RELATION_NAME "\
+                                "FROM RDB$RELATIONS"));
+   if(set != Qnil)
+   {
+      while((row = rb_funcall(set, rb_intern("fetch"), 0)) != Qnil)
+      {
+         VALUE name = rb_funcall(row, rb_intern("[]"), 1, INT2FIX(1));
+
+         rb_hash_aset(names, rb_funcall(row, rb_intern("[]"), 1, INT2FIX(0)),
+                      rb_funcall(name, rb_intern("strip"), 0));
+      }
+      rb_funcall(set, rb_intern("close"), 0);
+   }
+   rb_iv_set(connection, "@relation_names", names);
+}
@@ -0,0 +1,487 @@
+/*------------------------------------------------------------------------------
+ * NBackup.c
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "NBackup.h"
+#include "ibase.h"
+#include "ServiceManager.h"
+#include "Services.h"
+
+/* Function prototypes. */
+static VALUE initializeNBackup(VALUE, VALUE, VALUE);
+static VALUE getNBackupDatabase(VALUE);
+static VALUE setNBackupDatabase(VALUE, VALUE);
+static VALUE getNBackupFiles(VALUE);
+static VALUE setNBackupFiles(VALUE, VALUE);
+static VALUE getNBackupLevel(VALUE);
+static VALUE getNBackupNoTriggers(VALUE);
+static VALUE setNBackupNoTriggers(VALUE, VALUE);
+static VALUE executeNBackup(VALUE, VALUE);
+static VALUE restoreNBackup(VALUE, VALUE);
+static VALUE getNBackupLog(VALUE);
+static VALUE toNBackupPath(VALUE);
+static VALUE toNBackupFiles(VALUE);
+static VALUE runNBackupService(VALUE, VALUE, int);
+#if defined(FB_API_VER) && FB_API_VER >= 25
+static void createNBackupBuffer(VALUE, VALUE, VALUE, int, char **, short *);
+#endif
+
+
+/* Globals. */
+VALUE cNBackup;
+
+
+/* Definitions. */
+#define NO_TRIGGERS           rb_str_new2("NO_TRIGGERS")
+
+
+/**
+ * This function provides the initialize method for the NBackup class.
+ *
+ * @param  self      A reference to the NBackup object to be initialized.
+ * @param  database  A reference to a File or String containing the server path
+ *                   and name of the primary database file.
+ * @param  files     A reference to a File or String containing the server path
+ *                   and name of the level 0 backup file, or an Array of these
+ *                   giving the backup files for each level in turn.
+ *
+ * @return  A reference to the newly initialized NBackup object.
+ *
+ */
+VALUE initializeNBackup(VALUE self, VALUE database, VALUE files)
+{
+   rb_iv_set(self, "@database", toNBackupPath(database));
+   rb_iv_set(self, "@files", toNBackupFiles(files));
+   rb_iv_set(self, "@options", rb_hash_new());
+   rb_iv_set(self, "@log", Qnil);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the database attribute accessor for the NBackup
+ * class.
+ *
+ * @param  self  A reference to the NBackup object to make the call on.
+ *
+ * @return  A reference to a String containing the database file path/name.
+ *
+ */
+VALUE getNBackupDatabase(VALUE self)
+{
+   return(rb_iv_get(self, "@database"));
+}
+
+
+/**
+ * This function provides the database attribute mutator for the NBackup
+ * class.
+ *
+ * @param  self     A reference to the NBackup object to make the call on.
+ * @param  setting  A reference to a File or String containing the new path and
+ *                  name details of the main database file.
+ *
+ * @return  A reference to the NBackup object that has been updated.
+ *
+ */
+VALUE setNBackupDatabase(VALUE self, VALUE setting)
+{
+   rb_iv_set(self, "@database", toNBackupPath(setting));
+
+   return(self);
+}
+
+
+/**
+ * This function provides the files attribute accessor for the NBackup class.
+ *
+ * @param  self  A reference to the NBackup object to make the call on.
+ *
+ * @return  A reference to an Array containing the backup file paths/names,
+ *          one for each level.
+ *
+ */
+VALUE getNBackupFiles(VALUE self)
+{
+   return(rb_ary_dup(rb_iv_get(self, "@files")));
+}
+
+
+/**
+ * This function provides the files attribute mutator for the NBackup class.
+ *
+ * @param  self     A reference to the NBackup object to make the call on.
+ * @param  setting  A reference to a File or String containing the level 0
+ *                  backup file, or an Array of these giving the backup files
+ *                  for each level in turn.
+ *
+ * @return  A reference to the NBackup object that has been updated.
+ *
+ */
+VALUE setNBackupFiles(VALUE self, VALUE setting)
+{
+   rb_iv_set(self, "@files", toNBackupFiles(setting));
+
+   return(self);
+}
+
+
+/**
+ * This function provides the level attribute accessor for the NBackup class.
+ * The level is worked out from the number of backup files, the last of which
+ * is the one that will be written by a backup.
+ *
+ * @param  self  A reference to the NBackup object to make the call on.
+ *
+ * @return  A reference to an Integer containing the backup level.
+ *
+ */
+VALUE getNBackupLevel(VALUE self)
+{
+   VALUE size = rb_funcall(rb_iv_get(self, "@files"), rb_intern("size"), 0);
+
+   return(INT2FIX((TYPE(size) == T_FIXNUM ? FIX2INT(size) :
+                   NUM2INT(size)) - 1));
+}
+
+
+/**
+ * This function provides the no_triggers attribute accessor for the NBackup
+ * class.
+ *
+ * @param  self  A reference to the NBackup object to make the call on.
+ *
+ * @return  Either true or false.
+ *
+ */
+VALUE getNBackupNoTriggers(VALUE self)
+{
+   VALUE value = rb_hash_aref(rb_iv_get(self, "@options"), NO_TRIGGERS);
+
+   return(value == Qtrue ? Qtrue : Qfalse);
+}
+
+
+/**
+ * This function provides the no_triggers attribute mutator for the NBackup
+ * class.
+ *
+ * @param  self     A reference to the NBackup object to make the call on.
+ * @param  setting  Either true or false. All other settings are ignored.
+ *
+ * @return  A reference to the NBackup object that has been updated.
+ *
+ */
+VALUE setNBackupNoTriggers(VALUE self, VALUE setting)
+{
+   if(setting == Qtrue || setting == Qfalse)
+   {
+      rb_hash_aset(rb_iv_get(self, "@options"), NO_TRIGGERS, setting);
+   }
+
+   return(self);
+}
+
+
+/**
+ * This function provides the execute method for the NBackup class, making a
+ * physical backup of the database at the level given by the number of
+ * backup files. A level 0 backup copies every page of the database while a
+ * higher level copies only the pages changed since the backup at the level
+ * below it. Each line of the service output is passed to the block, if one
+ * is given, as it is produced.
+ *
+ * @param  self     A reference to the NBackup object to be executed.
+ * @param  manager  A reference to the ServiceManager object that will be used
+ *                  to execute the backup.
+ *
+ * @return  A reference to the NBackup object executed.
+ *
+ */
+VALUE executeNBackup(VALUE self, VALUE manager)
+{
+   return(runNBackupService(self, manager, 1));
+}
+
+
+/**
+ * This function provides the restore method for the NBackup class, creating
+ * the database from the chain of backup files, level 0 first. Each line of
+ * the service output is passed to the block, if one is given, as it is
+ * produced.
+ *
+ * @param  self     A reference to the NBackup object to make the call on.
+ * @param  manager  A reference to the ServiceManager object that will be used
+ *                  to execute the restore.
+ *
+ * @return  A reference to the NBackup object.
+ *
+ */
+VALUE restoreNBackup(VALUE self, VALUE manager)
+{
+   return(runNBackupService(self, manager, 0));
+}
+
+
+/**
+ * This function provides the log attribute accessor for the NBackup class.
+ *
+ * @param  self  A reference to the NBackup object to make the call on.
+ *
+ * @return  A reference to the current log attribute value.
+ *
+ */
+VALUE getNBackupLog(VALUE self)
+{
+   return(rb_iv_get(self, "@log"));
+}
+
+
+/**
+ * This function converts a File or String into a path.
+ *
+ * @param  file  A reference to the File or String to be converted.
+ *
+ * @return  A reference to a String containing the path.
+ *
+ */
+VALUE toNBackupPath(VALUE file)
+{
+   if(TYPE(file) == T_FILE)
+   {
+      return(rb_funcall(file, rb_intern("path"), 0));
+   }
+
+   return(rb_funcall(file, rb_intern("to_s"), 0));
+}
+
+
+/**
+ * This function converts the backup files given for an NBackup into an Array
+ * of paths.
+ *
+ * @param  files  A reference to a File or String, or an Array of these.
+ *
+ * @return  A reference to an Array containing the paths.
+ *
+ */
+VALUE toNBackupFiles(VALUE files)
+{
+   VALUE array = rb_ary_new();
+
+   if(TYPE(files) == T_ARRAY)
+   {
+      VALUE number = rb_funcall(files, rb_intern("size"), 0);
+      long  size   = TYPE(number) == T_FIXNUM ? FIX2INT(number) :
+                                                NUM2INT(number),
+            i;
+
+      for(i = 0; i < size; i++)
+      {
+         rb_ary_push(array, toNBackupPath(rb_ary_entry(files, i)));
+      }
+   }
+   else
+   {
+      rb_ary_push(array, toNBackupPath(files));
+   }
+
+   if(rb_ary_entry(array, 0) == Qnil)
+   {
+      rb_ibruby_raise(NULL, "At least one backup file must be specified.");
+   }
+
+   return(array);
+}
+
+
+/**
+ * This function starts an nbackup service task and then queries it until it
+ * has completed.
+ *
+ * @param  self     A reference to the NBackup object.
+ * @param  manager  A reference to the ServiceManager object to be used.
+ * @param  backup   True to make a backup, false to restore.
+ *
+ * @return  A reference to the NBackup object.
+ *
+ */
+VALUE runNBackupService(VALUE self, VALUE manager, int backup)
+{
+   ManagerHandle *handle = NULL;
+
+   /* Check that the service manager is connected. */
+   Data_Get_Struct(manager, ManagerHandle, handle);
+   if(handle->handle == 0)
+   {
+      rb_ibruby_raise(NULL,
+                      "Database nbackup error. Service manager not connected.");
+   }
+
+#if defined(FB_API_VER) && FB_API_VER >= 25
+   {
+      short      length  = 0;
+      char       *buffer = NULL;
+      ISC_STATUS status[20];
+
+      createNBackupBuffer(rb_iv_get(self, "@database"),
+                          rb_iv_get(self, "@files"),
+                          rb_iv_get(self, "@options"), backup, &buffer,
+                          &length);
+
+      /* Start the service request. */
+      if(startService(status, &handle->handle, length, buffer))
+      {
+         free(buffer);
+         rb_ibruby_raise(status, backup ?
+                         "Error performing database nbackup." :
+                         "Error performing database nrestore.");
+      }
+      free(buffer);
+
+      /* Query the service until it has completed. */
+      rb_iv_set(self, "@log", queryService(&handle->handle, Qnil));
+   }
+#else
+   rb_ibruby_raise(NULL,
+                   "Physical backups are not supported by the client library.");
+#endif
+
+   return(self);
+}
+
+
+#if defined(FB_API_VER) && FB_API_VER >= 25
+/**
+ * This function creates the service parameter buffer for an nbackup service
+ * task.
+ *
+ * @param  database  A reference to a String containing the path and name of
+ *                   the database file.
+ * @param  files     A reference to an Array containing the paths and names
+ *                   of the backup files, one for each level.
+ * @param  options   A reference to a Hash containing the task options.
+ * @param  backup    True to create a backup buffer, false to create a
+ *                   restore buffer.
+ * @param  buffer    A pointer that will be set to the generated parameter
+ *                   buffer.
+ * @param  length    A pointer to a short integer that will be assigned the
+ *                   length of buffer.
+ *
+ */
+void createNBackupBuffer(VALUE database, VALUE files, VALUE options,
+                         int backup, char **buffer, short *length)
+{
+   VALUE number    = rb_funcall(files, rb_intern("size"), 0);
+   long  size      = TYPE(number) == T_FIXNUM ? FIX2INT(number) :
+                                                NUM2INT(number),
+         first     = backup ? size - 1 : 0,
+         mask      = 0,
+         i;
+   char  *position = NULL;
+   short count     = 0;
+
+   if(rb_hash_aref(options, NO_TRIGGERS) == Qtrue)
+   {
+      mask |= isc_spb_nbk_no_triggers;
+   }
+
+   /* Calculate the length needed for the buffer. */
+   *length = 1 + strlen(STR2CSTR(database)) + 3;
+   for(i = first; i < size; i++)
+   {
+      *length += strlen(STR2CSTR(rb_ary_entry(files, i))) + 3;
+   }
+   if(backup)
+   {
+      *length += 5;
+   }
+   if(mask != 0)
+   {
+      *length += 5;
+   }
+
+   /* Allocate the buffer. */
+   *buffer = position = ALLOC_N(char, *length);
+   if(*buffer == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation error preparing database nbackup.");
+   }
+   memset(*buffer, 0, *length);
+
+   /* Populate the buffer. */
+   *position++ = backup ? isc_action_svc_nbak : isc_action_svc_nrest;
+   *position++ = isc_spb_dbname;
+   count       = strlen(STR2CSTR(database));
+   ADD_SPB_LENGTH(position, count);
+   memcpy(position, STR2CSTR(database), count);
+   position += count;
+   for(i = first; i < size; i++)
+   {
+      VALUE name = rb_ary_entry(files, i);
+
+      *position++ = isc_spb_nbk_file;
+      count       = strlen(STR2CSTR(name));
+      ADD_SPB_LENGTH(position, count);
+      memcpy(position, STR2CSTR(name), count);
+      position += count;
+   }
+   if(backup)
+   {
+      *position++ = isc_spb_nbk_level;
+      ADD_SPB_NUMERIC(position, first);
+   }
+   if(mask != 0)
+   {
+      *position++ = isc_spb_options;
+      ADD_SPB_NUMERIC(position, mask);
+   }
+}
+#endif
+
+
+/**
+ * This function initialize the NBackup class in the Ruby environment.
+ *
+ * @param  module  The module to create the new class definition under.
+ *
+ */
+void Init_NBackup(VALUE module)
+{
+   cNBackup = rb_define_class_under(module, "NBackup", rb_cObject);
+   rb_define_method(cNBackup, "initialize", initializeNBackup, 2);
+   rb_define_method(cNBackup, "database", getNBackupDatabase, 0);
+   rb_define_method(cNBackup, "database=", setNBackupDatabase, 1);
+   rb_define_method(cNBackup, "files", getNBackupFiles, 0);
+   rb_define_method(cNBackup, "files=", setNBackupFiles, 1);
+   rb_define_method(cNBackup, "level", getNBackupLevel, 0);
+   rb_define_method(cNBackup, "no_triggers", getNBackupNoTriggers, 0);
+   rb_define_method(cNBackup, "no_triggers=", setNBackupNoTriggers, 1);
+   rb_define_method(cNBackup, "execute", executeNBackup, 1);
+   rb_define_method(cNBackup, "restore", restoreNBackup, 1);
+   rb_define_method(cNBackup, "log", getNBackupLog, 0);
+}
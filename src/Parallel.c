@@ -0,0 +1,1613 @@
+/*------------------------------------------------------------------------------
+ * Parallel.c
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "Parallel.h"
+#include "Common.h"
+#include "Connection.h"
+#include "DataArea.h"
+#include "Statement.h"
+#include "Transaction.h"
+#include "TypeMap.h"
+#include <ctype.h>
+#include <string.h>
+
+/* Function prototypes. */
+static VALUE runInParallel(VALUE, VALUE);
+static VALUE addBatchQuery(int, VALUE *, VALUE);
+static VALUE getBatchSize(VALUE);
+VALUE parallelBlock(VALUE);
+VALUE parallelEnsure(VALUE);
+VALUE rollbackParallelTransaction(VALUE);
+VALUE ignoreRollbackError(VALUE, VALUE);
+void prepareParallelQuery(ParallelRun *, long);
+VALUE getParallelResult(ParallelQuery *);
+int storeParallelRow(ParallelQuery *);
+int runParallelQuery(ParallelQuery *);
+void getParallelRowCount(ParallelQuery *);
+void *runParallelLane(void *);
+void *runParallelLanes(void *);
+void cancelParallelLanes(void *);
+int isScanIdentifier(const char *);
+VALUE getScanKey(VALUE, VALUE);
+VALUE fetchScanRows(VALUE, VALUE);
+VALUE getScanBound(VALUE, VALUE, long, long);
+VALUE scanBlock(VALUE);
+VALUE scanEnsure(VALUE);
+void checkScanPartitions(ParallelScan *);
+void deliverScanBatch(ParallelScan *, ScanBatch *);
+void freeScanBatch(ScanBatch *);
+void *attachScanPartition(void *);
+void *attachScanPartitions(void *);
+void *runScanPartition(void *);
+void queueScanBatch(ParallelScan *, ScanBatch *);
+void *takeScanBatch(void *);
+void wakeScanConsumer(void *);
+void *joinScanPartitions(void *);
+
+/* Globals. */
+VALUE cQueryBatch;
+
+
+/**
+ * This function provides the parallel module function for the IBRuby module.
+ * A QueryBatch is passed to the block to collect the queries to be run. The
+ * queries are then shared out between the connections, each connection
+ * running its share in turn within a transaction of its own on a native
+ * thread, without the interpreter lock. The transactions are committed once
+ * every query has run and rolled back if any query fails.
+ *
+ * @param  module       A reference to the IBRuby module.
+ * @param  connections  A reference to an Array of open Connection objects, or
+ *                      a single Connection.
+ *
+ * @return  An Array holding a result for each query, in the order the queries
+ *          were added. Queries give an Array of row value Arrays and other
+ *          statements the number of rows they affected.
+ *
+ */
+static VALUE runInParallel(VALUE module, VALUE connections)
+{
+   ParallelRun run;
+   VALUE       batch = Qnil,
+               entry = Qnil;
+   long        size  = 0,
+               index;
+
+   if(TYPE(connections) != T_ARRAY)
+   {
+      connections = rb_ary_new3(1, connections);
+   }
+   size = NUM2LONG(rb_funcall(connections, rb_intern("size"), 0));
+   if(size == 0)
+   {
+      rb_ibruby_raise(NULL, "No connections specified for parallel queries.");
+   }
+   for(index = 0; index < size; index++)
+   {
+      entry = rb_ary_entry(connections, index);
+      if(TYPE(entry) != T_DATA ||
+         RDATA(entry)->dfree != (RUBY_DATA_FUNC)connectionFree)
+      {
+         rb_ibruby_raise(NULL, "Invalid connection specified for parallel "\
+                         "queries.");
+      }
+      if(rb_funcall(entry, rb_intern("open?"), 0) == Qfalse)
+      {
+         rb_ibruby_raise(NULL, "Closed connection specified for parallel "\
+                         "queries.");
+      }
+   }
+
+   /* Collect the queries. */
+   batch = rb_obj_alloc(cQueryBatch);
+   rb_iv_set(batch, "@queries", rb_ary_new());
+   rb_yield(batch);
+
+   memset(&run, 0, sizeof(ParallelRun));
+   run.connections = connections;
+   run.queries     = rb_ary_dup(rb_iv_get(batch, "@queries"));
+   run.sources     = rb_ary_new();
+   run.count       = NUM2LONG(rb_funcall(run.queries, rb_intern("size"), 0));
+   run.lanes       = size < run.count ? size : run.count;
+   if(run.count == 0)
+   {
+      return(rb_ary_new());
+   }
+
+   return(rb_ensure(parallelBlock, (VALUE)&run, parallelEnsure, (VALUE)&run));
+}
+
+
+/**
+ * This function provides the add method for the QueryBatch class.
+ *
+ * @param  argc  A count of the number of arguments passed to the function.
+ * @param  argv  A pointer to the array of arguments passed to the function.
+ *               These are the SQL text and an optional Array of parameters.
+ * @param  self  A reference to the QueryBatch object to make the call on.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE addBatchQuery(int argc, VALUE *argv, VALUE self)
+{
+   VALUE query = rb_ary_new();
+
+   if(argc < 1 || argc > 2)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               argc < 1 ? 1 : 2);
+   }
+   rb_ary_push(query, rb_funcall(argv[0], rb_intern("to_s"), 0));
+   rb_ary_push(query, argc > 1 ? argv[1] : Qnil);
+   rb_ary_push(rb_iv_get(self, "@queries"), query);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the size method for the QueryBatch class.
+ *
+ * @param  self  A reference to the QueryBatch object to make the call on.
+ *
+ * @return  A count of the queries added to the batch.
+ *
+ */
+static VALUE getBatchSize(VALUE self)
+{
+   return(rb_funcall(rb_iv_get(self, "@queries"), rb_intern("size"), 0));
+}
+
+
+/**
+ * This function prepares and runs the queries for a parallel run and then
+ * collects their results.
+ *
+ * @param  data  A pointer to the ParallelRun structure, cast to a VALUE.
+ *
+ * @return  A reference to the Array of results.
+ *
+ */
+VALUE parallelBlock(VALUE data)
+{
+   ParallelRun *run    = (ParallelRun *)data;
+   VALUE       results = rb_ary_new();
+   long        index;
+
+   run->query = ALLOC_N(ParallelQuery, run->count);
+   run->lane  = ALLOC_N(ParallelLane, run->lanes);
+   if(run->query == NULL || run->lane == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure running parallel queries.");
+   }
+   memset(run->query, 0, sizeof(ParallelQuery) * run->count);
+   memset(run->lane, 0, sizeof(ParallelLane) * run->lanes);
+
+   /* Start a transaction on each connection to be used. */
+   for(index = 0; index < run->lanes; index++)
+   {
+      VALUE connection = rb_ary_entry(run->connections, index),
+            source     = rb_obj_alloc(rb_cObject);
+
+      rb_iv_set(source, "@connection", connection);
+      rb_iv_set(source, "@transaction",
+                rb_funcall(connection, rb_intern("start_transaction"), 0));
+      rb_ary_push(run->sources, source);
+      run->lane[index].run    = run;
+      run->lane[index].number = index;
+   }
+
+   for(index = 0; index < run->count; index++)
+   {
+      prepareParallelQuery(run, index);
+   }
+
+   callBlocking(runParallelLanes, run, cancelParallelLanes, run);
+
+   /* Report the first failure in the order the queries were added. */
+   for(index = 0; index < run->count; index++)
+   {
+      if(run->query[index].failed == 2)
+      {
+         rb_raise(rb_eNoMemError,
+                  "Memory allocation failure fetching parallel query rows.");
+      }
+      else if(run->query[index].failed)
+      {
+         rb_ibruby_raise(run->query[index].status,
+                         "Error executing parallel query.");
+      }
+   }
+
+   for(index = 0; index < run->count; index++)
+   {
+      rb_ary_push(results, getParallelResult(&run->query[index]));
+   }
+   for(index = 0; index < run->lanes; index++)
+   {
+      VALUE source = rb_ary_entry(run->sources, index);
+
+      rb_funcall(rb_iv_get(source, "@transaction"), rb_intern("commit"), 0);
+   }
+   run->committed = 1;
+
+   return(results);
+}
+
+
+/**
+ * This function releases the resources used by a parallel run, rolling back
+ * its transactions if they have not been committed.
+ *
+ * @param  data  A pointer to the ParallelRun structure, cast to a VALUE.
+ *
+ * @return  Always Qnil.
+ *
+ */
+VALUE parallelEnsure(VALUE data)
+{
+   ParallelRun *run = (ParallelRun *)data;
+   long        index,
+               size = NUM2LONG(rb_funcall(run->sources, rb_intern("size"), 0));
+
+   if(run->query != NULL)
+   {
+      for(index = 0; index < run->count; index++)
+      {
+         ParallelQuery *query = &run->query[index];
+
+         if(query->statement != 0)
+         {
+            ISC_STATUS status[20];
+
+            isc_dsql_free_statement(status, &query->statement, DSQL_drop);
+         }
+         if(query->parameters != NULL)
+         {
+            releaseDataArea(query->parameters);
+         }
+         if(query->output != NULL)
+         {
+            releaseDataArea(query->output);
+         }
+         if(query->data != NULL)
+         {
+            free(query->data);
+         }
+      }
+      free(run->query);
+      run->query = NULL;
+   }
+   if(run->lane != NULL)
+   {
+      free(run->lane);
+      run->lane = NULL;
+   }
+
+   if(!run->committed)
+   {
+      for(index = 0; index < size; index++)
+      {
+         VALUE source = rb_ary_entry(run->sources, index);
+
+         rb_rescue(rollbackParallelTransaction,
+                   rb_iv_get(source, "@transaction"), ignoreRollbackError,
+                   Qnil);
+      }
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function rolls back a transaction started for a parallel run.
+ *
+ * @param  transaction  A reference to the Transaction to be rolled back.
+ *
+ * @return  Always Qnil.
+ *
+ */
+VALUE rollbackParallelTransaction(VALUE transaction)
+{
+   if(rb_funcall(transaction, rb_intern("active?"), 0) == Qtrue)
+   {
+      rb_funcall(transaction, rb_intern("rollback"), 0);
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function discards any error raised rolling back a parallel run so
+ * that the error that caused the roll back is the one reported.
+ *
+ * @param  unused  Not used.
+ * @param  error   A reference to the exception raised.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE ignoreRollbackError(VALUE unused, VALUE error)
+{
+   return(Qnil);
+}
+
+
+/**
+ * This function prepares one of the queries for a parallel run, setting its
+ * parameters and allocating the output area for queries that return rows.
+ *
+ * @param  run    A pointer to the ParallelRun structure.
+ * @param  index  The position of the query within the run.
+ *
+ */
+void prepareParallelQuery(ParallelRun *run, long index)
+{
+   ParallelQuery     *query      = &run->query[index];
+   VALUE             entry       = rb_ary_entry(run->queries, index),
+                     parameters  = rb_ary_entry(entry, 1),
+                     source      = rb_ary_entry(run->sources,
+                                                index % run->lanes);
+   ConnectionHandle  *connection = NULL;
+   TransactionHandle *transaction = NULL;
+   int               inputs      = 0,
+                     outputs     = 0;
+
+   Data_Get_Struct(rb_iv_get(source, "@connection"), ConnectionHandle,
+                   connection);
+   Data_Get_Struct(rb_iv_get(source, "@transaction"), TransactionHandle,
+                   transaction);
+   query->connection  = &connection->handle;
+   query->transaction = &transaction->handle;
+   prepare(query->connection, query->transaction,
+           STR2CSTR(rb_ary_entry(entry, 0)), &query->statement, 3,
+           &query->type, &inputs, &outputs);
+
+   if(inputs > 0)
+   {
+      VALUE value = Qnil;
+      int   size  = 0;
+
+      if(parameters == Qnil)
+      {
+         rb_ibruby_raise(NULL, "Empty parameter list specified for parallel "\
+                         "query.");
+      }
+      value = rb_funcall(parameters, rb_intern("size"), 0);
+      size  = TYPE(value) == T_FIXNUM ? FIX2INT(value) : NUM2INT(value);
+      if(size < inputs)
+      {
+         rb_ibruby_raise(NULL, "Insufficient parameters specified for "\
+                         "parallel query.");
+      }
+      query->parameters = allocateInXSQLDA(inputs, &query->statement, 3);
+      prepareDataArea(query->parameters);
+      setParameters(query->parameters, parameters, source);
+   }
+
+   if(query->type == isc_info_sql_stmt_select ||
+      query->type == isc_info_sql_stmt_select_for_upd)
+   {
+      query->output = allocateOutXSQLDA(outputs, &query->statement, 3);
+      prepareDataArea(query->output);
+      query->width = getRowWidth(query->output);
+   }
+}
+
+
+/**
+ * This function converts the outcome of a parallel query to Ruby.
+ *
+ * @param  query  A pointer to the ParallelQuery to be converted.
+ *
+ * @return  An Array of row value Arrays for a query, or the number of rows
+ *          affected for any other statement.
+ *
+ */
+VALUE getParallelResult(ParallelQuery *query)
+{
+   VALUE rows     = Qnil;
+   char  *position = query->data;
+   long  row;
+   int   index;
+
+   if(query->output == NULL)
+   {
+      return(INT2NUM(query->affected));
+   }
+
+   rows = rb_ary_new();
+   for(row = 0; row < query->rows; row++)
+   {
+      VALUE   values = rb_ary_new();
+      XSQLVAR *field = query->output->sqlvar;
+
+      position = restoreOutputRow(query->output, position);
+      for(index = 0; index < query->output->sqld; index++, field++)
+      {
+         rb_ary_push(values, rb_ary_entry(toValue(field, query->connection,
+                                                  query->transaction), 0));
+      }
+      rb_ary_push(rows, values);
+   }
+
+   return(rows);
+}
+
+
+/**
+ * This function calculates the number of bytes needed to hold a copy of one
+ * row fetched into an output area.
+ *
+ * @param  output  A pointer to the output XSQLDA.
+ *
+ * @return  The number of bytes needed for a row.
+ *
+ */
+long getRowWidth(XSQLDA *output)
+{
+   XSQLVAR *field = output->sqlvar;
+   long    width  = 0;
+   int     index;
+
+   for(index = 0; index < output->sqld; index++, field++)
+   {
+      if(field->sqldata != NULL)
+      {
+         width += field->sqllen;
+         if((field->sqltype & ~1) == SQL_VARYING)
+         {
+            width += sizeof(short);
+         }
+      }
+      width += sizeof(short);
+   }
+
+   return(width);
+}
+
+
+/**
+ * This function appends a copy of the row currently held in a query output
+ * area to the rows stored for the query. It is called without the
+ * interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  query  A pointer to the ParallelQuery that fetched the row.
+ *
+ * @return  Zero if the row was stored, non-zero if memory ran out.
+ *
+ */
+int storeParallelRow(ParallelQuery *query)
+{
+   long needed = (query->rows + 1) * query->width;
+
+   if(needed > query->capacity)
+   {
+      long capacity = query->capacity > 0 ? query->capacity * 2 :
+                      query->width * 64;
+      char *data    = NULL;
+
+      if(capacity < needed)
+      {
+         capacity = needed;
+      }
+      if((data = (char *)realloc(query->data, capacity)) == NULL)
+      {
+         return(1);
+      }
+      query->data     = data;
+      query->capacity = capacity;
+   }
+
+   copyOutputRow(query->output, query->data + query->rows * query->width);
+   query->rows++;
+
+   return(0);
+}
+
+
+/**
+ * This function copies the row currently held in an output area to a block
+ * of memory. It makes no calls into Ruby and so may be called without the
+ * interpreter lock.
+ *
+ * @param  output    A pointer to the output XSQLDA.
+ * @param  position  A pointer to the memory to copy the row to, which must
+ *                   be at least the row width given by getRowWidth.
+ *
+ * @return  A pointer to the memory following the copied row.
+ *
+ */
+char *copyOutputRow(XSQLDA *output, char *position)
+{
+   XSQLVAR *field = output->sqlvar;
+   int     index;
+
+   for(index = 0; index < output->sqld; index++, field++)
+   {
+      if(field->sqldata != NULL)
+      {
+         long length = field->sqllen;
+
+         if((field->sqltype & ~1) == SQL_VARYING)
+         {
+            length += sizeof(short);
+         }
+         memcpy(position, field->sqldata, length);
+         position += length;
+      }
+      memcpy(position, field->sqlind, sizeof(short));
+      position += sizeof(short);
+   }
+
+   return(position);
+}
+
+
+/**
+ * This function copies a stored row back into an output area so that it can
+ * be converted.
+ *
+ * @param  output    A pointer to the output XSQLDA.
+ * @param  position  A pointer to the stored row.
+ *
+ * @return  A pointer to the next stored row.
+ *
+ */
+char *restoreOutputRow(XSQLDA *output, char *position)
+{
+   XSQLVAR *field = output->sqlvar;
+   int     index;
+
+   for(index = 0; index < output->sqld; index++, field++)
+   {
+      if(field->sqldata != NULL)
+      {
+         long length = field->sqllen;
+
+         if((field->sqltype & ~1) == SQL_VARYING)
+         {
+            length += sizeof(short);
+         }
+         memcpy(field->sqldata, position, length);
+         position += length;
+      }
+      memcpy(field->sqlind, position, sizeof(short));
+      position += sizeof(short);
+   }
+
+   return(position);
+}
+
+
+/**
+ * This function executes one of the queries for a parallel run, fetching and
+ * storing all of the rows for a query. It is called without the interpreter
+ * lock and so makes no calls into Ruby.
+ *
+ * @param  query  A pointer to the ParallelQuery to be run.
+ *
+ * @return  Zero if the query ran successfully, non-zero otherwise. The query
+ *          failed member is set to 1 for a database error and 2 if memory
+ *          ran out storing the rows.
+ *
+ */
+int runParallelQuery(ParallelQuery *query)
+{
+   ISC_STATUS result = 0;
+
+   if(isc_dsql_execute(query->status, query->transaction, &query->statement,
+                       3, query->parameters) != 0)
+   {
+      query->failed = 1;
+      return(1);
+   }
+
+   if(query->output != NULL)
+   {
+      while((result = isc_dsql_fetch(query->status, &query->statement, 3,
+                                     query->output)) == 0)
+      {
+         if(storeParallelRow(query) != 0)
+         {
+            query->failed = 2;
+            return(1);
+         }
+      }
+      if(result != 100)
+      {
+         query->failed = 1;
+         return(1);
+      }
+   }
+   else
+   {
+      getParallelRowCount(query);
+   }
+
+   return(0);
+}
+
+
+/**
+ * This function fetches the number of rows affected by an insert, update or
+ * delete run as part of a parallel run. It is called without the interpreter
+ * lock and so makes no calls into Ruby.
+ *
+ * @param  query  A pointer to the ParallelQuery that was run.
+ *
+ */
+void getParallelRowCount(ParallelQuery *query)
+{
+   ISC_STATUS status[20];
+   char       items[]   = {isc_info_sql_records},
+              buffer[40],
+              *position = buffer + 3;
+   int        info      = 0;
+
+   switch(query->type)
+   {
+      case isc_info_sql_stmt_update :
+         info = isc_info_req_update_count;
+         break;
+
+      case isc_info_sql_stmt_delete :
+         info = isc_info_req_delete_count;
+         break;
+
+      case isc_info_sql_stmt_insert :
+         info = isc_info_req_insert_count;
+         break;
+
+      default :
+         return;
+   }
+
+   if(isc_dsql_sql_info(status, &query->statement, sizeof(items), items,
+                        sizeof(buffer), buffer) == 0)
+   {
+      while(*position != isc_info_end)
+      {
+         char current = *position++;
+         long length  = isc_vax_integer(position, 2);
+
+         position += 2;
+         if(current == info)
+         {
+            query->affected = isc_vax_integer(position, (short)length);
+            break;
+         }
+         position += length;
+      }
+   }
+}
+
+
+/**
+ * This function runs the queries allocated to one lane of a parallel run, in
+ * the order they were added, stopping at the first failure.
+ *
+ * @param  data  A pointer to the ParallelLane to be run.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *runParallelLane(void *data)
+{
+   ParallelLane *lane = (ParallelLane *)data;
+   ParallelRun  *run  = lane->run;
+   long         index;
+
+   for(index = lane->number; index < run->count; index += run->lanes)
+   {
+      if(runParallelQuery(&run->query[index]) != 0)
+      {
+         break;
+      }
+   }
+
+   return(NULL);
+}
+
+
+/**
+ * This function runs the lanes of a parallel run. The first lane is run on
+ * the calling thread and each of the others on a thread of its own. Should a
+ * thread fail to start its lane is simply run on the calling thread.
+ *
+ * @param  data  A pointer to the ParallelRun structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *runParallelLanes(void *data)
+{
+   ParallelRun *run = (ParallelRun *)data;
+   long        index;
+
+   for(index = 1; index < run->lanes; index++)
+   {
+      run->lane[index].started = (startThread(&run->lane[index].thread,
+                                              runParallelLane,
+                                              &run->lane[index]) == 0);
+   }
+
+   for(index = 0; index < run->lanes; index++)
+   {
+      if(run->lane[index].started)
+      {
+         joinThread(run->lane[index].thread);
+      }
+      else
+      {
+         runParallelLane(&run->lane[index]);
+      }
+   }
+
+   return(NULL);
+}
+
+
+/**
+ * This function is called by the interpreter to interrupt a parallel run,
+ * such as when the calling thread is killed. Where the client library allows
+ * it the operations running on the connections are cancelled.
+ *
+ * @param  data  A pointer to the ParallelRun structure.
+ *
+ */
+void cancelParallelLanes(void *data)
+{
+#if defined(FB_API_VER) && FB_API_VER >= 25
+   ParallelRun *run = (ParallelRun *)data;
+   long        index;
+
+   for(index = 0; index < run->lanes; index++)
+   {
+      ISC_STATUS status[20];
+
+      fb_cancel_operation(status, run->query[index].connection,
+                          fb_cancel_raise);
+   }
+#endif
+}
+
+
+/**
+ * This function runs a parallel scan of a table for the parallel_scan method
+ * of the Connection class. The range of the integer key column is split into
+ * partitions and each partition is fetched over an attachment of its own,
+ * inside a read only snapshot transaction, on a native thread. Rows are
+ * passed to the block in batches as the threads fetch them.
+ *
+ * @param  self     A reference to the Connection to scan through.
+ * @param  table    A reference to the name of the table to be scanned.
+ * @param  options  A reference to a Hash of options, or nil. The recognised
+ *                  keys are :key (the integer column to partition on, the
+ *                  primary key by default), :partitions (default 4, at
+ *                  most MAX_SCAN_PARTITIONS) and :batch_size (default 1000).
+ *
+ * @return  The total number of rows passed to the block.
+ *
+ */
+VALUE rb_parallel_scan(VALUE self, VALUE table, VALUE options)
+{
+   ConnectionHandle *connection = NULL;
+   ParallelScan     scan;
+   VALUE            key         = Qnil,
+                    setting     = Qnil,
+                    bounds      = Qnil,
+                    lower       = Qnil,
+                    span        = Qnil,
+                    sql         = Qnil;
+   long             partitions  = 4,
+                    size        = 1000,
+                    index;
+   char             *file       = NULL;
+
+   Data_Get_Struct(self, ConnectionHandle, connection);
+   if(connection->handle == 0)
+   {
+      rb_ibruby_raise(NULL, "Closed connection specified for table scan.");
+   }
+   if(!rb_block_given_p())
+   {
+      rb_ibruby_raise(NULL, "No block specified for table scan.");
+   }
+   table = rb_funcall(table, rb_intern("to_s"), 0);
+   if(!isScanIdentifier(STR2CSTR(table)))
+   {
+      rb_ibruby_raise(NULL, "Invalid table name specified for table scan.");
+   }
+   if(options != Qnil)
+   {
+      if(TYPE(options) != T_HASH)
+      {
+         rb_ibruby_raise(NULL, "Invalid table scan options specified.");
+      }
+      key = rb_hash_aref(options, toSymbol("key"));
+      if((setting = rb_hash_aref(options, toSymbol("partitions"))) != Qnil)
+      {
+         partitions = NUM2LONG(setting);
+      }
+      if((setting = rb_hash_aref(options, toSymbol("batch_size"))) != Qnil)
+      {
+         size = NUM2LONG(setting);
+      }
+   }
+   if(partitions < 1 || size < 1)
+   {
+      rb_ibruby_raise(NULL, "Invalid table scan options specified.");
+   }
+   if(partitions > MAX_SCAN_PARTITIONS)
+   {
+      partitions = MAX_SCAN_PARTITIONS;
+   }
+   key = (key != Qnil ? rb_funcall(key, rb_intern("to_s"), 0) :
+          getScanKey(self, table));
+   if(!isScanIdentifier(STR2CSTR(key)))
+   {
+      rb_ibruby_raise(NULL, "Invalid key column specified for table scan.");
+   }
+
+   /* Find the key range. */
+   sql = rb_str_new2("SELECT MIN(");
+   rb_str_concat(sql, key);
+   rb_str_cat2(sql, "), MAX(");
+   rb_str_concat(sql, key);
+   rb_str_cat2(sql, ") FROM ");
+   rb_str_concat(sql, table);
+   bounds = rb_ary_entry(fetchScanRows(self, sql), 0);
+   lower  = rb_ary_entry(bounds, 0);
+   if(lower == Qnil)
+   {
+      return(INT2FIX(0));
+   }
+   if(rb_obj_is_kind_of(lower, rb_cInteger) == Qfalse)
+   {
+      rb_ibruby_raise(NULL, "Table scan key must be an integer column.");
+   }
+   span = rb_funcall(rb_funcall(rb_ary_entry(bounds, 1), rb_intern("-"), 1,
+                                lower), rb_intern("+"), 1, INT2FIX(1));
+   if(rb_funcall(span, rb_intern("<"), 1, LONG2NUM(partitions)) == Qtrue)
+   {
+      partitions = NUM2LONG(span);
+   }
+
+   /* Build a query for each partition of the range. */
+   memset(&scan, 0, sizeof(ParallelScan));
+   scan.connection = self;
+   scan.queries    = rb_ary_new();
+   scan.count      = partitions;
+   scan.size       = size;
+   scan.limit      = partitions * 2;
+   for(index = 0; index < partitions; index++)
+   {
+      VALUE first = getScanBound(lower, span, index, partitions),
+            last  = getScanBound(lower, span, index + 1, partitions);
+
+      sql = rb_str_new2("SELECT * FROM ");
+      rb_str_concat(sql, table);
+      rb_str_cat2(sql, " WHERE ");
+      rb_str_concat(sql, key);
+      rb_str_cat2(sql, " >= ");
+      rb_str_concat(sql, rb_funcall(first, rb_intern("to_s"), 0));
+      rb_str_cat2(sql, " AND ");
+      rb_str_concat(sql, key);
+      rb_str_cat2(sql, " < ");
+      rb_str_concat(sql, rb_funcall(last, rb_intern("to_s"), 0));
+      rb_ary_push(scan.queries, sql);
+   }
+
+   /* Keep copies of the attachment details for use off the Ruby thread. */
+   file      = STR2CSTR(rb_iv_get(rb_iv_get(self, "@database"), "@file"));
+   scan.file = ALLOC_N(char, strlen(file) + 1);
+   if(scan.file == NULL)
+   {
+      rb_raise(rb_eNoMemError, "Memory allocation failure scanning a table.");
+   }
+   strcpy(scan.file, file);
+   scan.dpb    = connection->dpb;
+   scan.length = connection->length;
+   initializeLock(&scan.lock);
+   initializeCondition(&scan.ready);
+   initializeCondition(&scan.space);
+
+   return(rb_ensure(scanBlock, (VALUE)&scan, scanEnsure, (VALUE)&scan));
+}
+
+
+/**
+ * This function checks that a table or column name given for a table scan is
+ * a plain identifier that can be placed in the SQL text.
+ *
+ * @param  name  A pointer to the name to be checked.
+ *
+ * @return  Non-zero if the name is acceptable, zero otherwise.
+ *
+ */
+int isScanIdentifier(const char *name)
+{
+   int length = 0;
+
+   if(!isalpha((unsigned char)*name))
+   {
+      return(0);
+   }
+   while(name[length] != '\0')
+   {
+      if(!isalnum((unsigned char)name[length]) && name[length] != '_' &&
+         name[length] != '$')
+      {
+         return(0);
+      }
+      length++;
+   }
+
+   return(length <= 31);
+}
+
+
+/**
+ * This function fetches the name of the single column primary key for a
+ * table, to be used as the key of a table scan.
+ *
+ * @param  connection  A reference to the Connection to query through.
+ * @param  table       A reference to the name of the table.
+ *
+ * @return  A reference to a String containing the column name.
+ *
+ */
+VALUE getScanKey(VALUE connection, VALUE table)
+{
+   VALUE sql  = rb_str_new2("SELECT S.RDB$FIELD_NAME FROM "\
+                            "RDB$RELATION_CONSTRAINTS C, RDB$INDEX_SEGMENTS S "\
+                            "WHERE S.RDB$INDEX_NAME = C.RDB$INDEX_NAME AND "\
+                            "C.RDB$CONSTRAINT_TYPE = 'PRIMARY KEY' AND "\
+                            "C.RDB$RELATION_NAME = '"),
+         rows = Qnil;
+
+   rb_str_concat(sql, rb_funcall(table, rb_intern("upcase"), 0));
+   rb_str_cat2(sql, "'");
+   rows = fetchScanRows(connection, sql);
+   if(NUM2LONG(rb_funcall(rows, rb_intern("size"), 0)) != 1)
+   {
+      rb_ibruby_raise(NULL, "Table has no single column primary key, a :key "\
+                      "must be specified for the table scan.");
+   }
+
+   return(rb_funcall(rb_ary_entry(rb_ary_entry(rows, 0), 0),
+                     rb_intern("strip"), 0));
+}
+
+
+/**
+ * This function runs a query on a connection and returns all of its rows.
+ *
+ * @param  connection  A reference to the Connection to run the query on.
+ * @param  sql         A reference to the query text.
+ *
+ * @return  A reference to an Array of row value Arrays.
+ *
+ */
+VALUE fetchScanRows(VALUE connection, VALUE sql)
+{
+   VALUE results = rb_funcall(connection, rb_intern("execute_immediate"), 1,
+                              sql),
+         rows    = rb_ary_new(),
+         row     = Qnil;
+
+   while((row = rb_funcall(results, rb_intern("fetch"), 0)) != Qnil)
+   {
+      rb_ary_push(rows, rb_funcall(row, rb_intern("values"), 0));
+   }
+   rb_funcall(results, rb_intern("close"), 0);
+
+   return(rows);
+}
+
+
+/**
+ * This function calculates the start of a table scan partition.
+ *
+ * @param  lower   A reference to the lowest key value.
+ * @param  span    A reference to the number of key values in the range.
+ * @param  number  The number of the partition.
+ * @param  count   The total number of partitions.
+ *
+ * @return  A reference to the first key value of the partition.
+ *
+ */
+VALUE getScanBound(VALUE lower, VALUE span, long number, long count)
+{
+   VALUE offset = rb_funcall(span, rb_intern("*"), 1, LONG2NUM(number));
+
+   offset = rb_funcall(offset, rb_intern("/"), 1, LONG2NUM(count));
+
+   return(rb_funcall(lower, rb_intern("+"), 1, offset));
+}
+
+
+/**
+ * This function opens the partition attachments for a table scan, prepares
+ * the partition queries, starts the partition threads and then passes the
+ * batches of rows they fetch to the block.
+ *
+ * @param  data  A pointer to the ParallelScan structure, cast to a VALUE.
+ *
+ * @return  The total number of rows passed to the block.
+ *
+ */
+VALUE scanBlock(VALUE data)
+{
+   ParallelScan *scan = (ParallelScan *)data;
+   ScanBatch    *batch = NULL;
+   long         index;
+   int          done   = 0;
+
+   scan->partition = ALLOC_N(ScanPartition, scan->count);
+   if(scan->partition == NULL)
+   {
+      rb_raise(rb_eNoMemError, "Memory allocation failure scanning a table.");
+   }
+   memset(scan->partition, 0, sizeof(ScanPartition) * scan->count);
+   for(index = 0; index < scan->count; index++)
+   {
+      scan->partition[index].scan = scan;
+   }
+
+   callBlocking(attachScanPartitions, scan, NULL, NULL);
+   checkScanPartitions(scan);
+
+   for(index = 0; index < scan->count; index++)
+   {
+      ScanPartition *partition = &scan->partition[index];
+      int           type       = 0,
+                    inputs     = 0,
+                    outputs    = 0;
+
+      prepare(&partition->handle, &partition->transaction,
+              STR2CSTR(rb_ary_entry(scan->queries, index)),
+              &partition->statement, 3, &type, &inputs, &outputs);
+      partition->output = allocateOutXSQLDA(outputs, &partition->statement, 3);
+      prepareDataArea(partition->output);
+      partition->values = allocateOutXSQLDA(outputs, &partition->statement, 3);
+      prepareDataArea(partition->values);
+      partition->width  = getRowWidth(partition->output);
+   }
+
+   scan->active = scan->count;
+   for(index = 0; index < scan->count; index++)
+   {
+      ScanPartition *partition = &scan->partition[index];
+
+      partition->started = (startThread(&partition->thread, runScanPartition,
+                                        partition) == 0);
+      if(!partition->started)
+      {
+         partition->failed  = 3;
+         partition->message = "Unable to start a table scan thread.";
+         acquireLock(&scan->lock);
+         scan->active--;
+         releaseLock(&scan->lock);
+      }
+   }
+
+   while(!done)
+   {
+      batch = (ScanBatch *)callBlocking(takeScanBatch, scan, wakeScanConsumer,
+                                        scan);
+      if(batch != NULL)
+      {
+         deliverScanBatch(scan, batch);
+      }
+      else
+      {
+         acquireLock(&scan->lock);
+         done = (scan->active == 0 && scan->first == NULL);
+         releaseLock(&scan->lock);
+         checkScanPartitions(scan);
+      }
+   }
+
+   return(LONG2NUM(scan->rows));
+}
+
+
+/**
+ * This function stops and cleans up after a table scan, closing the
+ * partition attachments and releasing any batches not yet delivered.
+ *
+ * @param  data  A pointer to the ParallelScan structure, cast to a VALUE.
+ *
+ * @return  Always Qnil.
+ *
+ */
+VALUE scanEnsure(VALUE data)
+{
+   ParallelScan *scan = (ParallelScan *)data;
+   ISC_STATUS   status[20];
+   long         index;
+
+   acquireLock(&scan->lock);
+   scan->cancelled = 1;
+   broadcastCondition(&scan->ready);
+   broadcastCondition(&scan->space);
+   releaseLock(&scan->lock);
+
+   if(scan->partition != NULL)
+   {
+#if defined(FB_API_VER) && FB_API_VER >= 25
+      /* Cancel every started partition, a finished one just ignores it. */
+      for(index = 0; index < scan->count; index++)
+      {
+         if(scan->partition[index].started)
+         {
+            fb_cancel_operation(status, &scan->partition[index].handle,
+                                fb_cancel_raise);
+         }
+      }
+#endif
+      callBlocking(joinScanPartitions, scan, NULL, NULL);
+
+      for(index = 0; index < scan->count; index++)
+      {
+         ScanPartition *partition = &scan->partition[index];
+
+         if(partition->statement != 0)
+         {
+            isc_dsql_free_statement(status, &partition->statement, DSQL_drop);
+         }
+         if(partition->transaction != 0)
+         {
+            isc_rollback_transaction(status, &partition->transaction);
+         }
+         if(partition->handle != 0)
+         {
+            isc_detach_database(status, &partition->handle);
+         }
+         if(partition->output != NULL)
+         {
+            releaseDataArea(partition->output);
+         }
+         if(partition->values != NULL)
+         {
+            releaseDataArea(partition->values);
+         }
+      }
+      free(scan->partition);
+      scan->partition = NULL;
+   }
+
+   while(scan->first != NULL)
+   {
+      ScanBatch *batch = scan->first;
+
+      scan->first = batch->next;
+      freeScanBatch(batch);
+   }
+   if(scan->current != NULL)
+   {
+      freeScanBatch(scan->current);
+      scan->current = NULL;
+   }
+   free(scan->file);
+   destroyCondition(&scan->space);
+   destroyCondition(&scan->ready);
+   destroyLock(&scan->lock);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function raises an exception for the first table scan partition found
+ * to have failed.
+ *
+ * @param  scan  A pointer to the ParallelScan structure.
+ *
+ */
+void checkScanPartitions(ParallelScan *scan)
+{
+   long index;
+
+   for(index = 0; index < scan->count; index++)
+   {
+      ScanPartition *partition = &scan->partition[index];
+
+      if(partition->failed == 2)
+      {
+         rb_raise(rb_eNoMemError, "%s", partition->message);
+      }
+      else if(partition->failed)
+      {
+         rb_ibruby_raise(partition->failed == 1 ? partition->status : NULL,
+                         partition->message);
+      }
+   }
+}
+
+
+/**
+ * This function converts a batch of rows fetched by a table scan partition
+ * to Ruby and passes them to the block.
+ *
+ * @param  scan   A pointer to the ParallelScan structure.
+ * @param  batch  A pointer to the batch of rows.
+ *
+ */
+void deliverScanBatch(ParallelScan *scan, ScanBatch *batch)
+{
+   ScanPartition *partition = &scan->partition[batch->partition];
+   VALUE         rows       = rb_ary_new();
+   char          *position  = batch->data;
+   long          row;
+   int           index;
+
+   scan->current = batch;
+   for(row = 0; row < batch->rows; row++)
+   {
+      VALUE   values = rb_ary_new();
+      XSQLVAR *field = partition->values->sqlvar;
+
+      position = restoreOutputRow(partition->values, position);
+      for(index = 0; index < partition->values->sqld; index++, field++)
+      {
+         rb_ary_push(values, rb_ary_entry(toValue(field, &partition->handle,
+                                                  &partition->transaction),
+                                          0));
+      }
+      rb_ary_push(rows, values);
+   }
+   scan->rows    += batch->rows;
+   scan->current  = NULL;
+   freeScanBatch(batch);
+
+   rb_yield(rows);
+}
+
+
+/**
+ * This function releases a batch of table scan rows.
+ *
+ * @param  batch  A pointer to the batch to be released.
+ *
+ */
+void freeScanBatch(ScanBatch *batch)
+{
+   free(batch->data);
+   free(batch);
+}
+
+
+/**
+ * This function opens the attachment and starts the transaction for a table
+ * scan partition. It is called without the interpreter lock and so makes no
+ * calls into Ruby.
+ *
+ * @param  data  A pointer to the ScanPartition to be attached.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *attachScanPartition(void *data)
+{
+   ScanPartition *partition = (ScanPartition *)data;
+   ParallelScan  *scan      = partition->scan;
+   char          tpb[]      = {isc_tpb_version3, isc_tpb_concurrency,
+                               isc_tpb_read, isc_tpb_wait};
+
+   if(isc_attach_database(partition->status, strlen(scan->file), scan->file,
+                          &partition->handle, scan->length, scan->dpb) != 0)
+   {
+      partition->handle  = 0;
+      partition->failed  = 1;
+      partition->message = "Error opening table scan connection.";
+   }
+   else if(isc_start_transaction(partition->status, &partition->transaction,
+                                 1, &partition->handle, sizeof(tpb),
+                                 tpb) != 0)
+   {
+      partition->transaction = 0;
+      partition->failed      = 1;
+      partition->message     = "Error starting table scan transaction.";
+   }
+
+   return(NULL);
+}
+
+
+/**
+ * This function attaches the partitions of a table scan in parallel, the
+ * first on the calling thread and each of the others on a thread of its
+ * own. Should a thread fail to start its partition is simply attached on the
+ * calling thread.
+ *
+ * @param  data  A pointer to the ParallelScan structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *attachScanPartitions(void *data)
+{
+   ParallelScan *scan = (ParallelScan *)data;
+   long         index;
+
+   for(index = 1; index < scan->count; index++)
+   {
+      scan->partition[index].started =
+         (startThread(&scan->partition[index].thread, attachScanPartition,
+                      &scan->partition[index]) == 0);
+   }
+
+   for(index = 0; index < scan->count; index++)
+   {
+      if(scan->partition[index].started)
+      {
+         joinThread(scan->partition[index].thread);
+         scan->partition[index].started = 0;
+      }
+      else
+      {
+         attachScanPartition(&scan->partition[index]);
+      }
+   }
+
+   return(NULL);
+}
+
+
+/**
+ * This function provides the body of a table scan partition thread. The
+ * partition query is executed and its rows fetched into batches, which are
+ * queued for delivery to the block. Should too many batches be waiting the
+ * thread waits for some to be delivered. It is called without the
+ * interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the ScanPartition to be fetched.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *runScanPartition(void *data)
+{
+   ScanPartition *partition = (ScanPartition *)data;
+   ParallelScan  *scan      = partition->scan;
+   ScanBatch     *batch     = NULL;
+   ISC_STATUS    result     = 0;
+
+   if(isc_dsql_execute(partition->status, &partition->transaction,
+                       &partition->statement, 3, NULL) != 0)
+   {
+      partition->failed  = 1;
+      partition->message = "Error executing table scan query.";
+   }
+
+   while(!partition->failed && !scan->cancelled)
+   {
+      result = isc_dsql_fetch(partition->status, &partition->statement, 3,
+                              partition->output);
+      if(result != 0)
+      {
+         if(result != 100 && !scan->cancelled)
+         {
+            partition->failed  = 1;
+            partition->message = "Error fetching table scan rows.";
+         }
+         break;
+      }
+
+      if(batch == NULL)
+      {
+         batch = (ScanBatch *)malloc(sizeof(ScanBatch));
+         if(batch != NULL &&
+            (batch->data = (char *)malloc(partition->width *
+                                          scan->size)) == NULL)
+         {
+            free(batch);
+            batch = NULL;
+         }
+         if(batch == NULL)
+         {
+            partition->failed  = 2;
+            partition->message = "Memory allocation failure scanning a table.";
+            break;
+         }
+         batch->next      = NULL;
+         batch->partition = partition - scan->partition;
+         batch->rows      = 0;
+      }
+
+      copyOutputRow(partition->output,
+                    batch->data + batch->rows * partition->width);
+      if(++batch->rows == scan->size)
+      {
+         queueScanBatch(scan, batch);
+         batch = NULL;
+      }
+   }
+
+   if(batch != NULL)
+   {
+      if(!partition->failed)
+      {
+         queueScanBatch(scan, batch);
+      }
+      else
+      {
+         freeScanBatch(batch);
+      }
+   }
+
+   acquireLock(&scan->lock);
+   scan->active--;
+   broadcastCondition(&scan->ready);
+   releaseLock(&scan->lock);
+
+   return(NULL);
+}
+
+
+/**
+ * This function adds a batch of rows to the delivery queue for a table scan,
+ * waiting for space on the queue if need be. The batch is discarded if the
+ * scan is cancelled.
+ *
+ * @param  scan   A pointer to the ParallelScan structure.
+ * @param  batch  A pointer to the batch to be queued.
+ *
+ */
+void queueScanBatch(ParallelScan *scan, ScanBatch *batch)
+{
+   acquireLock(&scan->lock);
+   while(scan->queued >= scan->limit && !scan->cancelled)
+   {
+      waitOnCondition(&scan->space, &scan->lock, 250);
+   }
+   if(!scan->cancelled)
+   {
+      if(scan->last != NULL)
+      {
+         scan->last->next = batch;
+      }
+      else
+      {
+         scan->first = batch;
+      }
+      scan->last = batch;
+      scan->queued++;
+      signalCondition(&scan->ready);
+      batch = NULL;
+   }
+   releaseLock(&scan->lock);
+
+   if(batch != NULL)
+   {
+      freeScanBatch(batch);
+   }
+}
+
+
+/**
+ * This function takes the next batch of rows from the delivery queue for a
+ * table scan, waiting briefly for one if the queue is empty. It is called
+ * without the interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the ParallelScan structure.
+ *
+ * @return  A pointer to the batch taken, or NULL if none was available.
+ *
+ */
+void *takeScanBatch(void *data)
+{
+   ParallelScan *scan  = (ParallelScan *)data;
+   ScanBatch    *batch = NULL;
+
+   acquireLock(&scan->lock);
+   if(scan->first == NULL && scan->active > 0 && !scan->cancelled)
+   {
+      waitOnCondition(&scan->ready, &scan->lock, 250);
+   }
+   if((batch = scan->first) != NULL)
+   {
+      scan->first = batch->next;
+      if(scan->first == NULL)
+      {
+         scan->last = NULL;
+      }
+      scan->queued--;
+      broadcastCondition(&scan->space);
+   }
+   releaseLock(&scan->lock);
+
+   return(batch);
+}
+
+
+/**
+ * This function is called by the interpreter to interrupt a thread waiting
+ * for table scan rows, such as when the thread is killed.
+ *
+ * @param  data  A pointer to the ParallelScan structure.
+ *
+ */
+void wakeScanConsumer(void *data)
+{
+   ParallelScan *scan = (ParallelScan *)data;
+
+   acquireLock(&scan->lock);
+   broadcastCondition(&scan->ready);
+   releaseLock(&scan->lock);
+}
+
+
+/**
+ * This function waits for the partition threads of a table scan to finish.
+ *
+ * @param  data  A pointer to the ParallelScan structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *joinScanPartitions(void *data)
+{
+   ParallelScan *scan = (ParallelScan *)data;
+   long         index;
+
+   for(index = 0; index < scan->count; index++)
+   {
+      if(scan->partition[index].started)
+      {
+         joinThread(scan->partition[index].thread);
+         scan->partition[index].started = 0;
+      }
+   }
+
+   return(NULL);
+}
+
+
+/**
+ * This function initializes the parallel query support within the Ruby
+ * environment, adding the parallel function and the QueryBatch class to the
+ * module specified. The Connection parallel_scan method is defined along with
+ * the rest of the Connection class.
+ *
+ * @param  module  A reference to the module to add to.
+ *
+ */
+void Init_Parallel(VALUE module)
+{
+   rb_define_module_function(module, "parallel", runInParallel, 1);
+
+   cQueryBatch = rb_define_class_under(module, "QueryBatch", rb_cObject);
+   rb_define_method(cQueryBatch, "add", addBatchQuery, -1);
+   rb_define_method(cQueryBatch, "size", getBatchSize, 0);
+}
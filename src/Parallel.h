@@ -0,0 +1,140 @@
+/*------------------------------------------------------------------------------
+ * Parallel.h
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+#ifndef IBRUBY_PARALLEL_H
+#define IBRUBY_PARALLEL_H
+
+   /* Includes. */
+   #ifndef IBRUBY_FIRE_RUBY_H
+      #include "IBRuby.h"
+   #endif
+
+   #ifndef IBRUBY_FIRE_RUBY_EXCEPTION_H
+      #include "IBRubyException.h"
+   #endif
+
+   #ifndef IBRUBY_THREADS_H
+      #include "Threads.h"
+   #endif
+
+   /* Definitions. */
+   #define MAX_SCAN_PARTITIONS 32
+
+   /* Structure definitions. */
+   typedef struct
+   {
+      isc_stmt_handle statement;
+      isc_db_handle   *connection;
+      isc_tr_handle   *transaction;
+      XSQLDA          *parameters,
+                      *output;
+      int             type,
+                      failed;
+      long            affected,
+                      rows,
+                      width,
+                      capacity;
+      char            *data;
+      ISC_STATUS      status[20];
+   } ParallelQuery;
+
+   typedef struct ParallelRun ParallelRun;
+
+   typedef struct
+   {
+      ParallelRun  *run;
+      long         number;
+      IBRubyThread thread;
+      int          started;
+   } ParallelLane;
+
+   struct ParallelRun
+   {
+      VALUE         connections,
+                    queries,
+                    sources;
+      ParallelQuery *query;
+      ParallelLane  *lane;
+      long          count,
+                    lanes;
+      int           committed;
+   };
+
+   typedef struct ScanBatch
+   {
+      struct ScanBatch *next;
+      long             partition,
+                       rows;
+      char             *data;
+   } ScanBatch;
+
+   typedef struct ParallelScan ParallelScan;
+
+   typedef struct
+   {
+      ParallelScan    *scan;
+      isc_db_handle   handle;
+      isc_tr_handle   transaction;
+      isc_stmt_handle statement;
+      XSQLDA          *output,
+                      *values;
+      long            width;
+      int             failed,
+                      started;
+      const char      *message;
+      IBRubyThread    thread;
+      ISC_STATUS      status[20];
+   } ScanPartition;
+
+   struct ParallelScan
+   {
+      IBRubyLock      lock;
+      IBRubyCondition ready,
+                      space;
+      VALUE           connection,
+                      queries;
+      ScanPartition   *partition;
+      ScanBatch       *first,
+                      *last,
+                      *current;
+      char            *file,
+                      *dpb;
+      short           length;
+      long            count,
+                      active,
+                      queued,
+                      limit,
+                      size,
+                      rows;
+      int             cancelled;
+   };
+
+   /* Function prototypes. */
+   void Init_Parallel(VALUE);
+   VALUE rb_parallel_scan(VALUE, VALUE, VALUE);
+   long getRowWidth(XSQLDA *);
+   char *copyOutputRow(XSQLDA *, char *);
+   char *restoreOutputRow(XSQLDA *, char *);
+
+#endif /* IBRUBY_PARALLEL_H */
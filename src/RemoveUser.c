@@ -27,6 +27,7 @@
 #include "RemoveUser.h"
 #include "ibase.h"
 #include "ServiceManager.h"
+#include "Services.h"
 
 /* Function prototypes. */
 static VALUE initializeRemoveUser(VALUE , VALUE);
@@ -145,7 +146,7 @@ VALUE executeRemoveUser(VALUE self, VALUE manager)
    createRemoveUserBuffer(self, &buffer, &length);
 
    /* Start the service request. */
-   if(isc_service_start(status, &handle->handle, NULL, length, buffer))
+   if(startService(status, &handle->handle, length, buffer))
    {
       free(buffer);
       rb_ibruby_raise(status, "Error removing user.");
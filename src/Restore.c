@@ -28,6 +28,7 @@
 #include "ibase.h"
 #include "ServiceManager.h"
 #include "Services.h"
+#include "ServiceStream.h"
 
 /* Function prototypes. */
 static VALUE initializeRestore(VALUE, VALUE, VALUE);
@@ -53,7 +54,8 @@ static VALUE getRestoreMode(VALUE);
 static VALUE setRestoreMode(VALUE, VALUE);
 static VALUE getRestoreUseAllSpace(VALUE);
 static VALUE setRestoreUseAllSpace(VALUE, VALUE);
-static VALUE executeRestore(VALUE, VALUE);
+static VALUE executeRestore(int, VALUE *, VALUE);
+static VALUE setRestoreProgress(VALUE);
 static VALUE getRestoreLog(VALUE);
 static void createRestoreBuffer(VALUE, VALUE, VALUE, char **, short *);
 
@@ -119,6 +121,7 @@ VALUE initializeRestore(VALUE self, VALUE file, VALUE database)
    rb_iv_set(self, "@database", to);
    rb_iv_set(self, "@options", options);
    rb_iv_set(self, "@log", Qnil);
+   rb_iv_set(self, "@progress", Qnil);
 
    return(self);
 }
@@ -630,22 +633,50 @@ VALUE setRestoreUseAllSpace(VALUE self, VALUE setting)
 
 
 /**
- * This function provides the execute method for the Restore class.
- *
- * @param  self     A reference to the Restore object to call the method on.
- * @param  manager  A reference to the ServiceManager that will be used to
- *                  execute the task.
+ * This function provides the execute method for the Restore class. Each line
+ * of the service output is passed to the block, if one is given, as it is
+ * produced. If an IO is given in the options the backup is read from it,
+ * rather than from the backup file.
+ *
+ * @param  argc  A count of the number of arguments passed to the function.
+ * @param  argv  A pointer to the array of arguments passed to the function.
+ *               The first is the ServiceManager that will be used to execute
+ *               the task and the second an optional Hash of options, :io and
+ *               :compression.
+ * @param  self  A reference to the Restore object to call the method on.
  *
  * @return  A reference to the Restore object executed.
  *
  */
-VALUE executeRestore(VALUE self, VALUE manager)
+VALUE executeRestore(int argc, VALUE *argv, VALUE self)
 {
-   ManagerHandle *handle = NULL;
-   char          *buffer = NULL;
-   short         length  = 0;
+   ManagerHandle *handle     = NULL;
+   char          *buffer     = NULL;
+   short         length      = 0;
+   VALUE         manager     = Qnil,
+                 io          = Qnil,
+                 file        = rb_iv_get(self, "@backup_file");
+   int           compression = STREAM_COMPRESSION_NONE;
    ISC_STATUS    status[20];
 
+   if(argc < 1 || argc > 2)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               argc < 1 ? 1 : 2);
+   }
+   manager = argv[0];
+   if(argc > 1 && argv[1] != Qnil)
+   {
+      io = rb_hash_aref(argv[1], toSymbol("io"));
+   }
+   if(io != Qnil)
+   {
+      /* The service reads the backup from its standard input. */
+      compression = getStreamCompression(rb_hash_aref(argv[1],
+                                                      toSymbol("compression")));
+      file        = rb_str_new2("stdin");
+   }
+
    /* Check that the service manager is connected. */
    Data_Get_Struct(manager, ManagerHandle, handle);
    if(handle->handle == 0)
@@ -654,12 +685,11 @@ VALUE executeRestore(VALUE self, VALUE manager)
                         "Database restore error. Service manager not connected.");
    }
 
-   createRestoreBuffer(rb_iv_get(self, "@backup_file"),
-                       rb_iv_get(self, "@database"),
+   createRestoreBuffer(file, rb_iv_get(self, "@database"),
                        rb_iv_get(self, "@options"), &buffer, &length);
 
    /* Start the service request. */
-   if(isc_service_start(status, &handle->handle, NULL, length, buffer))
+   if(startService(status, &handle->handle, length, buffer))
    {
       free(buffer);
       rb_ibruby_raise(status, "Error performing database restore.");
@@ -667,8 +697,35 @@ VALUE executeRestore(VALUE self, VALUE manager)
    free(buffer);
 
    /* Query the service until it is complete. */
-   rb_iv_set(self, "@log", queryService(&handle->handle));
+   if(io != Qnil)
+   {
+      rb_iv_set(self, "@log",
+                readServiceInput(&handle->handle, io, compression,
+                                 rb_iv_get(self, "@progress")));
+   }
+   else
+   {
+      rb_iv_set(self, "@log", queryService(&handle->handle,
+                                           rb_iv_get(self, "@progress")));
+   }
+
+   return(self);
+}
+
 
+/**
+ * This function provides the on_progress method for the Restore class, setting
+ * the block to be called with counts of the tables and rows processed as the
+ * restore is executed.
+ *
+ * @param  self  A reference to the Restore object to make the call on.
+ *
+ * @return  A reference to the Restore object.
+ *
+ */
+VALUE setRestoreProgress(VALUE self)
+{
+   rb_iv_set(self, "@progress", rb_block_given_p() ? rb_block_proc() : Qnil);
    return(self);
 }
 
@@ -845,7 +902,8 @@ void Init_Restore(VALUE module)
    rb_define_method(cRestore, "restore_mode=", setRestoreMode, 1);
    rb_define_method(cRestore, "use_all_space", getRestoreUseAllSpace, 0);
    rb_define_method(cRestore, "use_all_space=", setRestoreUseAllSpace, 1);
-   rb_define_method(cRestore, "execute", executeRestore, 1);
+   rb_define_method(cRestore, "execute", executeRestore, -1);
+   rb_define_method(cRestore, "on_progress", setRestoreProgress, 0);
    rb_define_method(cRestore, "log", getRestoreLog, 0);
 
    rb_define_const(cRestore, "ACCESS_READ_ONLY", INT2FIX(isc_spb_prp_am_readonly));
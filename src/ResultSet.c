@@ -67,6 +67,38 @@
 #include "Row.h"
 
 #include "TypeMap.h"
+#include "Threads.h"
+#include "Parallel.h"
+
+/* Type definitions. */
+typedef struct
+{
+   ISC_STATUS    *status,
+                 result;
+   ResultsHandle *results;
+} FetchCall;
+
+struct RowPrefetch
+{
+   IBRubyLock      lock;
+   IBRubyCondition filled,
+                   drained;
+   IBRubyThread    thread;
+   isc_stmt_handle handle;
+   XSQLDA          *output;
+   char            *ring;
+   long            capacity,
+                   width,
+                   head,
+                   count;
+   short           dialect;
+   int             finished,
+                   stopped,
+                   exited,
+                   orphaned;
+   ISC_STATUS      result,
+                   status[20];
+};
 
 #include "ruby.h"
 
@@ -77,6 +109,7 @@
 static VALUE allocateResultSet(VALUE);
 
 static VALUE initializeResultSet(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE);
+static VALUE startResultSet(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, long);
 
 static VALUE fetchResultSetEntry(VALUE);
 
@@ -105,10 +138,21 @@ static VALUE getResultSetColumnType(VALUE, VALUE);
 static VALUE eachResultSetRow(VALUE);
 
 static VALUE isResultSetExhausted(VALUE);
+static VALUE prefetchResultSet(int, VALUE *, VALUE);
+static VALUE getResultSetPlan(VALUE);
 
 static void resultSetMark(void *);
 
 static void cleanupHandle(isc_stmt_handle *handle);
+void *fetchClientCall(void *);
+ISC_STATUS takePrefetchedRow(ResultsHandle *, ISC_STATUS *);
+void stopPrefetch(ResultsHandle *);
+void abandonPrefetch(ResultsHandle *);
+void releasePrefetch(RowPrefetch *);
+void *joinPrefetch(void *);
+void *runPrefetch(void *);
+void *waitForPrefetch(void *);
+void wakePrefetch(void *);
 
 
 
@@ -165,6 +209,7 @@ VALUE allocateResultSet(VALUE klass)
    results->dialect     = 0;
 
    results->transaction = Qnil;
+   results->prefetch    = NULL;
 
    
 
@@ -218,6 +263,31 @@ VALUE initializeResultSet(VALUE self, VALUE connection, VALUE transaction,
 
 {
 
+   return(startResultSet(self, connection, transaction, sql, dialect,
+                         parameters, -1));
+}
+
+
+/**
+ * This function prepares and executes the query for a ResultSet object.
+ *
+ * @param  self         A reference to the ResultSet object being initialized.
+ * @param  connection   A reference to the Connection object to be used.
+ * @param  transaction  A reference to the Transaction object to be used.
+ * @param  sql          A reference to a String containing the query.
+ * @param  dialect      A reference to the SQL dialect to be used.
+ * @param  parameters   A reference to an array containing the parameters to be
+ *                      used in executing the query.
+ * @param  timeout      The statement timeout, in milliseconds, to apply to the
+ *                      execution or -1 to use the connection statement timeout.
+ *
+ * @return  A reference to the newly initialize ResultSet object.
+ *
+ */
+static VALUE startResultSet(VALUE self, VALUE connection, VALUE transaction,
+                            VALUE sql, VALUE dialect, VALUE parameters,
+                            long timeout)
+{
    short             setting     = 0;
 
    int               type        = 0,
@@ -446,7 +516,8 @@ VALUE initializeResultSet(VALUE self, VALUE connection, VALUE transaction,
 
    execute(&tHandle->handle, &results->handle, setting, params, type,
 
-           &affected);
+           &affected, &cHandle->handle,
+           timeout < 0 ? cHandle->timeout : timeout);
 
    if(params != NULL)
 
@@ -502,9 +573,19 @@ VALUE fetchResultSetEntry(VALUE self)
 
    {
 
-      value = isc_dsql_fetch(status, &results->handle, results->dialect,
+      if(results->prefetch != NULL)
+      {
+         value = takePrefetchedRow(results, status);
+      }
+      else
+      {
+         FetchCall call;
 
-                             results->output);
+         call.status  = status;
+         call.results = results;
+         callClient(fetchClientCall, &call, NULL, NULL);
+         value = call.result;
+      }
 
       if(value != 0 && value != 100)
 
@@ -539,6 +620,7 @@ VALUE fetchResultSetEntry(VALUE self)
       {
 
          results->exhausted = 1;
+         stopPrefetch(results);
 
          if(results->transaction != Qnil)
 
@@ -565,6 +647,372 @@ VALUE fetchResultSetEntry(VALUE self)
 
 
 
+/**
+ * This function makes the isc_dsql_fetch call for the fetch method. It may be
+ * run on a thread other than the calling Ruby thread.
+ *
+ * @param  data  A pointer to the FetchCall structure for the call.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *fetchClientCall(void *data)
+{
+   FetchCall *call = (FetchCall *)data;
+
+   call->result = isc_dsql_fetch(call->status, &call->results->handle,
+                                 call->results->dialect,
+                                 call->results->output);
+
+   return(NULL);
+}
+
+
+/**
+ * This function provides the prefetch method for the ResultSet class. A
+ * native thread is started that fetches rows ahead of the caller into a ring
+ * buffer of row images, so that the network round trips for later rows
+ * overlap with the conversion and processing of earlier ones.
+ *
+ * @param  argc  A count of the number of arguments passed to the function.
+ * @param  argv  A pointer to the array of arguments passed to the function.
+ *               The only argument is an optional count of the rows to fetch
+ *               ahead, defaulting to 256.
+ * @param  self  A reference to the ResultSet object to make the call on.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE prefetchResultSet(int argc, VALUE *argv, VALUE self)
+{
+   ResultsHandle *results  = NULL;
+   RowPrefetch   *prefetch = NULL;
+   long          capacity  = 256;
+
+   if(argc > 1)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               1);
+   }
+   if(argc > 0)
+   {
+      capacity = NUM2LONG(argv[0]);
+   }
+   if(capacity < 1)
+   {
+      rb_ibruby_raise(NULL, "Invalid prefetch row count specified.");
+   }
+   Data_Get_Struct(self, ResultsHandle, results);
+   if(results->handle == 0 || results->exhausted ||
+      results->prefetch != NULL)
+   {
+      return(self);
+   }
+
+   prefetch = ALLOC(RowPrefetch);
+   if(prefetch == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure starting result set prefetch.");
+   }
+   memset(prefetch, 0, sizeof(RowPrefetch));
+   prefetch->handle    = results->handle;
+   prefetch->dialect   = results->dialect;
+   prefetch->capacity  = capacity;
+   prefetch->output    = allocateOutXSQLDA(results->output->sqld,
+                                           &results->handle,
+                                           results->dialect);
+   prepareDataArea(prefetch->output);
+   prefetch->width     = getRowWidth(prefetch->output);
+   prefetch->ring      = (char *)malloc(prefetch->width * capacity);
+   if(prefetch->ring == NULL)
+   {
+      releaseDataArea(prefetch->output);
+      free(prefetch);
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure starting result set prefetch.");
+   }
+   initializeLock(&prefetch->lock);
+   initializeCondition(&prefetch->filled);
+   initializeCondition(&prefetch->drained);
+
+   /* Without a thread the result set simply carries on fetching directly. */
+   if(startThread(&prefetch->thread, runPrefetch, prefetch) == 0)
+   {
+      results->prefetch = prefetch;
+   }
+   else
+   {
+      releasePrefetch(prefetch);
+   }
+
+   return(self);
+}
+
+
+/**
+ * This function takes the next row fetched by the prefetch thread for a
+ * ResultSet, copying it into the result set output area. The caller waits,
+ * without the interpreter lock where possible, if no row is ready yet.
+ *
+ * @param  results  A pointer to the result set structure.
+ * @param  status   A pointer to the status vector to be populated if the
+ *                  fetch failed.
+ *
+ * @return  0 if a row was taken, 100 if the rows are exhausted or some other
+ *          value if the fetch failed.
+ *
+ */
+ISC_STATUS takePrefetchedRow(ResultsHandle *results, ISC_STATUS *status)
+{
+   RowPrefetch *prefetch = results->prefetch;
+   ISC_STATUS  result    = 0;
+   int         ready     = 0;
+
+   acquireLock(&prefetch->lock);
+   ready = (prefetch->count > 0 || prefetch->finished);
+   releaseLock(&prefetch->lock);
+   while(!ready)
+   {
+      callBlocking(waitForPrefetch, prefetch, wakePrefetch, prefetch);
+      acquireLock(&prefetch->lock);
+      ready = (prefetch->count > 0 || prefetch->finished);
+      releaseLock(&prefetch->lock);
+   }
+
+   acquireLock(&prefetch->lock);
+   if(prefetch->count > 0)
+   {
+      restoreOutputRow(results->output,
+                       prefetch->ring + prefetch->head * prefetch->width);
+      prefetch->head = (prefetch->head + 1) % prefetch->capacity;
+      prefetch->count--;
+      signalCondition(&prefetch->drained);
+   }
+   else
+   {
+      result = prefetch->result;
+      memcpy(status, prefetch->status, sizeof(prefetch->status));
+   }
+   releaseLock(&prefetch->lock);
+
+   return(result);
+}
+
+
+/**
+ * This function stops the prefetch thread for a ResultSet, if there is one,
+ * and releases the resources used for prefetching. The thread may be part
+ * way through a fetch so it is waited for without the interpreter lock.
+ *
+ * @param  results  A pointer to the result set structure.
+ *
+ */
+void stopPrefetch(ResultsHandle *results)
+{
+   RowPrefetch *prefetch = results->prefetch;
+
+   if(prefetch != NULL)
+   {
+      results->prefetch = NULL;
+      acquireLock(&prefetch->lock);
+      prefetch->stopped = 1;
+      broadcastCondition(&prefetch->drained);
+      releaseLock(&prefetch->lock);
+      callBlocking(joinPrefetch, prefetch, NULL, NULL);
+      releasePrefetch(prefetch);
+   }
+}
+
+
+/**
+ * This function stops the prefetch thread for a ResultSet that is being
+ * collected without waiting for it. Should the thread still be running it
+ * is detached and given the statement handle, which it drops along with the
+ * rest of the prefetch resources once its current fetch completes.
+ *
+ * @param  results  A pointer to the result set structure.
+ *
+ */
+void abandonPrefetch(ResultsHandle *results)
+{
+   RowPrefetch *prefetch = results->prefetch;
+
+   if(prefetch != NULL)
+   {
+      int exited = 0;
+
+      results->prefetch = NULL;
+      acquireLock(&prefetch->lock);
+      prefetch->stopped = 1;
+      exited            = prefetch->exited;
+      if(!exited)
+      {
+         prefetch->orphaned = 1;
+         results->handle    = 0;
+      }
+      broadcastCondition(&prefetch->drained);
+      releaseLock(&prefetch->lock);
+
+      if(exited)
+      {
+         joinThread(prefetch->thread);
+         releasePrefetch(prefetch);
+      }
+      else
+      {
+         detachThread(prefetch->thread);
+      }
+   }
+}
+
+
+/**
+ * This function releases the resources used for prefetching the rows of a
+ * ResultSet. It makes no calls into Ruby.
+ *
+ * @param  prefetch  A pointer to the RowPrefetch structure to be released.
+ *
+ */
+void releasePrefetch(RowPrefetch *prefetch)
+{
+   releaseDataArea(prefetch->output);
+   free(prefetch->ring);
+   destroyCondition(&prefetch->drained);
+   destroyCondition(&prefetch->filled);
+   destroyLock(&prefetch->lock);
+   free(prefetch);
+}
+
+
+/**
+ * This function waits for the prefetch thread of a ResultSet to finish. It is
+ * called without the interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the RowPrefetch structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *joinPrefetch(void *data)
+{
+   joinThread(((RowPrefetch *)data)->thread);
+
+   return(NULL);
+}
+
+
+/**
+ * This function provides the body of a ResultSet prefetch thread. Rows are
+ * fetched into the thread's own output area and copied into the ring buffer
+ * until the rows are exhausted, a fetch fails, the prefetch is stopped or
+ * the ring buffer is full, in which case the thread waits for the caller to
+ * take a row. Should the ResultSet have been collected in the meantime the
+ * thread drops the statement and releases the prefetch resources itself. It
+ * is called without the interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the RowPrefetch structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *runPrefetch(void *data)
+{
+   RowPrefetch *prefetch = (RowPrefetch *)data;
+   ISC_STATUS  result    = 0;
+   int         stopped   = 0,
+               orphaned  = 0;
+
+   while(result == 0 && !stopped)
+   {
+      acquireLock(&prefetch->lock);
+      while(prefetch->count == prefetch->capacity && !prefetch->stopped)
+      {
+         waitOnCondition(&prefetch->drained, &prefetch->lock, 250);
+      }
+      stopped = prefetch->stopped;
+      releaseLock(&prefetch->lock);
+
+      if(!stopped)
+      {
+         result = isc_dsql_fetch(prefetch->status, &prefetch->handle,
+                                 prefetch->dialect, prefetch->output);
+         acquireLock(&prefetch->lock);
+         if(result == 0)
+         {
+            long slot = (prefetch->head + prefetch->count) %
+                        prefetch->capacity;
+
+            copyOutputRow(prefetch->output,
+                          prefetch->ring + slot * prefetch->width);
+            prefetch->count++;
+         }
+         else
+         {
+            prefetch->result   = result;
+            prefetch->finished = 1;
+         }
+         signalCondition(&prefetch->filled);
+         releaseLock(&prefetch->lock);
+      }
+   }
+
+   acquireLock(&prefetch->lock);
+   orphaned         = prefetch->orphaned;
+   prefetch->exited = 1;
+   releaseLock(&prefetch->lock);
+   if(orphaned)
+   {
+      isc_dsql_free_statement(prefetch->status, &prefetch->handle, DSQL_drop);
+      releasePrefetch(prefetch);
+   }
+
+   return(NULL);
+}
+
+
+/**
+ * This function waits for the prefetch thread of a ResultSet to make a row
+ * available. It is called without the interpreter lock and so makes no calls
+ * into Ruby.
+ *
+ * @param  data  A pointer to the RowPrefetch structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *waitForPrefetch(void *data)
+{
+   RowPrefetch *prefetch = (RowPrefetch *)data;
+
+   acquireLock(&prefetch->lock);
+   if(prefetch->count == 0 && !prefetch->finished)
+   {
+      waitOnCondition(&prefetch->filled, &prefetch->lock, 250);
+   }
+   releaseLock(&prefetch->lock);
+
+   return(NULL);
+}
+
+
+/**
+ * This function is called by the interpreter to interrupt a thread waiting
+ * for a prefetched row, such as when the thread is killed.
+ *
+ * @param  data  A pointer to the RowPrefetch structure.
+ *
+ */
+void wakePrefetch(void *data)
+{
+   RowPrefetch *prefetch = (RowPrefetch *)data;
+
+   acquireLock(&prefetch->lock);
+   broadcastCondition(&prefetch->filled);
+   releaseLock(&prefetch->lock);
+}
+
+
 /**
 
  * This function provides the close method for the ResultSet class, releasing
@@ -592,6 +1040,7 @@ VALUE closeResultSet(VALUE self)
    
 
    Data_Get_Struct(self, ResultsHandle, results);
+   stopPrefetch(results);
 
    if(results->handle != 0)
 
@@ -777,6 +1226,30 @@ VALUE getResultSetSQL(VALUE self)
 }
 
 
+/**
+ * This function provides the plan attribute accessor for the ResultSet class.
+ *
+ * @param  self  A reference to the ResultSet object to fetch the attribute
+ *               from.
+ *
+ * @return  A reference to a String containing the plan used by the query, or
+ *          nil.
+ *
+ */
+static VALUE getResultSetPlan(VALUE self)
+{
+   ResultsHandle *results = NULL;
+
+   Data_Get_Struct(self, ResultsHandle, results);
+   if(results->handle == 0)
+   {
+      rb_ibruby_raise(NULL, "Result set is closed.");
+   }
+
+   return(getSQLPlan(&results->handle));
+}
+
+
 
 
 
@@ -1332,6 +1805,8 @@ void resultSetMark(void *handle)
 
  *                      used in executing the query.
 
+ * @param  timeout      The statement timeout, in milliseconds, to apply to the
+ *                      query or -1 to use the connection statement timeout.
  *
 
  * @return  A reference to the newly created ResultSet object.
@@ -1342,7 +1817,7 @@ void resultSetMark(void *handle)
 
 VALUE rb_result_set_new(VALUE connection, VALUE transaction, VALUE sql,
 
-                        VALUE dialect, VALUE parameters)
+                        VALUE dialect, VALUE parameters, long timeout)
 
 {
 
@@ -1350,9 +1825,9 @@ VALUE rb_result_set_new(VALUE connection, VALUE transaction, VALUE sql,
 
    
 
-   initializeResultSet(instance, connection, transaction, sql, dialect,
+   startResultSet(instance, connection, transaction, sql, dialect,
 
-                       parameters);
+                  parameters, timeout);
 
    
 
@@ -1428,7 +1903,7 @@ void resultSetFree(void *handle)
 
       ResultsHandle *results = (ResultsHandle *)handle;
 
-      
+      abandonPrefetch(results);
 
       if(results->handle != 0)
 
@@ -1546,6 +2021,8 @@ void Init_ResultSet(VALUE module)
 
    rb_define_method(cResultSet, "fetch", fetchResultSetEntry, 0);
 
+   rb_define_method(cResultSet, "prefetch", prefetchResultSet, -1);
+
    rb_define_method(cResultSet, "close", closeResultSet, 0);
 
    rb_define_method(cResultSet, "connection", getResultSetConnection, 0);
@@ -1553,6 +2030,7 @@ void Init_ResultSet(VALUE module)
    rb_define_method(cResultSet, "transaction", getResultSetTransaction, 0);
 
    rb_define_method(cResultSet, "sql", getResultSetSQL, 0);
+   rb_define_method(cResultSet, "plan", getResultSetPlan, 0);
 
    rb_define_method(cResultSet, "dialect", getResultSetDialect, 0);
 
@@ -37,6 +37,8 @@
    #endif
    
    /* Type definitions. */
+   typedef struct RowPrefetch RowPrefetch;
+
    typedef struct
    {
       isc_stmt_handle handle;
@@ -45,11 +47,12 @@
       long            fetched;
       short           dialect;
       VALUE           transaction;
+      RowPrefetch     *prefetch;
       /*char            sql[1000];*/
    } ResultsHandle;
    
    /* Function prototypes. */
-   VALUE rb_result_set_new(VALUE, VALUE, VALUE, VALUE, VALUE);
+   VALUE rb_result_set_new(VALUE, VALUE, VALUE, VALUE, VALUE, long);
    void rb_assign_transaction(VALUE, VALUE);
    void  resultSetFree(void *);
    void Init_ResultSet(VALUE);
@@ -26,6 +26,7 @@
 /* Includes. */
 #include "ServiceManager.h"
 #include "Common.h"
+#include "Services.h"
 
 /* Function prototypes. */
 static VALUE allocateServiceManager(VALUE);
@@ -34,6 +35,7 @@ static VALUE connectServiceManager(VALUE, VALUE, VALUE);
 static VALUE disconnectServiceManager(VALUE);
 static VALUE isServiceManagerConnected(VALUE);
 static VALUE executeServiceTasks(int, VALUE *, VALUE);
+char *createServiceName(VALUE);
 
 /* Globals. */
 VALUE cServiceManager;
@@ -59,6 +61,8 @@ VALUE allocateServiceManager(VALUE klass)
                "Memory allocation failure creating a service manager.");
    }
    manager->handle = NULL;
+   manager->spb    = NULL;
+   manager->length = 0;
    instance        = Data_Wrap_Struct(klass, NULL, serviceManagerFree, manager);
 
    return(instance);
@@ -143,34 +147,101 @@ VALUE connectServiceManager(VALUE self, VALUE user, VALUE password)
    strncpy(position, text, size);
 
    /* Create the service name. */
-   size    = strlen(STR2CSTR(host)) + 13;
-   service = ALLOC_N(char, size);
+   service = createServiceName(host);
    if(service == NULL)
    {
       free(buffer);
       rb_raise(rb_eNoMemError,
                "Memory allocation failure service manager service name.");
    }
-   memset(service, 0, size);
-   sprintf(service, "%s:service_mgr", STR2CSTR(host));
 
    /* Make the attachment call. */
-   if(isc_service_attach(status, 0, service, &manager->handle, length,
-                         buffer))
+   if(attachService(status, service, &manager->handle, length, buffer))
    {
       free(buffer);
       free(service);
       rb_ibruby_raise(status, "Error connecting service manager.");
    }
 
-   /* Clean up. */
-   free(buffer);
+   /* Clean up, keeping the parameter buffer for reconnecting. */
    free(service);
+   if(manager->spb != NULL)
+   {
+      free(manager->spb);
+   }
+   manager->spb    = buffer;
+   manager->length = length;
 
    return(self);
 }
 
 
+/**
+ * This function reconnects a ServiceManager, dropping its attachment and
+ * making a new one with the details it was last connected with. This leaves
+ * the manager free of any service it was running.
+ *
+ * @param  self  A reference to the ServiceManager object to be reconnected.
+ *
+ */
+void rb_service_manager_reconnect(VALUE self)
+{
+   ManagerHandle *manager = NULL;
+   char          *service = NULL;
+   ISC_STATUS    status[20];
+
+   Data_Get_Struct(self, ManagerHandle, manager);
+   if(manager->spb == NULL)
+   {
+      rb_ibruby_raise(NULL, "Service manager has never been connected.");
+   }
+   if(manager->handle != 0)
+   {
+      detachService(status, &manager->handle);
+      manager->handle = 0;
+   }
+
+   service = createServiceName(rb_iv_get(self, "@host"));
+   if(service == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure service manager service name.");
+   }
+   if(attachService(status, service, &manager->handle, manager->length,
+                    manager->spb))
+   {
+      free(service);
+      rb_ibruby_raise(status, "Error reconnecting service manager.");
+   }
+   free(service);
+}
+
+
+/**
+ * This function creates the service name used to attach to the service
+ * manager on a host.
+ *
+ * @param  host  A reference to a String containing the host name.
+ *
+ * @return  A pointer to the service name, which the caller must free, or
+ *          NULL if it could not be allocated.
+ *
+ */
+char *createServiceName(VALUE host)
+{
+   short size     = strlen(STR2CSTR(host)) + 13;
+   char  *service = ALLOC_N(char, size);
+
+   if(service != NULL)
+   {
+      memset(service, 0, size);
+      sprintf(service, "%s:service_mgr", STR2CSTR(host));
+   }
+
+   return(service);
+}
+
+
 /**
  * This function provides the disconnect method for the ServiceManager class.
  *
@@ -188,7 +259,7 @@ VALUE disconnectServiceManager(VALUE self)
    {
       ISC_STATUS status[20];
 
-      if(isc_service_detach(status, &manager->handle))
+      if(detachService(status, &manager->handle))
       {
          rb_ibruby_raise(status, "Error disconnecting service manager.");
       }
@@ -272,6 +343,10 @@ void serviceManagerFree(void *manager)
 
          isc_service_detach(status, &handle->handle);
       }
+      if(handle->spb != NULL)
+      {
+         free(handle->spb);
+      }
       free(handle);
    }
 }
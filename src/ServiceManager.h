@@ -38,11 +38,14 @@
    typedef struct
    {
       isc_svc_handle handle;
+      char           *spb;
+      short          length;
    } ManagerHandle;
    
    /* Function prototypes. */
    void Init_ServiceManager(VALUE);
    void serviceManagerFree(void *);
    VALUE rb_service_manager_new(VALUE);
+   void rb_service_manager_reconnect(VALUE);
 
 #endif /* IBRUBY_SERVICE_MANAGER_H */
@@ -0,0 +1,747 @@
+/*------------------------------------------------------------------------------
+ * ServiceQueue.c
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "ServiceQueue.h"
+#include "ibase.h"
+#include "ServiceManager.h"
+#include "Services.h"
+#include "Threads.h"
+#include <string.h>
+
+/* Function prototypes. */
+static VALUE allocateServiceQueue(VALUE);
+static VALUE initializeServiceQueue(int, VALUE *, VALUE);
+static VALUE addServiceJob(VALUE, VALUE);
+static VALUE addSweepJob(VALUE, VALUE);
+static VALUE getServiceJobs(VALUE);
+static VALUE getServiceQueueSize(VALUE);
+static VALUE runServiceQueue(VALUE);
+VALUE createServiceJob(VALUE, VALUE);
+VALUE takeServiceJob(VALUE);
+VALUE joinServiceWorkers(VALUE);
+VALUE joinServiceWorker(VALUE);
+VALUE serviceQueueEnsure(VALUE);
+VALUE runServiceWorker(void *);
+VALUE runServiceJobs(VALUE);
+VALUE callServiceBlock(VALUE);
+VALUE serviceWorkerEnsure(VALUE);
+VALUE connectServiceWorker(VALUE);
+VALUE serviceWorkerFailed(VALUE, VALUE);
+VALUE runServiceJob(VALUE);
+VALUE serviceJobFailed(VALUE, VALUE);
+VALUE disconnectServiceWorker(VALUE);
+VALUE ignoreServiceError(VALUE, VALUE);
+void sweepDatabase(VALUE, VALUE);
+
+/* Globals. */
+VALUE cServiceQueue;
+
+/* Definitions. */
+#define DEFAULT_QUEUE_SIZE    4
+
+
+/**
+ * This function provides for the allocation of new ServiceQueue objects
+ * through the Ruby language.
+ *
+ * @param  klass  A reference to the ServiceQueue Class object.
+ *
+ * @return  A reference to the newly allocated ServiceQueue object.
+ *
+ */
+static VALUE allocateServiceQueue(VALUE klass)
+{
+   VALUE              instance = Qnil;
+   ServiceQueueHandle *queue   = ALLOC(ServiceQueueHandle);
+
+   if(queue != NULL)
+   {
+      queue->password = NULL;
+      instance        = Data_Wrap_Struct(klass, NULL, serviceQueueFree,
+                                         queue);
+   }
+   else
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure creating a service queue.");
+   }
+
+   return(instance);
+}
+
+
+/**
+ * This function provides the initialize method for the ServiceQueue class.
+ *
+ * @param  argc  A count of the number of arguments passed to the method.
+ * @param  argv  A pointer to the method arguments. These are the name of the
+ *               server host, the user name and password to connect to its
+ *               service manager with and, optionally, the largest number of
+ *               jobs to run at once.
+ * @param  self  A reference to the ServiceQueue object being initialized.
+ *
+ * @return  A reference to the newly initialized ServiceQueue object.
+ *
+ */
+static VALUE initializeServiceQueue(int argc, VALUE *argv, VALUE self)
+{
+   ServiceQueueHandle *queue = NULL;
+   long               size   = DEFAULT_QUEUE_SIZE;
+
+   if(argc < 3 || argc > 4)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               argc < 3 ? 3 : 4);
+   }
+
+   if(argc > 3 && argv[3] != Qnil)
+   {
+      size = NUM2LONG(argv[3]);
+      if(size < 1)
+      {
+         rb_ibruby_raise(NULL, "Invalid service queue size specified.");
+      }
+   }
+
+   /* The password is kept out of sight in the queue structure. */
+   Data_Get_Struct(self, ServiceQueueHandle, queue);
+   if(queue->password != NULL)
+   {
+      memset(queue->password, 0, strlen(queue->password));
+      free(queue->password);
+      queue->password = NULL;
+   }
+   if(argv[2] != Qnil)
+   {
+      char *text = STR2CSTR(argv[2]);
+
+      queue->password = ALLOC_N(char, strlen(text) + 1);
+      if(queue->password == NULL)
+      {
+         rb_raise(rb_eNoMemError,
+                  "Memory allocation failure creating a service queue.");
+      }
+      strcpy(queue->password, text);
+   }
+
+   rb_iv_set(self, "@host", argv[0]);
+   rb_iv_set(self, "@user", argv[1]);
+   rb_iv_set(self, "@size", LONG2NUM(size));
+   rb_iv_set(self, "@jobs", rb_ary_new());
+   rb_iv_set(self, "@running", Qfalse);
+   rb_iv_set(self, "@stopping", Qfalse);
+   rb_iv_set(self, "@block", Qnil);
+   rb_iv_set(self, "@error", Qnil);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the add method for the ServiceQueue class, queueing
+ * a service task such as a Backup, Restore or NBackup to be executed.
+ *
+ * @param  self  A reference to the ServiceQueue object to make the call on.
+ * @param  task  A reference to the task to be queued. This must provide an
+ *               execute method taking a ServiceManager.
+ *
+ * @return  A reference to the ServiceQueue object.
+ *
+ */
+static VALUE addServiceJob(VALUE self, VALUE task)
+{
+   if(!rb_respond_to(task, rb_intern("execute")))
+   {
+      rb_ibruby_raise(NULL,
+                      "Service queue tasks must provide an execute method.");
+   }
+   rb_ary_push(rb_iv_get(self, "@jobs"),
+               createServiceJob(toSymbol("execute"), task));
+
+   return(self);
+}
+
+
+/**
+ * This function provides the sweep method for the ServiceQueue class,
+ * queueing a sweep of a database.
+ *
+ * @param  self      A reference to the ServiceQueue object to make the call
+ *                   on.
+ * @param  database  A reference to a File or String containing the server path
+ *                   and name of the database to be swept.
+ *
+ * @return  A reference to the ServiceQueue object.
+ *
+ */
+static VALUE addSweepJob(VALUE self, VALUE database)
+{
+   VALUE path = Qnil;
+
+   if(TYPE(database) == T_FILE)
+   {
+      path = rb_funcall(database, rb_intern("path"), 0);
+   }
+   else
+   {
+      path = rb_funcall(database, rb_intern("to_s"), 0);
+   }
+   rb_ary_push(rb_iv_get(self, "@jobs"),
+               createServiceJob(toSymbol("sweep"), path));
+
+   return(self);
+}
+
+
+/**
+ * This function provides the jobs attribute accessor for the ServiceQueue
+ * class.
+ *
+ * @param  self  A reference to the ServiceQueue object to make the call on.
+ *
+ * @return  A reference to an Array containing a Hash for each job queued.
+ *
+ */
+static VALUE getServiceJobs(VALUE self)
+{
+   return(rb_iv_get(self, "@jobs"));
+}
+
+
+/**
+ * This function provides the size attribute accessor for the ServiceQueue
+ * class.
+ *
+ * @param  self  A reference to the ServiceQueue object to make the call on.
+ *
+ * @return  A reference to an Integer containing the largest number of jobs
+ *          the queue will run at once.
+ *
+ */
+static VALUE getServiceQueueSize(VALUE self)
+{
+   return(rb_iv_get(self, "@size"));
+}
+
+
+/**
+ * This function provides the run method for the ServiceQueue class. Each of
+ * the pending jobs is run, up to size of them at once. Every worker thread
+ * has a service manager connection of its own and the service calls are
+ * made with the interpreter lock released, so the jobs proceed on the
+ * server in parallel. If a block is given then each job Hash is passed to it
+ * as the job finishes.
+ *
+ * @param  self  A reference to the ServiceQueue object to make the call on.
+ *
+ * @return  A reference to an Array containing the job Hashes.
+ *
+ */
+static VALUE runServiceQueue(VALUE self)
+{
+   VALUE jobs    = rb_iv_get(self, "@jobs"),
+         threads = rb_ary_new(),
+         pending = toSymbol("pending"),
+         job     = Qnil;
+   long  size    = NUM2LONG(rb_iv_get(self, "@size")),
+         count   = 0,
+         i;
+
+   if(rb_iv_get(self, "@running") == Qtrue)
+   {
+      rb_ibruby_raise(NULL, "Service queue is already running.");
+   }
+
+   for(i = 0; (job = rb_ary_entry(jobs, i)) != Qnil; i++)
+   {
+      if(rb_hash_aref(job, toSymbol("status")) == pending)
+      {
+         count++;
+      }
+   }
+
+   rb_iv_set(self, "@running", Qtrue);
+   rb_iv_set(self, "@stopping", Qfalse);
+   rb_iv_set(self, "@block", rb_block_given_p() ? rb_block_proc() : Qnil);
+   rb_iv_set(self, "@error", Qnil);
+   for(i = 0; i < size && i < count; i++)
+   {
+      rb_ary_push(threads, rb_thread_create(runServiceWorker, (void *)self));
+   }
+   rb_ensure(joinServiceWorkers, threads, serviceQueueEnsure, self);
+
+   /* Fail any jobs left because no worker could connect. */
+   for(i = 0; (job = rb_ary_entry(jobs, i)) != Qnil; i++)
+   {
+      if(rb_hash_aref(job, toSymbol("status")) == pending)
+      {
+         rb_hash_aset(job, toSymbol("status"), toSymbol("failed"));
+         rb_hash_aset(job, toSymbol("error"), rb_iv_get(self, "@error"));
+      }
+   }
+
+   return(jobs);
+}
+
+
+/**
+ * This function creates the Hash used to track a queued job.
+ *
+ * @param  action  A reference to a Symbol giving what the job does.
+ * @param  task    A reference to the task or database for the job.
+ *
+ * @return  A reference to the new job Hash.
+ *
+ */
+VALUE createServiceJob(VALUE action, VALUE task)
+{
+   VALUE job = rb_hash_new();
+
+   rb_hash_aset(job, toSymbol("action"), action);
+   rb_hash_aset(job, toSymbol("task"), task);
+   rb_hash_aset(job, toSymbol("status"), toSymbol("pending"));
+   rb_hash_aset(job, toSymbol("error"), Qnil);
+   rb_hash_aset(job, toSymbol("elapsed"), Qnil);
+
+   return(job);
+}
+
+
+/**
+ * This function takes the next pending job from a queue, marking it as
+ * running. Workers only call this while holding the interpreter lock, so no
+ * two of them can take the same job. No job is taken once the queue is
+ * stopping.
+ *
+ * @param  self  A reference to the ServiceQueue object.
+ *
+ * @return  A reference to the job Hash taken, or nil if none are pending.
+ *
+ */
+VALUE takeServiceJob(VALUE self)
+{
+   VALUE jobs = rb_iv_get(self, "@jobs"),
+         job  = Qnil;
+   long  i;
+
+   if(rb_iv_get(self, "@stopping") == Qtrue)
+   {
+      return(Qnil);
+   }
+
+   for(i = 0; (job = rb_ary_entry(jobs, i)) != Qnil; i++)
+   {
+      if(rb_hash_aref(job, toSymbol("status")) == toSymbol("pending"))
+      {
+         rb_hash_aset(job, toSymbol("status"), toSymbol("running"));
+         break;
+      }
+   }
+
+   return(job);
+}
+
+
+/**
+ * This function waits for each of the worker threads of a queue to finish.
+ * Every worker is waited for before the first error raised by any of them is
+ * raised again.
+ *
+ * @param  threads  A reference to an Array of the worker threads.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE joinServiceWorkers(VALUE threads)
+{
+   VALUE thread = Qnil;
+   int   failed = 0;
+
+   while((thread = rb_ary_shift(threads)) != Qnil)
+   {
+      int state = 0;
+
+      rb_protect(joinServiceWorker, thread, &state);
+      if(state != 0 && failed == 0)
+      {
+         failed = state;
+      }
+   }
+   if(failed != 0)
+   {
+      rb_jump_tag(failed);
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function waits for a single worker thread of a queue to finish.
+ *
+ * @param  thread  A reference to the worker thread.
+ *
+ * @return  A reference to the thread.
+ *
+ */
+VALUE joinServiceWorker(VALUE thread)
+{
+   return(rb_funcall(thread, rb_intern("join"), 0));
+}
+
+
+/**
+ * This function marks a queue as no longer running once its workers have
+ * finished.
+ *
+ * @param  self  A reference to the ServiceQueue object.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE serviceQueueEnsure(VALUE self)
+{
+   rb_iv_set(self, "@running", Qfalse);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function is the body of a queue worker thread. It connects a service
+ * manager of its own and then runs pending jobs on it until there are none
+ * left. The service manager is disconnected however the worker finishes.
+ *
+ * @param  data  The ServiceQueue object, cast to a pointer.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE runServiceWorker(void *data)
+{
+   volatile VALUE self    = (VALUE)data,
+                  manager = rb_service_manager_new(rb_iv_get(self, "@host")),
+                  worker  = rb_ary_new3(3, self, manager, Qnil);
+
+   if(rb_rescue(connectServiceWorker, worker, serviceWorkerFailed,
+                self) == Qnil)
+   {
+      return(Qnil);
+   }
+
+   return(rb_ensure(runServiceJobs, worker, serviceWorkerEnsure, manager));
+}
+
+
+/**
+ * This function runs pending jobs on a queue worker's service manager until
+ * there are none left. Should the block passed to run raise an exception the
+ * queue is stopped, so that the other workers take no more jobs, and the
+ * exception is raised again.
+ *
+ * @param  worker  A reference to an Array holding the ServiceQueue, the
+ *                 worker ServiceManager and the current job Hash.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE runServiceJobs(VALUE worker)
+{
+   VALUE self = rb_ary_entry(worker, 0),
+         job  = Qnil;
+
+   while((job = takeServiceJob(self)) != Qnil)
+   {
+      VALUE  block   = rb_iv_get(self, "@block");
+      double started = getCurrentTime();
+
+      rb_ary_store(worker, 2, job);
+      rb_rescue(runServiceJob, worker, serviceJobFailed, job);
+      rb_hash_aset(job, toSymbol("elapsed"),
+                   rb_float_new(getCurrentTime() - started));
+      if(block != Qnil)
+      {
+         int state = 0;
+
+         rb_protect(callServiceBlock, rb_assoc_new(block, job), &state);
+         if(state != 0)
+         {
+            rb_iv_set(self, "@stopping", Qtrue);
+            rb_jump_tag(state);
+         }
+      }
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function passes a finished job to the block given to a queue's run
+ * method.
+ *
+ * @param  call  A reference to an Array holding the block and the job Hash.
+ *
+ * @return  The value returned by the block.
+ *
+ */
+VALUE callServiceBlock(VALUE call)
+{
+   return(rb_funcall(rb_ary_entry(call, 0), rb_intern("call"), 1,
+                     rb_ary_entry(call, 1)));
+}
+
+
+/**
+ * This function disconnects a queue worker's service manager once the
+ * worker has finished, discarding any error as the jobs are already done.
+ *
+ * @param  manager  A reference to the worker ServiceManager.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE serviceWorkerEnsure(VALUE manager)
+{
+   rb_rescue(disconnectServiceWorker, manager, ignoreServiceError, Qnil);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function connects the service manager for a queue worker.
+ *
+ * @param  worker  A reference to an Array holding the ServiceQueue and the
+ *                 worker ServiceManager.
+ *
+ * @return  Always true.
+ *
+ */
+VALUE connectServiceWorker(VALUE worker)
+{
+   ServiceQueueHandle *queue   = NULL;
+   VALUE              self     = rb_ary_entry(worker, 0),
+                      password = Qnil;
+
+   Data_Get_Struct(self, ServiceQueueHandle, queue);
+   if(queue->password != NULL)
+   {
+      password = rb_str_new2(queue->password);
+   }
+   rb_funcall(rb_ary_entry(worker, 1), rb_intern("connect"), 2,
+              rb_iv_get(self, "@user"), password);
+
+   return(Qtrue);
+}
+
+
+/**
+ * This function records the error when a queue worker fails to connect.
+ *
+ * @param  self   A reference to the ServiceQueue object.
+ * @param  error  A reference to the exception raised.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE serviceWorkerFailed(VALUE self, VALUE error)
+{
+   rb_iv_set(self, "@error", error);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function runs a single job on a queue worker's service manager.
+ *
+ * @param  worker  A reference to an Array holding the ServiceQueue, the
+ *                 worker ServiceManager and the job Hash.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE runServiceJob(VALUE worker)
+{
+   VALUE manager = rb_ary_entry(worker, 1),
+         job     = rb_ary_entry(worker, 2),
+         task    = rb_hash_aref(job, toSymbol("task"));
+
+   if(rb_hash_aref(job, toSymbol("action")) == toSymbol("sweep"))
+   {
+      sweepDatabase(manager, task);
+   }
+   else
+   {
+      rb_funcall(task, rb_intern("execute"), 1, manager);
+   }
+   rb_hash_aset(job, toSymbol("status"), toSymbol("done"));
+
+   return(Qnil);
+}
+
+
+/**
+ * This function records the error raised by a job that failed.
+ *
+ * @param  job    A reference to the job Hash.
+ * @param  error  A reference to the exception raised.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE serviceJobFailed(VALUE job, VALUE error)
+{
+   rb_hash_aset(job, toSymbol("status"), toSymbol("failed"));
+   rb_hash_aset(job, toSymbol("error"), error);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function disconnects the service manager of a queue worker.
+ *
+ * @param  manager  A reference to the ServiceManager to disconnect.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE disconnectServiceWorker(VALUE manager)
+{
+   rb_funcall(manager, rb_intern("disconnect"), 0);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function discards an error raised disconnecting a queue worker, as
+ * the jobs it ran have already finished.
+ *
+ * @param  unused  Not used.
+ * @param  error   A reference to the exception raised.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE ignoreServiceError(VALUE unused, VALUE error)
+{
+   return(Qnil);
+}
+
+
+/**
+ * This function sweeps a database through the repair service action, waiting
+ * for the sweep to complete.
+ *
+ * @param  manager   A reference to the connected ServiceManager to use.
+ * @param  database  A reference to a String containing the server path and
+ *                   name of the database.
+ *
+ */
+void sweepDatabase(VALUE manager, VALUE database)
+{
+   ManagerHandle *handle   = NULL;
+   char          *name     = STR2CSTR(database),
+                 *buffer   = NULL,
+                 *position = NULL;
+   short         size      = strlen(name),
+                 length    = 1 + 3 + size + 5;
+   ISC_STATUS    status[20];
+
+   Data_Get_Struct(manager, ManagerHandle, handle);
+
+   /* Create and populate the service request buffer. */
+   buffer = position = ALLOC_N(char, length);
+   if(buffer == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation error preparing database sweep.");
+   }
+   memset(buffer, 0, length);
+   *position++ = isc_action_svc_repair;
+   *position++ = isc_spb_dbname;
+   ADD_SPB_LENGTH(position, size);
+   memcpy(position, name, size);
+   position   += size;
+   *position++ = isc_spb_options;
+   ADD_SPB_NUMERIC(position, isc_spb_rpr_sweep_db);
+
+   /* Start the sweep and wait for it to complete. */
+   if(startService(status, &handle->handle, length, buffer))
+   {
+      free(buffer);
+      rb_ibruby_raise(status, "Error performing database sweep.");
+   }
+   free(buffer);
+   queryService(&handle->handle, Qnil);
+}
+
+
+/**
+ * This function integrates with the Ruby garbage collector to release the
+ * resources associated with a ServiceQueue object.
+ *
+ * @param  queue  A pointer to the ServiceQueueHandle structure associated
+ *                with the object being collected.
+ *
+ */
+void serviceQueueFree(void *queue)
+{
+   if(queue != NULL)
+   {
+      ServiceQueueHandle *handle = (ServiceQueueHandle *)queue;
+
+      if(handle->password != NULL)
+      {
+         memset(handle->password, 0, strlen(handle->password));
+         free(handle->password);
+      }
+      free(handle);
+   }
+}
+
+
+/**
+ * This function initialize the ServiceQueue class in the Ruby environment.
+ *
+ * @param  module  The module to create the new class definition under.
+ *
+ */
+void Init_ServiceQueue(VALUE module)
+{
+   cServiceQueue = rb_define_class_under(module, "ServiceQueue", rb_cObject);
+   rb_define_alloc_func(cServiceQueue, allocateServiceQueue);
+   rb_define_method(cServiceQueue, "initialize", initializeServiceQueue, -1);
+   rb_define_method(cServiceQueue, "add", addServiceJob, 1);
+   rb_define_method(cServiceQueue, "<<", addServiceJob, 1);
+   rb_define_method(cServiceQueue, "sweep", addSweepJob, 1);
+   rb_define_method(cServiceQueue, "jobs", getServiceJobs, 0);
+   rb_define_method(cServiceQueue, "size", getServiceQueueSize, 0);
+   rb_define_method(cServiceQueue, "run", runServiceQueue, 0);
+}
@@ -0,0 +1,1141 @@
+/*------------------------------------------------------------------------------
+ * ServiceStream.c
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "ServiceStream.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Function prototypes. */
+ServiceStream *createServiceStream(isc_svc_handle *, VALUE, int, int);
+void releaseServiceStream(ServiceStream *);
+VALUE writeServiceChunks(VALUE);
+VALUE readServiceChunks(VALUE);
+VALUE stopServiceStream(VALUE);
+void raiseStreamError(ServiceStream *, const char *);
+void *runServiceOutput(void *);
+void *runServiceInput(void *);
+void *waitForServiceOutput(void *);
+void *waitForServiceInput(void *);
+void *joinServiceStream(void *);
+void wakeServiceStream(void *);
+int queueStreamChunk(ServiceStream *, StreamBuffer *);
+int queueStreamLine(ServiceStream *, const char *, long);
+int fillServiceInput(ServiceStream *, char *, long, long *);
+void freeStreamChunks(StreamChunk *);
+int startStreamCodec(StreamCodec *, int, int);
+int runStreamCodec(StreamCodec *, const char *, long, int, StreamBuffer *);
+void endStreamCodec(StreamCodec *);
+int reserveStreamBuffer(StreamBuffer *, long);
+
+/* Definitions. */
+#define STREAM_NO_ERROR           0
+#define STREAM_SERVICE_ERROR      1
+#define STREAM_MEMORY_ERROR       2
+#define STREAM_COMPRESSION_ERROR  3
+
+
+/**
+ * This function checks that service data can be streamed through a Ruby IO
+ * and converts a compression setting into one of the stream compression
+ * types.
+ *
+ * @param  compression  A reference to the compression setting, either nil,
+ *                      :zlib or :zstd.
+ *
+ * @return  The stream compression type to be used.
+ *
+ */
+int getStreamCompression(VALUE compression)
+{
+   int type = STREAM_COMPRESSION_NONE;
+
+#if !defined(FB_API_VER) || FB_API_VER < 25
+   rb_ibruby_raise(NULL,
+                   "Streaming service data through an IO is not supported "\
+                   "by the client library.");
+#endif
+   if(compression == toSymbol("zlib"))
+   {
+#ifndef HAVE_ZLIB_H
+      rb_ibruby_raise(NULL, "The library was built without zlib support.");
+#endif
+      type = STREAM_COMPRESSION_ZLIB;
+   }
+   else if(compression == toSymbol("zstd"))
+   {
+#ifndef HAVE_ZSTD_H
+      rb_ibruby_raise(NULL, "The library was built without zstd support.");
+#endif
+      type = STREAM_COMPRESSION_ZSTD;
+   }
+   else if(compression != Qnil && compression != Qfalse)
+   {
+      rb_ibruby_raise(NULL, "Unknown stream compression specified.");
+   }
+
+   return(type);
+}
+
+
+/**
+ * This function streams the data output by a started service, such as a
+ * backup to stdout, into a Ruby IO. The service is queried, and the data
+ * compressed, on a native thread while the calling thread writes the data
+ * to the IO.
+ *
+ * @param  handle       A pointer to the service manager handle.
+ * @param  io           A reference to the IO to write the data to.
+ * @param  compression  The stream compression type to be used.
+ *
+ */
+void writeServiceOutput(isc_svc_handle *handle, VALUE io, int compression)
+{
+   ServiceStream *stream = createServiceStream(handle, io, compression, 1);
+
+   if(startThread(&stream->thread, runServiceOutput, stream) != 0)
+   {
+      releaseServiceStream(stream);
+      rb_ibruby_raise(NULL, "Error starting service stream thread.");
+   }
+   rb_ensure(writeServiceChunks, (VALUE)stream, stopServiceStream,
+             (VALUE)stream);
+}
+
+
+/**
+ * This function streams data read from a Ruby IO into a started service
+ * that reads its standard input, such as a restore from stdin. The calling
+ * thread reads the IO while the data is decompressed, and handed to the
+ * service, on a native thread. Lines of output from the service are dealt
+ * with as for queryService.
+ *
+ * @param  handle       A pointer to the service manager handle.
+ * @param  io           A reference to the IO to read the data from.
+ * @param  compression  The stream compression type to be used.
+ * @param  progress     A reference to a Proc to be called with the progress
+ *                      counts, or nil.
+ *
+ * @return  Either a String object containing the output from the service or
+ *          nil if there is no output.
+ *
+ */
+VALUE readServiceInput(isc_svc_handle *handle, VALUE io, int compression,
+                       VALUE progress)
+{
+   ServiceStream *stream = createServiceStream(handle, io, compression, 0);
+   ServiceOutput output;
+
+   memset(&output, 0, sizeof(ServiceOutput));
+   output.log      = Qnil;
+   output.progress = progress;
+   stream->output  = &output;
+
+   if(startThread(&stream->thread, runServiceInput, stream) != 0)
+   {
+      releaseServiceStream(stream);
+      rb_ibruby_raise(NULL, "Error starting service stream thread.");
+   }
+   rb_ensure(readServiceChunks, (VALUE)stream, stopServiceStream,
+             (VALUE)stream);
+
+   return(output.log);
+}
+
+
+/**
+ * This function creates the structure used to stream service data.
+ *
+ * @param  handle       A pointer to the service manager handle.
+ * @param  io           A reference to the IO being streamed to or from.
+ * @param  compression  The stream compression type to be used.
+ * @param  compress     True if the data is to be compressed, false if it is
+ *                      to be decompressed.
+ *
+ * @return  A pointer to the new ServiceStream structure.
+ *
+ */
+ServiceStream *createServiceStream(isc_svc_handle *handle, VALUE io,
+                                   int compression, int compress)
+{
+   ServiceStream *stream = ALLOC(ServiceStream);
+
+   if(stream == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure creating service stream.");
+   }
+   memset(stream, 0, sizeof(ServiceStream));
+   stream->handle = handle;
+   stream->io     = io;
+   if(startStreamCodec(&stream->codec, compression, compress))
+   {
+      endStreamCodec(&stream->codec);
+      free(stream);
+      rb_ibruby_raise(NULL, "Error preparing service stream compression.");
+   }
+   initializeLock(&stream->lock);
+   initializeCondition(&stream->changed);
+
+   return(stream);
+}
+
+
+/**
+ * This function releases a ServiceStream and everything it holds. The native
+ * thread for the stream must not be running.
+ *
+ * @param  stream  A pointer to the ServiceStream to be released.
+ *
+ */
+void releaseServiceStream(ServiceStream *stream)
+{
+   freeStreamChunks(stream->first);
+   freeStreamChunks(stream->lines);
+   if(stream->pending.data != NULL)
+   {
+      free(stream->pending.data);
+   }
+   endStreamCodec(&stream->codec);
+   destroyCondition(&stream->changed);
+   destroyLock(&stream->lock);
+   free(stream);
+}
+
+
+/**
+ * This function writes the chunks of service data queued by the native
+ * thread to the IO until the service is finished.
+ *
+ * @param  data  A pointer to the ServiceStream.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE writeServiceChunks(VALUE data)
+{
+   ServiceStream *stream = (ServiceStream *)data;
+   int           done    = 0;
+
+   while(!done)
+   {
+      StreamChunk *chunk = NULL;
+
+      callBlocking(waitForServiceOutput, stream, wakeServiceStream, stream);
+      acquireLock(&stream->lock);
+      chunk = stream->first;
+      if(chunk != NULL)
+      {
+         stream->first = chunk->next;
+         if(stream->first == NULL)
+         {
+            stream->last = NULL;
+         }
+         stream->queued--;
+         broadcastCondition(&stream->changed);
+      }
+      else
+      {
+         done = stream->finished;
+      }
+      releaseLock(&stream->lock);
+
+      if(chunk != NULL)
+      {
+         VALUE text = rb_str_new(chunk->data, chunk->size);
+
+         free(chunk->data);
+         free(chunk);
+         rb_funcall(stream->io, rb_intern("write"), 1, text);
+      }
+   }
+   raiseStreamError(stream, "Error streaming service output.");
+
+   return(Qnil);
+}
+
+
+/**
+ * This function reads chunks of data from the IO for the native thread to
+ * pass to the service, dealing with the lines of service output as they
+ * arrive, until the service is finished.
+ *
+ * @param  data  A pointer to the ServiceStream.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE readServiceChunks(VALUE data)
+{
+   ServiceStream *stream = (ServiceStream *)data;
+   int           done    = 0;
+
+   while(!done)
+   {
+      StreamChunk *lines = NULL;
+      int         reading = 0;
+
+      acquireLock(&stream->lock);
+      lines         = stream->lines;
+      stream->lines = stream->lastLine = NULL;
+      done          = (stream->finished && lines == NULL);
+      reading       = (!stream->inputDone &&
+                       stream->queued < STREAM_QUEUE_LIMIT);
+      releaseLock(&stream->lock);
+
+      if(lines != NULL)
+      {
+         VALUE array = rb_ary_new(),
+               line  = Qnil;
+
+         while(lines != NULL)
+         {
+            StreamChunk *next = lines->next;
+
+            rb_ary_push(array, rb_str_new(lines->data, lines->size));
+            free(lines->data);
+            free(lines);
+            lines = next;
+         }
+         while((line = rb_ary_shift(array)) != Qnil)
+         {
+            addServiceLine(stream->output, line);
+         }
+      }
+      else if(!done && reading)
+      {
+         VALUE        text   = rb_funcall(stream->io, rb_intern("read"), 1,
+                                          INT2FIX(STREAM_CHUNK_SIZE));
+         StreamBuffer buffer = {NULL, 0, 0};
+
+         if(text != Qnil)
+         {
+            VALUE number = rb_funcall(text, rb_intern("length"), 0);
+            long  size   = TYPE(number) == T_FIXNUM ? FIX2INT(number) :
+                                                      NUM2INT(number);
+
+            if(reserveStreamBuffer(&buffer, size) != STREAM_NO_ERROR)
+            {
+               rb_raise(rb_eNoMemError,
+                        "Memory allocation failure streaming service data.");
+            }
+            memcpy(buffer.data, STR2CSTR(text), size);
+            buffer.size = size;
+            if(queueStreamChunk(stream, &buffer) != STREAM_NO_ERROR)
+            {
+               free(buffer.data);
+               rb_raise(rb_eNoMemError,
+                        "Memory allocation failure streaming service data.");
+            }
+         }
+         else
+         {
+            acquireLock(&stream->lock);
+            stream->inputDone = 1;
+            broadcastCondition(&stream->changed);
+            releaseLock(&stream->lock);
+         }
+      }
+      else if(!done)
+      {
+         callBlocking(waitForServiceInput, stream, wakeServiceStream, stream);
+      }
+   }
+   raiseStreamError(stream, "Error streaming service input.");
+
+   return(Qnil);
+}
+
+
+/**
+ * This function stops the native thread for a ServiceStream, waits for it
+ * to finish and then releases the stream.
+ *
+ * @param  data  A pointer to the ServiceStream.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE stopServiceStream(VALUE data)
+{
+   ServiceStream *stream = (ServiceStream *)data;
+
+   acquireLock(&stream->lock);
+   stream->stopped = 1;
+   broadcastCondition(&stream->changed);
+   releaseLock(&stream->lock);
+   callBlocking(joinServiceStream, stream, NULL, NULL);
+   releaseServiceStream(stream);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function raises an exception for a ServiceStream whose native thread
+ * failed, doing nothing if it didn't.
+ *
+ * @param  stream   A pointer to the ServiceStream.
+ * @param  message  A string containing the message for a service error.
+ *
+ */
+void raiseStreamError(ServiceStream *stream, const char *message)
+{
+   switch(stream->failed)
+   {
+      case STREAM_SERVICE_ERROR :
+         rb_ibruby_raise(stream->status, message);
+         break;
+
+      case STREAM_MEMORY_ERROR :
+         rb_raise(rb_eNoMemError,
+                  "Memory allocation failure streaming service data.");
+         break;
+
+      case STREAM_COMPRESSION_ERROR :
+         rb_ibruby_raise(NULL, "Error compressing or decompressing service "\
+                               "data.");
+         break;
+   }
+}
+
+
+/**
+ * This function provides the body of the native thread for a service being
+ * streamed to an IO. The service output is fetched and compressed and then
+ * queued for the Ruby thread, waiting whenever the queue is full. It is
+ * called without the interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the ServiceStream.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *runServiceOutput(void *data)
+{
+   ServiceStream *stream    = (ServiceStream *)data;
+   StreamBuffer  output     = {NULL, 0, 0};
+   char          request[]  = {isc_info_svc_to_eof},
+                 timeout[]  = {isc_info_svc_timeout, 1, 0, 0, 0},
+                 *buffer    = (char *)malloc(STREAM_CHUNK_SIZE);
+   int           failed     = STREAM_NO_ERROR,
+                 done       = 0,
+                 stopped    = 0;
+
+   if(buffer == NULL)
+   {
+      failed = STREAM_MEMORY_ERROR;
+   }
+   while(!failed && !done && !stopped)
+   {
+      char  *offset = buffer;
+      short length  = 0;
+      int   more    = 0,
+            waiting = 0;
+
+      if(isc_service_query(stream->status, stream->handle, NULL,
+                           sizeof(timeout), timeout, sizeof(request),
+                           request, STREAM_CHUNK_SIZE, buffer))
+      {
+         failed = STREAM_SERVICE_ERROR;
+         break;
+      }
+      while(!failed && offset < buffer + STREAM_CHUNK_SIZE &&
+            *offset != isc_info_end)
+      {
+         switch(*offset++)
+         {
+            case isc_info_svc_to_eof :
+               length  = isc_vax_integer(offset, 2);
+               offset += 2;
+               failed  = runStreamCodec(&stream->codec, offset, length, 0,
+                                        &output);
+               offset += length;
+               break;
+
+            case isc_info_truncated :
+               more = 1;
+               break;
+
+            case isc_info_svc_timeout :
+               waiting = 1;
+               break;
+
+            default :
+               offset = buffer + STREAM_CHUNK_SIZE;
+         }
+      }
+
+      /* The service is finished when there's no more data to wait for. */
+      done = (length == 0 && !more && !waiting);
+      if(!failed && done)
+      {
+         failed = runStreamCodec(&stream->codec, NULL, 0, 1, &output);
+      }
+      if(!failed && output.size > 0)
+      {
+         failed = queueStreamChunk(stream, &output);
+      }
+
+      acquireLock(&stream->lock);
+      stopped = stream->stopped;
+      releaseLock(&stream->lock);
+   }
+   if(buffer != NULL)
+   {
+      free(buffer);
+   }
+   if(output.data != NULL)
+   {
+      free(output.data);
+   }
+
+   acquireLock(&stream->lock);
+   stream->failed   = failed;
+   stream->finished = 1;
+   broadcastCondition(&stream->changed);
+   releaseLock(&stream->lock);
+
+   return(NULL);
+}
+
+
+/**
+ * This function provides the body of the native thread for a service being
+ * streamed from an IO. Each query hands the service as much of the input as
+ * it last asked for, decompressing the chunks queued by the Ruby thread as
+ * needed, and queues any lines of output for the Ruby thread. It is called
+ * without the interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the ServiceStream.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *runServiceInput(void *data)
+{
+   ServiceStream *stream    = (ServiceStream *)data;
+   char          request[]  = {isc_info_svc_stdin, isc_info_svc_line},
+                 *send      = (char *)malloc(STREAM_CHUNK_SIZE + 8),
+                 *buffer    = (char *)malloc(STREAM_CHUNK_SIZE);
+   long          wanted     = 0;
+   int           failed     = STREAM_NO_ERROR,
+                 done       = 0,
+                 stopped    = 0;
+
+   if(send == NULL || buffer == NULL)
+   {
+      failed = STREAM_MEMORY_ERROR;
+   }
+   while(!failed && !done && !stopped)
+   {
+      char *offset = send;
+      int  ended   = 0,
+           waiting = 0;
+
+      *offset++ = isc_info_svc_timeout;
+      ADD_SPB_NUMERIC(offset, 1);
+      if(wanted > 0)
+      {
+         long size = 0;
+
+         /* An empty line tells the service the input has ended. */
+         failed = fillServiceInput(stream, offset + 3,
+                                   wanted < STREAM_CHUNK_SIZE ? wanted :
+                                   STREAM_CHUNK_SIZE, &size);
+         *offset++ = isc_info_svc_line;
+         ADD_SPB_LENGTH(offset, size);
+         offset += size;
+      }
+      if(!failed &&
+         isc_service_query(stream->status, stream->handle, NULL,
+                           offset - send, send, sizeof(request), request,
+                           STREAM_CHUNK_SIZE, buffer))
+      {
+         failed = STREAM_SERVICE_ERROR;
+      }
+
+      wanted = 0;
+      offset = buffer;
+      while(!failed && offset < buffer + STREAM_CHUNK_SIZE &&
+            *offset != isc_info_end)
+      {
+         short length = 0;
+
+         switch(*offset++)
+         {
+            case isc_info_svc_stdin :
+               wanted  = isc_vax_integer(offset, 4);
+               offset += 4;
+               break;
+
+            case isc_info_svc_line :
+               length  = isc_vax_integer(offset, 2);
+               offset += 2;
+               if(length > 0)
+               {
+                  failed = queueStreamLine(stream, offset, length);
+               }
+               else
+               {
+                  ended = 1;
+               }
+               offset += length;
+               break;
+
+            case isc_info_svc_timeout :
+               waiting = 1;
+               break;
+
+            case isc_info_truncated :
+               break;
+
+            default :
+               offset = buffer + STREAM_CHUNK_SIZE;
+         }
+      }
+      done = (ended && !waiting && wanted == 0);
+
+      acquireLock(&stream->lock);
+      stopped = stream->stopped;
+      releaseLock(&stream->lock);
+   }
+   if(send != NULL)
+   {
+      free(send);
+   }
+   if(buffer != NULL)
+   {
+      free(buffer);
+   }
+
+   acquireLock(&stream->lock);
+   stream->failed   = failed;
+   stream->finished = 1;
+   broadcastCondition(&stream->changed);
+   releaseLock(&stream->lock);
+
+   return(NULL);
+}
+
+
+/**
+ * This function waits for the native thread of a ServiceStream to queue a
+ * chunk of output or finish. It is called without the interpreter lock.
+ *
+ * @param  data  A pointer to the ServiceStream.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *waitForServiceOutput(void *data)
+{
+   ServiceStream *stream = (ServiceStream *)data;
+
+   acquireLock(&stream->lock);
+   if(stream->first == NULL && !stream->finished)
+   {
+      waitOnCondition(&stream->changed, &stream->lock, 250);
+   }
+   releaseLock(&stream->lock);
+
+   return(NULL);
+}
+
+
+/**
+ * This function waits for the native thread of a ServiceStream to queue a
+ * line of output, make room for more input or finish. It is called without
+ * the interpreter lock.
+ *
+ * @param  data  A pointer to the ServiceStream.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *waitForServiceInput(void *data)
+{
+   ServiceStream *stream = (ServiceStream *)data;
+
+   acquireLock(&stream->lock);
+   if(stream->lines == NULL && !stream->finished &&
+      (stream->inputDone || stream->queued >= STREAM_QUEUE_LIMIT))
+   {
+      waitOnCondition(&stream->changed, &stream->lock, 250);
+   }
+   releaseLock(&stream->lock);
+
+   return(NULL);
+}
+
+
+/**
+ * This function waits for the native thread of a ServiceStream to end. It is
+ * called without the interpreter lock.
+ *
+ * @param  data  A pointer to the ServiceStream.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *joinServiceStream(void *data)
+{
+   joinThread(((ServiceStream *)data)->thread);
+
+   return(NULL);
+}
+
+
+/**
+ * This function is called by the interpreter to interrupt a thread waiting
+ * on a ServiceStream.
+ *
+ * @param  data  A pointer to the ServiceStream.
+ *
+ */
+void wakeServiceStream(void *data)
+{
+   ServiceStream *stream = (ServiceStream *)data;
+
+   acquireLock(&stream->lock);
+   broadcastCondition(&stream->changed);
+   releaseLock(&stream->lock);
+}
+
+
+/**
+ * This function queues a chunk of data on a ServiceStream, taking over the
+ * data held by a buffer and leaving the buffer empty. The native thread for
+ * a stream being written waits while the queue is full.
+ *
+ * @param  stream  A pointer to the ServiceStream.
+ * @param  buffer  A pointer to the StreamBuffer holding the data.
+ *
+ * @return  STREAM_NO_ERROR or STREAM_MEMORY_ERROR.
+ *
+ */
+int queueStreamChunk(ServiceStream *stream, StreamBuffer *buffer)
+{
+   StreamChunk *chunk = (StreamChunk *)malloc(sizeof(StreamChunk));
+
+   if(chunk == NULL)
+   {
+      return(STREAM_MEMORY_ERROR);
+   }
+   chunk->data      = buffer->data;
+   chunk->size      = buffer->size;
+   chunk->next      = NULL;
+   buffer->data     = NULL;
+   buffer->size     = 0;
+   buffer->capacity = 0;
+
+   acquireLock(&stream->lock);
+   while(stream->codec.compress && stream->queued >= STREAM_QUEUE_LIMIT &&
+         !stream->stopped)
+   {
+      waitOnCondition(&stream->changed, &stream->lock, 250);
+   }
+   if(stream->last != NULL)
+   {
+      stream->last->next = chunk;
+   }
+   else
+   {
+      stream->first = chunk;
+   }
+   stream->last = chunk;
+   stream->queued++;
+   broadcastCondition(&stream->changed);
+   releaseLock(&stream->lock);
+
+   return(STREAM_NO_ERROR);
+}
+
+
+/**
+ * This function queues a line of service output for the Ruby thread.
+ *
+ * @param  stream  A pointer to the ServiceStream.
+ * @param  text    A pointer to the text of the line.
+ * @param  length  The length of the line.
+ *
+ * @return  STREAM_NO_ERROR or STREAM_MEMORY_ERROR.
+ *
+ */
+int queueStreamLine(ServiceStream *stream, const char *text, long length)
+{
+   StreamChunk *chunk = (StreamChunk *)malloc(sizeof(StreamChunk));
+
+   if(chunk == NULL)
+   {
+      return(STREAM_MEMORY_ERROR);
+   }
+   chunk->data = (char *)malloc(length);
+   if(chunk->data == NULL)
+   {
+      free(chunk);
+      return(STREAM_MEMORY_ERROR);
+   }
+   memcpy(chunk->data, text, length);
+   chunk->size = length;
+   chunk->next = NULL;
+
+   acquireLock(&stream->lock);
+   if(stream->lastLine != NULL)
+   {
+      stream->lastLine->next = chunk;
+   }
+   else
+   {
+      stream->lines = chunk;
+   }
+   stream->lastLine = chunk;
+   broadcastCondition(&stream->changed);
+   releaseLock(&stream->lock);
+
+   return(STREAM_NO_ERROR);
+}
+
+
+/**
+ * This function fills a buffer with the next of the input for a service,
+ * decompressing the chunks queued by the Ruby thread as needed and waiting
+ * for one if there are none. It is called by the native thread.
+ *
+ * @param  stream  A pointer to the ServiceStream.
+ * @param  target  A pointer to the buffer to be filled.
+ * @param  limit   The maximum number of bytes to put in the buffer.
+ * @param  size    A pointer to a long that will be set to the number of bytes
+ *                 put in the buffer, which is zero once the input has ended.
+ *
+ * @return  STREAM_NO_ERROR or the type of error that occurred.
+ *
+ */
+int fillServiceInput(ServiceStream *stream, char *target, long limit,
+                     long *size)
+{
+   int failed = STREAM_NO_ERROR;
+
+   *size = 0;
+   while(!failed && stream->consumed == stream->pending.size)
+   {
+      StreamChunk *chunk = NULL;
+
+      acquireLock(&stream->lock);
+      while(stream->first == NULL && !stream->inputDone && !stream->stopped)
+      {
+         waitOnCondition(&stream->changed, &stream->lock, 250);
+      }
+      chunk = stream->first;
+      if(chunk != NULL)
+      {
+         stream->first = chunk->next;
+         if(stream->first == NULL)
+         {
+            stream->last = NULL;
+         }
+         stream->queued--;
+         broadcastCondition(&stream->changed);
+      }
+      releaseLock(&stream->lock);
+
+      if(chunk == NULL)
+      {
+         break;
+      }
+      stream->pending.size = 0;
+      stream->consumed     = 0;
+      failed = runStreamCodec(&stream->codec, chunk->data, chunk->size, 0,
+                              &stream->pending);
+      free(chunk->data);
+      free(chunk);
+   }
+
+   if(!failed && stream->consumed < stream->pending.size)
+   {
+      *size = stream->pending.size - stream->consumed;
+      if(*size > limit)
+      {
+         *size = limit;
+      }
+      memcpy(target, &stream->pending.data[stream->consumed], *size);
+      stream->consumed += *size;
+   }
+
+   return(failed);
+}
+
+
+/**
+ * This function frees a list of StreamChunk structures.
+ *
+ * @param  chunk  A pointer to the first chunk in the list.
+ *
+ */
+void freeStreamChunks(StreamChunk *chunk)
+{
+   while(chunk != NULL)
+   {
+      StreamChunk *next = chunk->next;
+
+      free(chunk->data);
+      free(chunk);
+      chunk = next;
+   }
+}
+
+
+/**
+ * This function prepares a StreamCodec for use.
+ *
+ * @param  codec        A pointer to the StreamCodec to be prepared.
+ * @param  compression  The stream compression type to be used.
+ * @param  compress     True to compress data, false to decompress it.
+ *
+ * @return  0 on success, non-zero if the codec couldn't be prepared.
+ *
+ */
+int startStreamCodec(StreamCodec *codec, int compression, int compress)
+{
+   int result = 0;
+
+   memset(codec, 0, sizeof(StreamCodec));
+   codec->type     = compression;
+   codec->compress = compress;
+#ifdef HAVE_ZLIB_H
+   if(compression == STREAM_COMPRESSION_ZLIB)
+   {
+      /* Compressed data is gzip format, decompression accepts zlib too. */
+      if(compress)
+      {
+         result = deflateInit2(&codec->zlib, Z_DEFAULT_COMPRESSION,
+                               Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+      }
+      else
+      {
+         result = inflateInit2(&codec->zlib, 15 + 32);
+      }
+      codec->started = (result == Z_OK);
+   }
+#endif
+#ifdef HAVE_ZSTD_H
+   if(compression == STREAM_COMPRESSION_ZSTD)
+   {
+      if(compress)
+      {
+         codec->encoder = ZSTD_createCCtx();
+      }
+      else
+      {
+         codec->decoder = ZSTD_createDCtx();
+      }
+      codec->started = (codec->encoder != NULL || codec->decoder != NULL);
+      result         = !codec->started;
+   }
+#endif
+
+   return(result);
+}
+
+
+/**
+ * This function passes data through a StreamCodec, appending the results to
+ * a buffer.
+ *
+ * @param  codec   A pointer to the StreamCodec to be used.
+ * @param  input   A pointer to the data to be passed through the codec.
+ * @param  size    The number of bytes of data.
+ * @param  finish  True if this is the end of the data to be compressed.
+ * @param  output  A pointer to the StreamBuffer to add the results to.
+ *
+ * @return  STREAM_NO_ERROR or the type of error that occurred.
+ *
+ */
+int runStreamCodec(StreamCodec *codec, const char *input, long size,
+                   int finish, StreamBuffer *output)
+{
+   int failed = STREAM_NO_ERROR;
+
+   if(codec->type == STREAM_COMPRESSION_NONE)
+   {
+      if(size > 0)
+      {
+         failed = reserveStreamBuffer(output, size);
+         if(!failed)
+         {
+            memcpy(&output->data[output->size], input, size);
+            output->size += size;
+         }
+      }
+   }
+#ifdef HAVE_ZLIB_H
+   else if(codec->type == STREAM_COMPRESSION_ZLIB)
+   {
+      z_stream *zlib = &codec->zlib;
+      int      code  = Z_OK;
+
+      zlib->next_in  = (Bytef *)input;
+      zlib->avail_in = (uInt)size;
+      do
+      {
+         failed = reserveStreamBuffer(output, STREAM_CHUNK_SIZE);
+         if(!failed)
+         {
+            zlib->next_out  = (Bytef *)&output->data[output->size];
+            zlib->avail_out = (uInt)(output->capacity - output->size);
+            if(codec->compress)
+            {
+               code = deflate(zlib, finish ? Z_FINISH : Z_NO_FLUSH);
+            }
+            else
+            {
+               code = inflate(zlib, Z_NO_FLUSH);
+            }
+            output->size = output->capacity - zlib->avail_out;
+            if(code != Z_OK && code != Z_STREAM_END && code != Z_BUF_ERROR)
+            {
+               failed = STREAM_COMPRESSION_ERROR;
+            }
+         }
+      } while(!failed && code != Z_STREAM_END &&
+              (zlib->avail_in > 0 || zlib->avail_out == 0 ||
+               (codec->compress && finish)));
+   }
+#endif
+#ifdef HAVE_ZSTD_H
+   else if(codec->type == STREAM_COMPRESSION_ZSTD)
+   {
+      ZSTD_inBuffer in        = {input, (size_t)size, 0};
+      size_t        remaining = 0;
+      int           full      = 0;
+
+      do
+      {
+         ZSTD_outBuffer out;
+
+         failed = reserveStreamBuffer(output, codec->compress ?
+                                      ZSTD_CStreamOutSize() :
+                                      ZSTD_DStreamOutSize());
+         if(!failed)
+         {
+            out.dst  = &output->data[output->size];
+            out.size = output->capacity - output->size;
+            out.pos  = 0;
+            if(codec->compress)
+            {
+               remaining = ZSTD_compressStream2(codec->encoder, &out, &in,
+                                                finish ? ZSTD_e_end :
+                                                ZSTD_e_continue);
+            }
+            else
+            {
+               remaining = ZSTD_decompressStream(codec->decoder, &out, &in);
+            }
+            if(ZSTD_isError(remaining))
+            {
+               failed = STREAM_COMPRESSION_ERROR;
+            }
+            else
+            {
+               output->size += out.pos;
+               full          = (out.pos == out.size);
+            }
+         }
+      } while(!failed && (in.pos < in.size || full ||
+                          (codec->compress && finish && remaining != 0)));
+   }
+#endif
+
+   return(failed);
+}
+
+
+/**
+ * This function releases the resources held by a StreamCodec.
+ *
+ * @param  codec  A pointer to the StreamCodec to be released.
+ *
+ */
+void endStreamCodec(StreamCodec *codec)
+{
+#ifdef HAVE_ZLIB_H
+   if(codec->type == STREAM_COMPRESSION_ZLIB && codec->started)
+   {
+      if(codec->compress)
+      {
+         deflateEnd(&codec->zlib);
+      }
+      else
+      {
+         inflateEnd(&codec->zlib);
+      }
+   }
+#endif
+#ifdef HAVE_ZSTD_H
+   if(codec->encoder != NULL)
+   {
+      ZSTD_freeCCtx(codec->encoder);
+   }
+   if(codec->decoder != NULL)
+   {
+      ZSTD_freeDCtx(codec->decoder);
+   }
+#endif
+   codec->started = 0;
+}
+
+
+/**
+ * This function makes sure a StreamBuffer has room for a number of extra
+ * bytes, growing it if needed.
+ *
+ * @param  buffer  A pointer to the StreamBuffer.
+ * @param  needed  The number of extra bytes needed.
+ *
+ * @return  STREAM_NO_ERROR or STREAM_MEMORY_ERROR.
+ *
+ */
+int reserveStreamBuffer(StreamBuffer *buffer, long needed)
+{
+   if(buffer->capacity - buffer->size < needed)
+   {
+      long capacity = buffer->size + needed;
+      char *data    = NULL;
+
+      if(capacity < buffer->capacity * 2)
+      {
+         capacity = buffer->capacity * 2;
+      }
+      data = (char *)realloc(buffer->data, capacity);
+      if(data == NULL)
+      {
+         return(STREAM_MEMORY_ERROR);
+      }
+      buffer->data     = data;
+      buffer->capacity = capacity;
+   }
+
+   return(STREAM_NO_ERROR);
+}
@@ -0,0 +1,117 @@
+/*------------------------------------------------------------------------------
+ * ServiceStream.h
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+#ifndef IBRUBY_SERVICE_STREAM_H
+#define IBRUBY_SERVICE_STREAM_H
+
+   /* Includes. */
+   #ifndef IBRUBY_FIRE_RUBY_H
+      #include "IBRuby.h"
+   #endif
+
+   #ifndef IBRUBY_FIRE_RUBY_EXCEPTION_H
+      #include "IBRubyException.h"
+   #endif
+
+   #ifndef IBRUBY_THREADS_H
+      #include "Threads.h"
+   #endif
+
+   #ifndef IBRUBY_SERVICES_H
+      #include "Services.h"
+   #endif
+
+   #ifdef HAVE_ZLIB_H
+      #include <zlib.h>
+   #endif
+
+   #ifdef HAVE_ZSTD_H
+      #include <zstd.h>
+   #endif
+
+   /* Definitions. */
+   #define STREAM_CHUNK_SIZE          32768
+   #define STREAM_QUEUE_LIMIT         8
+   #define STREAM_COMPRESSION_NONE    0
+   #define STREAM_COMPRESSION_ZLIB    1
+   #define STREAM_COMPRESSION_ZSTD    2
+
+   /* Structure definitions. */
+   typedef struct StreamChunk
+   {
+      char               *data;
+      long               size;
+      struct StreamChunk *next;
+   } StreamChunk;
+
+   typedef struct
+   {
+      char *data;
+      long size,
+           capacity;
+   } StreamBuffer;
+
+   typedef struct
+   {
+      int       type,
+                compress,
+                started;
+#ifdef HAVE_ZLIB_H
+      z_stream  zlib;
+#endif
+#ifdef HAVE_ZSTD_H
+      ZSTD_CCtx *encoder;
+      ZSTD_DCtx *decoder;
+#endif
+   } StreamCodec;
+
+   typedef struct
+   {
+      IBRubyLock      lock;
+      IBRubyCondition changed;
+      IBRubyThread    thread;
+      isc_svc_handle  *handle;
+      VALUE           io;
+      ServiceOutput   *output;
+      StreamCodec     codec;
+      StreamChunk     *first,
+                      *last,
+                      *lines,
+                      *lastLine;
+      StreamBuffer    pending;
+      long            queued,
+                      consumed;
+      int             inputDone,
+                      finished,
+                      stopped,
+                      failed;
+      ISC_STATUS      status[20];
+   } ServiceStream;
+
+   /* Function prototypes. */
+   int getStreamCompression(VALUE);
+   void writeServiceOutput(isc_svc_handle *, VALUE, int);
+   VALUE readServiceInput(isc_svc_handle *, VALUE, int, VALUE);
+
+#endif /* IBRUBY_SERVICE_STREAM_H */
@@ -25,100 +25,393 @@
 
 #include "Services.h"
 #include "IBRubyException.h"
-#ifdef OS_UNIX
-   #include <unistd.h>
-#endif
+#include "Threads.h"
+#include <ctype.h>
+#include <stdlib.h>
+
+/* Type definitions. */
+typedef struct
+{
+   isc_svc_handle *handle;
+   char           *output;
+   int            size;
+   ISC_STATUS     result,
+                  status[20];
+} ServiceQuery;
+
+typedef struct
+{
+   isc_svc_handle *handle;
+   char           *name,
+                  *buffer;
+   short          length;
+   ISC_STATUS     *status,
+                  result;
+} ServiceCall;
+
+
+
+/* Function prototypes. */
+void *queryServiceCall(void *);
+void *attachServiceCall(void *);
+void *startServiceCall(void *);
+void *detachServiceCall(void *);
+
 
 /* Defines. */
 #define START_BUFFER_SIZE     1024
+#define MAX_BUFFER_SIZE       65535
+#define QUERY_TIMEOUT         1
 
 
 /**
  * This function is used to query the status of a service, returning any of
- * the output generated by the service operation.
+ * the output generated by the service operation. The output is requested a
+ * line at a time with the interpreter lock released, so other threads keep
+ * running while the service works. Each line is passed to the block of the
+ * calling method, if it has one, as soon as it arrives.
  *
- * @param  handle  A pointer to the service manager handle to be used to query
- *                 the service.
+ * @param  handle    A pointer to the service manager handle to be used to
+ *                   query the service.
+ * @param  progress  A reference to a Proc to be called with counts of the
+ *                   tables and rows processed whenever they change, or nil.
  *
  * @return  Either a String object containing the output from the service query
  *          or nil if there is no output.
  *
  */
-VALUE queryService(isc_svc_handle *handle)
+VALUE queryService(isc_svc_handle *handle, VALUE progress)
 {
-   VALUE result = Qnil;
-   int   size   = START_BUFFER_SIZE;
-   short done   = 0;
+   ServiceOutput output;
+   int           size = 0,
+                 done = 0;
+
+   memset(&output, 0, sizeof(ServiceOutput));
+   output.log      = Qnil;
+   output.progress = progress;
 
    /* Query the service until it has completed. */
    while(!done)
    {
-      ISC_STATUS status[20];
-      char       *output   = NULL,
-                 *offset   = NULL,
-                 *log      = NULL,
-                 request[] = {isc_info_svc_to_eof};
-      short      len       = 0;
-
-      /* Allocate the output buffer. */
-      offset = output = ALLOC_N(char, size);
-      if(output == NULL)
+      VALUE lines = rb_ary_new(),
+            line  = Qnil;
+
+      done = readServiceLines(handle, lines, &size);
+      while((line = rb_ary_shift(lines)) != Qnil)
       {
-         rb_raise(rb_eNoMemError,
-                  "Memory allocation failure querying service status.");
+         addServiceLine(&output, line);
       }
-      memset(output, 0, size);
+   }
+
+   return(output.log);
+}
+
+
+/**
+ * This function makes a single request for the lines of output from a
+ * service, with the interpreter lock released. The request waits for no
+ * more than a second for output to arrive, so it may return without any
+ * lines even though the service is still running.
+ *
+ * @param  handle  A pointer to the service manager handle to be used to
+ *                 query the service.
+ * @param  lines   A reference to an Array that the lines received will be
+ *                 added to.
+ * @param  size    A pointer to the size of buffer to use, which is grown
+ *                 if the output will not fit, up to the largest buffer the
+ *                 service API accepts. Zero selects the default.
+ *
+ * @return  Non-zero if the service has completed, zero otherwise.
+ *
+ */
+int readServiceLines(isc_svc_handle *handle, VALUE lines, int *size)
+{
+   ServiceQuery query;
+   char         *offset = NULL;
+   int          done    = 0,
+                waiting = 0;
 
-      /* Make the service info request. */
-      done = 1;
-      if(isc_service_query(status, handle, NULL, 0, NULL, sizeof(request),
-                           request, size, output))
+   if(*size <= 0)
+   {
+      *size = START_BUFFER_SIZE;
+   }
+   query.handle = handle;
+
+   /* Allocate the output buffer. */
+   query.output = ALLOC_N(char, *size);
+   if(query.output == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure querying service status.");
+   }
+   memset(query.output, 0, *size);
+   query.size = *size;
+
+   /* Make the service info request without the interpreter lock. */
+   callBlocking(queryServiceCall, &query, NULL, NULL);
+   if(query.result != 0)
+   {
+      free(query.output);
+      rb_ibruby_raise(query.status, "Error querying service status.");
+   }
+
+   offset = query.output;
+   while(*offset != isc_info_end && offset < query.output + query.size)
+   {
+      short length = 0;
+
+      switch(*offset++)
       {
-         free(output);
-         rb_ibruby_raise(status, "Error querying service status.");
+         case isc_info_svc_line :
+            length  = isc_vax_integer(offset, 2);
+            offset += 2;
+            if(length > 0)
+            {
+               rb_ary_push(lines, rb_str_new(offset, length));
+               offset += length;
+            }
+            else
+            {
+               done = 1;
+            }
+            break;
+
+         case isc_info_svc_timeout :
+            waiting = 1;
+            break;
+
+         case isc_info_truncated :
+            *size = (*size > MAX_BUFFER_SIZE / 2 ? MAX_BUFFER_SIZE :
+                     *size * 2);
+            break;
+
+         default :
+            offset = query.output + query.size;
       }
+   }
+   free(query.output);
+
+   /* An empty line only marks the end if the wait didn't time out. */
+   return(waiting ? 0 : done);
+}
+
+
+/**
+ * This function makes the isc_service_query call for a service query. It is
+ * called without the interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the ServiceQuery structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *queryServiceCall(void *data)
+{
+   ServiceQuery *query    = (ServiceQuery *)data;
+   char         request[] = {isc_info_svc_line},
+                timeout[] = {isc_info_svc_timeout, QUERY_TIMEOUT, 0, 0, 0};
+
+   query->result = isc_service_query(query->status, query->handle, NULL,
+                                     sizeof(timeout), timeout,
+                                     sizeof(request), request,
+                                     (unsigned short)query->size,
+                                     query->output);
+
+   return(NULL);
+}
+
+
+/**
+ * This function attaches to a service manager with the interpreter lock
+ * released, so that other threads keep running while the connection to the
+ * server is made.
+ *
+ * @param  status  A pointer to the status vector for the call.
+ * @param  name    A pointer to the service name.
+ * @param  handle  A pointer to the handle to be attached.
+ * @param  length  The length of the service parameter buffer.
+ * @param  buffer  A pointer to the service parameter buffer.
+ *
+ * @return  Zero on success, the error code otherwise.
+ *
+ */
+ISC_STATUS attachService(ISC_STATUS *status, char *name,
+                         isc_svc_handle *handle, short length, char *buffer)
+{
+   ServiceCall call;
+
+   call.status = status;
+   call.name   = name;
+   call.handle = handle;
+   call.length = length;
+   call.buffer = buffer;
+   callBlocking(attachServiceCall, &call, NULL, NULL);
+
+   return(call.result);
+}
+
+
+/**
+ * This function starts a service task with the interpreter lock released.
+ * Each thread wanting to run tasks at the same time as others must do so on
+ * its own service manager handle.
+ *
+ * @param  status  A pointer to the status vector for the call.
+ * @param  handle  A pointer to the service manager handle.
+ * @param  length  The length of the service request buffer.
+ * @param  buffer  A pointer to the service request buffer.
+ *
+ * @return  Zero on success, the error code otherwise.
+ *
+ */
+ISC_STATUS startService(ISC_STATUS *status, isc_svc_handle *handle,
+                        short length, char *buffer)
+{
+   ServiceCall call;
 
-      do
+   call.status = status;
+   call.handle = handle;
+   call.length = length;
+   call.buffer = buffer;
+   callBlocking(startServiceCall, &call, NULL, NULL);
+
+   return(call.result);
+}
+
+
+/**
+ * This function detaches from a service manager with the interpreter lock
+ * released.
+ *
+ * @param  status  A pointer to the status vector for the call.
+ * @param  handle  A pointer to the handle to be detached.
+ *
+ * @return  Zero on success, the error code otherwise.
+ *
+ */
+ISC_STATUS detachService(ISC_STATUS *status, isc_svc_handle *handle)
+{
+   ServiceCall call;
+
+   call.status = status;
+   call.handle = handle;
+   callBlocking(detachServiceCall, &call, NULL, NULL);
+
+   return(call.result);
+}
+
+
+/**
+ * This function makes the isc_service_attach call for attachService.
+ *
+ * @param  data  A pointer to the ServiceCall structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *attachServiceCall(void *data)
+{
+   ServiceCall *call = (ServiceCall *)data;
+
+   call->result = isc_service_attach(call->status, 0, call->name, call->handle,
+                                     call->length, call->buffer);
+
+   return(NULL);
+}
+
+
+/**
+ * This function makes the isc_service_start call for startService.
+ *
+ * @param  data  A pointer to the ServiceCall structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *startServiceCall(void *data)
+{
+   ServiceCall *call = (ServiceCall *)data;
+
+   call->result = isc_service_start(call->status, call->handle, NULL,
+                                    call->length, call->buffer);
+
+   return(NULL);
+}
+
+
+/**
+ * This function makes the isc_service_detach call for detachService.
+ *
+ * @param  data  A pointer to the ServiceCall structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *detachServiceCall(void *data)
+{
+   ServiceCall *call = (ServiceCall *)data;
+
+   call->result = isc_service_detach(call->status, call->handle);
+
+   return(NULL);
+}
+
+
+/**
+ * This function deals with a line of service output, adding it to the log,
+ * passing it to the block of the calling method and updating the progress
+ * counts. The counts come from the verbose output of gbak, in which a line
+ * naming a table is followed by one giving the records written or restored
+ * for it.
+ *
+ * @param  output  A pointer to the ServiceOutput structure for the query.
+ * @param  line    A reference to a String containing the line.
+ *
+ */
+void addServiceLine(ServiceOutput *output, VALUE line)
+{
+   char *text    = STR2CSTR(line),
+        *records = strstr(text, " records ");
+   int  changed  = 0;
+
+   if(output->log == Qnil)
+   {
+      output->log = rb_str_dup(line);
+   }
+   else
+   {
+      rb_str_cat2(output->log, "\n");
+      rb_str_append(output->log, line);
+   }
+
+   if(strstr(text, "data for table ") != NULL)
+   {
+      output->completed = output->rows;
+      output->tables++;
+      changed = 1;
+   }
+   else if(records != NULL && output->tables > 0)
+   {
+      char *start = records;
+
+      while(start > text && isdigit((unsigned char)start[-1]))
       {
-         switch(*offset++)
-         {
-            case isc_info_svc_to_eof :
-               len    = isc_vax_integer(offset, 2);
-               offset += 2;
-               if(len > 0)
-               {
-                  log = ALLOC_N(char, len + 1);
-                  if(log == NULL)
-                  {
-                     free(output);
-                     rb_raise(rb_eNoMemError,
-                              "Memory allocation failure querying service status.");
-                  }
-
-                  memset(log, 0, len + 1);
-                  memcpy(log, offset, len);
-
-                  result = rb_str_new2(log);
-                  free(log);
-               }
-               break;
-
-            case isc_info_truncated :
-               done = 0;
-               size = size * 2;
-               break;
-         }
-      } while(*offset);
-
-      /* Clean up. */
-      free(output);
-
-      /* Snooze if we're not done. */
-      if(!done)
+         start--;
+      }
+      if(start < records)
       {
-         sleep(1);
+         output->rows = output->completed + atol(start);
+         changed      = 1;
       }
    }
 
-   return(result);
+   if(rb_block_given_p())
+   {
+      rb_yield(line);
+   }
+   if(changed && output->progress != Qnil)
+   {
+      rb_funcall(output->progress, rb_intern("call"), 2,
+                 LONG2NUM(output->tables), LONG2NUM(output->rows));
+   }
 }
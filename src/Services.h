@@ -36,7 +36,23 @@
       #define RUBY_H_INCLUDED
    #endif
 
+   /* Structure definitions. */
+   typedef struct
+   {
+      VALUE log,
+            progress;
+      long  tables,
+            rows,
+            completed;
+   } ServiceOutput;
+
    /* Function prototypes. */
-   VALUE queryService(isc_svc_handle *);
+   VALUE queryService(isc_svc_handle *, VALUE);
+   int readServiceLines(isc_svc_handle *, VALUE, int *);
+   ISC_STATUS attachService(ISC_STATUS *, char *, isc_svc_handle *, short,
+                            char *);
+   ISC_STATUS startService(ISC_STATUS *, isc_svc_handle *, short, char *);
+   ISC_STATUS detachService(ISC_STATUS *, isc_svc_handle *);
+   void addServiceLine(ServiceOutput *, VALUE);
 
 #endif /* IBRUBY_SERVICES_H */
@@ -66,6 +66,33 @@
 
 #include "ResultSet.h"
 
+#include "Threads.h"
+#include <ctype.h>
+
+/* Type definitions. */
+typedef struct
+{
+   ISC_STATUS      *status,
+                   result;
+   isc_tr_handle   *transaction;
+   isc_stmt_handle *statement;
+   short           dialect;
+   XSQLDA          *parameters;
+   isc_db_handle   *connection;
+} ExecuteCall;
+
+#if defined(FB_API_VER) && FB_API_VER >= 25 && FB_API_VER < 40
+typedef struct
+{
+   IBRubyLock      lock;
+   IBRubyCondition finished;
+   IBRubyThread    thread;
+   isc_db_handle   *connection;
+   long            timeout;
+   int             done,
+                   fired;
+} Watchdog;
+#endif
 
 
 /* Function prototypes. */
@@ -91,9 +118,23 @@ static VALUE executeStatement(VALUE);
 static VALUE executeStatementFor(VALUE, VALUE);
 
 static VALUE closeStatement(VALUE);
+static VALUE getStatementPlan(VALUE);
+void *executeClientCall(void *);
+void cancelClientCall(void *);
+static VALUE executeStatementWithOptions(int, VALUE *, VALUE);
+static VALUE executeStatementWithTimeout(VALUE, long);
+#if defined(FB_API_VER) && FB_API_VER >= 25 && FB_API_VER < 40
+Watchdog *startWatchdog(isc_db_handle *, long);
+int stopWatchdog(Watchdog *);
+void *runWatchdog(void *);
+#endif
 
 
 
+/* Definitions. */
+#define PLAN_BUFFER_SIZE      1024
+#define MAX_PLAN_BUFFER_SIZE  32767
+
 /* Globals. */
 
 VALUE cStatement;
@@ -547,6 +588,31 @@ VALUE getStatementParameterCount(VALUE self)
 }
 
 
+/**
+ * This function provides the plan attribute accessor method for the Statement
+ * class. The statement is prepared if it hasn't been already but it is not
+ * executed.
+ *
+ * @param  self  A reference to the Statement object to call the method on.
+ *
+ * @return  A reference to a String containing the plan chosen by the
+ *          optimizer, or nil if the statement has no plan.
+ *
+ */
+VALUE getStatementPlan(VALUE self)
+{
+   StatementHandle *statement = NULL;
+
+   Data_Get_Struct(self, StatementHandle, statement);
+   if(statement->handle == 0)
+   {
+      getStatementType(self);
+   }
+
+   return(getSQLPlan(&statement->handle));
+}
+
+
 
 
 
@@ -570,6 +636,24 @@ VALUE getStatementParameterCount(VALUE self)
 
 VALUE executeStatement(VALUE self)
 
+{
+   return(executeStatementWithTimeout(self, -1));
+}
+
+
+/**
+ * This function executes a statement without parameters, applying a given
+ * statement timeout to the execution.
+ *
+ * @param  self     A reference to the Statement object to be executed.
+ * @param  timeout  The statement timeout, in milliseconds, to apply to the
+ *                  execution or -1 to use the connection statement timeout.
+ *
+ * @return  One of a count of the number of rows affected by the SQL statement,
+ *          a ResultSet object for a query or nil.
+ *
+ */
+static VALUE executeStatementWithTimeout(VALUE self, long timeout)
 {
 
    VALUE             result;
@@ -581,6 +665,7 @@ VALUE executeStatement(VALUE self)
    StatementHandle   *statement   = NULL;
 
    TransactionHandle *transaction = NULL;
+   ConnectionHandle  *connection  = NULL;
 
    
 
@@ -600,7 +685,7 @@ VALUE executeStatement(VALUE self)
 
                                     rb_iv_get(self, "@dialect"),
 
-                                    rb_ary_new());
+                                    rb_ary_new(), timeout);
 
          break;
 
@@ -618,10 +703,14 @@ VALUE executeStatement(VALUE self)
 
                          transaction);
 
+         Data_Get_Struct(rb_iv_get(self, "@connection"), ConnectionHandle,
+                         connection);
          execute(&transaction->handle, &statement->handle, statement->dialect,
 
-                 NULL, statement->type, &affected);
+                 NULL, statement->type, &affected, &connection->handle,
+                 timeout < 0 ? connection->timeout : timeout);
 
+         rb_transaction_executed(rb_iv_get(self, "@transaction"), affected);
          result = INT2NUM(affected);
 
          break;
@@ -636,10 +725,14 @@ VALUE executeStatement(VALUE self)
 
                          transaction);
 
+         Data_Get_Struct(rb_iv_get(self, "@connection"), ConnectionHandle,
+                         connection);
          execute(&transaction->handle, &statement->handle, statement->dialect,
 
-                 NULL, statement->type, &affected);
+                 NULL, statement->type, &affected, &connection->handle,
+                 timeout < 0 ? connection->timeout : timeout);
 
+         rb_transaction_executed(rb_iv_get(self, "@transaction"), 0);
          result = Qnil;
 
    }
@@ -691,6 +784,7 @@ VALUE executeStatementFor(VALUE self, VALUE parameters)
    StatementHandle   *statement   = NULL;
 
    TransactionHandle *transaction = NULL;
+   ConnectionHandle  *connection  = NULL;
 
 
 
@@ -710,7 +804,7 @@ VALUE executeStatementFor(VALUE self, VALUE parameters)
 
 								 rb_iv_get(self, "@dialect"),
 
-								 parameters);
+								 parameters, -1);
 
    }
 
@@ -784,9 +878,13 @@ VALUE executeStatementFor(VALUE self, VALUE parameters)
 
                       transaction);
 
+      Data_Get_Struct(rb_iv_get(self, "@connection"), ConnectionHandle,
+                      connection);
       execute(&transaction->handle, &statement->handle, statement->dialect,
 
-              statement->parameters, statement->type, &affected);
+              statement->parameters, statement->type, &affected,
+              &connection->handle, connection->timeout);
+      rb_transaction_executed(rb_iv_get(self, "@transaction"), affected);
 
       if(type == isc_info_sql_stmt_insert ||
 
@@ -1015,6 +1113,83 @@ void prepare(isc_db_handle *connection, isc_tr_handle *transaction,
 }
 
 
+/**
+ * This function fetches the access plan for a prepared SQL statement. The
+ * plan is requested into a buffer that is grown until the plan fits.
+ *
+ * @param  statement  A pointer to the prepared statement handle.
+ *
+ * @return  A reference to a String containing the plan, or nil if the
+ *          statement has no plan.
+ *
+ */
+VALUE getSQLPlan(isc_stmt_handle *statement)
+{
+   VALUE      plan    = Qnil;
+   char       items[] = {isc_info_sql_get_plan},
+              *buffer = NULL;
+   short      size    = PLAN_BUFFER_SIZE;
+   int        done    = 0;
+   ISC_STATUS status[20];
+
+   while(!done)
+   {
+      buffer = ALLOC_N(char, size);
+      if(buffer == NULL)
+      {
+         rb_raise(rb_eNoMemError,
+                  "Memory allocation failure retrieving statement plan.");
+      }
+      memset(buffer, 0, size);
+
+      if(isc_dsql_sql_info(status, statement, sizeof(items), items, size,
+                           buffer))
+      {
+         free(buffer);
+         rb_ibruby_raise(status, "Error retrieving statement plan.");
+      }
+
+      done = 1;
+      if(buffer[0] == isc_info_sql_get_plan)
+      {
+         short length = isc_vax_integer(&buffer[1], 2);
+         char  *text  = &buffer[3];
+
+         if(text + length < buffer + size &&
+            text[length] == isc_info_truncated && size < MAX_PLAN_BUFFER_SIZE)
+         {
+            done = 0;
+         }
+         else
+         {
+            while(length > 0 && isspace((unsigned char)*text))
+            {
+               text++;
+               length--;
+            }
+            if(length > 0)
+            {
+               plan = rb_str_new(text, length);
+            }
+         }
+      }
+      else if(buffer[0] == isc_info_truncated && size < MAX_PLAN_BUFFER_SIZE)
+      {
+         done = 0;
+      }
+      free(buffer);
+
+      if(!done)
+      {
+         size = size < MAX_PLAN_BUFFER_SIZE / 2 ? size * 2 :
+                                                  MAX_PLAN_BUFFER_SIZE;
+      }
+   }
+
+   return(plan);
+}
+
+
 
 
 
@@ -1050,25 +1225,61 @@ void prepare(isc_db_handle *connection, isc_tr_handle *transaction,
 
 void execute(isc_tr_handle *transaction, isc_stmt_handle *statement,
 
-             short dialect, XSQLDA *parameters, int type, long *affected)
+             short dialect, XSQLDA *parameters, int type, long *affected,
+             isc_db_handle *connection, long timeout)
 
 {
 
-   ISC_STATUS status[20];
+   ISC_STATUS  status[20];
 
+   ExecuteCall call;
+   int         expired = 0;
+#if defined(FB_API_VER) && FB_API_VER >= 25 && FB_API_VER < 40
+   Watchdog    *watchdog = NULL;
+#endif
    
 
-   if(isc_dsql_execute(status, transaction, statement, dialect, parameters))
-
+   call.status      = status;
+   call.transaction = transaction;
+   call.statement   = statement;
+   call.dialect     = dialect;
+   call.parameters  = parameters;
+   call.connection  = connection;
+#if defined(FB_API_VER) && FB_API_VER >= 40
+   /* A zero timeout clears any timeout left from an earlier execution. */
+   if(fb_dsql_set_timeout(status, statement, timeout) != 0 && timeout > 0)
+   {
+      rb_ibruby_raise(status, "Error setting statement timeout.");
+   }
+#elif defined(FB_API_VER) && FB_API_VER >= 25
+   if(timeout > 0)
+   {
+      watchdog = startWatchdog(connection, timeout);
+   }
+#endif
+#if defined(FB_API_VER) && FB_API_VER >= 25
+   callClient(executeClientCall, &call, cancelClientCall, &call);
+#else
+   callClient(executeClientCall, &call, NULL, NULL);
+#endif
+#if defined(FB_API_VER) && FB_API_VER >= 25 && FB_API_VER < 40
+   if(watchdog != NULL)
+   {
+      expired = stopWatchdog(watchdog);
+   }
+#endif
+   if(call.result)
    {
 	  
 
-      rb_ibruby_raise(status, "Error executing SQL statement.");
+      rb_ibruby_raise(status, expired ? "Statement execution timed out." :
+                      "Error executing SQL statement.");
 
    }
 
    
 
+
    /* Check if a row count is needed. */
 
    if(type == isc_info_sql_stmt_update || type == isc_info_sql_stmt_delete ||
@@ -1171,6 +1382,185 @@ void execute(isc_tr_handle *transaction, isc_stmt_handle *statement,
 
 
 
+/**
+ * This function makes the isc_dsql_execute call for the execute function. It
+ * may be run on a thread other than the calling Ruby thread.
+ *
+ * @param  data  A pointer to the ExecuteCall structure for the call.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *executeClientCall(void *data)
+{
+   ExecuteCall *call = (ExecuteCall *)data;
+
+   call->result = isc_dsql_execute(call->status, call->transaction,
+                                   call->statement, call->dialect,
+                                   call->parameters);
+
+   return(NULL);
+}
+
+
+/**
+ * This function is called by the interpreter when a thread executing a
+ * statement is interrupted, for example by Thread#raise. The statement is
+ * cancelled so that the thread can respond to the interrupt.
+ *
+ * @param  data  A pointer to the ExecuteCall structure for the execution.
+ *
+ */
+void cancelClientCall(void *data)
+{
+#if defined(FB_API_VER) && FB_API_VER >= 25
+   ExecuteCall *call = (ExecuteCall *)data;
+   ISC_STATUS  status[20];
+
+   fb_cancel_operation(status, call->connection, fb_cancel_raise);
+#endif
+}
+
+
+/**
+ * This function provides the execute method for the Statement class, which
+ * takes an optional Hash of execution options. The only option recognised is
+ * :timeout, the number of seconds the statement may run for, which replaces
+ * the connection statement timeout for the one call.
+ *
+ * @param  argc  A count of the number of arguments passed to the function.
+ * @param  argv  A pointer to the array of arguments passed to the function.
+ * @param  self  A reference to the Statement object to call the method on.
+ *
+ * @return  One of a count of the number of rows affected by the SQL statement,
+ *          a ResultSet object for a query or nil.
+ *
+ */
+static VALUE executeStatementWithOptions(int argc, VALUE *argv, VALUE self)
+{
+   VALUE timeout = Qnil;
+
+   if(argc > 1)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc, 1);
+   }
+   if(argc == 1 && argv[0] != Qnil)
+   {
+      if(TYPE(argv[0]) != T_HASH)
+      {
+         rb_ibruby_raise(NULL, "Invalid statement execution options specified.");
+      }
+      timeout = rb_hash_aref(argv[0], toSymbol("timeout"));
+   }
+   if(timeout == Qnil)
+   {
+      return(executeStatement(self));
+   }
+
+   return(executeStatementWithTimeout(self, getTimeoutValue(timeout)));
+}
+
+
+#if defined(FB_API_VER) && FB_API_VER >= 25 && FB_API_VER < 40
+/**
+ * This function starts a watchdog thread that cancels the operation running
+ * on a connection if it has not finished within a timeout. This is used with
+ * client libraries that can cancel operations but have no statement timeout
+ * of their own.
+ *
+ * @param  connection  A pointer to the handle of the connection to watch.
+ * @param  timeout     The timeout in milliseconds.
+ *
+ * @return  A pointer to the Watchdog started.
+ *
+ */
+Watchdog *startWatchdog(isc_db_handle *connection, long timeout)
+{
+   Watchdog *watchdog = ALLOC(Watchdog);
+
+   initializeLock(&watchdog->lock);
+   initializeCondition(&watchdog->finished);
+   watchdog->connection = connection;
+   watchdog->timeout    = timeout;
+   watchdog->done       = 0;
+   watchdog->fired      = 0;
+   if(startThread(&watchdog->thread, runWatchdog, watchdog) != 0)
+   {
+      destroyCondition(&watchdog->finished);
+      destroyLock(&watchdog->lock);
+      free(watchdog);
+      rb_ibruby_raise(NULL, "Unable to start statement timeout thread.");
+   }
+
+   return(watchdog);
+}
+
+
+/**
+ * This function stops a watchdog thread once the operation it watches has
+ * completed and releases it.
+ *
+ * @param  watchdog  A pointer to the Watchdog to be stopped.
+ *
+ * @return  Non-zero if the watchdog cancelled the operation, zero otherwise.
+ *
+ */
+int stopWatchdog(Watchdog *watchdog)
+{
+   int fired = 0;
+
+   acquireLock(&watchdog->lock);
+   watchdog->done = 1;
+   signalCondition(&watchdog->finished);
+   releaseLock(&watchdog->lock);
+   joinThread(watchdog->thread);
+
+   fired = watchdog->fired;
+   destroyCondition(&watchdog->finished);
+   destroyLock(&watchdog->lock);
+   free(watchdog);
+
+   return(fired);
+}
+
+
+/**
+ * This function provides the body of a watchdog thread. The lock is held
+ * while the cancel is made so that an operation can't complete and be
+ * followed by another between the check and the cancel.
+ *
+ * @param  data  A pointer to the Watchdog structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *runWatchdog(void *data)
+{
+   Watchdog *watchdog = (Watchdog *)data;
+   double   deadline  = getCurrentTime() + (watchdog->timeout / 1000.0);
+
+   acquireLock(&watchdog->lock);
+   while(!watchdog->done)
+   {
+      long remaining = (long)((deadline - getCurrentTime()) * 1000.0);
+
+      if(remaining <= 0)
+      {
+         ISC_STATUS status[20];
+
+         fb_cancel_operation(status, watchdog->connection, fb_cancel_raise);
+         watchdog->fired = 1;
+         break;
+      }
+      waitOnCondition(&watchdog->finished, &watchdog->lock, remaining);
+   }
+   releaseLock(&watchdog->lock);
+
+   return(NULL);
+}
+#endif
+
+
 /**
 
  * This function provides a programmatic means of creating a Statement object.
@@ -1439,13 +1829,14 @@ void Init_Statement(VALUE module)
 
    rb_define_method(cStatement, "type", getStatementType, 0);
 
-   rb_define_method(cStatement, "execute", executeStatement, 0);
+   rb_define_method(cStatement, "execute", executeStatementWithOptions, -1);
 
    rb_define_method(cStatement, "execute_for", executeStatementFor, 1);
 
    rb_define_method(cStatement, "close", closeStatement, 0);
 
    rb_define_method(cStatement, "parameter_count", getStatementParameterCount, 0);
+   rb_define_method(cStatement, "plan", getStatementPlan, 0);
 
    
 
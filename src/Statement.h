@@ -50,11 +50,12 @@
    void prepare(isc_db_handle *, isc_tr_handle *, char *, isc_stmt_handle *,
                 short, int *, int *, int *);
    void execute(isc_tr_handle *, isc_stmt_handle *, short, XSQLDA *,
-                int, long *);
+                int, long *, isc_db_handle *, long);
    VALUE rb_statement_new(VALUE, VALUE, VALUE, VALUE);
    VALUE rb_execute_statement(VALUE);
    VALUE rb_execute_statement_for(VALUE, VALUE);
    VALUE rb_get_statement_type(VALUE);
+   VALUE getSQLPlan(isc_stmt_handle *);
    void rb_statement_close(VALUE);
    void statementFree(void *);
    void Init_Statement(VALUE);
@@ -0,0 +1,894 @@
+/*------------------------------------------------------------------------------
+ * Statistics.c
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "Statistics.h"
+#include "ibase.h"
+#include "ServiceManager.h"
+#include "Services.h"
+#include <ctype.h>
+#include <stdlib.h>
+
+/* Type definitions. */
+typedef struct
+{
+   VALUE header,
+         tables,
+         table,
+         target;
+   int   section;
+} StatisticsParse;
+
+/* Function prototypes. */
+static VALUE initializeStatistics(VALUE, VALUE);
+static VALUE getStatisticsDatabase(VALUE);
+static VALUE setStatisticsDatabase(VALUE, VALUE);
+static VALUE getStatisticsDataPages(VALUE);
+static VALUE setStatisticsDataPages(VALUE, VALUE);
+static VALUE getStatisticsIndexPages(VALUE);
+static VALUE setStatisticsIndexPages(VALUE, VALUE);
+static VALUE getStatisticsRecordVersions(VALUE);
+static VALUE setStatisticsRecordVersions(VALUE, VALUE);
+static VALUE getStatisticsSystemTables(VALUE);
+static VALUE setStatisticsSystemTables(VALUE, VALUE);
+static VALUE getStatisticsTableNames(VALUE);
+static VALUE setStatisticsTableNames(VALUE, VALUE);
+static VALUE executeStatistics(VALUE, VALUE);
+static VALUE getStatisticsHeader(VALUE);
+static VALUE getStatisticsTables(VALUE);
+static VALUE getStatisticsLog(VALUE);
+VALUE getStatisticsOption(VALUE, VALUE);
+VALUE setStatisticsOption(VALUE, VALUE, VALUE);
+void createStatisticsBuffer(VALUE, VALUE, VALUE, char **, short *);
+void parseStatistics(VALUE, StatisticsParse *);
+void parseStatisticsLine(StatisticsParse *, char *);
+void parseStatisticsPairs(StatisticsParse *, char *);
+VALUE toStatisticsKey(const char *, long);
+VALUE toStatisticsValue(char *, int);
+char *trimStatisticsText(char *);
+
+/* Globals. */
+VALUE cStatistics;
+
+/* Definitions. */
+#define DATA_PAGES            rb_str_new2("DATA_PAGES")
+#define INDEX_PAGES           rb_str_new2("INDEX_PAGES")
+#define RECORD_VERSIONS       rb_str_new2("RECORD_VERSIONS")
+#define SYSTEM_TABLES         rb_str_new2("SYSTEM_TABLES")
+#define NO_SECTION            0
+#define HEADER_SECTION        1
+#define PAGES_SECTION         2
+
+
+/**
+ * This function provides the initialize method for the Statistics class.
+ *
+ * @param  self      A reference to the Statistics object to be initialized.
+ * @param  database  A reference to a File or String containing the server path
+ *                   and name of the database to gather statistics for.
+ *
+ * @return  A reference to the newly initialized Statistics object.
+ *
+ */
+static VALUE initializeStatistics(VALUE self, VALUE database)
+{
+   VALUE options = rb_hash_new();
+
+   rb_hash_aset(options, DATA_PAGES, Qtrue);
+   rb_hash_aset(options, INDEX_PAGES, Qtrue);
+   setStatisticsDatabase(self, database);
+   rb_iv_set(self, "@options", options);
+   rb_iv_set(self, "@table_names", Qnil);
+   rb_iv_set(self, "@header", Qnil);
+   rb_iv_set(self, "@tables", Qnil);
+   rb_iv_set(self, "@log", Qnil);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the database attribute accessor for the Statistics
+ * class.
+ *
+ * @param  self  A reference to the Statistics object to make the call on.
+ *
+ * @return  A reference to a String containing the database file path/name.
+ *
+ */
+static VALUE getStatisticsDatabase(VALUE self)
+{
+   return(rb_iv_get(self, "@database"));
+}
+
+
+/**
+ * This function provides the database attribute mutator for the Statistics
+ * class.
+ *
+ * @param  self     A reference to the Statistics object to make the call on.
+ * @param  setting  A reference to a File or String containing the path and
+ *                  name of the database.
+ *
+ * @return  A reference to the Statistics object that has been updated.
+ *
+ */
+static VALUE setStatisticsDatabase(VALUE self, VALUE setting)
+{
+   if(TYPE(setting) == T_FILE)
+   {
+      rb_iv_set(self, "@database", rb_funcall(setting, rb_intern("path"), 0));
+   }
+   else
+   {
+      rb_iv_set(self, "@database", rb_funcall(setting, rb_intern("to_s"), 0));
+   }
+
+   return(self);
+}
+
+
+/**
+ * This function provides the data_pages attribute accessor for the Statistics
+ * class.
+ *
+ * @param  self  A reference to the Statistics object to make the call on.
+ *
+ * @return  Either true or false.
+ *
+ */
+static VALUE getStatisticsDataPages(VALUE self)
+{
+   return(getStatisticsOption(self, DATA_PAGES));
+}
+
+
+/**
+ * This function provides the data_pages attribute mutator for the Statistics
+ * class.
+ *
+ * @param  self     A reference to the Statistics object to make the call on.
+ * @param  setting  Either true or false. All other settings are ignored.
+ *
+ * @return  A reference to the Statistics object that has been updated.
+ *
+ */
+static VALUE setStatisticsDataPages(VALUE self, VALUE setting)
+{
+   return(setStatisticsOption(self, DATA_PAGES, setting));
+}
+
+
+/**
+ * This function provides the index_pages attribute accessor for the
+ * Statistics class.
+ *
+ * @param  self  A reference to the Statistics object to make the call on.
+ *
+ * @return  Either true or false.
+ *
+ */
+static VALUE getStatisticsIndexPages(VALUE self)
+{
+   return(getStatisticsOption(self, INDEX_PAGES));
+}
+
+
+/**
+ * This function provides the index_pages attribute mutator for the
+ * Statistics class.
+ *
+ * @param  self     A reference to the Statistics object to make the call on.
+ * @param  setting  Either true or false. All other settings are ignored.
+ *
+ * @return  A reference to the Statistics object that has been updated.
+ *
+ */
+static VALUE setStatisticsIndexPages(VALUE self, VALUE setting)
+{
+   return(setStatisticsOption(self, INDEX_PAGES, setting));
+}
+
+
+/**
+ * This function provides the record_versions attribute accessor for the
+ * Statistics class.
+ *
+ * @param  self  A reference to the Statistics object to make the call on.
+ *
+ * @return  Either true or false.
+ *
+ */
+static VALUE getStatisticsRecordVersions(VALUE self)
+{
+   return(getStatisticsOption(self, RECORD_VERSIONS));
+}
+
+
+/**
+ * This function provides the record_versions attribute mutator for the
+ * Statistics class.
+ *
+ * @param  self     A reference to the Statistics object to make the call on.
+ * @param  setting  Either true or false. All other settings are ignored.
+ *
+ * @return  A reference to the Statistics object that has been updated.
+ *
+ */
+static VALUE setStatisticsRecordVersions(VALUE self, VALUE setting)
+{
+   return(setStatisticsOption(self, RECORD_VERSIONS, setting));
+}
+
+
+/**
+ * This function provides the system_tables attribute accessor for the
+ * Statistics class.
+ *
+ * @param  self  A reference to the Statistics object to make the call on.
+ *
+ * @return  Either true or false.
+ *
+ */
+static VALUE getStatisticsSystemTables(VALUE self)
+{
+   return(getStatisticsOption(self, SYSTEM_TABLES));
+}
+
+
+/**
+ * This function provides the system_tables attribute mutator for the
+ * Statistics class.
+ *
+ * @param  self     A reference to the Statistics object to make the call on.
+ * @param  setting  Either true or false. All other settings are ignored.
+ *
+ * @return  A reference to the Statistics object that has been updated.
+ *
+ */
+static VALUE setStatisticsSystemTables(VALUE self, VALUE setting)
+{
+   return(setStatisticsOption(self, SYSTEM_TABLES, setting));
+}
+
+
+/**
+ * This function provides the table_names attribute accessor for the
+ * Statistics class.
+ *
+ * @param  self  A reference to the Statistics object to make the call on.
+ *
+ * @return  A reference to an Array of the names of the tables to gather
+ *          statistics for, or nil for all tables.
+ *
+ */
+static VALUE getStatisticsTableNames(VALUE self)
+{
+   return(rb_iv_get(self, "@table_names"));
+}
+
+
+/**
+ * This function provides the table_names attribute mutator for the
+ * Statistics class.
+ *
+ * @param  self     A reference to the Statistics object to make the call on.
+ * @param  setting  A reference to a String or an Array of Strings giving the
+ *                  names of the tables to gather statistics for, or nil for
+ *                  all tables.
+ *
+ * @return  A reference to the Statistics object that has been updated.
+ *
+ */
+static VALUE setStatisticsTableNames(VALUE self, VALUE setting)
+{
+   VALUE names = Qnil;
+
+   if(setting != Qnil)
+   {
+      VALUE entry = Qnil;
+      long  i;
+
+      if(TYPE(setting) != T_ARRAY)
+      {
+         setting = rb_ary_new3(1, setting);
+      }
+      names = rb_ary_new();
+      for(i = 0; (entry = rb_ary_entry(setting, i)) != Qnil; i++)
+      {
+         rb_ary_push(names, rb_funcall(entry, rb_intern("to_s"), 0));
+      }
+   }
+   rb_iv_set(self, "@table_names", names);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the execute method for the Statistics class. The
+ * statistics are gathered by the server and the text produced parsed into
+ * the header and tables attributes. Each line of the text is passed to the
+ * block, if one is given, as it is produced.
+ *
+ * @param  self     A reference to the Statistics object to be executed.
+ * @param  manager  A reference to the ServiceManager object that will be used
+ *                  to gather the statistics.
+ *
+ * @return  A reference to the Statistics object executed.
+ *
+ */
+static VALUE executeStatistics(VALUE self, VALUE manager)
+{
+   ManagerHandle   *handle = NULL;
+   short           length  = 0;
+   char            *buffer = NULL;
+   VALUE           log     = Qnil;
+   ISC_STATUS      status[20];
+   StatisticsParse parse;
+
+   /* Check that the service manager is connected. */
+   Data_Get_Struct(manager, ManagerHandle, handle);
+   if(handle->handle == 0)
+   {
+      rb_ibruby_raise(NULL,
+                      "Database statistics error. Service manager not "\
+                      "connected.");
+   }
+
+   createStatisticsBuffer(rb_iv_get(self, "@database"),
+                          rb_iv_get(self, "@options"),
+                          rb_iv_get(self, "@table_names"), &buffer, &length);
+
+   /* Start the service request. */
+   if(startService(status, &handle->handle, length, buffer))
+   {
+      free(buffer);
+      rb_ibruby_raise(status, "Error gathering database statistics.");
+   }
+   free(buffer);
+
+   /* Query the service until it has completed and parse the output. */
+   log = queryService(&handle->handle, Qnil);
+   memset(&parse, 0, sizeof(StatisticsParse));
+   parse.header = rb_hash_new();
+   parse.tables = rb_hash_new();
+   parse.table  = Qnil;
+   parse.target = Qnil;
+   if(log != Qnil)
+   {
+      parseStatistics(log, &parse);
+   }
+   rb_iv_set(self, "@log", log);
+   rb_iv_set(self, "@header", parse.header);
+   rb_iv_set(self, "@tables", parse.tables);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the header attribute accessor for the Statistics
+ * class.
+ *
+ * @param  self  A reference to the Statistics object to make the call on.
+ *
+ * @return  A reference to a Hash of the database header page details, or nil
+ *          if the statistics have not been gathered.
+ *
+ */
+static VALUE getStatisticsHeader(VALUE self)
+{
+   return(rb_iv_get(self, "@header"));
+}
+
+
+/**
+ * This function provides the tables attribute accessor for the Statistics
+ * class.
+ *
+ * @param  self  A reference to the Statistics object to make the call on.
+ *
+ * @return  A reference to a Hash of table statistics keyed on table name, or
+ *          nil if the statistics have not been gathered.
+ *
+ */
+static VALUE getStatisticsTables(VALUE self)
+{
+   return(rb_iv_get(self, "@tables"));
+}
+
+
+/**
+ * This function provides the log attribute accessor for the Statistics class.
+ *
+ * @param  self  A reference to the Statistics object to make the call on.
+ *
+ * @return  A reference to a String containing the text produced by the
+ *          server, or nil.
+ *
+ */
+static VALUE getStatisticsLog(VALUE self)
+{
+   return(rb_iv_get(self, "@log"));
+}
+
+
+/**
+ * This function fetches one of the boolean options of a Statistics object.
+ *
+ * @param  self  A reference to the Statistics object.
+ * @param  key   A reference to the option key.
+ *
+ * @return  Either true or false.
+ *
+ */
+VALUE getStatisticsOption(VALUE self, VALUE key)
+{
+   VALUE value = rb_hash_aref(rb_iv_get(self, "@options"), key);
+
+   return(value == Qtrue ? Qtrue : Qfalse);
+}
+
+
+/**
+ * This function updates one of the boolean options of a Statistics object.
+ *
+ * @param  self     A reference to the Statistics object.
+ * @param  key      A reference to the option key.
+ * @param  setting  Either true or false. All other settings are ignored.
+ *
+ * @return  A reference to the Statistics object.
+ *
+ */
+VALUE setStatisticsOption(VALUE self, VALUE key, VALUE setting)
+{
+   if(setting == Qtrue || setting == Qfalse)
+   {
+      rb_hash_aset(rb_iv_get(self, "@options"), key, setting);
+   }
+
+   return(self);
+}
+
+
+/**
+ * This function creates the service parameter buffer for a statistics
+ * request. If none of the page options are set then only the header page is
+ * analysed.
+ *
+ * @param  database  A reference to a String containing the path and name of
+ *                   the database.
+ * @param  options   A reference to the Hash of options.
+ * @param  names     A reference to an Array of table names or nil.
+ * @param  buffer    A pointer that will be set to the generated parameter
+ *                   buffer.
+ * @param  length    A pointer to a short integer that will be assigned the
+ *                   length of buffer.
+ *
+ */
+void createStatisticsBuffer(VALUE database, VALUE options, VALUE names,
+                            char **buffer, short *length)
+{
+   VALUE command   = Qnil;
+   long  mask      = 0;
+   char  *position = NULL;
+   short count     = 0;
+
+   if(rb_hash_aref(options, DATA_PAGES) == Qtrue)
+   {
+      mask |= isc_spb_sts_data_pages;
+   }
+   if(rb_hash_aref(options, INDEX_PAGES) == Qtrue)
+   {
+      mask |= isc_spb_sts_idx_pages;
+   }
+   if(rb_hash_aref(options, RECORD_VERSIONS) == Qtrue)
+   {
+      mask |= isc_spb_sts_record_versions;
+   }
+   if(rb_hash_aref(options, SYSTEM_TABLES) == Qtrue)
+   {
+      mask |= isc_spb_sts_sys_relations;
+   }
+   if(mask == 0)
+   {
+      mask = isc_spb_sts_hdr_pages;
+   }
+
+   if(names != Qnil && rb_ary_entry(names, 0) != Qnil)
+   {
+#if defined(FB_API_VER) && FB_API_VER >= 25
+      mask   |= isc_spb_sts_table;
+      command = rb_ary_join(names, rb_str_new2(" "));
+#else
+      rb_ibruby_raise(NULL,
+                      "Statistics for specific tables are not supported by "\
+                      "the client library.");
+#endif
+   }
+
+   /* Calculate the length needed for the buffer. */
+   *length = 1 + strlen(STR2CSTR(database)) + 3 + 5;
+   if(command != Qnil)
+   {
+      *length += strlen(STR2CSTR(command)) + 3;
+   }
+
+   /* Allocate the buffer. */
+   *buffer = position = ALLOC_N(char, *length);
+   if(*buffer == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation error preparing database statistics.");
+   }
+   memset(*buffer, 0, *length);
+
+   /* Populate the buffer. */
+   *position++ = isc_action_svc_db_stats;
+   *position++ = isc_spb_dbname;
+   count       = strlen(STR2CSTR(database));
+   ADD_SPB_LENGTH(position, count);
+   memcpy(position, STR2CSTR(database), count);
+   position   += count;
+   *position++ = isc_spb_options;
+   ADD_SPB_NUMERIC(position, mask);
+   if(command != Qnil)
+   {
+      *position++ = isc_spb_command_line;
+      count       = strlen(STR2CSTR(command));
+      ADD_SPB_LENGTH(position, count);
+      memcpy(position, STR2CSTR(command), count);
+   }
+}
+
+
+/**
+ * This function splits the text produced by a statistics request into lines
+ * and parses each of them in turn.
+ *
+ * @param  log    A reference to a String containing the text.
+ * @param  parse  A pointer to the StatisticsParse structure to be populated.
+ *
+ */
+void parseStatistics(VALUE log, StatisticsParse *parse)
+{
+   char *text  = NULL,
+        *start = NULL,
+        *end   = NULL;
+   long size   = strlen(STR2CSTR(log));
+
+   text = ALLOC_N(char, size + 1);
+   if(text == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation error parsing database statistics.");
+   }
+   memcpy(text, STR2CSTR(log), size + 1);
+
+   for(start = text; start != NULL; start = end)
+   {
+      end = strchr(start, '\n');
+      if(end != NULL)
+      {
+         *end++ = '\0';
+      }
+      parseStatisticsLine(parse, start);
+   }
+   free(text);
+}
+
+
+/**
+ * This function parses a single line of statistics text. The header page
+ * details are a name and value separated by tabs or spaces. A table begins
+ * with an unindented line of its name and relation id, an index within a
+ * table with a line starting 'Index', and the figures for either are lists
+ * of name: value pairs separated by commas, followed by a fill distribution.
+ *
+ * @param  parse  A pointer to the StatisticsParse structure being populated.
+ * @param  line   A pointer to the line, which will be modified.
+ *
+ */
+void parseStatisticsLine(StatisticsParse *parse, char *line)
+{
+   char *text    = trimStatisticsText(line),
+        *bracket = strrchr(text, '(');
+   long low      = 0,
+        high     = 0,
+        count    = 0;
+   int  indented = (text != line);
+
+   if(*text == '\0')
+   {
+      return;
+   }
+
+   if(strncmp(text, "Database header page information", 32) == 0)
+   {
+      parse->section = HEADER_SECTION;
+   }
+   else if(strncmp(text, "Variable header data", 20) == 0 ||
+           strncmp(text, "Database file sequence", 22) == 0)
+   {
+      parse->section = NO_SECTION;
+   }
+   else if(strncmp(text, "Analyzing database pages", 24) == 0)
+   {
+      parse->section = PAGES_SECTION;
+   }
+   else if(parse->section == HEADER_SECTION)
+   {
+      char *value = text;
+
+      while(*value != '\0' && *value != '\t' &&
+            !(value[0] == ' ' && value[1] == ' '))
+      {
+         value++;
+      }
+      rb_hash_aset(parse->header, toStatisticsKey(text, value - text),
+                   toStatisticsValue(trimStatisticsText(value), 0));
+   }
+   else if(parse->section == PAGES_SECTION)
+   {
+      if(!indented && bracket != NULL && bracket > text &&
+         text[strlen(text) - 1] == ')')
+      {
+         VALUE name = rb_str_new(text, bracket - text);
+
+         parse->table = rb_hash_new();
+         rb_hash_aset(parse->table, toSymbol("id"),
+                      LONG2NUM(atol(bracket + 1)));
+         rb_hash_aset(parse->table, toSymbol("indices"), rb_hash_new());
+         rb_hash_aset(parse->tables, rb_funcall(name, rb_intern("strip"), 0),
+                      parse->table);
+         parse->target = parse->table;
+      }
+      else if(strncmp(text, "Index ", 6) == 0 && parse->table != Qnil &&
+              bracket != NULL && bracket > text + 6)
+      {
+         VALUE name    = rb_str_new(text + 6, bracket - text - 6),
+               indices = rb_hash_aref(parse->table, toSymbol("indices"));
+
+         parse->target = rb_hash_new();
+         rb_hash_aset(parse->target, toSymbol("id"),
+                      LONG2NUM(atol(bracket + 1)));
+         rb_hash_aset(indices, rb_funcall(name, rb_intern("strip"), 0),
+                      parse->target);
+      }
+      else if(parse->target == Qnil)
+      {
+         return;
+      }
+      else if(strncmp(text, "Fill distribution", 17) == 0)
+      {
+         rb_hash_aset(parse->target, toSymbol("fill_distribution"),
+                      rb_ary_new());
+      }
+      else if(sscanf(text, "%ld - %ld%% = %ld", &low, &high, &count) == 3)
+      {
+         VALUE fill = rb_hash_aref(parse->target,
+                                   toSymbol("fill_distribution"));
+
+         if(fill != Qnil)
+         {
+            rb_ary_push(fill, LONG2NUM(count));
+         }
+      }
+      else if(strchr(text, ':') != NULL)
+      {
+         parseStatisticsPairs(parse, text);
+      }
+   }
+}
+
+
+/**
+ * This function parses a line of name: value pairs, separated by commas, into
+ * the table or index currently being parsed. Once the node and duplicate
+ * counts of an index are known its selectivity is added, this being one over
+ * the number of distinct key values.
+ *
+ * @param  parse  A pointer to the StatisticsParse structure being populated.
+ * @param  text   A pointer to the line text, which will be modified.
+ *
+ */
+void parseStatisticsPairs(StatisticsParse *parse, char *text)
+{
+   char  *pair = text,
+         *next = NULL;
+   VALUE nodes = Qnil,
+         dups  = Qnil;
+
+   for(; pair != NULL; pair = next)
+   {
+      char *colon = NULL;
+
+      next = strstr(pair, ", ");
+      if(next != NULL)
+      {
+         *next = '\0';
+         next += 2;
+      }
+
+      colon = strchr(pair, ':');
+      if(colon != NULL)
+      {
+         pair = trimStatisticsText(pair);
+         rb_hash_aset(parse->target, toStatisticsKey(pair, colon - pair),
+                      toStatisticsValue(trimStatisticsText(colon + 1), 1));
+      }
+   }
+
+   nodes = rb_hash_aref(parse->target, toSymbol("nodes"));
+   dups  = rb_hash_aref(parse->target, toSymbol("total_dup"));
+   if(FIXNUM_P(nodes) && FIXNUM_P(dups))
+   {
+      long distinct = FIX2LONG(nodes) - FIX2LONG(dups);
+
+      rb_hash_aset(parse->target, toSymbol("selectivity"),
+                   rb_float_new(distinct > 0 ? 1.0 / distinct : 0.0));
+   }
+}
+
+
+/**
+ * This function converts the name of a statistics figure into a Symbol, for
+ * example 'Oldest transaction' becomes :oldest_transaction.
+ *
+ * @param  name    A pointer to the name text.
+ * @param  length  The length of the name text.
+ *
+ * @return  A reference to the Symbol created.
+ *
+ */
+VALUE toStatisticsKey(const char *name, long length)
+{
+   VALUE symbol = Qnil;
+   char  *key   = ALLOC_N(char, length + 1);
+   long  size   = 0,
+         i;
+   int   split  = 0;
+
+   if(key == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation error parsing database statistics.");
+   }
+
+   for(i = 0; i < length; i++)
+   {
+      if(isalnum((unsigned char)name[i]))
+      {
+         if(split && size > 0)
+         {
+            key[size++] = '_';
+         }
+         key[size++] = tolower((unsigned char)name[i]);
+         split       = 0;
+      }
+      else
+      {
+         split = 1;
+      }
+   }
+   key[size] = '\0';
+   symbol    = toSymbol(key);
+   free(key);
+
+   return(symbol);
+}
+
+
+/**
+ * This function converts the text of a statistics figure into a value. Whole
+ * numbers, with or without a percent sign, become Integers, decimals become
+ * Floats if requested and anything else is left as a String.
+ *
+ * @param  text      A pointer to the figure text.
+ * @param  decimals  True to convert decimals to Floats, false to leave them
+ *                   as Strings (a version number such as 11.10 for example).
+ *
+ * @return  A reference to the value created.
+ *
+ */
+VALUE toStatisticsValue(char *text, int decimals)
+{
+   char   *end   = NULL;
+   long   whole  = strtol(text, &end, 10);
+   double number = 0.0;
+
+   if(end != text && (*end == '\0' || (*end == '%' && end[1] == '\0')))
+   {
+      return(LONG2NUM(whole));
+   }
+
+   number = strtod(text, &end);
+   if(decimals && end != text && *end == '\0')
+   {
+      return(rb_float_new(number));
+   }
+
+   return(rb_str_new2(text));
+}
+
+
+/**
+ * This function trims the white space from the start and end of a piece of
+ * text.
+ *
+ * @param  text  A pointer to the text, which will be modified.
+ *
+ * @return  A pointer to the first character of the trimmed text.
+ *
+ */
+char *trimStatisticsText(char *text)
+{
+   char *end = NULL;
+
+   while(isspace((unsigned char)*text))
+   {
+      text++;
+   }
+   end = text + strlen(text);
+   while(end > text && isspace((unsigned char)end[-1]))
+   {
+      *--end = '\0';
+   }
+
+   return(text);
+}
+
+
+/**
+ * This function initialize the Statistics class in the Ruby environment.
+ *
+ * @param  module  The module to create the new class definition under.
+ *
+ */
+void Init_Statistics(VALUE module)
+{
+   cStatistics = rb_define_class_under(module, "Statistics", rb_cObject);
+   rb_define_method(cStatistics, "initialize", initializeStatistics, 1);
+   rb_define_method(cStatistics, "database", getStatisticsDatabase, 0);
+   rb_define_method(cStatistics, "database=", setStatisticsDatabase, 1);
+   rb_define_method(cStatistics, "data_pages", getStatisticsDataPages, 0);
+   rb_define_method(cStatistics, "data_pages=", setStatisticsDataPages, 1);
+   rb_define_method(cStatistics, "index_pages", getStatisticsIndexPages, 0);
+   rb_define_method(cStatistics, "index_pages=", setStatisticsIndexPages, 1);
+   rb_define_method(cStatistics, "record_versions",
+                    getStatisticsRecordVersions, 0);
+   rb_define_method(cStatistics, "record_versions=",
+                    setStatisticsRecordVersions, 1);
+   rb_define_method(cStatistics, "system_tables", getStatisticsSystemTables, 0);
+   rb_define_method(cStatistics, "system_tables=", setStatisticsSystemTables,
+                    1);
+   rb_define_method(cStatistics, "table_names", getStatisticsTableNames, 0);
+   rb_define_method(cStatistics, "table_names=", setStatisticsTableNames, 1);
+   rb_define_method(cStatistics, "execute", executeStatistics, 1);
+   rb_define_method(cStatistics, "header", getStatisticsHeader, 0);
+   rb_define_method(cStatistics, "tables", getStatisticsTables, 0);
+   rb_define_method(cStatistics, "log", getStatisticsLog, 0);
+}
@@ -0,0 +1,835 @@
+/*------------------------------------------------------------------------------
+ * Threads.c
+ *------------------------------------------------------------------------------
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "Threads.h"
+#ifdef HAVE_RUBY_THREAD_H
+   #include <ruby/thread.h>
+#endif
+#ifdef HAVE_RUBY_FIBER_SCHEDULER_H
+   #include <ruby/fiber/scheduler.h>
+#endif
+
+#ifdef HAVE_RUBY_RACTOR_H
+   #include <ruby/ractor.h>
+#endif
+#ifndef OS_WIN32
+   #include <sys/time.h>
+   #include <errno.h>
+#endif
+
+/* Type definitions. */
+#ifdef HAVE_RUBY_FIBER_SCHEDULER_H
+typedef struct ClientJob
+{
+   IBRubyBlockingFunction function;
+   void                   *data,
+                          *result;
+   int                    state,
+                          abandoned,
+                          blocked;
+   VALUE                  scheduler,
+                          blocker,
+                          fiber;
+   struct ClientQueue     *queue;
+   struct ClientJob       *next;
+} ClientJob;
+
+typedef struct ClientQueue
+{
+   IBRubyLock      lock;
+   IBRubyCondition ready,
+                   done;
+   ClientJob       *first,
+                   *last;
+   long            workers;
+} ClientQueue;
+
+typedef struct
+{
+   ClientQueue *queue;
+   VALUE       details[3];
+   int         taken,
+               abandoned,
+               blocked;
+} WorkerTask;
+#endif
+
+#ifdef OS_WIN32
+typedef struct
+{
+   IBRubyBlockingFunction function;
+   void                   *data;
+} ThreadStart;
+#endif
+
+/* Function prototypes. */
+#ifdef OS_WIN32
+static DWORD WINAPI threadEntry(LPVOID);
+#endif
+#ifdef HAVE_RUBY_FIBER_SCHEDULER_H
+ClientQueue *getClientQueue(void);
+void freeClientQueue(void *);
+void *callOnWorker(VALUE, IBRubyBlockingFunction, void *);
+VALUE waitForClientJob(VALUE);
+VALUE finishClientJob(VALUE);
+VALUE runClientWorker(void *);
+VALUE unblockClientJob(VALUE);
+void *takeClientJob(void *);
+void *waitForAbandonedJob(void *);
+void wakeClientWorkers(void *);
+#endif
+
+/* Globals. */
+#ifdef HAVE_RUBY_FIBER_SCHEDULER_H
+#ifdef HAVE_RUBY_RACTOR_H
+static rb_ractor_local_key_t queueKey;
+static const struct rb_ractor_local_storage_type queueType =
+{
+   NULL,
+   freeClientQueue
+};
+#else
+static ClientQueue           mainQueue;
+#endif
+#endif
+
+
+/**
+ * This function initializes a native lock.
+ *
+ * @param  lock  A pointer to the lock to be initialized.
+ *
+ */
+void initializeLock(IBRubyLock *lock)
+{
+#ifdef OS_WIN32
+   InitializeCriticalSection(lock);
+#else
+   pthread_mutex_init(lock, NULL);
+#endif
+}
+
+
+/**
+ * This function releases the resources held by a native lock.
+ *
+ * @param  lock  A pointer to the lock to be destroyed.
+ *
+ */
+void destroyLock(IBRubyLock *lock)
+{
+#ifdef OS_WIN32
+   DeleteCriticalSection(lock);
+#else
+   pthread_mutex_destroy(lock);
+#endif
+}
+
+
+/**
+ * This function acquires a native lock, waiting for it if necessary.
+ *
+ * @param  lock  A pointer to the lock to be acquired.
+ *
+ */
+void acquireLock(IBRubyLock *lock)
+{
+#ifdef OS_WIN32
+   EnterCriticalSection(lock);
+#else
+   pthread_mutex_lock(lock);
+#endif
+}
+
+
+/**
+ * This function releases a native lock.
+ *
+ * @param  lock  A pointer to the lock to be released.
+ *
+ */
+void releaseLock(IBRubyLock *lock)
+{
+#ifdef OS_WIN32
+   LeaveCriticalSection(lock);
+#else
+   pthread_mutex_unlock(lock);
+#endif
+}
+
+
+/**
+ * This function initializes a native condition variable.
+ *
+ * @param  condition  A pointer to the condition to be initialized.
+ *
+ */
+void initializeCondition(IBRubyCondition *condition)
+{
+#ifdef OS_WIN32
+   InitializeConditionVariable(condition);
+#else
+   pthread_cond_init(condition, NULL);
+#endif
+}
+
+
+/**
+ * This function releases the resources held by a native condition variable.
+ *
+ * @param  condition  A pointer to the condition to be destroyed.
+ *
+ */
+void destroyCondition(IBRubyCondition *condition)
+{
+#ifndef OS_WIN32
+   pthread_cond_destroy(condition);
+#endif
+}
+
+
+/**
+ * This function waits on a condition variable for a limited period. The lock
+ * must be held by the caller and is held again when the function returns.
+ *
+ * @param  condition     A pointer to the condition to wait on.
+ * @param  lock          A pointer to the lock associated with the condition.
+ * @param  milliseconds  The longest time to wait for, in milliseconds.
+ *
+ * @return  0 if the condition was signalled, 1 if the wait timed out.
+ *
+ */
+int waitOnCondition(IBRubyCondition *condition, IBRubyLock *lock,
+                    long milliseconds)
+{
+   int result = 0;
+#ifdef OS_WIN32
+   if(!SleepConditionVariableCS(condition, lock, (DWORD)milliseconds))
+   {
+      result = 1;
+   }
+#else
+   struct timeval  now;
+   struct timespec until;
+
+   gettimeofday(&now, NULL);
+   until.tv_sec  = now.tv_sec + (milliseconds / 1000);
+   until.tv_nsec = (now.tv_usec * 1000) + ((milliseconds % 1000) * 1000000);
+   if(until.tv_nsec >= 1000000000)
+   {
+      until.tv_sec  += 1;
+      until.tv_nsec -= 1000000000;
+   }
+   if(pthread_cond_timedwait(condition, lock, &until) == ETIMEDOUT)
+   {
+      result = 1;
+   }
+#endif
+
+   return(result);
+}
+
+
+/**
+ * This function wakes a single thread waiting on a condition variable.
+ *
+ * @param  condition  A pointer to the condition to be signalled.
+ *
+ */
+void signalCondition(IBRubyCondition *condition)
+{
+#ifdef OS_WIN32
+   WakeConditionVariable(condition);
+#else
+   pthread_cond_signal(condition);
+#endif
+}
+
+
+/**
+ * This function wakes all of the threads waiting on a condition variable.
+ *
+ * @param  condition  A pointer to the condition to be signalled.
+ *
+ */
+void broadcastCondition(IBRubyCondition *condition)
+{
+#ifdef OS_WIN32
+   WakeAllConditionVariable(condition);
+#else
+   pthread_cond_broadcast(condition);
+#endif
+}
+
+
+/**
+ * This function starts a native thread. The function run by the thread must
+ * not make any calls into the Ruby interpreter and this function may itself
+ * be called without holding the interpreter lock.
+ *
+ * @param  thread    A pointer to the location to store the thread details in.
+ * @param  function  A pointer to the function to be run by the thread.
+ * @param  data      A pointer to be passed to the function.
+ *
+ * @return  0 if the thread was started, non-zero otherwise.
+ *
+ */
+int startThread(IBRubyThread *thread, IBRubyBlockingFunction function,
+                void *data)
+{
+   int result = 0;
+#ifdef OS_WIN32
+   ThreadStart *start = (ThreadStart *)malloc(sizeof(ThreadStart));
+
+   *thread = NULL;
+   if(start != NULL)
+   {
+      start->function = function;
+      start->data     = data;
+      *thread         = CreateThread(NULL, 0, threadEntry, start, 0, NULL);
+   }
+   if(*thread == NULL)
+   {
+      free(start);
+      result = 1;
+   }
+#else
+   result = pthread_create(thread, NULL, function, data);
+#endif
+
+   return(result);
+}
+
+
+/**
+ * This function waits for a native thread started with startThread to finish.
+ *
+ * @param  thread  The thread to wait for.
+ *
+ */
+void joinThread(IBRubyThread thread)
+{
+#ifdef OS_WIN32
+   WaitForSingleObject(thread, INFINITE);
+   CloseHandle(thread);
+#else
+   pthread_join(thread, NULL);
+#endif
+}
+
+
+/**
+ * This function releases a native thread started with startThread without
+ * waiting for it. The thread carries on running and its resources are
+ * released when it finishes.
+ *
+ * @param  thread  The thread to be released.
+ *
+ */
+void detachThread(IBRubyThread thread)
+{
+#ifdef OS_WIN32
+   CloseHandle(thread);
+#else
+   pthread_detach(thread);
+#endif
+}
+
+
+/**
+ * This function fetches the current time as a number of seconds, with a
+ * fractional part, for use in measuring elapsed times.
+ *
+ * @return  The current time in seconds.
+ *
+ */
+double getCurrentTime(void)
+{
+#ifdef OS_WIN32
+   return((double)GetTickCount() / 1000.0);
+#else
+   struct timeval now;
+
+   gettimeofday(&now, NULL);
+   return((double)now.tv_sec + ((double)now.tv_usec / 1000000.0));
+#endif
+}
+
+
+/**
+ * This function calls a function that may block for some time in the client
+ * library. Where the interpreter supports it the global interpreter lock is
+ * released for the duration of the call so that other Ruby threads can run.
+ * Otherwise the function is simply called. The function must not make any
+ * calls into the Ruby interpreter.
+ *
+ * @param  function  A pointer to the function to be called.
+ * @param  data      A pointer to be passed to the function.
+ * @param  unblock   A pointer to a function that can be called from another
+ *                   thread to make the blocking call return early. May be
+ *                   NULL.
+ * @param  argument  A pointer to be passed to the unblock function.
+ *
+ * @return  The value returned by the called function.
+ *
+ */
+void *callBlocking(IBRubyBlockingFunction function, void *data,
+                   IBRubyUnblockFunction unblock, void *argument)
+{
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+   return(rb_thread_call_without_gvl(function, data, unblock, argument));
+#else
+   return(function(data));
+#endif
+}
+
+
+/**
+ * This function makes a call into the client library on behalf of a Ruby
+ * method. When the calling Fiber is running under a Fiber scheduler, and the
+ * NON_BLOCKING_EXECUTION setting is on, the call is handed to one of a small
+ * set of worker threads and the Fiber is suspended through the scheduler
+ * until it completes, leaving the scheduler free to run other Fibers. In all
+ * other cases the call is made through callBlocking.
+ *
+ * @param  function  A pointer to the function to be called. The function
+ *                   must not make any calls into the Ruby interpreter.
+ * @param  data      A pointer to be passed to the function.
+ * @param  unblock   A pointer to a function that can be called from another
+ *                   thread to make the call return early. May be NULL.
+ * @param  argument  A pointer to be passed to the unblock function.
+ *
+ * @return  The value returned by the called function.
+ *
+ */
+void *callClient(IBRubyBlockingFunction function, void *data,
+                 IBRubyUnblockFunction unblock, void *argument)
+{
+#ifdef HAVE_RUBY_FIBER_SCHEDULER_H
+   VALUE scheduler = rb_fiber_scheduler_current();
+
+   if(scheduler != Qnil &&
+      getIBRubySetting("NON_BLOCKING_EXECUTION") == Qtrue)
+   {
+      return(callOnWorker(scheduler, function, data));
+   }
+#endif
+
+   return(callBlocking(function, data, unblock, argument));
+}
+
+
+/**
+ * This function initializes the thread support for the library.
+ *
+ * @param  module  A reference to the library module.
+ *
+ */
+void Init_Threads(VALUE module)
+{
+#ifdef HAVE_RUBY_FIBER_SCHEDULER_H
+#ifdef HAVE_RUBY_RACTOR_H
+   queueKey = rb_ractor_local_storage_ptr_newkey(&queueType);
+#else
+   memset(&mainQueue, 0, sizeof(ClientQueue));
+   initializeLock(&mainQueue.lock);
+   initializeCondition(&mainQueue.ready);
+   initializeCondition(&mainQueue.done);
+#endif
+#endif
+}
+
+
+#ifdef HAVE_RUBY_FIBER_SCHEDULER_H
+/**
+ * This function fetches the client job queue for the current Ractor. Each
+ * Ractor has its own queue and workers as the workers wake the Fibers that
+ * queued the jobs, which must happen within the Ractor that owns them.
+ *
+ * @return  A pointer to the ClientQueue for the current Ractor.
+ *
+ */
+ClientQueue *getClientQueue(void)
+{
+#ifdef HAVE_RUBY_RACTOR_H
+   ClientQueue *queue = (ClientQueue *)rb_ractor_local_storage_ptr(queueKey);
+
+   if(queue == NULL)
+   {
+      queue = ALLOC(ClientQueue);
+      memset(queue, 0, sizeof(ClientQueue));
+      initializeLock(&queue->lock);
+      initializeCondition(&queue->ready);
+      initializeCondition(&queue->done);
+      rb_ractor_local_storage_ptr_set(queueKey, queue);
+   }
+
+   return(queue);
+#else
+   return(&mainQueue);
+#endif
+}
+
+
+/**
+ * This function releases a client job queue when the Ractor that owns it is
+ * freed.
+ *
+ * @param  data  A pointer to the ClientQueue to be released.
+ *
+ */
+void freeClientQueue(void *data)
+{
+   ClientQueue *queue = (ClientQueue *)data;
+
+   destroyCondition(&queue->done);
+   destroyCondition(&queue->ready);
+   destroyLock(&queue->lock);
+   free(queue);
+}
+
+
+/**
+ * This function queues a client call for the worker threads of the current
+ * Ractor and suspends the current Fiber until it has been made. Worker
+ * threads are started as needed up to the CLIENT_WORKER_THREADS setting.
+ *
+ * @param  scheduler  A reference to the current Fiber scheduler.
+ * @param  function   A pointer to the function to be called.
+ * @param  data       A pointer to be passed to the function.
+ *
+ * @return  The value returned by the called function.
+ *
+ */
+void *callOnWorker(VALUE scheduler, IBRubyBlockingFunction function,
+                   void *data)
+{
+   ClientJob   job;
+   ClientQueue *queue = getClientQueue();
+   VALUE       limit  = getIBRubySetting("CLIENT_WORKER_THREADS");
+
+   job.function  = function;
+   job.data      = data;
+   job.result    = NULL;
+   job.state     = 0;
+   job.abandoned = 0;
+   job.blocked   = 0;
+   job.scheduler = scheduler;
+   job.blocker   = rb_obj_alloc(rb_cObject);
+   job.fiber     = rb_fiber_current();
+   job.queue     = queue;
+   job.next      = NULL;
+
+   if(queue->workers == 0 ||
+      queue->workers < (limit != Qnil ? NUM2LONG(limit) : 4))
+   {
+      rb_thread_create(runClientWorker, queue);
+      queue->workers++;
+   }
+
+   acquireLock(&queue->lock);
+   if(queue->last != NULL)
+   {
+      queue->last->next = &job;
+   }
+   else
+   {
+      queue->first = &job;
+   }
+   queue->last = &job;
+   signalCondition(&queue->ready);
+   releaseLock(&queue->lock);
+
+   rb_ensure(waitForClientJob, (VALUE)&job, finishClientJob, (VALUE)&job);
+
+   return(job.result);
+}
+
+
+/**
+ * This function suspends the current Fiber until a client job is complete.
+ * The job is flagged as blocked, under the queue lock, just before the Fiber
+ * blocks so that the worker only unblocks a Fiber that is waiting on the job.
+ * A job that completes before the Fiber checks it is never blocked on.
+ *
+ * @param  data  A pointer to the ClientJob being waited on.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE waitForClientJob(VALUE data)
+{
+   ClientJob   *job   = (ClientJob *)data;
+   ClientQueue *queue = job->queue;
+   int         done   = 0;
+
+   while(!done)
+   {
+      acquireLock(&queue->lock);
+      done         = (job->state == 2);
+      job->blocked = !done;
+      releaseLock(&queue->lock);
+
+      if(!done)
+      {
+         rb_fiber_scheduler_block(job->scheduler, job->blocker, Qnil);
+         acquireLock(&queue->lock);
+         job->blocked = 0;
+         releaseLock(&queue->lock);
+      }
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function makes sure a client job is no longer referenced by the
+ * workers before the Fiber that queued it moves on. This matters if the
+ * Fiber is interrupted while waiting as the job lives on its stack. A job
+ * that has not started is removed from the queue, otherwise the call waits
+ * for the job to finish.
+ *
+ * @param  data  A pointer to the ClientJob.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE finishClientJob(VALUE data)
+{
+   ClientJob   *job    = (ClientJob *)data;
+   ClientQueue *queue  = job->queue;
+   int         running = 0;
+
+   acquireLock(&queue->lock);
+   if(job->state == 0)
+   {
+      ClientJob *entry    = queue->first,
+                *previous = NULL;
+
+      while(entry != NULL && entry != job)
+      {
+         previous = entry;
+         entry    = entry->next;
+      }
+      if(entry != NULL)
+      {
+         if(previous != NULL)
+         {
+            previous->next = job->next;
+         }
+         else
+         {
+            queue->first = job->next;
+         }
+         if(queue->last == job)
+         {
+            queue->last = previous;
+         }
+      }
+      job->state = 2;
+   }
+   else if(job->state == 1)
+   {
+      job->abandoned = 1;
+      running        = 1;
+   }
+   releaseLock(&queue->lock);
+
+   if(running)
+   {
+      callBlocking(waitForAbandonedJob, job, NULL, NULL);
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function provides the body of a client worker thread. Each worker is
+ * a Ruby thread that makes client calls with the interpreter lock released
+ * and then wakes the Fiber that queued the call.
+ *
+ * @param  data  A pointer to the ClientQueue the worker takes jobs from.
+ *
+ * @return  Never returns normally.
+ *
+ */
+VALUE runClientWorker(void *data)
+{
+   for(;;)
+   {
+      WorkerTask task;
+
+      task.queue   = (ClientQueue *)data;
+      task.taken   = 0;
+      task.blocked = 0;
+      callBlocking(takeClientJob, &task, wakeClientWorkers, data);
+      if(task.taken && !task.abandoned && task.blocked)
+      {
+         int state = 0;
+
+         rb_protect(unblockClientJob, (VALUE)task.details, &state);
+      }
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function wakes the Fiber waiting on a completed client job.
+ *
+ * @param  data  A pointer to an array holding the scheduler, the blocker and
+ *               the Fiber.
+ *
+ * @return  The value returned by the scheduler.
+ *
+ */
+VALUE unblockClientJob(VALUE data)
+{
+   VALUE *details = (VALUE *)data;
+
+   return(rb_fiber_scheduler_unblock(details[0], details[1], details[2]));
+}
+
+
+/**
+ * This function takes the next job from the client job queue, waiting a
+ * while for one to arrive, and runs it. It is called without the interpreter
+ * lock. The details needed to wake the Fiber that queued the job, and whether
+ * the Fiber is blocked waiting on it, are copied out before the job is marked
+ * complete as the job may be gone after that.
+ *
+ * @param  data  A pointer to the WorkerTask to record the job details in.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *takeClientJob(void *data)
+{
+   WorkerTask  *task  = (WorkerTask *)data;
+   ClientQueue *queue = task->queue;
+   ClientJob   *job   = NULL;
+
+   acquireLock(&queue->lock);
+   if(queue->first == NULL)
+   {
+      waitOnCondition(&queue->ready, &queue->lock, 1000);
+   }
+   if(queue->first != NULL)
+   {
+      job          = queue->first;
+      queue->first = job->next;
+      if(queue->first == NULL)
+      {
+         queue->last = NULL;
+      }
+      job->state = 1;
+   }
+   releaseLock(&queue->lock);
+
+   if(job != NULL)
+   {
+      job->result = job->function(job->data);
+
+      acquireLock(&queue->lock);
+      task->details[0] = job->scheduler;
+      task->details[1] = job->blocker;
+      task->details[2] = job->fiber;
+      task->abandoned  = job->abandoned;
+      task->blocked    = job->blocked;
+      task->taken      = 1;
+      job->state       = 2;
+      broadcastCondition(&queue->done);
+      releaseLock(&queue->lock);
+   }
+
+   return(NULL);
+}
+
+
+/**
+ * This function waits, without the interpreter lock, for a running client
+ * job to complete.
+ *
+ * @param  data  A pointer to the ClientJob.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *waitForAbandonedJob(void *data)
+{
+   ClientJob *job = (ClientJob *)data;
+
+   acquireLock(&job->queue->lock);
+   while(job->state != 2)
+   {
+      waitOnCondition(&job->queue->done, &job->queue->lock, 1000);
+   }
+   releaseLock(&job->queue->lock);
+
+   return(NULL);
+}
+
+
+/**
+ * This function is called by the interpreter to interrupt idle worker
+ * threads, such as when the interpreter is shutting down.
+ *
+ * @param  data  A pointer to the ClientQueue the workers take jobs from.
+ *
+ */
+void wakeClientWorkers(void *data)
+{
+   ClientQueue *queue = (ClientQueue *)data;
+
+   acquireLock(&queue->lock);
+   broadcastCondition(&queue->ready);
+   releaseLock(&queue->lock);
+}
+#endif
+
+
+#ifdef OS_WIN32
+/**
+ * This function provides the entry point for threads started on Windows.
+ *
+ * @param  parameter  A pointer to the ThreadStart structure for the thread.
+ *
+ * @return  Always 0.
+ *
+ */
+static DWORD WINAPI threadEntry(LPVOID parameter)
+{
+   ThreadStart *start = (ThreadStart *)parameter;
+
+   start->function(start->data);
+   free(start);
+
+   return(0);
+}
+#endif
@@ -0,0 +1,73 @@
+/*------------------------------------------------------------------------------
+ * Threads.h
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ * 
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at 
+ *
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ * 
+ * The Original Code is the FireRuby extension for the Ruby language.
+ * 
+ * The Initial Developer of the Original Code is Peter Wood. All Rights 
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+#ifndef IBRUBY_THREADS_H
+#define IBRUBY_THREADS_H
+
+   /* Includes. */
+   #ifndef IBRUBY_FIRE_RUBY_H
+      #include "IBRuby.h"
+   #endif
+
+   #ifdef OS_WIN32
+      #include <windows.h>
+   #else
+      #include <pthread.h>
+   #endif
+
+   /* Type definitions. */
+   #ifdef OS_WIN32
+      typedef CRITICAL_SECTION   IBRubyLock;
+      typedef CONDITION_VARIABLE IBRubyCondition;
+      typedef HANDLE             IBRubyThread;
+   #else
+      typedef pthread_mutex_t    IBRubyLock;
+      typedef pthread_cond_t     IBRubyCondition;
+      typedef pthread_t          IBRubyThread;
+   #endif
+
+   typedef void *(*IBRubyBlockingFunction)(void *);
+   typedef void (*IBRubyUnblockFunction)(void *);
+
+   /* Function prototypes. */
+   void initializeLock(IBRubyLock *);
+   void destroyLock(IBRubyLock *);
+   void acquireLock(IBRubyLock *);
+   void releaseLock(IBRubyLock *);
+   void initializeCondition(IBRubyCondition *);
+   void destroyCondition(IBRubyCondition *);
+   int waitOnCondition(IBRubyCondition *, IBRubyLock *, long);
+   void signalCondition(IBRubyCondition *);
+   void broadcastCondition(IBRubyCondition *);
+   int startThread(IBRubyThread *, IBRubyBlockingFunction, void *);
+   void joinThread(IBRubyThread);
+   void detachThread(IBRubyThread);
+   double getCurrentTime(void);
+   void *callBlocking(IBRubyBlockingFunction, void *, IBRubyUnblockFunction,
+                      void *);
+   void *callClient(IBRubyBlockingFunction, void *, IBRubyUnblockFunction,
+                    void *);
+   void Init_Threads(VALUE);
+
+#endif /* IBRUBY_THREADS_H */
@@ -0,0 +1,946 @@
+/*------------------------------------------------------------------------------
+ * TraceSession.c
+ *----------------------------------------------------------------------------*/
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "TraceSession.h"
+#include "ibase.h"
+#include "ServiceManager.h"
+#include "Services.h"
+#include <ctype.h>
+#include <stdlib.h>
+
+/* Type definitions. */
+typedef struct
+{
+   VALUE self,
+         event,
+         columns;
+   long  nameEnd;
+   int   section;
+} TraceParse;
+
+typedef struct
+{
+   VALUE         manager;
+   ManagerHandle *handle;
+   TraceParse    parse;
+   int           size,
+                 finished;
+} TraceRun;
+
+/* Function prototypes. */
+static VALUE initializeTraceSession(int, VALUE *, VALUE);
+static VALUE getTraceSessionConfig(VALUE);
+static VALUE getTraceSessionName(VALUE);
+static VALUE getTraceSessionId(VALUE);
+static VALUE startTraceSession(VALUE, VALUE);
+static VALUE stopTraceSession(VALUE, VALUE);
+static VALUE suspendTraceSession(VALUE, VALUE);
+static VALUE resumeTraceSession(VALUE, VALUE);
+VALUE readTraceSession(VALUE);
+VALUE traceSessionEnsure(VALUE);
+VALUE endTraceSession(VALUE);
+VALUE ignoreTraceError(VALUE, VALUE);
+ManagerHandle *getTraceManager(VALUE);
+void controlTraceSession(VALUE, VALUE, char, const char *);
+void createTraceBuffer(VALUE, VALUE, char **, short *);
+void parseTraceLine(TraceParse *, VALUE);
+void parseTraceHeader(TraceParse *, char *);
+void parseTraceAttachment(TraceParse *, char *);
+void parseTracePerformance(TraceParse *, char *);
+void parseTraceColumns(TraceParse *, char *);
+void parseTraceTable(TraceParse *, char *);
+void addTraceText(VALUE, const char *, const char *);
+void flushTraceEvent(TraceParse *);
+int isTraceHeader(const char *);
+char *trimTraceText(char *);
+
+/* Globals. */
+VALUE cTraceSession;
+
+/* Definitions. */
+#define TRACE_NONE            0
+#define TRACE_SQL             1
+#define TRACE_PLAN            2
+#define TRACE_TABLES          3
+
+
+/**
+ * This function provides the initialize method for the TraceSession class.
+ *
+ * @param  argc  A count of the number of arguments passed to the method.
+ * @param  argv  A pointer to the method arguments. These are the trace
+ *               configuration text and an optional name for the session.
+ * @param  self  A reference to the TraceSession object being initialized.
+ *
+ * @return  A reference to the newly initialized TraceSession object.
+ *
+ */
+static VALUE initializeTraceSession(int argc, VALUE *argv, VALUE self)
+{
+   if(argc < 1 || argc > 2)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               argc < 1 ? 1 : 2);
+   }
+
+   rb_iv_set(self, "@config", rb_funcall(argv[0], rb_intern("to_s"), 0));
+   rb_iv_set(self, "@name", argc > 1 && argv[1] != Qnil ?
+                            rb_funcall(argv[1], rb_intern("to_s"), 0) : Qnil);
+   rb_iv_set(self, "@id", Qnil);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the config attribute accessor for the TraceSession
+ * class.
+ *
+ * @param  self  A reference to the TraceSession object to make the call on.
+ *
+ * @return  A reference to a String containing the trace configuration.
+ *
+ */
+static VALUE getTraceSessionConfig(VALUE self)
+{
+   return(rb_iv_get(self, "@config"));
+}
+
+
+/**
+ * This function provides the name attribute accessor for the TraceSession
+ * class.
+ *
+ * @param  self  A reference to the TraceSession object to make the call on.
+ *
+ * @return  A reference to a String containing the session name, or nil.
+ *
+ */
+static VALUE getTraceSessionName(VALUE self)
+{
+   return(rb_iv_get(self, "@name"));
+}
+
+
+/**
+ * This function provides the id attribute accessor for the TraceSession
+ * class.
+ *
+ * @param  self  A reference to the TraceSession object to make the call on.
+ *
+ * @return  A reference to an Integer containing the id the server gave the
+ *          session, or nil if it has not been started.
+ *
+ */
+static VALUE getTraceSessionId(VALUE self)
+{
+   return(rb_iv_get(self, "@id"));
+}
+
+
+/**
+ * This function provides the start method for the TraceSession class. The
+ * trace is started on the service manager and its output read, with the
+ * interpreter lock released, until the session is stopped. Each event in the
+ * output is parsed into a Hash and passed to the block. Should the block be
+ * left early, by an exception or a break, the trace is ended and the service
+ * manager reconnected so that it is free for other use.
+ *
+ * @param  self     A reference to the TraceSession object to make the call
+ *                  on.
+ * @param  manager  A reference to the ServiceManager to run the trace on. This
+ *                  is occupied until the session stops.
+ *
+ * @return  A reference to the TraceSession object.
+ *
+ */
+static VALUE startTraceSession(VALUE self, VALUE manager)
+{
+   ManagerHandle *handle = getTraceManager(manager);
+   TraceRun      run;
+   char          *buffer = NULL;
+   short         length  = 0;
+   ISC_STATUS    status[20];
+
+   if(!rb_block_given_p())
+   {
+      rb_ibruby_raise(NULL, "No block specified for trace session events.");
+   }
+
+   createTraceBuffer(rb_iv_get(self, "@config"), rb_iv_get(self, "@name"),
+                     &buffer, &length);
+   if(startService(status, &handle->handle, length, buffer))
+   {
+      free(buffer);
+      rb_ibruby_raise(status, "Error starting trace session.");
+   }
+   free(buffer);
+
+   memset(&run, 0, sizeof(TraceRun));
+   run.manager       = manager;
+   run.handle        = handle;
+   run.parse.self    = self;
+   run.parse.event   = Qnil;
+   run.parse.columns = Qnil;
+   rb_ensure(readTraceSession, (VALUE)&run, traceSessionEnsure, (VALUE)&run);
+
+   return(self);
+}
+
+
+/**
+ * This function reads the output of a running trace session, passing each
+ * event to the block, until the session is stopped.
+ *
+ * @param  data  A pointer to the TraceRun structure, cast to a VALUE.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE readTraceSession(VALUE data)
+{
+   TraceRun *run = (TraceRun *)data;
+
+   while(!run->finished)
+   {
+      VALUE lines = rb_ary_new(),
+            line  = Qnil;
+
+      run->finished = readServiceLines(&run->handle->handle, lines,
+                                       &run->size);
+      if(rb_ary_entry(lines, 0) == Qnil)
+      {
+         /* Events arrive whole, so a pause means the last one is complete. */
+         flushTraceEvent(&run->parse);
+      }
+      while((line = rb_ary_shift(lines)) != Qnil)
+      {
+         parseTraceLine(&run->parse, line);
+      }
+   }
+   flushTraceEvent(&run->parse);
+
+   return(Qnil);
+}
+
+
+/**
+ * This function ends a trace session that was left before the server
+ * stopped it. Errors are discarded so as not to hide the reason the session
+ * was left.
+ *
+ * @param  data  A pointer to the TraceRun structure, cast to a VALUE.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE traceSessionEnsure(VALUE data)
+{
+   TraceRun *run = (TraceRun *)data;
+
+   if(!run->finished)
+   {
+      rb_rescue(endTraceSession, rb_assoc_new(run->parse.self, run->manager),
+                ignoreTraceError, Qnil);
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function ends a trace session by reconnecting the service manager
+ * running it, which frees the manager of the trace output, and then asking
+ * the server to stop the session should it still be known.
+ *
+ * @param  array  A reference to an Array holding the TraceSession and the
+ *                ServiceManager running it.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE endTraceSession(VALUE array)
+{
+   VALUE self    = rb_ary_entry(array, 0),
+         manager = rb_ary_entry(array, 1);
+
+   rb_service_manager_reconnect(manager);
+   if(rb_iv_get(self, "@id") != Qnil)
+   {
+      controlTraceSession(self, manager, isc_action_svc_trace_stop,
+                          "Error stopping trace session.");
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function discards an error raised ending a trace session.
+ *
+ * @param  unused  Not used.
+ * @param  error   A reference to the exception raised.
+ *
+ * @return  Always nil.
+ *
+ */
+VALUE ignoreTraceError(VALUE unused, VALUE error)
+{
+   return(Qnil);
+}
+
+
+/**
+ * This function provides the stop method for the TraceSession class.
+ *
+ * @param  self     A reference to the TraceSession object to make the call
+ *                  on.
+ * @param  manager  A reference to a ServiceManager to make the request on.
+ *                  This must not be the one running the trace.
+ *
+ * @return  A reference to the TraceSession object.
+ *
+ */
+static VALUE stopTraceSession(VALUE self, VALUE manager)
+{
+   controlTraceSession(self, manager, isc_action_svc_trace_stop,
+                       "Error stopping trace session.");
+
+   return(self);
+}
+
+
+/**
+ * This function provides the suspend method for the TraceSession class.
+ *
+ * @param  self     A reference to the TraceSession object to make the call
+ *                  on.
+ * @param  manager  A reference to a ServiceManager to make the request on.
+ *                  This must not be the one running the trace.
+ *
+ * @return  A reference to the TraceSession object.
+ *
+ */
+static VALUE suspendTraceSession(VALUE self, VALUE manager)
+{
+   controlTraceSession(self, manager, isc_action_svc_trace_suspend,
+                       "Error suspending trace session.");
+
+   return(self);
+}
+
+
+/**
+ * This function provides the resume method for the TraceSession class.
+ *
+ * @param  self     A reference to the TraceSession object to make the call
+ *                  on.
+ * @param  manager  A reference to a ServiceManager to make the request on.
+ *                  This must not be the one running the trace.
+ *
+ * @return  A reference to the TraceSession object.
+ *
+ */
+static VALUE resumeTraceSession(VALUE self, VALUE manager)
+{
+   controlTraceSession(self, manager, isc_action_svc_trace_resume,
+                       "Error resuming trace session.");
+
+   return(self);
+}
+
+
+/**
+ * This function fetches the handle for a service manager to be used with a
+ * trace session, checking that it is connected and that the client library
+ * supports tracing.
+ *
+ * @param  manager  A reference to the ServiceManager object.
+ *
+ * @return  A pointer to the service manager handle.
+ *
+ */
+ManagerHandle *getTraceManager(VALUE manager)
+{
+   ManagerHandle *handle = NULL;
+
+   Data_Get_Struct(manager, ManagerHandle, handle);
+   if(handle->handle == 0)
+   {
+      rb_ibruby_raise(NULL, "Trace session error. Service manager not "\
+                      "connected.");
+   }
+#if !defined(FB_API_VER) || FB_API_VER < 25
+   rb_ibruby_raise(NULL,
+                   "Trace sessions are not supported by the client library.");
+#endif
+
+   return(handle);
+}
+
+
+/**
+ * This function makes a stop, suspend or resume request for a trace session.
+ *
+ * @param  self     A reference to the TraceSession object.
+ * @param  manager  A reference to the ServiceManager to make the request on.
+ * @param  action   The service action to request.
+ * @param  message  The message for the exception raised should it fail.
+ *
+ */
+void controlTraceSession(VALUE self, VALUE manager, char action,
+                         const char *message)
+{
+   ManagerHandle *handle   = getTraceManager(manager);
+   VALUE         id        = rb_iv_get(self, "@id");
+   char          buffer[6],
+                 *position = buffer;
+   ISC_STATUS    status[20];
+
+   if(id == Qnil)
+   {
+      rb_ibruby_raise(NULL, "Trace session has not been started.");
+   }
+
+   *position++ = action;
+   *position++ = isc_spb_trc_id;
+   ADD_SPB_NUMERIC(position, NUM2LONG(id));
+   if(startService(status, &handle->handle, sizeof(buffer), buffer))
+   {
+      rb_ibruby_raise(status, message);
+   }
+   queryService(&handle->handle, Qnil);
+}
+
+
+/**
+ * This function creates the service parameter buffer to start a trace
+ * session.
+ *
+ * @param  config  A reference to a String containing the trace
+ *                 configuration.
+ * @param  name    A reference to a String containing the session name, or
+ *                 nil.
+ * @param  buffer  A pointer that will be set to the generated parameter
+ *                 buffer.
+ * @param  length  A pointer to a short integer that will be assigned the
+ *                 length of buffer.
+ *
+ */
+void createTraceBuffer(VALUE config, VALUE name, char **buffer, short *length)
+{
+   char  *position = NULL;
+   short count     = 0;
+
+   *length = 1 + strlen(STR2CSTR(config)) + 3;
+   if(name != Qnil)
+   {
+      *length += strlen(STR2CSTR(name)) + 3;
+   }
+
+   *buffer = position = ALLOC_N(char, *length);
+   if(*buffer == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation error preparing trace session.");
+   }
+   memset(*buffer, 0, *length);
+
+   *position++ = isc_action_svc_trace_start;
+   if(name != Qnil)
+   {
+      *position++ = isc_spb_trc_name;
+      count       = strlen(STR2CSTR(name));
+      ADD_SPB_LENGTH(position, count);
+      memcpy(position, STR2CSTR(name), count);
+      position   += count;
+   }
+   *position++ = isc_spb_trc_cfg;
+   count       = strlen(STR2CSTR(config));
+   ADD_SPB_LENGTH(position, count);
+   memcpy(position, STR2CSTR(config), count);
+}
+
+
+/**
+ * This function parses a line of trace output. A line starting with a time
+ * stamp begins a new event, the lines after it adding the details of the
+ * event until the next one begins.
+ *
+ * @param  parse  A pointer to the TraceParse structure for the session.
+ * @param  line   A reference to a String containing the line.
+ *
+ */
+void parseTraceLine(TraceParse *parse, VALUE line)
+{
+   VALUE copy  = rb_str_dup(line);
+   char  *raw  = STR2CSTR(line),
+         *text = NULL;
+   long  value = 0;
+
+   /* The copy is written to while parsing so it needs a buffer of its own. */
+   rb_str_modify(copy);
+   text = trimTraceText(STR2CSTR(copy));
+
+   if(isTraceHeader(raw))
+   {
+      flushTraceEvent(parse);
+      parseTraceHeader(parse, STR2CSTR(copy));
+      return;
+   }
+
+   if(parse->event == Qnil)
+   {
+      if(sscanf(text, "Trace session ID %ld", &value) == 1)
+      {
+         rb_iv_set(parse->self, "@id", LONG2NUM(value));
+      }
+      return;
+   }
+   addTraceText(parse->event, "text", raw);
+
+   if(parse->section == TRACE_SQL)
+   {
+      if(strncmp(text, "^^^", 3) == 0)
+      {
+         parse->section = TRACE_NONE;
+      }
+      else
+      {
+         addTraceText(parse->event, "sql", raw);
+      }
+   }
+   else if(parse->section == TRACE_PLAN && *text != '\0')
+   {
+      addTraceText(parse->event, "plan", text);
+   }
+   else if(parse->section == TRACE_TABLES && *text != '\0')
+   {
+      if(*text != '*')
+      {
+         parseTraceTable(parse, raw);
+      }
+   }
+   else if(*text == '\0')
+   {
+      parse->section = TRACE_NONE;
+   }
+   else if(strncmp(text, "-----", 5) == 0)
+   {
+      parse->section = TRACE_SQL;
+   }
+   else if(strncmp(text, "PLAN", 4) == 0)
+   {
+      addTraceText(parse->event, "plan", text);
+      parse->section = TRACE_PLAN;
+   }
+   else if(strncmp(text, "Table ", 6) == 0 && strstr(text, "Natural") != NULL)
+   {
+      parseTraceColumns(parse, raw);
+      parse->section = TRACE_TABLES;
+   }
+   else if(sscanf(text, "Statement %ld:", &value) == 1)
+   {
+      rb_hash_aset(parse->event, toSymbol("statement_id"), LONG2NUM(value));
+   }
+   else if(strncmp(text, "param", 5) == 0 && strstr(text, " = ") != NULL)
+   {
+      VALUE parameters = rb_hash_aref(parse->event, toSymbol("parameters"));
+
+      if(parameters == Qnil)
+      {
+         parameters = rb_ary_new();
+         rb_hash_aset(parse->event, toSymbol("parameters"), parameters);
+      }
+      rb_ary_push(parameters, rb_str_new2(strstr(text, " = ") + 3));
+   }
+   else if(sscanf(text, "%ld records fetched", &value) == 1 &&
+           strstr(text, "records fetched") != NULL)
+   {
+      rb_hash_aset(parse->event, toSymbol("records"), LONG2NUM(value));
+   }
+   else if(sscanf(text, "%ld ms", &value) == 1 && strstr(text, " ms") != NULL)
+   {
+      parseTracePerformance(parse, text);
+   }
+   else if(strncmp(text, "(TRA_", 5) == 0)
+   {
+      rb_hash_aset(parse->event, toSymbol("transaction_id"),
+                   LONG2NUM(atol(text + 5)));
+   }
+   else if(strstr(text, " (ATT_") != NULL)
+   {
+      parseTraceAttachment(parse, text);
+   }
+}
+
+
+/**
+ * This function starts a new event from the line that begins it, which
+ * holds a time stamp, the server process details in brackets and the event
+ * type, for example '2011-01-01T12:00:00.0000 (1234:0x7f0a) EXECUTE_START'.
+ *
+ * @param  parse  A pointer to the TraceParse structure for the session.
+ * @param  text   A pointer to the line text, which will be modified.
+ *
+ */
+void parseTraceHeader(TraceParse *parse, char *text)
+{
+   char *space = strchr(text, ' '),
+        *close = NULL;
+
+   parse->event   = rb_hash_new();
+   parse->section = TRACE_NONE;
+   addTraceText(parse->event, "text", text);
+
+   if(space != NULL)
+   {
+      *space++ = '\0';
+      rb_hash_aset(parse->event, toSymbol("time"), rb_str_new2(text));
+      if(*space == '(' && (close = strchr(space, ')')) != NULL)
+      {
+         rb_hash_aset(parse->event, toSymbol("process_id"),
+                      LONG2NUM(atol(space + 1)));
+         space = close + 1;
+      }
+      rb_hash_aset(parse->event, toSymbol("event"),
+                   rb_str_new2(trimTraceText(space)));
+   }
+}
+
+
+/**
+ * This function parses the line giving the database and attachment for an
+ * event, for example '/data/test.fdb (ATT_12, SYSDBA:NONE, UTF8,
+ * TCPv4:127.0.0.1)'.
+ *
+ * @param  parse  A pointer to the TraceParse structure for the session.
+ * @param  text   A pointer to the line text, which will be modified.
+ *
+ */
+void parseTraceAttachment(TraceParse *parse, char *text)
+{
+   static const char *keys[] = {"attachment", "user", "charset", "remote"};
+   char *details = strstr(text, " (ATT_"),
+        *field   = NULL,
+        *next    = NULL;
+   int  i        = 0;
+
+   *details = '\0';
+   details += 2;
+   rb_hash_aset(parse->event, toSymbol("database"),
+                rb_str_new2(trimTraceText(text)));
+   if((next = strrchr(details, ')')) != NULL)
+   {
+      *next = '\0';
+   }
+
+   for(field = details; field != NULL && i < 4; field = next, i++)
+   {
+      next = strstr(field, ", ");
+      if(next != NULL)
+      {
+         *next = '\0';
+         next += 2;
+      }
+
+      if(i == 0)
+      {
+         rb_hash_aset(parse->event, toSymbol("attachment_id"),
+                      LONG2NUM(atol(field + 4)));
+      }
+      else
+      {
+         rb_hash_aset(parse->event, toSymbol(keys[i]),
+                      rb_str_new2(trimTraceText(field)));
+      }
+   }
+}
+
+
+/**
+ * This function parses the performance line of an event, for example '12 ms,
+ * 4 read(s), 30 fetch(es), 2 mark(s)'.
+ *
+ * @param  parse  A pointer to the TraceParse structure for the session.
+ * @param  text   A pointer to the line text.
+ *
+ */
+void parseTracePerformance(TraceParse *parse, char *text)
+{
+   char *item = text;
+
+   while(item != NULL)
+   {
+      char *unit = strchr(item, ' ');
+      long value = atol(item);
+
+      if(unit == NULL)
+      {
+         break;
+      }
+      if(strncmp(unit, " ms", 3) == 0)
+      {
+         rb_hash_aset(parse->event, toSymbol("elapsed"), LONG2NUM(value));
+      }
+      else if(strncmp(unit, " read", 5) == 0)
+      {
+         rb_hash_aset(parse->event, toSymbol("reads"), LONG2NUM(value));
+      }
+      else if(strncmp(unit, " write", 6) == 0)
+      {
+         rb_hash_aset(parse->event, toSymbol("writes"), LONG2NUM(value));
+      }
+      else if(strncmp(unit, " fetch", 6) == 0)
+      {
+         rb_hash_aset(parse->event, toSymbol("fetches"), LONG2NUM(value));
+      }
+      else if(strncmp(unit, " mark", 5) == 0)
+      {
+         rb_hash_aset(parse->event, toSymbol("marks"), LONG2NUM(value));
+      }
+
+      item = strstr(item, ", ");
+      if(item != NULL)
+      {
+         item += 2;
+      }
+   }
+}
+
+
+/**
+ * This function records the columns of the table counter heading of an
+ * event. The counters are right aligned under the column names, so the
+ * position each name ends at is kept with it.
+ *
+ * @param  parse  A pointer to the TraceParse structure for the session.
+ * @param  text   A pointer to the heading text.
+ *
+ */
+void parseTraceColumns(TraceParse *parse, char *text)
+{
+   char *position = text;
+
+   while(isspace((unsigned char)*position))
+   {
+      position++;
+   }
+   while(*position != '\0' && !isspace((unsigned char)*position))
+   {
+      position++;
+   }
+   parse->nameEnd = position - text;
+   parse->columns = rb_ary_new();
+
+   while(*position != '\0')
+   {
+      char name[32];
+      int  size = 0;
+
+      while(isspace((unsigned char)*position))
+      {
+         position++;
+      }
+      while(*position != '\0' && !isspace((unsigned char)*position))
+      {
+         if(size < sizeof(name) - 1)
+         {
+            name[size++] = tolower((unsigned char)*position);
+         }
+         position++;
+      }
+      if(size > 0)
+      {
+         name[size] = '\0';
+         rb_ary_push(parse->columns,
+                     rb_ary_new3(2, toSymbol(name), LONG2NUM(position - text)));
+      }
+   }
+   rb_hash_aset(parse->event, toSymbol("tables"), rb_hash_new());
+}
+
+
+/**
+ * This function parses a line of table counters for an event, using the
+ * column positions taken from the heading. Blank counters are left out.
+ *
+ * @param  parse  A pointer to the TraceParse structure for the session.
+ * @param  text   A pointer to the line text.
+ *
+ */
+void parseTraceTable(TraceParse *parse, char *text)
+{
+   VALUE counters = rb_hash_new(),
+         column   = Qnil;
+   char  *end     = text;
+   long  length   = strlen(text),
+         previous = 0,
+         i;
+
+   while(isspace((unsigned char)*end))
+   {
+      end++;
+   }
+   while(*end != '\0' && !isspace((unsigned char)*end))
+   {
+      end++;
+   }
+   previous = end - text;
+
+   for(i = 0; (column = rb_ary_entry(parse->columns, i)) != Qnil; i++)
+   {
+      long finish = NUM2LONG(rb_ary_entry(column, 1));
+
+      if(finish > length)
+      {
+         finish = length;
+      }
+      if(finish > previous)
+      {
+         VALUE field = rb_str_new(text + previous, finish - previous);
+         char  *digits = trimTraceText(STR2CSTR(field));
+
+         if(*digits != '\0')
+         {
+            rb_hash_aset(counters, rb_ary_entry(column, 0),
+                         LONG2NUM(atol(digits)));
+         }
+         previous = finish;
+      }
+   }
+
+   rb_hash_aset(rb_hash_aref(parse->event, toSymbol("tables")),
+                rb_str_new(text, end - text), counters);
+}
+
+
+/**
+ * This function adds a line to one of the text entries of an event.
+ *
+ * @param  event  A reference to the event Hash.
+ * @param  key    The name of the entry.
+ * @param  text   A pointer to the line text.
+ *
+ */
+void addTraceText(VALUE event, const char *key, const char *text)
+{
+   VALUE current = rb_hash_aref(event, toSymbol(key));
+
+   if(current == Qnil)
+   {
+      rb_hash_aset(event, toSymbol(key), rb_str_new2(text));
+   }
+   else
+   {
+      rb_str_cat2(current, "\n");
+      rb_str_cat2(current, text);
+   }
+}
+
+
+/**
+ * This function passes the event being parsed, if there is one, to the block
+ * of the start method.
+ *
+ * @param  parse  A pointer to the TraceParse structure for the session.
+ *
+ */
+void flushTraceEvent(TraceParse *parse)
+{
+   VALUE event = parse->event;
+
+   if(event != Qnil)
+   {
+      parse->event   = Qnil;
+      parse->section = TRACE_NONE;
+      rb_yield(event);
+   }
+}
+
+
+/**
+ * This function checks whether a line of trace output begins an event,
+ * which it does with a time stamp such as 2011-01-01T12:00:00.0000.
+ *
+ * @param  text  A pointer to the line text.
+ *
+ * @return  Non-zero if the line begins an event, zero otherwise.
+ *
+ */
+int isTraceHeader(const char *text)
+{
+   return(strlen(text) > 19 && isdigit((unsigned char)text[0]) &&
+          isdigit((unsigned char)text[3]) && text[4] == '-' &&
+          text[7] == '-' && text[10] == 'T' && text[13] == ':');
+}
+
+
+/**
+ * This function trims the white space from the start and end of a piece of
+ * text.
+ *
+ * @param  text  A pointer to the text, which will be modified.
+ *
+ * @return  A pointer to the first character of the trimmed text.
+ *
+ */
+char *trimTraceText(char *text)
+{
+   char *end = NULL;
+
+   while(isspace((unsigned char)*text))
+   {
+      text++;
+   }
+   end = text + strlen(text);
+   while(end > text && isspace((unsigned char)end[-1]))
+   {
+      *--end = '\0';
+   }
+
+   return(text);
+}
+
+
+/**
+ * This function initialize the TraceSession class in the Ruby environment.
+ *
+ * @param  module  The module to create the new class definition under.
+ *
+ */
+void Init_TraceSession(VALUE module)
+{
+   cTraceSession = rb_define_class_under(module, "TraceSession", rb_cObject);
+   rb_define_method(cTraceSession, "initialize", initializeTraceSession, -1);
+   rb_define_method(cTraceSession, "config", getTraceSessionConfig, 0);
+   rb_define_method(cTraceSession, "name", getTraceSessionName, 0);
+   rb_define_method(cTraceSession, "id", getTraceSessionId, 0);
+   rb_define_method(cTraceSession, "start", startTraceSession, 1);
+   rb_define_method(cTraceSession, "stop", stopTraceSession, 1);
+   rb_define_method(cTraceSession, "suspend", suspendTraceSession, 1);
+   rb_define_method(cTraceSession, "resume", resumeTraceSession, 1);
+}
@@ -59,6 +59,15 @@
 #include "ResultSet.h"
 
 #include "Statement.h"
+#include "TransactionOptions.h"
+#include "Threads.h"
+#include <ctype.h>
+#include <string.h>
+#ifdef HAVE_RUBY_RACTOR_H
+   #include <ruby/ractor.h>
+#endif
+
+
 
 
 
@@ -77,8 +86,26 @@ static VALUE isTransactionFor(VALUE, VALUE);
 static VALUE executeOnTransaction(VALUE, VALUE);
 
 static VALUE createTransaction(VALUE, VALUE, VALUE);
+static VALUE commitRetainingTransaction(VALUE);
+static VALUE rollbackRetainingTransaction(VALUE);
+static VALUE setTransactionAutoCommit(VALUE, VALUE);
+static VALUE createSavepoint(VALUE, VALUE);
+static VALUE releaseSavepoint(VALUE, VALUE);
+static VALUE rollbackToSavepoint(VALUE, VALUE);
+VALUE savepointBlock(VALUE);
+VALUE savepointUndo(VALUE);
+void executeSavepointCommand(VALUE, const char *, VALUE);
+void recordSavepoint(VALUE, TransactionHandle *, const char *, VALUE);
+void clearSavepoints(VALUE, TransactionHandle *);
+void initializeHandle(TransactionHandle *);
 
 void startTransaction(TransactionHandle *, VALUE, long, char *);
+static VALUE getTransactionId(VALUE);
+void *transactionInfoCall(void *);
+static VALUE getTransactionStarted(VALUE);
+static VALUE getLongestActiveTransactions(int, VALUE *, VALUE);
+VALUE getActiveTransactionMap(void);
+void trackTransaction(VALUE);
 
 void transactionFree(void *);
 
@@ -87,6 +114,14 @@ void transactionFree(void *);
 /* Globals. */
 
 VALUE cTransaction;
+static IBRubyLock            activeLock;
+static unsigned long         activeSequence = 0;
+static VALUE                 cWeakMap       = Qnil;
+#ifdef HAVE_RUBY_RACTOR_H
+static rb_ractor_local_key_t activeKey;
+#else
+static VALUE                 activeMap      = Qnil;
+#endif
 
 
 
@@ -117,6 +152,23 @@ static char DEFAULT_TEB[]    = {isc_tpb_version3,
                                 isc_tpb_wait};
 
 static int  DEFAULT_TEB_SIZE = 5;
+static char READ_ONLY_TPB[]    = {isc_tpb_version3,
+                                  isc_tpb_read,
+                                  isc_tpb_read_committed,
+                                  isc_tpb_rec_version,
+                                  isc_tpb_nowait};
+static int  READ_ONLY_TPB_SIZE = 5;
+
+typedef struct
+{
+   isc_tr_handle *handle;
+   char          *items,
+                 *buffer;
+   short         count,
+                 size;
+   ISC_STATUS    *status,
+                 result;
+} TransactionInfoCall;
 
 
 
@@ -154,7 +206,7 @@ static VALUE allocateTransaction(VALUE klass)
 
    {
 
-      handle->handle = 0;
+      initializeHandle(handle);
 
       transaction = Data_Wrap_Struct(klass, NULL, transactionFree, handle);
 
@@ -186,25 +238,45 @@ static VALUE allocateTransaction(VALUE klass)
 
  *
 
- * @param  self         A reference to the new Transaction class instance.
+ * @param  argc  A count of the arguments passed to the function.
 
- * @param  connections  Either a reference to a single Connection object or to
+ * @param  argv  A pointer to the arguments passed to the function. The first
 
- *                      an array of Connection objects that the transaction 
+ *               is either a reference to a single Connection object or to an
 
- *                      will apply to.
+ *               array of Connection objects that the transaction will apply
 
+ *               to. The second, optional, argument is a TransactionOptions
+ *               object to start the transaction with.
+ * @param  self  A reference to the new Transaction class instance.
  *
 
  */
 
-static VALUE transactionInitialize(VALUE self, VALUE connections)
+static VALUE transactionInitialize(int argc, VALUE *argv, VALUE self)
 
 {
 
-   TransactionHandle *transaction = NULL;
+   TransactionHandle        *transaction = NULL;
+
+   TransactionOptionsHandle *options     = NULL;
+   VALUE                    array        = Qnil,
+                            connections  = Qnil;
 
-   VALUE             array        = Qnil;
+   if(argc < 1 || argc > 2)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc, 1);
+   }
+   connections = argv[0];
+   if(argc > 1 && argv[1] != Qnil)
+   {
+      if(TYPE(argv[1]) != T_DATA ||
+         RDATA(argv[1])->dfree != (RUBY_DATA_FUNC)transactionOptionsFree)
+      {
+         rb_ibruby_raise(NULL, "Invalid options specified for transaction.");
+      }
+      Data_Get_Struct(argv[1], TransactionOptionsHandle, options);
+   }
 
    
 
@@ -252,9 +324,17 @@ static VALUE transactionInitialize(VALUE self, VALUE connections)
 
    Data_Get_Struct(self, TransactionHandle, transaction);
 
-   startTransaction(transaction, array, 0, NULL);
+   if(options != NULL)
 
+   {
+      startTransaction(transaction, array, options->length, options->tpb);
+   }
+   else
+   {
+      startTransaction(transaction, array, 0, NULL);
+   }
    rb_tx_started(self, array);
+   trackTransaction(self);
 
    
 
@@ -792,6 +872,354 @@ static VALUE executeOnTransaction(VALUE self, VALUE sql)
 
 
 
+/**
+ * This function provides the commit_retaining method for the Transaction
+ * class. The work of the transaction is committed but the transaction remains
+ * active, along with any open statements or result sets within it.
+ *
+ * @param  self  A reference to the Transaction object being committed.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE commitRetainingTransaction(VALUE self)
+{
+   rb_commit_retaining(self);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the rollback_retaining method for the Transaction
+ * class. The work of the transaction is undone but the transaction remains
+ * active, along with any open statements or result sets within it.
+ *
+ * @param  self  A reference to the Transaction object being rolled back.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE rollbackRetainingTransaction(VALUE self)
+{
+   TransactionHandle *transaction = NULL;
+   ISC_STATUS        status[20];
+
+   Data_Get_Struct(self, TransactionHandle, transaction);
+   if(transaction->handle == 0)
+   {
+      rb_ibruby_raise(NULL, "Transaction is not active.");
+   }
+
+   if(isc_rollback_retaining(status, &transaction->handle) != 0)
+   {
+      rb_ibruby_raise(status, "Error rolling back transaction.");
+   }
+   transaction->rows      = 0;
+   transaction->committed = time(NULL);
+   clearSavepoints(self, transaction);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the auto_commit_every method for the Transaction
+ * class. Once set, statements executed under the transaction will cause a
+ * commit retaining whenever the number of rows they have affected, or the
+ * time passed, since the last commit reaches the specified limits.
+ *
+ * @param  self     A reference to the Transaction object to set the limits
+ *                  for.
+ * @param  options  A reference to a Hash that may contain :rows and :seconds
+ *                  entries giving the limits. Nil switches auto commit off.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE setTransactionAutoCommit(VALUE self, VALUE options)
+{
+   TransactionHandle *transaction = NULL;
+   VALUE             rows         = Qnil,
+                     seconds      = Qnil;
+
+   if(options != Qnil)
+   {
+      if(TYPE(options) != T_HASH)
+      {
+         rb_ibruby_raise(NULL, "Invalid auto commit options specified.");
+      }
+      rows    = rb_hash_aref(options, toSymbol("rows"));
+      seconds = rb_hash_aref(options, toSymbol("seconds"));
+   }
+
+   Data_Get_Struct(self, TransactionHandle, transaction);
+   transaction->limit     = (rows != Qnil ? NUM2LONG(rows) : 0);
+   transaction->interval  = (seconds != Qnil ? NUM2LONG(seconds) : 0);
+   transaction->rows      = 0;
+   transaction->committed = time(NULL);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the savepoint method for the Transaction class. If a
+ * block is given it is executed after the savepoint is created. Work done in
+ * the block is kept and the savepoint released if the block completes
+ * normally. If the block is left in any other way, be it an exception, a
+ * break or a throw, the work is undone back to the savepoint and the savepoint
+ * released before control is passed on.
+ *
+ * @param  self  A reference to the Transaction object to create the savepoint
+ *               within.
+ * @param  name  A reference to a String containing the savepoint name.
+ *
+ * @return  A reference to self or, if a block was given, the value returned
+ *          by the block.
+ *
+ */
+static VALUE createSavepoint(VALUE self, VALUE name)
+{
+   VALUE result = self;
+
+   executeSavepointCommand(self, "SAVEPOINT", name);
+   if(rb_block_given_p())
+   {
+      VALUE array = rb_ary_new();
+      int   state = 0;
+
+      rb_ary_push(array, self);
+      rb_ary_push(array, name);
+      result = rb_protect(savepointBlock, array, &state);
+      if(state != 0)
+      {
+         TransactionHandle *transaction = NULL;
+         int               failed       = 0;
+
+         rb_protect(savepointUndo, array, &failed);
+         if(failed != 0)
+         {
+            /* Stop tracking the savepoint so it can't hold auto commit off. */
+            Data_Get_Struct(self, TransactionHandle, transaction);
+            recordSavepoint(self, transaction, "RELEASE SAVEPOINT", name);
+         }
+         rb_jump_tag(state);
+      }
+      releaseSavepoint(self, name);
+   }
+
+   return(result);
+}
+
+
+/**
+ * This function provides the release_savepoint method for the Transaction
+ * class, discarding a savepoint while keeping the work done since it was
+ * created.
+ *
+ * @param  self  A reference to the Transaction object holding the savepoint.
+ * @param  name  A reference to a String containing the savepoint name.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE releaseSavepoint(VALUE self, VALUE name)
+{
+   executeSavepointCommand(self, "RELEASE SAVEPOINT", name);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the rollback_to method for the Transaction class,
+ * undoing the work done since a savepoint was created. The savepoint itself
+ * remains in place.
+ *
+ * @param  self  A reference to the Transaction object holding the savepoint.
+ * @param  name  A reference to a String containing the savepoint name.
+ *
+ * @return  A reference to self.
+ *
+ */
+static VALUE rollbackToSavepoint(VALUE self, VALUE name)
+{
+   executeSavepointCommand(self, "ROLLBACK TO SAVEPOINT", name);
+
+   return(self);
+}
+
+
+/**
+ * This function provides the block handling for the savepoint method.
+ *
+ * @param  array  A reference to an Array containing the Transaction object and
+ *                the savepoint name.
+ *
+ * @return  The value returned by the block.
+ *
+ */
+VALUE savepointBlock(VALUE array)
+{
+   return(rb_yield(rb_ary_entry(array, 0)));
+}
+
+
+/**
+ * This function undoes the work of a savepoint block that was left early,
+ * rolling back to the savepoint and then releasing it.
+ *
+ * @param  array  A reference to an Array containing the Transaction object and
+ *                the savepoint name.
+ *
+ * @return  Always returns nil.
+ *
+ */
+VALUE savepointUndo(VALUE array)
+{
+   VALUE transaction = rb_ary_entry(array, 0);
+
+   if(transactionIsActive(transaction) == Qtrue)
+   {
+      rollbackToSavepoint(transaction, rb_ary_entry(array, 1));
+      releaseSavepoint(transaction, rb_ary_entry(array, 1));
+   }
+
+   return(Qnil);
+}
+
+
+/**
+ * This function executes one of the savepoint statements for each of the
+ * connections covered by a Transaction.
+ *
+ * @param  self     A reference to the Transaction object to execute the
+ *                  statement within.
+ * @param  command  A pointer to the text of the savepoint command.
+ * @param  name     A reference to a String containing the savepoint name.
+ *
+ */
+void executeSavepointCommand(VALUE self, const char *command, VALUE name)
+{
+   TransactionHandle *transaction = NULL;
+   VALUE             list         = rb_iv_get(self, "@connections"),
+                     value        = rb_funcall(list, rb_intern("size"), 0);
+   char              *text        = NULL,
+                     sql[100];
+   int               size         = 0,
+                     index;
+
+   if(TYPE(name) != T_STRING)
+   {
+      rb_ibruby_raise(NULL, "Invalid savepoint name specified.");
+   }
+   text = STR2CSTR(name);
+   if(strlen(text) == 0 || strlen(text) > 31 || !isalpha((unsigned char)text[0]))
+   {
+      rb_ibruby_raise(NULL, "Invalid savepoint name specified.");
+   }
+   for(index = 0; text[index] != '\0'; index++)
+   {
+      if(!isalnum((unsigned char)text[index]) && text[index] != '_' &&
+         text[index] != '$')
+      {
+         rb_ibruby_raise(NULL, "Invalid savepoint name specified.");
+      }
+   }
+
+   Data_Get_Struct(self, TransactionHandle, transaction);
+   if(transaction->handle == 0)
+   {
+      rb_ibruby_raise(NULL, "Transaction is not active.");
+   }
+
+   sprintf(sql, "%s %s", command, text);
+   size = (TYPE(value) == T_FIXNUM ? FIX2INT(value) : NUM2INT(value));
+   for(index = 0; index < size; index++)
+   {
+      ConnectionHandle *connection = NULL;
+      ISC_STATUS       status[20];
+
+      Data_Get_Struct(rb_ary_entry(list, index), ConnectionHandle, connection);
+      if(isc_dsql_execute_immediate(status, &connection->handle,
+                                    &transaction->handle, 0, sql, 3,
+                                    NULL) != 0)
+      {
+         rb_ibruby_raise(status, "Error executing savepoint statement.");
+      }
+   }
+   recordSavepoint(self, transaction, command, name);
+}
+
+
+/**
+ * This function keeps track of the savepoints outstanding on a Transaction
+ * so that automatic commit retaining, which would discard them, can be held
+ * off until they have all been released. Creating a savepoint replaces any
+ * existing savepoint of the same name and releasing one also releases those
+ * created after it.
+ *
+ * @param  self         A reference to the Transaction object.
+ * @param  transaction  A pointer to the transaction structure.
+ * @param  command      A pointer to the savepoint command that was executed.
+ * @param  name         A reference to the savepoint name.
+ *
+ */
+void recordSavepoint(VALUE self, TransactionHandle *transaction,
+                     const char *command, VALUE name)
+{
+   VALUE names    = rb_iv_get(self, "@savepoints"),
+         position = Qnil,
+         size     = Qnil;
+
+   if(names == Qnil)
+   {
+      names = rb_ary_new();
+      rb_iv_set(self, "@savepoints", names);
+   }
+   name = rb_funcall(name, rb_intern("upcase"), 0);
+
+   if(strcmp(command, "SAVEPOINT") == 0)
+   {
+      rb_ary_delete(names, name);
+      rb_ary_push(names, name);
+   }
+   else if(strcmp(command, "RELEASE SAVEPOINT") == 0)
+   {
+      position = rb_funcall(names, rb_intern("index"), 1, name);
+      if(position != Qnil)
+      {
+         size = rb_funcall(names, rb_intern("size"), 0);
+         rb_funcall(names, rb_intern("slice!"), 2, position, size);
+      }
+   }
+
+   size                    = rb_funcall(names, rb_intern("size"), 0);
+   transaction->savepoints = NUM2LONG(size);
+}
+
+
+/**
+ * This function forgets the savepoints outstanding on a Transaction once a
+ * commit or roll back retaining has discarded them.
+ *
+ * @param  self         A reference to the Transaction object.
+ * @param  transaction  A pointer to the transaction structure.
+ *
+ */
+void clearSavepoints(VALUE self, TransactionHandle *transaction)
+{
+   VALUE names = rb_iv_get(self, "@savepoints");
+
+   if(names != Qnil)
+   {
+      rb_ary_clear(names);
+   }
+   transaction->savepoints = 0;
+}
+
+
 /**
 
  * This function creates a new Transaction object for a connection. This method
@@ -842,7 +1270,7 @@ static VALUE createTransaction(VALUE unused, VALUE connections, VALUE parameters
 
    }
 
-   transaction->handle = 0;
+   initializeHandle(transaction);
 
    
 
@@ -866,6 +1294,15 @@ static VALUE createTransaction(VALUE unused, VALUE connections, VALUE parameters
 
    
 
+   if(TYPE(parameters) == T_DATA &&
+      RDATA(parameters)->dfree == (RUBY_DATA_FUNC)transactionOptionsFree)
+   {
+      /* Precompiled options, start from their buffer. */
+      free(transaction);
+
+      return(rb_transaction_new_with_options(list, parameters));
+   }
+
    if(TYPE(parameters) != T_ARRAY)
 
    {
@@ -929,6 +1366,7 @@ static VALUE createTransaction(VALUE unused, VALUE connections, VALUE parameters
          rb_iv_set(instance, "@connections", list);
 
          rb_tx_started(instance, connections);
+         trackTransaction(instance);
 
       }
 
@@ -1002,7 +1440,8 @@ void startTransaction(TransactionHandle *transaction,
 
 {
 
-   ISC_TEB          *teb   = NULL;
+   ISC_TEB          *teb   = NULL,
+                    single;
 
    VALUE            value  = rb_funcall(connections, rb_intern("size"), 0),
 
@@ -1044,7 +1483,9 @@ void startTransaction(TransactionHandle *transaction,
 
    {
 
-      if((teb = ALLOC_N(ISC_TEB, length)) != NULL)
+      /* The common single connection case needs no allocation. */
+      teb = (length == 1 ? &single : ALLOC_N(ISC_TEB, length));
+      if(teb != NULL)
 
       {
 
@@ -1110,7 +1551,10 @@ void startTransaction(TransactionHandle *transaction,
 
                   /* Clean up and raise an exception. */
 
-                  free(teb);
+                  if(teb != &single)
+                  {
+                     free(teb);
+                  }
 
                   rb_ibruby_raise(NULL,
 
@@ -1128,7 +1572,10 @@ void startTransaction(TransactionHandle *transaction,
 
                /* Clean up and thrown an exception. */
 
-               free(teb);
+               if(teb != &single)
+               {
+                  free(teb);
+               }
 
                rb_ibruby_raise(NULL,
 
@@ -1187,6 +1634,7 @@ void startTransaction(TransactionHandle *transaction,
          rb_ibruby_raise(status, "Error starting transaction.");
 
       }
+      transaction->started = time(NULL);
 
    }
 
@@ -1194,7 +1642,7 @@ void startTransaction(TransactionHandle *transaction,
 
    /* Free the database details list if need be. */
 
-   if(teb != NULL)
+   if(teb != NULL && teb != &single)
 
    {
 
@@ -1290,7 +1738,7 @@ VALUE rb_transaction_new(VALUE connections)
 
    
 
-   transactionInitialize(transaction, connections);
+   transactionInitialize(1, &connections, transaction);
 
    
 
@@ -1299,6 +1747,133 @@ VALUE rb_transaction_new(VALUE connections)
 }
 
 
+/**
+ * This function provides a programmatic method of creating a Transaction
+ * object from a set of precompiled TransactionOptions.
+ *
+ * @param  connections  Either an single Connection object or an array of
+ *                      Connection objects that the transaction will apply
+ *                      to.
+ * @param  options      A reference to the TransactionOptions object to start
+ *                      the transaction with, may be nil.
+ *
+ * @return  A reference to the Transaction object.
+ *
+ */
+VALUE rb_transaction_new_with_options(VALUE connections, VALUE options)
+{
+   VALUE transaction = allocateTransaction(cTransaction),
+         arguments[2];
+
+   arguments[0] = connections;
+   arguments[1] = options;
+   transactionInitialize(2, arguments, transaction);
+
+   return(transaction);
+}
+
+
+
+/**
+ * This function creates a read only, read committed Transaction for a single
+ * connection. Transactions created through this function are not added to the
+ * list of transactions for the connection.
+ *
+ * @param  connection  A reference to the Connection object that the
+ *                     transaction will apply to.
+ *
+ * @return  A reference to the Transaction object created.
+ *
+ */
+VALUE rb_read_transaction_new(VALUE connection)
+{
+   VALUE             instance     = allocateTransaction(cTransaction),
+                     list         = rb_ary_new();
+   TransactionHandle *transaction = NULL;
+
+   rb_ary_push(list, connection);
+   Data_Get_Struct(instance, TransactionHandle, transaction);
+   startTransaction(transaction, list, READ_ONLY_TPB_SIZE, READ_ONLY_TPB);
+   rb_iv_set(instance, "@connections", list);
+
+   return(instance);
+}
+
+
+/**
+ * This function commits the work of a Transaction while retaining its context,
+ * leaving the transaction active.
+ *
+ * @param  self  A reference to the Transaction object to be committed.
+ *
+ */
+void rb_commit_retaining(VALUE self)
+{
+   TransactionHandle *transaction = NULL;
+   ISC_STATUS        status[20];
+
+   Data_Get_Struct(self, TransactionHandle, transaction);
+   if(transaction->handle == 0)
+   {
+      rb_ibruby_raise(NULL, "Transaction is not active.");
+   }
+
+   if(isc_commit_retaining(status, &transaction->handle) != 0)
+   {
+      rb_ibruby_raise(status, "Error committing transaction.");
+   }
+   transaction->rows      = 0;
+   transaction->committed = time(NULL);
+   clearSavepoints(self, transaction);
+}
+
+
+/**
+ * This function is called whenever a Statement has been executed under a
+ * Transaction, committing the work of the transaction with its context
+ * retained if the limits set via auto_commit_every have been reached.
+ *
+ * @param  self  A reference to the Transaction object the statement was
+ *               executed under.
+ * @param  rows  The number of rows affected by the statement.
+ *
+ */
+void rb_transaction_executed(VALUE self, long rows)
+{
+   TransactionHandle *transaction = NULL;
+
+   Data_Get_Struct(self, TransactionHandle, transaction);
+   transaction->rows += rows;
+   /* A commit retaining would discard any outstanding savepoints. */
+   if(transaction->savepoints == 0 &&
+      ((transaction->limit > 0 && transaction->rows >= transaction->limit) ||
+       (transaction->interval > 0 &&
+        time(NULL) - transaction->committed >= transaction->interval)))
+   {
+      rb_commit_retaining(self);
+   }
+}
+
+
+/**
+ * This function sets the fields of a TransactionHandle to their initial
+ * values.
+ *
+ * @param  transaction  A pointer to the TransactionHandle to be initialized.
+ *
+ */
+void initializeHandle(TransactionHandle *transaction)
+{
+   transaction->handle     = 0;
+   transaction->rows       = 0;
+   transaction->limit      = 0;
+   transaction->interval   = 0;
+   transaction->savepoints = 0;
+   transaction->committed  = time(NULL);
+   transaction->started    = 0;
+   transaction->sequence   = 0;
+}
+
 
 /**
 
@@ -1347,6 +1922,242 @@ int coversConnection(VALUE transaction, VALUE connection)
 }
 
 
+/**
+ * This function provides the id method for the Transaction class, fetching
+ * the number that the database gave the transaction when it was started.
+ * This is the number reported as the oldest active transaction while the
+ * transaction is holding back garbage collection.
+ *
+ * @param  self  A reference to the Transaction object to make the call on.
+ *
+ * @return  A reference to the transaction number, or nil if the transaction
+ *          is not active.
+ *
+ */
+static VALUE getTransactionId(VALUE self)
+{
+   TransactionHandle *transaction = NULL;
+   VALUE             result       = Qnil;
+   char              items[]      = {isc_info_tra_id, isc_info_end},
+                     buffer[32];
+   ISC_STATUS        status[20];
+
+   Data_Get_Struct(self, TransactionHandle, transaction);
+   if(transaction->handle != 0)
+   {
+      TransactionInfoCall call;
+
+      memset(buffer, 0, sizeof(buffer));
+      call.status = status;
+      call.handle = &transaction->handle;
+      call.count  = sizeof(items);
+      call.items  = items;
+      call.size   = sizeof(buffer);
+      call.buffer = buffer;
+      callBlocking(transactionInfoCall, &call, NULL, NULL);
+      if(call.result != 0)
+      {
+         rb_ibruby_raise(status, "Error fetching transaction id.");
+      }
+      if(buffer[0] == isc_info_tra_id)
+      {
+         short length = (short)isc_vax_integer(&buffer[1], 2);
+
+         result = toInfoInteger(&buffer[3], length);
+      }
+   }
+
+   return(result);
+}
+
+
+/**
+ * This function makes the isc_transaction_info call for getTransactionId. It
+ * is called without the interpreter lock and so makes no calls into Ruby.
+ *
+ * @param  data  A pointer to the TransactionInfoCall structure.
+ *
+ * @return  Always NULL.
+ *
+ */
+void *transactionInfoCall(void *data)
+{
+   TransactionInfoCall *call = (TransactionInfoCall *)data;
+
+   call->result = isc_transaction_info(call->status, call->handle,
+                                       call->count, call->items, call->size,
+                                       call->buffer);
+
+   return(NULL);
+}
+
+
+/**
+ * This function provides the started method for the Transaction class.
+ *
+ * @param  self  A reference to the Transaction object to make the call on.
+ *
+ * @return  A reference to a Time for when the transaction was started, or nil
+ *          if the transaction is not active.
+ *
+ */
+static VALUE getTransactionStarted(VALUE self)
+{
+   TransactionHandle *transaction = NULL;
+   VALUE             result       = Qnil;
+
+   Data_Get_Struct(self, TransactionHandle, transaction);
+   if(transaction->handle != 0)
+   {
+      result = rb_time_new(transaction->started, 0);
+   }
+
+   return(result);
+}
+
+
+/**
+ * This function provides the longest_active class method for the Transaction
+ * class.
+ *
+ * @param  argc   A count of the number of arguments passed to the function.
+ * @param  argv   A pointer to the array of arguments passed to the function.
+ *                The only argument, which is optional, is the maximum number
+ *                of transactions to return.
+ * @param  klass  A reference to the Transaction Class object.
+ *
+ * @return  A reference to an Array of the active Transaction objects, the
+ *          longest active first.
+ *
+ */
+static VALUE getLongestActiveTransactions(int argc, VALUE *argv, VALUE klass)
+{
+   long limit = 0;
+
+   if(argc > 1)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc,
+               1);
+   }
+   if(argc > 0 && argv[0] != Qnil)
+   {
+      limit = NUM2LONG(argv[0]);
+   }
+
+   return(rb_transactions_active(limit));
+}
+
+
+/**
+ * This function fetches the Transaction objects that are currently active,
+ * in the order in which they were started. Only transactions created by the
+ * current Ractor are included.
+ *
+ * @param  limit  The maximum number of transactions to fetch, or zero for no
+ *                limit.
+ *
+ * @return  A reference to an Array of the Transaction objects.
+ *
+ */
+VALUE rb_transactions_active(long limit)
+{
+   VALUE map     = getActiveTransactionMap(),
+         entries = rb_ary_new(),
+         result  = rb_ary_new(),
+         keys    = Qnil,
+         entry   = Qnil;
+   long  index;
+
+   if(map == Qnil)
+   {
+      return(result);
+   }
+
+   /* The map only hands back transactions that are still alive. */
+   keys = rb_funcall(map, rb_intern("keys"), 0);
+   for(index = 0; (entry = rb_ary_entry(keys, index)) != Qnil; index++)
+   {
+      TransactionHandle *transaction = NULL;
+
+      Data_Get_Struct(entry, TransactionHandle, transaction);
+      if(transaction->handle != 0)
+      {
+         rb_ary_push(entries,
+                     rb_assoc_new(ULONG2NUM(transaction->sequence), entry));
+      }
+   }
+   entries = rb_funcall(entries, rb_intern("sort"), 0);
+
+   for(index = 0; (entry = rb_ary_entry(entries, index)) != Qnil &&
+                  (limit <= 0 || index < limit); index++)
+   {
+      rb_ary_push(result, rb_ary_entry(entry, 1));
+   }
+
+   return(result);
+}
+
+
+/**
+ * This function fetches the map used to track the Transaction objects that
+ * have been started by the current Ractor, creating it if need be. The map
+ * is an ObjectSpace::WeakMap so it does not keep the transactions alive and
+ * never hands back one that the garbage collector has found to be dead.
+ *
+ * @return  A reference to the map, or nil if the interpreter has no weak map
+ *          to offer.
+ *
+ */
+VALUE getActiveTransactionMap(void)
+{
+   VALUE map = Qnil;
+
+   if(cWeakMap != Qnil)
+   {
+#ifdef HAVE_RUBY_RACTOR_H
+      if(!rb_ractor_local_storage_value_lookup(activeKey, &map))
+      {
+         map = rb_class_new_instance(0, NULL, cWeakMap);
+         rb_ractor_local_storage_value_set(activeKey, map);
+      }
+#else
+      if(activeMap == Qnil)
+      {
+         activeMap = rb_class_new_instance(0, NULL, cWeakMap);
+      }
+      map = activeMap;
+#endif
+   }
+
+   return(map);
+}
+
+
+/**
+ * This function records a newly started Transaction in the map of active
+ * transactions for the current Ractor, numbering it so that the order the
+ * transactions were started in is known. The map does not keep the
+ * Transaction alive and ended transactions are skipped when it is read.
+ *
+ * @param  self  A reference to the Transaction object that was started.
+ *
+ */
+void trackTransaction(VALUE self)
+{
+   TransactionHandle *transaction = NULL;
+   VALUE             map          = getActiveTransactionMap();
+
+   Data_Get_Struct(self, TransactionHandle, transaction);
+   acquireLock(&activeLock);
+   transaction->sequence = ++activeSequence;
+   releaseLock(&activeLock);
+   if(map != Qnil)
+   {
+      rb_funcall(map, rb_intern("[]="), 2, self, self);
+   }
+}
+
+
 
 
 
@@ -1367,12 +2178,13 @@ int coversConnection(VALUE transaction, VALUE connection)
 void Init_Transaction(VALUE module)
 
 {
+   VALUE space = rb_const_get(rb_cObject, rb_intern("ObjectSpace"));
 
    cTransaction = rb_define_class_under(module, "Transaction", rb_cObject);
 
    rb_define_alloc_func(cTransaction, allocateTransaction);
 
-   rb_define_method(cTransaction, "initialize", transactionInitialize, 1);
+   rb_define_method(cTransaction, "initialize", transactionInitialize, -1);
 
    rb_define_method(cTransaction, "initialize_copy", forbidObjectCopy, 1);
 
@@ -1391,6 +2203,26 @@ void Init_Transaction(VALUE module)
    rb_define_module_function(cTransaction, "create", createTransaction, 2);
 
    rb_define_method(cTransaction, "execute", executeOnTransaction, 1);
+   rb_define_method(cTransaction, "commit_retaining", commitRetainingTransaction, 0);
+   rb_define_method(cTransaction, "rollback_retaining", rollbackRetainingTransaction, 0);
+   rb_define_method(cTransaction, "auto_commit_every", setTransactionAutoCommit, 1);
+   rb_define_method(cTransaction, "savepoint", createSavepoint, 1);
+   rb_define_method(cTransaction, "release_savepoint", releaseSavepoint, 1);
+   rb_define_method(cTransaction, "rollback_to", rollbackToSavepoint, 1);
+   rb_define_method(cTransaction, "id", getTransactionId, 0);
+   rb_define_method(cTransaction, "started", getTransactionStarted, 0);
+   rb_define_module_function(cTransaction, "longest_active",
+                             getLongestActiveTransactions, -1);
+   initializeLock(&activeLock);
+   if(rb_const_defined(space, rb_intern("WeakMap")))
+   {
+      cWeakMap = rb_const_get(space, rb_intern("WeakMap"));
+   }
+#ifdef HAVE_RUBY_RACTOR_H
+   activeKey = rb_ractor_local_storage_value_newkey();
+#else
+   rb_global_variable(&activeMap);
+#endif
 
    rb_define_const(cTransaction, "TPB_VERSION_1", INT2FIX(isc_tpb_version1));
 
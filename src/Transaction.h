@@ -34,16 +34,30 @@
       #include "IBRubyException.h"
    #endif
 
+   #include <time.h>
+
    /* Structure definitions. */
    typedef struct
    {
       isc_tr_handle handle;
+      long          rows,
+                    limit,
+                    interval,
+                    savepoints;
+      unsigned long sequence;
+      time_t        committed,
+                    started;
    } TransactionHandle;
    
    /* Function prototypes. */
    void Init_Transaction(VALUE);
    VALUE rb_transaction_new(VALUE);
+   VALUE rb_transaction_new_with_options(VALUE, VALUE);
+   VALUE rb_read_transaction_new(VALUE);
+   void rb_commit_retaining(VALUE);
+   void rb_transaction_executed(VALUE, long);
    int coversConnection(VALUE, VALUE);
+   VALUE rb_transactions_active(long);
    void transactionFree(void *);
 
 #endif /* IBRUBY_TRANSACTION_H */
@@ -0,0 +1,374 @@
+/*------------------------------------------------------------------------------
+ * TransactionOptions.c
+ *------------------------------------------------------------------------------
+/**
+ * Copyright  Peter Wood, 2005
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ *
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License for
+ * the specificlanguage governing rights and  limitations under the License.
+ *
+ * The Original Code is the FireRuby extension for the Ruby language.
+ *
+ * The Initial Developer of the Original Code is Peter Wood. All Rights
+ * Reserved.
+ *
+ * @author  Peter Wood
+ * @version 1.0
+ */
+
+/* Includes. */
+#include "TransactionOptions.h"
+#include "Common.h"
+#include <string.h>
+
+/* Function prototypes. */
+static VALUE allocateTransactionOptions(VALUE);
+static VALUE initializeTransactionOptions(int, VALUE *, VALUE);
+static VALUE getTransactionOptionsTPB(VALUE);
+static VALUE getTransactionOptionsSettings(VALUE);
+char getReservationType(VALUE, char *);
+
+/* Globals. */
+VALUE cTransactionOptions;
+
+
+/**
+ * This function provides for the allocation of new TransactionOptions objects
+ * through the Ruby language.
+ *
+ * @param  klass  A reference to the TransactionOptions Class object.
+ *
+ * @return  A reference to the newly allocated TransactionOptions object.
+ *
+ */
+static VALUE allocateTransactionOptions(VALUE klass)
+{
+   VALUE                    instance = Qnil;
+   TransactionOptionsHandle *options = ALLOC(TransactionOptionsHandle);
+
+   if(options != NULL)
+   {
+      options->tpb    = NULL;
+      options->length = 0;
+      instance        = Data_Wrap_Struct(klass, NULL, transactionOptionsFree,
+                                         options);
+   }
+   else
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure allocating transaction options.");
+   }
+
+   return(instance);
+}
+
+
+/**
+ * This function provides the initialize method for the TransactionOptions
+ * class. The settings are converted into a transaction parameter buffer at
+ * this point so that transactions started with the object don't have to
+ * repeat the work.
+ *
+ * @param  argc  A count of the arguments passed to the function.
+ * @param  argv  A pointer to the arguments passed to the function. The only
+ *               argument accepted is an optional Hash of settings.
+ * @param  self  A reference to the object being initialized.
+ *
+ * @return  A reference to the newly initialized TransactionOptions object.
+ *
+ */
+static VALUE initializeTransactionOptions(int argc, VALUE *argv, VALUE self)
+{
+   TransactionOptionsHandle *options  = NULL;
+   VALUE                    settings  = (argc > 0 ? argv[0] : Qnil),
+                            isolation = Qnil,
+                            timeout   = Qnil,
+                            tables    = Qnil,
+                            names     = Qnil,
+                            value     = Qnil;
+   long                     size      = 0,
+                            count     = 0,
+                            index;
+   char                     *tpb      = NULL,
+                            *offset   = NULL;
+#ifdef isc_tpb_lock_timeout
+   long                     seconds   = 0;
+#endif
+
+   if(argc > 1)
+   {
+      rb_raise(rb_eArgError, "Wrong number of arguments (%d for %d).", argc, 1);
+   }
+
+   if(settings == Qnil)
+   {
+      settings = rb_hash_new();
+   }
+   if(TYPE(settings) != T_HASH)
+   {
+      rb_ibruby_raise(NULL, "Invalid transaction options specified.");
+   }
+
+   isolation = rb_hash_aref(settings, toSymbol("isolation"));
+   timeout   = rb_hash_aref(settings, toSymbol("lock_timeout"));
+   tables    = rb_hash_aref(settings, toSymbol("reserve"));
+#ifdef isc_tpb_lock_timeout
+   if(timeout != Qnil)
+   {
+      seconds = NUM2LONG(timeout);
+   }
+#endif
+   if(tables != Qnil)
+   {
+      if(TYPE(tables) != T_HASH)
+      {
+         rb_ibruby_raise(NULL, "Invalid table reservations specified.");
+      }
+      names = rb_funcall(tables, rb_intern("keys"), 0);
+      value = rb_funcall(names, rb_intern("size"), 0);
+      count = TYPE(value) == T_FIXNUM ? FIX2INT(value) : NUM2INT(value);
+   }
+
+   /* Work out the buffer size, 6 bytes of flags plus timeout and tables. */
+   size = 6 + 6;
+   for(index = 0; index < count; index++)
+   {
+      VALUE name = rb_ary_entry(names, index);
+
+      if(TYPE(name) != T_STRING || strlen(STR2CSTR(name)) > 255)
+      {
+         rb_ibruby_raise(NULL, "Invalid table name specified for reservation.");
+      }
+      size += strlen(STR2CSTR(name)) + 3;
+   }
+
+   if((tpb = ALLOC_N(char, size)) == NULL)
+   {
+      rb_raise(rb_eNoMemError,
+               "Memory allocation failure creating transaction options.");
+   }
+   offset    = tpb;
+   *offset++ = isc_tpb_version3;
+
+   /* Isolation level. */
+   if(isolation == Qnil || isolation == toSymbol("concurrency"))
+   {
+      *offset++ = isc_tpb_concurrency;
+   }
+   else if(isolation == toSymbol("consistency"))
+   {
+      *offset++ = isc_tpb_consistency;
+   }
+   else if(isolation == toSymbol("read_committed"))
+   {
+      *offset++ = isc_tpb_read_committed;
+      if(rb_hash_aref(settings, toSymbol("rec_version")) == Qfalse)
+      {
+         *offset++ = isc_tpb_no_rec_version;
+      }
+      else
+      {
+         *offset++ = isc_tpb_rec_version;
+      }
+   }
+   else
+   {
+      free(tpb);
+      rb_ibruby_raise(NULL, "Invalid transaction isolation level specified.");
+   }
+
+   /* Access mode and lock resolution. */
+   if(rb_hash_aref(settings, toSymbol("read_only")) == Qtrue)
+   {
+      *offset++ = isc_tpb_read;
+   }
+   else
+   {
+      *offset++ = isc_tpb_write;
+   }
+
+   if(rb_hash_aref(settings, toSymbol("wait")) == Qfalse)
+   {
+      *offset++ = isc_tpb_nowait;
+   }
+   else
+   {
+      *offset++ = isc_tpb_wait;
+      if(timeout != Qnil)
+      {
+#ifdef isc_tpb_lock_timeout
+         *offset++ = isc_tpb_lock_timeout;
+         *offset++ = 4;
+         *offset++ = (char)seconds;
+         *offset++ = (char)(seconds >> 8);
+         *offset++ = (char)(seconds >> 16);
+         *offset++ = (char)(seconds >> 24);
+#else
+         free(tpb);
+         rb_ibruby_raise(NULL, "Lock timeouts are not supported by the "\
+                               "database client library.");
+#endif
+      }
+   }
+
+   /* Table reservations. */
+   for(index = 0; index < count; index++)
+   {
+      VALUE name   = rb_ary_entry(names, index);
+      char  mode   = 0,
+            lock   = getReservationType(rb_hash_aref(tables, name), &mode),
+            *table = STR2CSTR(name);
+
+      if(lock == 0)
+      {
+         free(tpb);
+         rb_ibruby_raise(NULL, "Invalid table reservation type specified.");
+      }
+      *offset++ = lock;
+      *offset++ = (char)strlen(table);
+      memcpy(offset, table, strlen(table));
+      offset   += strlen(table);
+      *offset++ = mode;
+   }
+
+   Data_Get_Struct(self, TransactionOptionsHandle, options);
+   if(options->tpb != NULL)
+   {
+      free(options->tpb);
+   }
+   options->tpb    = tpb;
+   options->length = offset - tpb;
+   rb_iv_set(self, "@settings", rb_obj_freeze(rb_obj_dup(settings)));
+
+   return(self);
+}
+
+
+/**
+ * This function provides the tpb method for the TransactionOptions class.
+ *
+ * @param  self  A reference to the TransactionOptions object to fetch the
+ *               buffer for.
+ *
+ * @return  A reference to a String containing the bytes of the compiled
+ *          transaction parameter buffer.
+ *
+ */
+static VALUE getTransactionOptionsTPB(VALUE self)
+{
+   TransactionOptionsHandle *options = NULL;
+
+   Data_Get_Struct(self, TransactionOptionsHandle, options);
+
+   return(rb_str_new(options->tpb, options->length));
+}
+
+
+/**
+ * This function provides the settings accessor for the TransactionOptions
+ * class.
+ *
+ * @param  self  A reference to the TransactionOptions object to fetch the
+ *               settings for.
+ *
+ * @return  A reference to a frozen copy of the Hash the object was created
+ *          from.
+ *
+ */
+static VALUE getTransactionOptionsSettings(VALUE self)
+{
+   return(rb_iv_get(self, "@settings"));
+}
+
+
+/**
+ * This function converts a table reservation type, one of the symbols
+ * :shared_read, :shared_write, :protected_read or :protected_write, into the
+ * equivalent transaction parameter buffer entries.
+ *
+ * @param  type  A reference to the reservation type Symbol.
+ * @param  mode  A pointer to a character that will be set to the sharing
+ *               mode for the reservation.
+ *
+ * @return  The lock type for the reservation or 0 if the type is not valid.
+ *
+ */
+char getReservationType(VALUE type, char *mode)
+{
+   char lock = 0;
+
+   if(type == toSymbol("shared_read"))
+   {
+      lock  = isc_tpb_lock_read;
+      *mode = isc_tpb_shared;
+   }
+   else if(type == toSymbol("shared_write"))
+   {
+      lock  = isc_tpb_lock_write;
+      *mode = isc_tpb_shared;
+   }
+   else if(type == toSymbol("protected_read"))
+   {
+      lock  = isc_tpb_lock_read;
+      *mode = isc_tpb_protected;
+   }
+   else if(type == toSymbol("protected_write"))
+   {
+      lock  = isc_tpb_lock_write;
+      *mode = isc_tpb_protected;
+   }
+
+   return(lock);
+}
+
+
+/**
+ * This function integrates with the Ruby garbage collector to release the
+ * resources associated with a TransactionOptions object when it is collected.
+ *
+ * @param  options  A pointer to the TransactionOptionsHandle structure for
+ *                  the object being collected.
+ *
+ */
+void transactionOptionsFree(void *options)
+{
+   if(options != NULL)
+   {
+      TransactionOptionsHandle *handle = (TransactionOptionsHandle *)options;
+
+      if(handle->tpb != NULL)
+      {
+         free(handle->tpb);
+      }
+      free(handle);
+   }
+}
+
+
+/**
+ * This function initializes the TransactionOptions class within the Ruby
+ * environment. The class is established under the module specified to the
+ * function.
+ *
+ * @param  module  A reference to the module to create the class within.
+ *
+ */
+void Init_TransactionOptions(VALUE module)
+{
+   cTransactionOptions = rb_define_class_under(module, "TransactionOptions",
+                                               rb_cObject);
+   rb_define_alloc_func(cTransactionOptions, allocateTransactionOptions);
+   rb_define_method(cTransactionOptions, "initialize",
+                    initializeTransactionOptions, -1);
+   rb_define_method(cTransactionOptions, "initialize_copy", forbidObjectCopy, 1);
+   rb_define_method(cTransactionOptions, "tpb", getTransactionOptionsTPB, 0);
+   rb_define_method(cTransactionOptions, "settings",
+                    getTransactionOptionsSettings, 0);
+}
@@ -19,5 +19,22 @@ end
 # Make sure the interbase stuff is included.
 dir_config("interbase2007")
 
+# Native threads are used by the connection pool. Where the interpreter
+# allows it the interpreter lock is released around blocking calls.
+have_library("pthread") unless PLATFORM.include?("win32")
+have_header("ruby/thread.h")
+have_func("rb_thread_call_without_gvl", "ruby/thread.h")
+
+# Statements run from Fibers under a Fiber scheduler use worker threads.
+have_header("ruby/fiber/scheduler.h")
+
+# Backups streamed through a Ruby IO may be compressed with zlib or zstd.
+have_header("zlib.h") if have_library("z", "deflate", "zlib.h")
+have_header("zstd.h") if have_library("zstd", "ZSTD_compressStream2", "zstd.h")
+
+# The extension declares itself safe for use from any Ractor.
+have_header("ruby/ractor.h")
+have_func("rb_ext_ractor_safe", "ruby.h")
+
 # Generate the Makefile.
 create_makefile("ib_lib")
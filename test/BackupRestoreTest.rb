@@ -4,6 +4,7 @@ require 'TestSetup'
 require 'test/unit'
 #require 'rubygems'
 require 'ibruby'
+require 'stringio'
 
 include IBRuby
 
@@ -96,4 +97,204 @@ class BackupRestoreTest < Test::Unit::TestCase
          end
       end
    end
+
+   def test03
+      sm = ServiceManager.new('localhost')
+      sm.connect(DB_USER_NAME, DB_PASSWORD)
+
+      lines    = []
+      progress = []
+      b = Backup.new(DB_FILE, BACKUP_FILE)
+      b.on_progress {|tables, rows| progress.push([tables, rows])}
+      b.execute(sm) {|line| lines.push(line)}
+      assert(lines.size > 0)
+      assert(b.log == lines.join("\n"))
+      assert(progress.include?([1, 5]))
+      @database.drop(DB_USER_NAME, DB_PASSWORD)
+
+      lines    = []
+      progress = []
+      r = Restore.new(BACKUP_FILE, DB_FILE)
+      r.on_progress {|tables, rows| progress.push([tables, rows])}
+      r.execute(sm) {|line| lines.push(line)}
+      sm.disconnect
+      assert(lines.size > 0)
+      assert(progress.last[1] >= 5)
+      assert(File.exist?(DB_FILE))
+   end
+
+   def test04
+      sm = ServiceManager.new('localhost')
+      sm.connect(DB_USER_NAME, DB_PASSWORD)
+
+      [nil, :zlib].each do |compression|
+         File.open(BACKUP_FILE, 'wb') do |file|
+            b = Backup.new(DB_FILE, 'unused.ibak')
+            b.execute(sm, :io => file, :compression => compression)
+            assert(b.log == nil)
+         end
+         assert(File.size(BACKUP_FILE) > 0)
+         @database.drop(DB_USER_NAME, DB_PASSWORD)
+
+         File.open(BACKUP_FILE, 'rb') do |file|
+            r = Restore.new('unused.ibak', DB_FILE)
+            r.execute(sm, :io => file, :compression => compression)
+         end
+         @database.connect(DB_USER_NAME, DB_PASSWORD) do |cxn|
+            cxn.execute_immediate('select count(*) from test') do |row|
+               assert(row[0] == 5)
+            end
+         end
+      end
+
+      b = Backup.new(DB_FILE, BACKUP_FILE)
+      assert_raise(IBRubyException) do
+         b.execute(sm, :io => StringIO.new, :compression => :lzma)
+      end
+      sm.disconnect
+   end
+
+   def test05
+      files = ["#{CURDIR}#{File::SEPARATOR}database.nbk0",
+               "#{CURDIR}#{File::SEPARATOR}database.nbk1"]
+      files.each {|path| File.delete(path) if File.exist?(path)}
+      sm = ServiceManager.new('localhost')
+      sm.connect(DB_USER_NAME, DB_PASSWORD)
+
+      b = NBackup.new(DB_FILE, files[0])
+      assert(b.level == 0)
+      assert(b.no_triggers == false)
+      b.execute(sm)
+      assert(File.exist?(files[0]))
+
+      @database.connect(DB_USER_NAME, DB_PASSWORD) do |cxn|
+         cxn.execute_immediate('insert into test values (5000)')
+      end
+
+      lines = []
+      b.files = files
+      assert(b.level == 1)
+      b.execute(sm) {|line| lines << line}
+      assert(File.exist?(files[1]))
+      @database.drop(DB_USER_NAME, DB_PASSWORD)
+
+      b.restore(sm)
+      @database.connect(DB_USER_NAME, DB_PASSWORD) do |cxn|
+         cxn.execute_immediate('select count(*) from test') do |row|
+            assert(row[0] == 6)
+         end
+      end
+      sm.disconnect
+      files.each {|path| File.delete(path) if File.exist?(path)}
+   end
+
+   def test06
+      files = ["#{CURDIR}#{File::SEPARATOR}database1.ibak",
+               "#{CURDIR}#{File::SEPARATOR}database2.ibak"]
+      files.each {|path| File.delete(path) if File.exist?(path)}
+
+      queue = ServiceQueue.new('localhost', DB_USER_NAME, DB_PASSWORD, 2)
+      assert(queue.size == 2)
+      files.each {|path| queue << Backup.new(DB_FILE, path)}
+      queue.sweep(DB_FILE)
+      queue.add(Backup.new("#{CURDIR}#{File::SEPARATOR}missing.ib",
+                           BACKUP_FILE))
+      assert(queue.jobs.size == 4)
+
+      finished = []
+      jobs     = queue.run {|job| finished << job}
+      assert(finished.size == 4)
+      assert(jobs[0][:status] == :done)
+      assert(jobs[1][:status] == :done)
+      assert(jobs[2][:status] == :done)
+      assert(jobs[2][:action] == :sweep)
+      assert(jobs[3][:status] == :failed)
+      assert(jobs[3][:error].kind_of?(IBRubyException))
+      assert(jobs[0][:elapsed] >= 0)
+      files.each do |path|
+         assert(File.exist?(path))
+         File.delete(path)
+      end
+
+      assert_raise(IBRubyException) {queue.add(Object.new)}
+
+      queue = ServiceQueue.new('localhost', DB_USER_NAME, DB_PASSWORD, 1)
+      2.times {queue.sweep(DB_FILE)}
+      assert_raise(RuntimeError) {queue.run {|job| raise 'Stop.'}}
+      assert(queue.jobs[0][:status] == :done)
+      assert(queue.jobs[1][:status] == :pending)
+   end
+
+   def test07
+      sm = ServiceManager.new('localhost')
+      sm.connect(DB_USER_NAME, DB_PASSWORD)
+
+      s = Statistics.new(DB_FILE)
+      assert(s.data_pages)
+      assert(s.index_pages)
+      assert(s.record_versions == false)
+      s.record_versions = true
+      s.execute(sm)
+      assert(s.header[:page_size] > 0)
+      assert(s.header[:next_transaction] >= s.header[:oldest_transaction])
+      assert(s.tables['TEST'] != nil)
+      assert(s.tables['TEST'][:total_records] == 5)
+      assert(s.tables['TEST'][:total_versions] >= 0)
+      assert(s.tables['TEST'][:fill_distribution].size > 0)
+
+      s.data_pages      = false
+      s.index_pages     = false
+      s.record_versions = false
+      s.execute(sm)
+      assert(s.header[:oldest_active] != nil)
+      assert(s.tables.empty?)
+      sm.disconnect
+   end
+
+   def test08
+      tracer = ServiceManager.new('localhost')
+      tracer.connect(DB_USER_NAME, DB_PASSWORD)
+      control = ServiceManager.new('localhost')
+      control.connect(DB_USER_NAME, DB_PASSWORD)
+
+      config = "<database #{DB_FILE}>\nenabled true\nlog_statement_finish "\
+               "true\nprint_plan true\nprint_perf true\n</database>"
+      trace  = TraceSession.new(config, 'unit test')
+      events = []
+      thread = Thread.new do
+         trace.start(tracer) {|event| events << event}
+      end
+      sleep(0.1) while trace.id.nil? && thread.alive?
+
+      @database.connect(DB_USER_NAME, DB_PASSWORD) do |cxn|
+         cxn.execute_immediate('select * from test where id = 1000') {|row|}
+      end
+      sleep(2)
+      trace.suspend(control)
+      trace.resume(control)
+      trace.stop(control)
+      thread.join
+
+      finished = events.find do |event|
+         event[:event] =~ /EXECUTE_STATEMENT_FINISH/ &&
+         event[:sql] =~ /from test/
+      end
+      assert(finished != nil)
+      assert(finished[:attachment_id] > 0)
+      assert(finished[:plan] =~ /NATURAL/)
+      assert(finished[:records] == 1)
+      assert(finished[:tables]['TEST'][:natural] == 5)
+      assert_raise(IBRubyException) {TraceSession.new(config).stop(control)}
+
+      early  = TraceSession.new(config)
+      thread = Thread.new {early.start(tracer) {|event| break}}
+      sleep(0.1) while early.id.nil? && thread.alive?
+      @database.connect(DB_USER_NAME, DB_PASSWORD) do |cxn|
+         cxn.execute_immediate('select * from test where id = 1000') {|row|}
+      end
+      assert(thread.join(30) != nil)
+      assert(tracer.connected?)
+      tracer.disconnect
+      control.disconnect
+   end
 end
@@ -0,0 +1,94 @@
+#!/usr/bin/env ruby
+
+require 'TestSetup'
+require 'test/unit'
+#require 'rubygems'
+require 'ibruby'
+require 'thread'
+
+include IBRuby
+
+class ConnectionPoolTest < Test::Unit::TestCase
+   CURDIR  = "#{Dir.getwd}"
+   DB_FILE = "#{CURDIR}#{File::SEPARATOR}pool_unit_test.ib"
+   
+   def setup
+      puts "#{self.class.name} started." if TEST_LOGGING
+      if File::exist?(DB_FILE)
+         Database.new(DB_FILE).drop(DB_USER_NAME, DB_PASSWORD)
+      end
+      
+      @database = Database.create(DB_FILE, DB_USER_NAME, DB_PASSWORD)
+      @pools    = []
+   end
+   
+   def teardown
+      @pools.each {|pool| pool.shutdown}
+      @pools.clear
+      if File::exist?(DB_FILE)
+         Database.new(DB_FILE).drop(DB_USER_NAME, DB_PASSWORD)
+      end
+      puts "#{self.class.name} finished." if TEST_LOGGING
+   end
+   
+   def test01
+      pool = ConnectionPool.new(@database, DB_USER_NAME, DB_PASSWORD, nil,
+                                :min => 2, :max => 3, :timeout => 0.5)
+      @pools.push(pool)
+      assert(pool.size == 2)
+      assert(pool.statistics[:creations] == 2)
+      assert(pool.statistics[:idle] == 2)
+      
+      connections = []
+      3.times {connections.push(pool.checkout)}
+      assert(pool.size == 3)
+      assert(pool.statistics[:in_use] == 3)
+      connections.each {|cxn| assert(cxn.open?)}
+      
+      assert_raise(IBRubyException) {pool.checkout}
+      assert(pool.statistics[:timeouts] == 1)
+      assert(pool.statistics[:waits] == 1)
+      
+      cxn = connections.pop
+      waiter = Thread.new {pool.checkout}
+      sleep(0.1)
+      pool.checkin(cxn)
+      assert(waiter.value == cxn)
+      connections.push(cxn)
+      
+      connections.each {|entry| pool.checkin(entry)}
+      assert(pool.statistics[:in_use] == 0)
+      assert_raise(IBRubyException) {pool.checkin(cxn)}
+   end
+   
+   def test02
+      pool = ConnectionPool.new(@database, DB_USER_NAME, DB_PASSWORD, nil,
+                                :min => 0, :max => 2, :idle_timeout => 1,
+                                :check_after => 0)
+      @pools.push(pool)
+      assert(pool.size == 0)
+      
+      pool.connection do |cxn|
+         cxn.start_transaction
+         cxn.execute_immediate('SELECT COUNT(*) FROM RDB$DATABASE') do |row|
+            assert(row[0] == 1)
+         end
+      end
+      assert(pool.size == 1)
+      assert(pool.statistics[:idle] == 1)
+      
+      cxn = pool.checkout
+      assert(cxn.transactions.size == 0)
+      cxn.close
+      pool.checkin(cxn)
+      assert(pool.size == 0)
+      
+      pool.connection {|entry| entry}
+      sleep(1.5)
+      assert(pool.reap == 1)
+      assert(pool.size == 0)
+      
+      pool.shutdown
+      assert_raise(IBRubyException) {pool.checkout}
+   end
+end
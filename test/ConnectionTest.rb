@@ -4,6 +4,8 @@ require 'TestSetup'
 require 'test/unit'
 #require 'rubygems'
 require 'ib_lib'
+require 'ibmonitor'
+require 'thread'
 
 include IBRuby
 
@@ -108,4 +110,266 @@ class ConnectionTest < Test::Unit::TestCase
       assert(tx1.active? == false)
       assert(tx3.active? == false)
    end
+
+   def test05
+      @connections.push(@database.connect(DB_USER_NAME, DB_PASSWORD))
+      cxn = @connections[0]
+      cxn.execute_immediate('CREATE TABLE READ_TEST (ID INTEGER)')
+      cxn.execute_immediate('INSERT INTO READ_TEST VALUES (1)')
+
+      r = cxn.execute_immediate('SELECT * FROM READ_TEST')
+      assert(cxn.transactions.size == 1)
+      r.close
+
+      $IBRubySettings[:SHARED_READ_TRANSACTION] = true
+      3.times do |i|
+         total = 0
+         cxn.execute_immediate('SELECT COUNT(*) FROM READ_TEST') do |row|
+            total = row[0]
+         end
+         assert(total == i + 1)
+         assert(cxn.transactions.size == 0)
+         cxn.execute_immediate('INSERT INTO READ_TEST VALUES (1)')
+      end
+
+      $IBRubySettings[:READ_TRANSACTION_STATEMENTS] = 1
+      r = cxn.execute_immediate('SELECT * FROM READ_TEST')
+      assert(r.transaction.active?)
+      r.close
+      assert(r.transaction.active?)
+      cxn.execute_immediate('SELECT * FROM READ_TEST') {|row| }
+      $IBRubySettings[:READ_TRANSACTION_STATEMENTS] = 1000
+
+      r = cxn.execute_immediate("SELECT 'UPDATE' FROM READ_TEST")
+      assert(cxn.transactions.size == 0)
+      r.close
+      r = cxn.execute_immediate('WITH T AS (SELECT ID FROM READ_TEST) '\
+                                'SELECT * FROM T')
+      assert(cxn.transactions.size == 0)
+      r.close
+      r = cxn.execute_immediate('SELECT * FROM READ_TEST WITH LOCK')
+      assert(cxn.transactions.size == 1)
+      r.close
+
+      $IBRubySettings[:SHARED_READ_TRANSACTION] = false
+      r = cxn.execute_immediate('SELECT * FROM READ_TEST')
+      assert(cxn.transactions.size == 1)
+      r.close
+      assert(cxn.transactions.size == 0)
+
+      cxn.execute_immediate('DROP TABLE READ_TEST')
+   end
+
+   def test06
+      cxn = @database.connect(DB_USER_NAME, DB_PASSWORD)
+      @connections.push(cxn)
+      assert(cxn.statement_timeout == nil)
+      begin
+         cxn.statement_timeout = 30
+      rescue IBRubyException
+         # The client library doesn't support timeouts or cancellation.
+         assert_raise(IBRubyException) {cxn.cancel}
+         return
+      end
+      assert(cxn.statement_timeout == 30.0)
+      cxn.statement_timeout = nil
+      assert(cxn.statement_timeout == nil)
+
+      sql = 'SELECT A.RDB$RELATION_ID FROM RDB$RELATIONS A, RDB$RELATIONS B, '\
+            'RDB$RELATIONS C, RDB$RELATIONS D ORDER BY 1'
+      tx  = cxn.start_transaction
+      s   = Statement.new(cxn, tx, sql, 3)
+      assert_raise(IBRubyException) {s.execute(:timeout => 0.5)}
+      assert(cxn.statement_timeout == nil)
+      s.close
+
+      if RUBY_VERSION >= '1.9'
+         canceller = Thread.new {sleep(0.5); cxn.cancel}
+         assert_raise(IBRubyException) {cxn.execute(sql, tx)}
+         canceller.join
+      end
+      tx.rollback
+   end
+   
+   def test07
+      cxn = @database.connect(DB_USER_NAME, DB_PASSWORD)
+      @connections.push(cxn)
+      cxn.execute_immediate('CREATE PROCEDURE FIRE_EVENT (NAME VARCHAR(31)) '\
+                            'AS BEGIN POST_EVENT :NAME; END')
+      assert_raise(IBRubyException) {cxn.on_event('NO_BLOCK')}
+      
+      received = Queue.new
+      names    = (1..20).collect {|number| "EVENT_#{number}"}
+      listener = cxn.on_event(names, :OTHER) do |name, count|
+         received.push([name, count])
+      end
+      assert(listener.active?)
+      assert(listener.names.size == 21)
+      assert(listener.connection == cxn)
+      sleep(0.5)
+      
+      ['EVENT_2', 'EVENT_18', 'EVENT_18'].each do |name|
+         cxn.start_transaction do |tx|
+            tx.execute("EXECUTE PROCEDURE FIRE_EVENT('#{name}')")
+         end
+      end
+      events = {}
+      started = Time.now
+      while events.size < 2 && Time.now - started < 10
+         if received.empty?
+            sleep(0.1)
+         else
+            name, count = received.pop
+            events[name] = (events[name] || 0) + count
+         end
+      end
+      assert(events['EVENT_2'] == 1)
+      assert(events['EVENT_18'] >= 1)
+      
+      cxn.close
+      assert(listener.active? == false)
+   end
+   
+   def test08
+      3.times {@connections.push(@database.connect(DB_USER_NAME, DB_PASSWORD))}
+      @connections[0].execute_immediate('CREATE TABLE PARALLEL_TEST (ID '\
+                                        'INTEGER, NAME VARCHAR(20))')
+      
+      results = IBRuby.parallel(@connections) do |batch|
+         batch.add('INSERT INTO PARALLEL_TEST VALUES (?, ?)', [1, 'One'])
+         batch.add('SELECT COUNT(*) FROM RDB$RELATIONS')
+         batch.add("SELECT RDB$RELATION_NAME FROM RDB$RELATIONS WHERE "\
+                   "RDB$RELATION_NAME = 'PARALLEL_TEST'")
+         batch.add('SELECT 1, CAST(NULL AS INTEGER) FROM RDB$DATABASE')
+         assert(batch.size == 4)
+      end
+      assert(results.size == 4)
+      assert(results[0] == 1)
+      assert(results[1].size == 1 && results[1][0][0] > 0)
+      assert(results[2][0][0].strip == 'PARALLEL_TEST')
+      assert(results[3] == [[1, nil]])
+      assert(IBRuby.parallel(@connections[0]) {|batch|} == [])
+      
+      assert_raise(IBRubyException) do
+         IBRuby.parallel(@connections) do |batch|
+            batch.add('INSERT INTO PARALLEL_TEST VALUES (2, NULL)')
+            batch.add('SELECT * FROM NO_SUCH_TABLE')
+         end
+      end
+      @connections[0].start_transaction do |tx|
+         tx.execute('SELECT COUNT(*) FROM PARALLEL_TEST') do |row|
+            assert(row[0] == 1)
+         end
+      end
+   end
+   
+   def test09
+      cxn = @database.connect(DB_USER_NAME, DB_PASSWORD)
+      @connections.push(cxn)
+      cxn.execute_immediate('CREATE TABLE SCAN_TEST (ID INTEGER NOT NULL '\
+                            'PRIMARY KEY, NAME VARCHAR(20))')
+      cxn.start_transaction do |tx|
+         s = Statement.new(cxn, tx, 'INSERT INTO SCAN_TEST VALUES (?, ?)', 3)
+         1.upto(250) {|number| s.execute_for([number * 3, "Row #{number}"])}
+         s.close
+      end
+      
+      seen  = []
+      total = cxn.parallel_scan('SCAN_TEST', :partitions => 4,
+                                :batch_size => 40) do |rows|
+         assert(rows.size <= 40)
+         rows.each {|row| seen.push(row[0])}
+      end
+      assert(total == 250)
+      assert(seen.sort == (1..250).collect {|number| number * 3})
+      
+      count = cxn.parallel_scan('SCAN_TEST', :key => 'ID',
+                                :partitions => 1000) {|rows|}
+      assert(count == 250)
+      assert_raise(IBRubyException) {cxn.parallel_scan('SCAN_TEST') }
+      assert_raise(IBRubyException) do
+         cxn.parallel_scan('SCAN_TEST', :key => 'NAME') {|rows|}
+      end
+      assert_raise(IBRubyException) do
+         cxn.parallel_scan('SCAN_TEST; DROP TABLE X') {|rows|}
+      end
+      cxn.execute_immediate('DELETE FROM SCAN_TEST')
+      assert(cxn.parallel_scan('SCAN_TEST') {|rows| flunk} == 0)
+   end
+   
+   def test10
+      assert(IBRuby.settings.equal?($IBRubySettings))
+      if defined?(Ractor)
+         file     = DB_FILE
+         user     = DB_USER_NAME
+         password = DB_PASSWORD
+         worker   = Ractor.new(file, user, password) do |path, name, secret|
+            IBRuby.settings[:ALIAS_KEYS] = false
+            cxn   = IBRuby::Database.new(path).connect(name, secret)
+            total = 0
+            cxn.execute_immediate('SELECT 1 FROM RDB$DATABASE') do |row|
+               total = row[0]
+            end
+            cxn.close
+            [IBRuby.settings[:ALIAS_KEYS], total]
+         end
+         assert(worker.take == [false, 1])
+         assert($IBRubySettings[:ALIAS_KEYS] == true)
+
+         cxn = @database.connect(DB_USER_NAME, DB_PASSWORD)
+         @connections.push(cxn)
+         assert_raise(Ractor::Error, IBRubyException) do
+            Ractor.new(cxn) {|connection|}
+         end
+      end
+   end
+   
+   def test11
+      cxn = @database.connect(DB_USER_NAME, DB_PASSWORD)
+      @connections.push(cxn)
+      cxn.execute_immediate('CREATE TABLE IO_TEST (ID INTEGER NOT NULL '\
+                            'PRIMARY KEY, NAME VARCHAR(20))')
+      cxn.start_transaction do |tx|
+         s = Statement.new(cxn, tx, 'INSERT INTO IO_TEST VALUES (?, ?)', 3)
+         1.upto(20) {|number| s.execute_for([number, "Row #{number}"])}
+         s.close
+      end
+
+      stats = cxn.io_stats
+      assert(stats[:fetches] > 0)
+      assert(stats[:tables]['IO_TEST'][:inserts] == 20)
+
+      delta = cxn.measure do |connection|
+         connection.execute_immediate('SELECT * FROM IO_TEST WHERE NAME = '\
+                                      "'Row 5'") {|row|}
+         connection.execute_immediate('SELECT * FROM IO_TEST '\
+                                      'WHERE ID = 7') {|row|}
+      end
+      assert(delta[:fetches] > 0)
+      assert(delta[:tables]['IO_TEST'][:sequential_reads] == 20)
+      assert(delta[:tables]['IO_TEST'][:indexed_reads] == 1)
+      assert(delta[:tables]['IO_TEST'][:inserts] == nil)
+      assert_raise(IBRubyException) {cxn.measure}
+   end
+
+   def test12
+      cxn = @database.connect(DB_USER_NAME, DB_PASSWORD)
+      @connections.push(cxn)
+      tx = cxn.start_transaction
+
+      snapshot = cxn.monitor_snapshot
+      assert(snapshot.taken_at.kind_of?(Time))
+      assert(snapshot.attachments.size >= 1)
+      assert(snapshot.attachments.first.user == DB_USER_NAME.upcase)
+
+      oldest = snapshot.oldest_active_transaction
+      assert(oldest != nil)
+      assert(oldest.state == MonitorSnapshot::ACTIVE)
+      assert(snapshot.attachment_for(oldest) != nil)
+      assert(snapshot.io_stats_for(oldest).reads >= 0)
+      assert(snapshot.record_stats_for(oldest) != nil)
+      assert(snapshot.age(oldest) >= 0)
+      assert(snapshot.longest_running_statements(1).size <= 1)
+      tx.rollback
+   end
 end
@@ -56,4 +56,28 @@ class GeneratorTest < Test::Unit::TestCase
         trans.commit
       end
     end
+    
+    def test03
+      g = Generator::create('BLOCK_GEN', @connections[0])
+      r = g.reserve(100)
+      assert(r.first == 1)
+      assert(r.last == 100)
+      assert(g.last == 100)
+      
+      assert(g.cache_size == 0)
+      g.cache_size = 10
+      assert(g.cache_size == 10)
+      assert(g.next(1) == 101)
+      assert(g.last == 110)
+      9.times {|i| assert(g.next(1) == 102 + i)}
+      assert(g.next(1) == 111)
+      assert(g.statistics[:hits] == 9)
+      assert(g.statistics[:misses] == 2)
+      assert(g.statistics[:cached] == 9)
+      
+      assert(g.next(5) == 125)
+      assert(g.next(1) == 112)
+      
+      g.drop
+    end
 end
@@ -161,4 +161,33 @@ class ResultSetTest < Test::Unit::TestCase
          results.close if results != nil
       end
    end
+   
+   def test05
+      results = ResultSet.new(@connections[0], @transactions[0],
+                              "SELECT * FROM TEST_TABLE ORDER BY TESTID", 3)
+      assert(results.prefetch(2) == results)
+      assert(results.prefetch(2) == results)
+      total = 0
+      results.each {|row| total += row[0]}
+      assert(total == 150)
+      assert(results.exhausted?)
+      assert(results.prefetch == results)
+      results.close
+
+      results = ResultSet.new(@connections[0], @transactions[0],
+                              "SELECT * FROM TEST_TABLE ORDER BY TESTID", 3)
+      results.prefetch
+      assert(results.fetch[0] == 10)
+      results.close
+      
+      begin
+         results = ResultSet.new(@connections[0], @transactions[0],
+                                 "SELECT * FROM TEST_TABLE", 3)
+         results.prefetch(0)
+         assert(false, 'Started prefetch with an invalid row count.')
+      rescue IBRubyException
+      ensure
+         results.close
+      end
+   end
 end
@@ -132,4 +132,32 @@ class StatementTest < Test::Unit::TestCase
          cxn.execute_immediate('DROP TABLE STRING_TEST')
       end
    end
+   
+   def test04
+      @database.connect(DB_USER_NAME, DB_PASSWORD) do |cxn|
+         cxn.execute_immediate('CREATE TABLE PLAN_TEST (ID INTEGER NOT NULL '\
+                               'PRIMARY KEY, NAME VARCHAR(20))')
+         plan = cxn.explain('SELECT * FROM PLAN_TEST WHERE ID = 1')
+         assert(plan =~ /^PLAN /)
+         assert(plan.include?('INDEX'))
+         assert(cxn.explain('SELECT * FROM PLAN_TEST WHERE NAME = ?') =~
+                /NATURAL/)
+
+         cxn.start_transaction do |tx|
+            s = Statement.new(cxn, tx, 'SELECT * FROM PLAN_TEST WHERE ID = ?',
+                              3)
+            assert(s.plan == plan)
+            r = s.execute_for([1])
+            assert(r.plan.include?('INDEX'))
+            r.close
+            assert_raise(IBRubyException) {r.plan}
+            s.close
+
+            s = Statement.new(cxn, tx, 'DELETE FROM PLAN_TEST', 3)
+            assert(s.plan =~ /NATURAL/)
+            s.close
+         end
+         assert_raise(IBRubyException) {cxn.explain('SELECT * FROM NO_TABLE')}
+      end
+   end
 end
@@ -0,0 +1,91 @@
+#!/usr/bin/env ruby
+
+require 'TestSetup'
+require 'test/unit'
+#require 'rubygems'
+require 'ibruby'
+
+include IBRuby
+
+class TransactionOptionsTest < Test::Unit::TestCase
+   CURDIR  = "#{Dir.getwd}"
+   DB_FILE = "#{CURDIR}#{File::SEPARATOR}tx_options_unit_test.ib"
+   
+   def setup
+      puts "#{self.class.name} started." if TEST_LOGGING
+      if File::exist?(DB_FILE)
+         Database.new(DB_FILE).drop(DB_USER_NAME, DB_PASSWORD)
+      end
+      
+      @database     = Database.create(DB_FILE, DB_USER_NAME, DB_PASSWORD)
+      @connection   = @database.connect(DB_USER_NAME, DB_PASSWORD)
+      @transactions = []
+   end
+   
+   def teardown
+      @transactions.each do |tx|
+         tx.rollback if tx.active?
+      end
+      @transactions.clear
+      @connection.close if @connection.open?
+      if File::exist?(DB_FILE)
+         Database.new(DB_FILE).drop(DB_USER_NAME, DB_PASSWORD)
+      end
+      puts "#{self.class.name} finished." if TEST_LOGGING
+   end
+   
+   def test01
+      options = TransactionOptions.new
+      assert(options.tpb == [Transaction::TPB_VERSION_3,
+                             Transaction::TPB_CONCURRENCY,
+                             Transaction::TPB_WRITE,
+                             Transaction::TPB_WAIT].pack('C*'))
+      
+      options = TransactionOptions.new(:isolation => :read_committed,
+                                       :read_only => true,
+                                       :wait      => false)
+      assert(options.tpb == [Transaction::TPB_VERSION_3,
+                             Transaction::TPB_READ_COMMITTED,
+                             Transaction::TPB_REC_VERSION,
+                             Transaction::TPB_READ,
+                             Transaction::TPB_NO_WAIT].pack('C*'))
+      assert(options.settings[:read_only])
+      assert(options.settings.frozen?)
+      
+      options = TransactionOptions.new(:reserve => {'RDB$DATABASE' => :shared_read})
+      assert(options.tpb == [Transaction::TPB_VERSION_3,
+                             Transaction::TPB_CONCURRENCY,
+                             Transaction::TPB_WRITE,
+                             Transaction::TPB_WAIT,
+                             Transaction::TPB_LOCK_READ,
+                             12].pack('C*') + 'RDB$DATABASE' +
+                            [Transaction::TPB_SHARED].pack('C'))
+      
+      assert_raise(IBRubyException) do
+         TransactionOptions.new(:isolation => :lalala)
+      end
+      assert_raise(IBRubyException) do
+         TransactionOptions.new(:reserve => {'RDB$DATABASE' => :lalala})
+      end
+   end
+   
+   def test02
+      options = TransactionOptions.new(:isolation => :read_committed,
+                                       :read_only => true)
+      
+      @transactions.push(Transaction.new(@connection, options))
+      @transactions.push(@connection.start_transaction(options))
+      @transactions.push(Transaction.create(@connection, options))
+      @transactions.each do |tx|
+         assert(tx.active?)
+         total = 0
+         tx.execute('SELECT * FROM RDB$DATABASE') {|row| total += 1}
+         assert(total == 1)
+         assert_raise(IBRubyException) do
+            tx.execute("UPDATE RDB$EXCEPTIONS SET RDB$MESSAGE = 'WoooHooo' "\
+                       "WHERE RDB$EXCEPTION_NAME = 'Lalala'")
+         end
+         tx.commit
+      end
+   end
+end
@@ -4,6 +4,7 @@ require 'TestSetup'
 require 'test/unit'
 #require 'rubygems'
 require 'ibruby'
+require 'thread'
 
 include IBRuby
 
@@ -109,4 +110,187 @@ class TransactionTest < Test::Unit::TestCase
       end
       assert(total == 113)
    end
+   
+   def test03
+      @connections[0].execute_immediate('CREATE TABLE TX_TEST (ID INTEGER)')
+      @transactions.push(Transaction.new(@connections[0]))
+      tx = @transactions[0]
+      
+      tx.execute('INSERT INTO TX_TEST VALUES (1)')
+      tx.commit_retaining
+      assert(tx.active?)
+      tx.execute('INSERT INTO TX_TEST VALUES (2)')
+      tx.rollback_retaining
+      assert(tx.active?)
+      total = 0
+      @connections[1].execute_immediate('SELECT COUNT(*) FROM TX_TEST') do |row|
+         total = row[0]
+      end
+      assert(total == 1)
+      
+      tx.auto_commit_every(:rows => 2)
+      s = Statement.new(@connections[0], tx, 'INSERT INTO TX_TEST VALUES (?)', 3)
+      3.times {|i| s.execute_for([i + 10])}
+      s.close
+      @connections[1].execute_immediate('SELECT COUNT(*) FROM TX_TEST') do |row|
+         total = row[0]
+      end
+      assert(total == 3)
+      tx.auto_commit_every(nil)
+      tx.commit
+   end
+   
+   def test04
+      @connections[0].execute_immediate('CREATE TABLE TX_TEST (ID INTEGER)')
+      @transactions.push(Transaction.new(@connections[0]))
+      tx = @transactions[0]
+      
+      tx.execute('INSERT INTO TX_TEST VALUES (1)')
+      tx.savepoint('SP1')
+      tx.execute('INSERT INTO TX_TEST VALUES (2)')
+      tx.rollback_to('SP1')
+      tx.execute('INSERT INTO TX_TEST VALUES (3)')
+      tx.release_savepoint('SP1')
+      
+      [4, 5, 6].each do |id|
+         begin
+            tx.savepoint('ROW_SP') do
+               tx.execute("INSERT INTO TX_TEST VALUES (#{id})")
+               raise StandardError.new('Bad row.') if id == 5
+            end
+         rescue StandardError
+         end
+      end
+      assert(tx.active?)
+      
+      total = 0
+      tx.execute('SELECT SUM(ID) FROM TX_TEST') do |row|
+         total = row[0]
+      end
+      assert(total == 14)
+      
+      assert_raise(IBRubyException) {tx.savepoint('BAD NAME')}
+      tx.commit
+      assert_raise(IBRubyException) {tx.savepoint('SP2')}
+   end
+   
+   def test05
+      @connections[0].execute_immediate('CREATE TABLE TX_TEST (ID INTEGER)')
+      @connections[0].execute_immediate('INSERT INTO TX_TEST VALUES (1)')
+      @transactions.push(Transaction.new(@connections[0]))
+      options = TransactionOptions.new(:wait => false)
+      holder  = @transactions[0]
+      holder.execute('UPDATE TX_TEST SET ID = 2')
+      
+      error = nil
+      begin
+         @connections[1].with_retry(:attempts => 1, :options => options) do |tx|
+            tx.execute('UPDATE TX_TEST SET ID = 3')
+         end
+      rescue IBRubyException => error
+      end
+      assert(error.kind_of?(ConflictError))
+      assert(error.retryable?)
+      assert(error.gds_codes.size > 0)
+      assert(error.db_code == error.gds_codes[0])
+      assert(@connections[1].transactions.size == 0)
+      
+      count = 0
+      @connections[1].with_retry(:attempts => 3, :backoff => 0.01,
+                                 :options => options) do |tx|
+         count += 1
+         holder.commit if count == 2
+         tx.execute('UPDATE TX_TEST SET ID = 3')
+      end
+      assert(count == 3)
+      
+      error = nil
+      begin
+         @connections[1].with_retry {|tx| tx.execute('SELECT * FROM NO_TABLE')}
+      rescue IBRubyException => error
+      end
+      assert(error.retryable? == false)
+      assert(error.sql_code != 0)
+      assert(error.message.include?("SQL Code = #{error.sql_code}"))
+      assert(error.to_s == error.message)
+   end
+   
+   def test06
+      @transactions.push(@connections[0].start_transaction)
+      @transactions.push(@connections[1].start_transaction)
+      first, second = @transactions
+      assert(first.id < second.id)
+      assert(first.started.kind_of?(Time))
+      # Only this test's transactions are checked, others may be open.
+      assert(Transaction.longest_active & @transactions == [first, second])
+      assert(Transaction.longest_active(1).size == 1)
+      
+      markers = @connections[2].transaction_markers
+      assert(markers[:oldest_active] <= first.id)
+      assert(markers[:next_transaction] > second.id)
+      assert(markers[:oldest_transaction] <= markers[:oldest_active])
+      assert(@database.transaction_markers(DB_USER_NAME, DB_PASSWORD).size == 4)
+      
+      alerts  = Queue.new
+      monitor = GapMonitor.new(@database, DB_USER_NAME, DB_PASSWORD,
+                               :interval => 0.1, :threshold => 1) do |*alert|
+         alerts.push(alert)
+      end
+      deadline = Time.now + 10
+      sleep(0.1) while alerts.empty? && Time.now < deadline
+      monitor.stop
+      assert(monitor.active? == false)
+      assert(!alerts.empty?)
+      gap, found, transactions = alerts.pop
+      assert(gap >= 1)
+      assert(gap == found[:next_transaction] - found[:oldest_active])
+      assert((transactions & @transactions).first == first)
+      
+      second.commit
+      assert(Transaction.longest_active & @transactions == [first])
+      first.rollback
+      assert(Transaction.longest_active & @transactions == [])
+      assert(first.id == nil)
+      assert(first.started == nil)
+      assert_raise(IBRubyException) do
+         GapMonitor.new(@database, DB_USER_NAME, DB_PASSWORD,
+                        :from => :next_transaction) {}
+      end
+   end
+   
+   def test07
+      @connections[0].execute_immediate('CREATE TABLE TX_TEST (ID INTEGER)')
+      @transactions.push(Transaction.new(@connections[0]))
+      tx = @transactions[0]
+      tx.auto_commit_every(:rows => 1)
+      
+      error = nil
+      begin
+         tx.savepoint('ROW_SP') do
+            tx.execute('INSERT INTO TX_TEST VALUES (1)')
+            tx.execute('INSERT INTO TX_TEST VALUES (2)')
+            raise StandardError.new('Bad row.')
+         end
+      rescue StandardError => error
+      end
+      assert(error.message == 'Bad row.')
+      
+      [1, 2].each do |value|
+         tx.savepoint('ROW_SP') do
+            tx.execute("INSERT INTO TX_TEST VALUES (#{value * 10})")
+            break
+         end
+      end
+      
+      tx.savepoint('ROW_SP') do
+         tx.execute('INSERT INTO TX_TEST VALUES (3)')
+      end
+      tx.execute('INSERT INTO TX_TEST VALUES (4)')
+      total = 0
+      @connections[1].execute_immediate('SELECT SUM(ID) FROM TX_TEST') do |row|
+         total = row[0]
+      end
+      assert(total == 7)
+      tx.commit
+   end
 end